@@ -0,0 +1,108 @@
+// bench/bench_idle_store.cpp
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <queue>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include "connection.h"
+#include "idle_connection_store.h"
+#include "logger.h"
+
+/**
+ * @brief acquire/release throughput of the idle connection store
+ *
+ * Every thread repeatedly pops an idle connection and pushes it back,
+ * which is the shape of getConnection()/releaseConnection() on a warm pool.
+ * The old design (one std::queue behind one std::mutex) is measured as baseline.
+ *
+ * Connection objects are only initialized (mysql_init), no server is needed.
+ */
+
+const size_t CONNECTION_COUNT = 64;
+const size_t OPERATIONS_PER_THREAD = 200000;
+
+// the pre-sharding design, kept here as reference
+class SingleQueueStore {
+public:
+    void push(Connection* connection) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queue.push(connection);
+    }
+
+    Connection* pop() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_queue.empty()) {
+            return nullptr;
+        }
+        Connection* connection = m_queue.front();
+        m_queue.pop();
+        return connection;
+    }
+
+private:
+    std::mutex m_mutex;
+    std::queue<Connection*> m_queue;
+};
+
+template <typename Store>
+double runCycles(Store& store, size_t threadCount) {
+    std::atomic<bool> start{false};
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < threadCount; t++) {
+        threads.emplace_back([&store, &start]() {
+            while (!start.load()) {
+                std::this_thread::yield();
+            }
+            for (size_t i = 0; i < OPERATIONS_PER_THREAD; i++) {
+                Connection* connection = store.pop();
+                if (connection) {
+                    store.push(connection);
+                }
+            }
+        });
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    start = true;
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    return (threadCount * OPERATIONS_PER_THREAD) / elapsed;
+}
+
+int main() {
+    Logger::getInstance().init("", LogLevel::ERROR, true);
+
+    std::vector<std::unique_ptr<Connection>> connections;
+    for (size_t i = 0; i < CONNECTION_COUNT; i++) {
+        connections.emplace_back(new Connection("127.0.0.1", "bench", "bench", "bench"));
+    }
+
+    size_t maxThreads = std::max(1u, std::thread::hardware_concurrency()) * 2;
+    std::cout << std::left << std::setw(10) << "threads"
+              << std::setw(22) << "single queue ops/s"
+              << std::setw(22) << "sharded LIFO ops/s"
+              << std::setw(22) << "sharded FIFO ops/s" << std::endl;
+
+    for (size_t threadCount = 1; threadCount <= maxThreads; threadCount *= 2) {
+        SingleQueueStore single;
+        IdleConnectionStore lifo(0, IdleOrder::LIFO);
+        IdleConnectionStore fifo(0, IdleOrder::FIFO);
+        for (auto& connection : connections) {
+            single.push(connection.get());
+            lifo.push(connection.get());
+            fifo.push(connection.get());
+        }
+
+        std::cout << std::left << std::setw(10) << threadCount
+                  << std::setw(22) << std::fixed << std::setprecision(0) << runCycles(single, threadCount)
+                  << std::setw(22) << runCycles(lifo, threadCount)
+                  << std::setw(22) << runCycles(fifo, threadCount) << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,56 @@
+// bench/bench_load_balancer.cpp
+#include <iostream>
+#include <vector>
+#include <utility>
+#include "bench_util.h"
+#include "load_balancer.h"
+#include "logger.h"
+
+/**
+ * @brief backend selection cost of every LoadBalancer strategy
+ *
+ * Four backends with different weights. selectBackend() is what the pool calls,
+ * getNextDatabase() additionally copies the DBConfig. No server is needed.
+ */
+
+const size_t SELECTIONS_PER_THREAD = 500000;
+
+std::vector<DBConfig> makeBackends() {
+    std::vector<DBConfig> configs;
+    for (unsigned int i = 0; i < 4; i++) {
+        configs.emplace_back("10.0.0." + std::to_string(i + 1), "bench", "bench", "bench", 3306, i + 1);
+    }
+    return configs;
+}
+
+int main() {
+    Logger::getInstance().init("", LogLevel::ERROR, true);
+
+    const std::vector<std::pair<const char*, LoadBalanceStrategy>> strategies = {
+        {"RANDOM", LoadBalanceStrategy::RANDOM},
+        {"ROUND_ROBIN", LoadBalanceStrategy::ROUND_ROBIN},
+        {"WEIGHTED", LoadBalanceStrategy::WEIGHTED},
+        {"LEAST_CONNECTIONS", LoadBalanceStrategy::LEAST_CONNECTIONS},
+        {"PEAK_EWMA", LoadBalanceStrategy::PEAK_EWMA},
+        {"POWER_OF_TWO", LoadBalanceStrategy::POWER_OF_TWO}
+    };
+
+    for (const auto& strategy : strategies) {
+        LoadBalancer balancer;
+        balancer.init(makeBackends(), strategy.second);
+
+        printHeader(std::string(strategy.first) + " selectBackend", {"threads", "ops/s", "ns/op"});
+        for (size_t threadCount : threadCounts()) {
+            BenchResult result = runThreads(threadCount, scaled(SELECTIONS_PER_THREAD), [&balancer](size_t, size_t) {
+                doNotOptimize(balancer.selectBackend()->id);
+            });
+            printRow(std::to_string(threadCount), result);
+        }
+
+        BenchResult copied = runLoop(scaled(SELECTIONS_PER_THREAD), [&balancer](size_t) {
+            doNotOptimize(balancer.getNextDatabase().port);
+        });
+        printRow("getNextDatabase (1)", copied);
+    }
+    return 0;
+}
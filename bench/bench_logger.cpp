@@ -0,0 +1,56 @@
+// bench/bench_logger.cpp
+#include <iostream>
+#include <cstdio>
+#include <string>
+#include "bench_util.h"
+#include "logger.h"
+
+/**
+ * @brief cost of a log call on the calling thread
+ *
+ * 1. a message below the log level, which the pool's hot paths emit all the time
+ * 2. an enabled message written by the background thread (async) and by the caller (sync)
+ *
+ * Enabled messages go to a file in the working directory, which is removed afterwards.
+ */
+
+const size_t DISABLED_CALLS_PER_THREAD = 5000000;
+const size_t ENABLED_CALLS_PER_THREAD = 100000;
+const char* const LOG_FILE = "bench_logger.log";
+
+void benchEnabled(const char* mode, bool async) {
+    LoggerOptions options;
+    options.async = async;
+    options.bufferCapacity = 65536;
+    Logger::getInstance().init(LOG_FILE, LogLevel::INFO, false, options);
+
+    printHeader(std::string("enabled LOG_INFO, ") + mode, {"threads", "calls/s", "ns/call"});
+    for (size_t threadCount : threadCounts()) {
+        BenchResult result = runThreads(threadCount, scaled(ENABLED_CALLS_PER_THREAD), [](size_t thread, size_t i) {
+            LOG_INFO("connection " + std::to_string(thread) + " released after query " + std::to_string(i));
+        });
+        // the async writer has to catch up before the next round starts
+        Logger::getInstance().flush();
+        printRow(std::to_string(threadCount), result);
+    }
+}
+
+int main() {
+    Logger::getInstance().init("", LogLevel::INFO, false);
+
+    printHeader("disabled LOG_DEBUG", {"threads", "calls/s", "ns/call"});
+    for (size_t threadCount : threadCounts()) {
+        BenchResult result = runThreads(threadCount, scaled(DISABLED_CALLS_PER_THREAD), [](size_t thread, size_t i) {
+            // the message is never built, the level check is the whole cost
+            LOG_DEBUG("connection " + std::to_string(thread) + " validated " + std::to_string(i));
+        });
+        printRow(std::to_string(threadCount), result);
+    }
+
+    benchEnabled("async", true);
+    benchEnabled("sync", false);
+
+    Logger::getInstance().init("", LogLevel::ERROR, true);
+    std::remove(LOG_FILE);
+    return 0;
+}
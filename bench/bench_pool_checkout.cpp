@@ -0,0 +1,122 @@
+// bench/bench_pool_checkout.cpp
+#include <iostream>
+#include <atomic>
+#include <thread>
+#include <stdexcept>
+#include "bench_util.h"
+#include "fake_mysql_server.h"
+#include "connection_pool.h"
+#include "pool_config.h"
+#include "logger.h"
+
+/**
+ * @brief checkout throughput of ConnectionPool against the in-process fake server
+ *
+ * 1. getConnection()/releaseConnection() on a warm pool with one connection per thread,
+ *    which measures the pool's own bookkeeping, with and without the thread-local cache
+ * 2. acquire() plus a query with server latency and fewer connections than threads,
+ *    which measures waiting for a connection
+ * 3. queries while the server drops connections and fails queries, which exercises
+ *    reconnects and error paths
+ */
+
+const size_t CHECKOUTS_PER_THREAD = 20000;
+const size_t QUERIES_PER_THREAD = 500;
+
+PoolConfig makeConfig(unsigned int maxConnections) {
+    PoolConfig config;
+    config.setConnectionLimits(maxConnections, maxConnections, maxConnections);
+    config.connectionTimeout = 10000;
+    config.reconnectInterval = 10;
+    return config;
+}
+
+void benchCheckout(FakeMySQLServer& server, bool threadLocalCache) {
+    printHeader(std::string("getConnection/releaseConnection") + (threadLocalCache ? ", thread-local cache" : ""),
+                {"threads", "ops/s", "ns/op"});
+    for (size_t threadCount : threadCounts()) {
+        ConnectionPool pool("bench-checkout");
+        PoolConfig config = makeConfig(static_cast<unsigned int>(threadCount));
+        config.threadLocalCache = threadLocalCache;
+        pool.initWithSingleDatabase(config, "127.0.0.1", "bench", "bench", "bench", server.getPort());
+        BenchResult result = runThreads(threadCount, scaled(CHECKOUTS_PER_THREAD), [&pool](size_t, size_t) {
+            ConnectionPtr connection = pool.getConnection();
+            pool.releaseConnection(connection);
+        });
+        printRow(std::to_string(threadCount), result);
+        pool.shutdown();
+    }
+}
+
+void benchContention(FakeMySQLServer& server) {
+    const unsigned int latencyMicros = 200;
+    const unsigned int connections = 4;
+    server.setQueryLatency(latencyMicros);
+    printHeader("acquire + query, " + std::to_string(connections) + " connections, " +
+                std::to_string(latencyMicros) + "us server latency", {"threads", "queries/s", "ns/query"});
+    for (size_t threadCount : threadCounts()) {
+        ConnectionPool pool("bench-contention");
+        pool.initWithSingleDatabase(makeConfig(connections), "127.0.0.1", "bench", "bench", "bench", server.getPort());
+        BenchResult result = runThreads(threadCount, scaled(QUERIES_PER_THREAD), [&pool](size_t, size_t) {
+            PooledConnection connection = pool.acquire();
+            doNotOptimize(connection->executeQuery("SELECT id, name, price FROM t")->getRowCount());
+        });
+        printRow(std::to_string(threadCount), result);
+        pool.shutdown();
+    }
+    server.setQueryLatency(0);
+}
+
+void benchFaults(FakeMySQLServer& server) {
+    server.setDropRate(0.01);
+    server.setErrorRate(0.01);
+    size_t threadCount = std::max(1u, std::thread::hardware_concurrency());
+    std::cout << "\n== queries with 1% dropped connections and 1% query errors, "
+              << threadCount << " threads ==" << std::endl;
+
+    ConnectionPool pool("bench-faults");
+    pool.initWithSingleDatabase(makeConfig(static_cast<unsigned int>(threadCount)),
+                                "127.0.0.1", "bench", "bench", "bench", server.getPort());
+    std::atomic<size_t> failures{0};
+    uint64_t injectedBefore = server.getInjectedFailures();
+    BenchResult result = runThreads(threadCount, scaled(QUERIES_PER_THREAD * 4), [&pool, &failures](size_t, size_t) {
+        try {
+            PooledConnection connection = pool.acquire();
+            doNotOptimize(connection->executeQuery("SELECT id FROM t")->getRowCount());
+        } catch (const std::exception&) {
+            failures++;
+        }
+    });
+    PerformanceStats stats = pool.getPerformanceMonitor().getStats();
+    pool.shutdown();
+    server.setDropRate(0);
+    server.setErrorRate(0);
+
+    std::cout << "queries/s: " << std::fixed << std::setprecision(0) << result.opsPerSecond()
+              << ", failed for the caller: " << failures.load()
+              << ", injected: " << server.getInjectedFailures() - injectedBefore
+              << ", reconnects: " << stats.successfulReconnections << "/" << stats.reconnectionAttempts
+              << ", connections accepted by the server: " << server.getConnectionCount() << std::endl;
+}
+
+int main() {
+    Logger::getInstance().init("", LogLevel::FATAL, true);
+
+    FakeServerOptions options;
+    options.resultRows = 10;
+    FakeMySQLServer server(options);
+    server.start();
+    std::cout << "fake server on 127.0.0.1:" << server.getPort() << std::endl;
+
+    try {
+        benchCheckout(server, false);
+        benchCheckout(server, true);
+        benchContention(server);
+        benchFaults(server);
+    } catch (const std::exception& e) {
+        std::cerr << "benchmark failed: " << e.what() << std::endl;
+        return 1;
+    }
+    server.stop();
+    return 0;
+}
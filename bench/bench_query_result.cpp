@@ -0,0 +1,136 @@
+// bench/bench_query_result.cpp
+#include <iostream>
+#include <memory>
+#include <string>
+#include <tuple>
+#include "bench_util.h"
+#include "fake_mysql_server.h"
+#include "connection.h"
+#include "query_result.h"
+#include "typed_rows.h"
+#include "logger.h"
+
+/**
+ * @brief cost of reading a result: per-cell getters, zero-copy views and typed decoding
+ *
+ * 1. an in-memory result (ResultRows), which isolates the decoding from the network
+ * 2. the same columns fetched from the fake server with mysql_store_result and
+ *    mysql_use_result, which adds the client library's packet parsing
+ */
+
+const size_t MEMORY_ROWS = 100000;
+const unsigned int SERVER_ROWS = 10000;
+const size_t SERVER_QUERIES = 20;
+
+typedef std::tuple<long long, FieldView, double> OrderRow;
+
+ResultRowsPtr makeRows(size_t count) {
+    auto rows = std::make_shared<ResultRows>();
+    rows->fieldNames = {"id", "name", "price"};
+    rows->fieldTypes = {MYSQL_TYPE_LONGLONG, MYSQL_TYPE_VAR_STRING, MYSQL_TYPE_DOUBLE};
+    for (size_t i = 1; i <= count; i++) {
+        std::string id = std::to_string(i);
+        std::string name = "row-" + std::to_string(i);
+        std::string price = std::to_string(i) + ".5";
+        rows->appendValue(id.data(), static_cast<unsigned long>(id.size()));
+        rows->appendValue(name.data(), static_cast<unsigned long>(name.size()));
+        rows->appendValue(price.data(), static_cast<unsigned long>(price.size()));
+        rows->rowCount++;
+    }
+    return rows;
+}
+
+double sumWithGetters(QueryResult& result) {
+    double total = 0;
+    while (result.next()) {
+        total += result.getLong(0) + result.getDouble(2) + result.getString(1).size();
+    }
+    return total;
+}
+
+double sumWithNames(QueryResult& result) {
+    double total = 0;
+    while (result.next()) {
+        total += result.getLong("id") + result.getDouble("price") + result.getString("name").size();
+    }
+    return total;
+}
+
+double sumWithViews(QueryResult& result) {
+    double total = 0;
+    long long id = 0;
+    double price = 0;
+    while (result.next()) {
+        result.tryGetLong(0, id);
+        result.tryGetDouble(2, price);
+        total += id + price + result.getView(1).size();
+    }
+    return total;
+}
+
+double sumTyped(QueryResult& result) {
+    double total = 0;
+    RowDecoder<OrderRow> decoder(result);
+    TypedRows<OrderRow> batch;
+    while (decoder.fetch(result, batch, 1024) > 0) {
+        for (const auto& row : batch) {
+            total += std::get<0>(row) + std::get<2>(row) + std::get<1>(row).size();
+        }
+        batch.clear();
+    }
+    return total;
+}
+
+template <typename Sum>
+void benchMemory(const char* name, const ResultRowsPtr& rows, Sum sum) {
+    const size_t rounds = scaled(20);
+    BenchResult result = runLoop(rounds, [&rows, &sum](size_t) {
+        QueryResult queryResult(rows);
+        doNotOptimize(sum(queryResult));
+    });
+    result.operations = rounds * rows->rowCount;
+    printRow(name, result);
+}
+
+template <typename Sum>
+void benchServer(const char* name, Connection& connection, bool streaming, Sum sum) {
+    const size_t rounds = scaled(SERVER_QUERIES);
+    BenchResult result = runLoop(rounds, [&connection, streaming, &sum](size_t) {
+        QueryResultPtr queryResult = streaming ? connection.executeStreamingQuery("SELECT id, name, price FROM t")
+                                               : connection.executeQuery("SELECT id, name, price FROM t");
+        doNotOptimize(sum(*queryResult));
+    });
+    result.operations = rounds * SERVER_ROWS;
+    printRow(name, result);
+}
+
+int main() {
+    Logger::getInstance().init("", LogLevel::ERROR, true);
+
+    ResultRowsPtr rows = makeRows(scaled(MEMORY_ROWS));
+    printHeader("in-memory result, " + std::to_string(rows->rowCount) + " rows", {"reader", "rows/s", "ns/row"});
+    benchMemory("getters by index", rows, sumWithGetters);
+    benchMemory("getters by name", rows, sumWithNames);
+    benchMemory("views, tryGet", rows, sumWithViews);
+    benchMemory("typed, 1024 batch", rows, sumTyped);
+
+    FakeServerOptions options;
+    options.resultRows = SERVER_ROWS;
+    FakeMySQLServer server(options);
+    server.start();
+    Connection connection("127.0.0.1", "bench", "bench", "bench", server.getPort());
+    if (!connection.connect()) {
+        std::cerr << "cannot connect to the fake server" << std::endl;
+        return 1;
+    }
+
+    printHeader("fake server, " + std::to_string(SERVER_ROWS) + " rows per query", {"reader", "rows/s", "ns/row"});
+    benchServer("stored, getters", connection, false, sumWithGetters);
+    benchServer("stored, typed", connection, false, sumTyped);
+    benchServer("streamed, getters", connection, true, sumWithGetters);
+    benchServer("streamed, typed", connection, true, sumTyped);
+
+    connection.close();
+    server.stop();
+    return 0;
+}
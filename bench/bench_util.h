@@ -0,0 +1,120 @@
+// bench/bench_util.h
+#ifndef BENCH_UTIL_H
+#define BENCH_UTIL_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief helpers shared by the benchmark programs
+ *
+ * Every benchmark runs a fixed amount of work per thread, releases all threads
+ * at once and reports operations per second and nanoseconds per operation.
+ * BENCH_SCALE (environment, default 1.0) scales the amount of work, so CI can
+ * run a short smoke pass and a workstation a long one with the same binaries.
+ */
+
+inline double benchScale() {
+    const char* value = std::getenv("BENCH_SCALE");
+    double scale = value ? std::atof(value) : 1.0;
+    return scale > 0 ? scale : 1.0;
+}
+
+// iterations scaled by BENCH_SCALE, never below 1
+inline size_t scaled(size_t iterations) {
+    return std::max<size_t>(1, static_cast<size_t>(iterations * benchScale()));
+}
+
+// thread counts 1, 2, 4, ... up to twice the hardware threads
+inline std::vector<size_t> threadCounts() {
+    size_t maxThreads = std::max(1u, std::thread::hardware_concurrency()) * 2;
+    std::vector<size_t> counts;
+    for (size_t count = 1; count <= maxThreads; count *= 2) {
+        counts.push_back(count);
+    }
+    return counts;
+}
+
+// keeps the compiler from dropping a computed value
+template <typename T>
+inline void doNotOptimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+struct BenchResult {
+    size_t operations = 0;
+    double seconds = 0;
+
+    double opsPerSecond() const { return seconds > 0 ? operations / seconds : 0; }
+    double nanosPerOp() const { return operations > 0 ? seconds * 1e9 / operations : 0; }
+};
+
+/**
+ * @brief run body(threadIndex, iteration) iterationsPerThread times on each of threadCount threads
+ */
+template <typename Body>
+BenchResult runThreads(size_t threadCount, size_t iterationsPerThread, Body body) {
+    std::atomic<bool> start{false};
+    std::atomic<size_t> ready{0};
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < threadCount; t++) {
+        threads.emplace_back([&, t]() {
+            ready++;
+            while (!start.load()) {
+                std::this_thread::yield();
+            }
+            for (size_t i = 0; i < iterationsPerThread; i++) {
+                body(t, i);
+            }
+        });
+    }
+    while (ready.load() < threadCount) {
+        std::this_thread::yield();
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    start = true;
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    BenchResult result;
+    result.operations = threadCount * iterationsPerThread;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    return result;
+}
+
+// single-threaded variant
+template <typename Body>
+BenchResult runLoop(size_t iterations, Body body) {
+    auto begin = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; i++) {
+        body(i);
+    }
+    BenchResult result;
+    result.operations = iterations;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    return result;
+}
+
+inline void printHeader(const std::string& title, const std::vector<std::string>& columns) {
+    std::cout << "\n== " << title << " ==" << std::endl;
+    for (const auto& column : columns) {
+        std::cout << std::left << std::setw(22) << column;
+    }
+    std::cout << std::endl;
+}
+
+inline void printRow(const std::string& name, const BenchResult& result) {
+    std::cout << std::left << std::setw(22) << name
+              << std::setw(22) << std::fixed << std::setprecision(0) << result.opsPerSecond()
+              << std::setw(22) << std::setprecision(1) << result.nanosPerOp() << std::endl;
+}
+
+#endif // BENCH_UTIL_H
@@ -0,0 +1,471 @@
+// bench/fake_mysql_server.cpp
+#include "fake_mysql_server.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+// capability flags of the protocol, see include/mysql_com.h
+const uint32_t CLIENT_LONG_PASSWORD = 0x00000001;
+const uint32_t CLIENT_FOUND_ROWS = 0x00000002;
+const uint32_t CLIENT_LONG_FLAG = 0x00000004;
+const uint32_t CLIENT_CONNECT_WITH_DB = 0x00000008;
+const uint32_t CLIENT_PROTOCOL_41 = 0x00000200;
+const uint32_t CLIENT_TRANSACTIONS = 0x00002000;
+const uint32_t CLIENT_SECURE_CONNECTION = 0x00008000;
+const uint32_t CLIENT_PLUGIN_AUTH = 0x00080000;
+const uint32_t SERVER_CAPABILITIES = CLIENT_LONG_PASSWORD | CLIENT_FOUND_ROWS | CLIENT_LONG_FLAG |
+                                     CLIENT_CONNECT_WITH_DB | CLIENT_PROTOCOL_41 | CLIENT_TRANSACTIONS |
+                                     CLIENT_SECURE_CONNECTION | CLIENT_PLUGIN_AUTH;
+
+const uint16_t SERVER_STATUS_AUTOCOMMIT = 0x0002;
+const uint8_t CHARSET_UTF8MB4 = 45;
+const uint8_t CHARSET_BINARY = 63;
+
+const uint8_t COM_QUIT = 0x01;
+const uint8_t COM_INIT_DB = 0x02;
+const uint8_t COM_QUERY = 0x03;
+const uint8_t COM_PING = 0x0e;
+const uint8_t COM_STMT_PREPARE = 0x16;
+const uint8_t COM_SET_OPTION = 0x1b;
+const uint8_t COM_RESET_CONNECTION = 0x1f;
+
+const uint8_t TYPE_DOUBLE = 5;
+const uint8_t TYPE_LONGLONG = 8;
+const uint8_t TYPE_VAR_STRING = 253;
+
+const uint16_t ER_UNKNOWN_ERROR = 1105;
+const uint16_t ER_NOT_SUPPORTED_YET = 1235;
+const uint16_t ER_UNKNOWN_COM_ERROR = 1047;
+
+// a packet of the command phase, the sequence id restarts at 0 with every command
+class Packet {
+public:
+    void byte(uint8_t value) { m_data.push_back(static_cast<char>(value)); }
+
+    void int2(uint16_t value) {
+        byte(value & 0xff);
+        byte(value >> 8);
+    }
+
+    void int4(uint32_t value) {
+        int2(value & 0xffff);
+        int2(value >> 16);
+    }
+
+    void lenenc(uint64_t value) {
+        if (value < 251) {
+            byte(static_cast<uint8_t>(value));
+        } else if (value < (1 << 16)) {
+            byte(0xfc);
+            int2(static_cast<uint16_t>(value));
+        } else if (value < (1 << 24)) {
+            byte(0xfd);
+            int2(static_cast<uint16_t>(value & 0xffff));
+            byte(static_cast<uint8_t>(value >> 16));
+        } else {
+            byte(0xfe);
+            int4(static_cast<uint32_t>(value));
+            int4(static_cast<uint32_t>(value >> 32));
+        }
+    }
+
+    void text(const std::string& value) { m_data += value; }
+    void nulText(const std::string& value) { m_data += value; byte(0); }
+    void lenencText(const std::string& value) { lenenc(value.size()); text(value); }
+    void zeros(size_t count) { m_data.append(count, '\0'); }
+
+    const std::string& data() const { return m_data; }
+
+private:
+    std::string m_data;
+};
+
+bool writeAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = ::send(fd, data, size, MSG_NOSIGNAL);
+        if (written <= 0) {
+            return false;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+bool readAll(int fd, char* data, size_t size) {
+    while (size > 0) {
+        ssize_t received = ::recv(fd, data, size, 0);
+        if (received <= 0) {
+            return false;
+        }
+        data += received;
+        size -= static_cast<size_t>(received);
+    }
+    return true;
+}
+
+// the writer of a reply, numbers the packets from the sequence id after the request
+class Reply {
+public:
+    Reply(int fd, uint8_t sequence) : m_fd(fd), m_sequence(sequence) {}
+
+    void add(const Packet& packet) {
+        const std::string& payload = packet.data();
+        char header[4];
+        header[0] = static_cast<char>(payload.size() & 0xff);
+        header[1] = static_cast<char>((payload.size() >> 8) & 0xff);
+        header[2] = static_cast<char>((payload.size() >> 16) & 0xff);
+        header[3] = static_cast<char>(m_sequence++);
+        m_buffer.append(header, sizeof(header));
+        m_buffer += payload;
+    }
+
+    // one send for the whole reply, like the real server does for small results
+    bool flush() {
+        bool ok = writeAll(m_fd, m_buffer.data(), m_buffer.size());
+        m_buffer.clear();
+        return ok;
+    }
+
+private:
+    int m_fd;
+    uint8_t m_sequence;
+    std::string m_buffer;
+};
+
+bool readPacket(int fd, uint8_t& sequence, std::string& payload) {
+    unsigned char header[4];
+    if (!readAll(fd, reinterpret_cast<char*>(header), sizeof(header))) {
+        return false;
+    }
+    size_t size = header[0] | (header[1] << 8) | (header[2] << 16);
+    sequence = header[3];
+    payload.resize(size);
+    return size == 0 || readAll(fd, &payload[0], size);
+}
+
+Packet okPacket(uint64_t affectedRows = 0) {
+    Packet packet;
+    packet.byte(0x00);
+    packet.lenenc(affectedRows);
+    packet.lenenc(0);  // last insert id
+    packet.int2(SERVER_STATUS_AUTOCOMMIT);
+    packet.int2(0);    // warnings
+    return packet;
+}
+
+Packet eofPacket() {
+    Packet packet;
+    packet.byte(0xfe);
+    packet.int2(0);    // warnings
+    packet.int2(SERVER_STATUS_AUTOCOMMIT);
+    return packet;
+}
+
+Packet errorPacket(uint16_t code, const std::string& message) {
+    Packet packet;
+    packet.byte(0xff);
+    packet.int2(code);
+    packet.text("#HY000");
+    packet.text(message);
+    return packet;
+}
+
+// xorshift32, deterministic for a given seed so failure runs can be repeated
+double nextRandom(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return static_cast<double>(state) / 4294967296.0;
+}
+
+bool startsWithKeyword(const std::string& sql, const char* keyword) {
+    size_t start = 0;
+    while (start < sql.size() && (std::isspace(static_cast<unsigned char>(sql[start])) || sql[start] == '(')) {
+        start++;
+    }
+    size_t length = std::strlen(keyword);
+    if (sql.size() - start < length) {
+        return false;
+    }
+    for (size_t i = 0; i < length; i++) {
+        if (std::toupper(static_cast<unsigned char>(sql[start + i])) != keyword[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void sleepMicros(unsigned int micros) {
+    if (micros > 0) {
+        std::this_thread::sleep_for(std::chrono::microseconds(micros));
+    }
+}
+
+} // namespace
+
+
+FakeMySQLServer::FakeMySQLServer(const FakeServerOptions& options)
+    : m_options(options)
+    , m_listenFd(-1)
+    , m_port(0)
+    , m_running(false)
+    , m_queryLatencyMicros(0)
+    , m_connectLatencyMicros(0)
+    , m_errorRate(0.0)
+    , m_dropRate(0.0)
+    , m_refuseConnections(false)
+    , m_connections(0)
+    , m_queries(0)
+    , m_injectedFailures(0) {
+}
+
+
+FakeMySQLServer::~FakeMySQLServer() {
+    stop();
+}
+
+
+unsigned int FakeMySQLServer::start() {
+    if (m_running) {
+        return m_port;
+    }
+    m_listenFd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (m_listenFd < 0) {
+        throw std::runtime_error("FakeMySQLServer: cannot create a socket");
+    }
+    int reuse = 1;
+    ::setsockopt(m_listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = 0;
+    socklen_t length = sizeof(address);
+    if (::bind(m_listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        ::listen(m_listenFd, 512) != 0 ||
+        ::getsockname(m_listenFd, reinterpret_cast<sockaddr*>(&address), &length) != 0) {
+        ::close(m_listenFd);
+        m_listenFd = -1;
+        throw std::runtime_error("FakeMySQLServer: cannot listen on 127.0.0.1");
+    }
+    m_port = ntohs(address.sin_port);
+    m_running = true;
+    m_acceptThread = std::thread(&FakeMySQLServer::acceptLoop, this);
+    return m_port;
+}
+
+
+void FakeMySQLServer::stop() {
+    if (!m_running.exchange(false)) {
+        return;
+    }
+    // wakes up accept()
+    ::shutdown(m_listenFd, SHUT_RDWR);
+    if (m_acceptThread.joinable()) {
+        m_acceptThread.join();
+    }
+    ::close(m_listenFd);
+    m_listenFd = -1;
+
+    std::vector<std::thread> threads;
+    {
+        std::lock_guard<std::mutex> lock(m_clientsMutex);
+        // the serving threads close their sockets, shutdown only wakes them up
+        for (int fd : m_clientFds) {
+            ::shutdown(fd, SHUT_RDWR);
+        }
+        threads.swap(m_clientThreads);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+
+void FakeMySQLServer::acceptLoop() {
+    uint32_t nextId = 1;
+    while (m_running) {
+        int fd = ::accept(m_listenFd, nullptr, nullptr);
+        if (fd < 0) {
+            if (!m_running) {
+                break;
+            }
+            continue;
+        }
+        if (m_refuseConnections) {
+            ::close(fd);
+            continue;
+        }
+        int noDelay = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+        m_connections++;
+
+        std::lock_guard<std::mutex> lock(m_clientsMutex);
+        m_clientFds.push_back(fd);
+        m_clientThreads.emplace_back(&FakeMySQLServer::serve, this, fd, nextId++);
+    }
+}
+
+
+void FakeMySQLServer::serve(int fd, uint32_t connectionId) {
+    uint32_t random = m_options.seed * 2654435761u + connectionId;
+    if (random == 0) {
+        random = 1;
+    }
+    sleepMicros(m_connectLatencyMicros);
+
+    // Handshake V10, the auth plugin data is 8 + 12 bytes
+    Packet handshake;
+    handshake.byte(10);
+    handshake.nulText("8.0.36-fake");
+    handshake.int4(connectionId);
+    handshake.text("abcdefgh");
+    handshake.byte(0);
+    handshake.int2(SERVER_CAPABILITIES & 0xffff);
+    handshake.byte(CHARSET_UTF8MB4);
+    handshake.int2(SERVER_STATUS_AUTOCOMMIT);
+    handshake.int2(SERVER_CAPABILITIES >> 16);
+    handshake.byte(21);
+    handshake.zeros(10);
+    handshake.nulText("ijklmnopqrst");
+    handshake.nulText("mysql_native_password");
+
+    Reply greeting(fd, 0);
+    greeting.add(handshake);
+    uint8_t sequence = 0;
+    std::string payload;
+    // every password is accepted: a client whose plugin differs gets OK instead of an auth switch,
+    // which libmysqlclient treats as a finished authentication
+    bool open = greeting.flush() && readPacket(fd, sequence, payload);
+    if (open) {
+        Reply accepted(fd, static_cast<uint8_t>(sequence + 1));
+        accepted.add(okPacket());
+        open = accepted.flush();
+    }
+
+    while (open && m_running && readPacket(fd, sequence, payload) && !payload.empty()) {
+        uint8_t command = static_cast<uint8_t>(payload[0]);
+        Reply reply(fd, static_cast<uint8_t>(sequence + 1));
+        switch (command) {
+            case COM_QUIT:
+                open = false;
+                break;
+            case COM_QUERY:
+                open = handleQuery(fd, payload.substr(1), random);
+                break;
+            case COM_PING:
+            case COM_INIT_DB:
+            case COM_RESET_CONNECTION:
+                reply.add(okPacket());
+                open = reply.flush();
+                break;
+            case COM_SET_OPTION:
+                reply.add(eofPacket());
+                open = reply.flush();
+                break;
+            case COM_STMT_PREPARE:
+                reply.add(errorPacket(ER_NOT_SUPPORTED_YET, "prepared statements are not supported by the fake server"));
+                open = reply.flush();
+                break;
+            default:
+                reply.add(errorPacket(ER_UNKNOWN_COM_ERROR, "unknown command"));
+                open = reply.flush();
+                break;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_clientsMutex);
+    m_clientFds.erase(std::remove(m_clientFds.begin(), m_clientFds.end(), fd), m_clientFds.end());
+    ::close(fd);
+}
+
+
+bool FakeMySQLServer::handleQuery(int fd, const std::string& sql, uint32_t& random) {
+    m_queries++;
+    sleepMicros(m_queryLatencyMicros);
+
+    Reply reply(fd, 1);
+    double draw = nextRandom(random);
+    double dropRate = m_dropRate.load();
+    if (draw < dropRate) {
+        m_injectedFailures++;
+        return false;
+    }
+    if (draw < dropRate + m_errorRate.load()) {
+        m_injectedFailures++;
+        reply.add(errorPacket(ER_UNKNOWN_ERROR, "injected failure"));
+        return reply.flush();
+    }
+    if (sql.find(';') != std::string::npos && sql.find(';') + 1 < sql.size()) {
+        reply.add(errorPacket(ER_NOT_SUPPORTED_YET, "multi-statements are not supported by the fake server"));
+        return reply.flush();
+    }
+    if (startsWithKeyword(sql, "SELECT") || startsWithKeyword(sql, "SHOW")) {
+        writeResultSet(fd);
+        return true;
+    }
+    bool modifies = startsWithKeyword(sql, "INSERT") || startsWithKeyword(sql, "UPDATE") ||
+                    startsWithKeyword(sql, "DELETE") || startsWithKeyword(sql, "REPLACE");
+    reply.add(okPacket(modifies ? 1 : 0));
+    return reply.flush();
+}
+
+
+void FakeMySQLServer::writeResultSet(int fd) {
+    static const char* const names[] = {"id", "name", "price"};
+    static const uint8_t types[] = {TYPE_LONGLONG, TYPE_VAR_STRING, TYPE_DOUBLE};
+
+    Reply reply(fd, 1);
+    Packet count;
+    count.lenenc(m_options.resultColumns);
+    reply.add(count);
+    for (unsigned int column = 0; column < m_options.resultColumns; column++) {
+        unsigned int kind = column % 3;
+        std::string name = names[kind];
+        if (column >= 3) {
+            name += "_" + std::to_string(column / 3);
+        }
+        // ColumnDefinition41
+        Packet definition;
+        definition.lenencText("def");
+        definition.lenencText("fake");
+        definition.lenencText("t");
+        definition.lenencText("t");
+        definition.lenencText(name);
+        definition.lenencText(name);
+        definition.byte(0x0c);
+        definition.int2(types[kind] == TYPE_VAR_STRING ? CHARSET_UTF8MB4 : CHARSET_BINARY);
+        definition.int4(types[kind] == TYPE_VAR_STRING ? 255 : 20);
+        definition.byte(types[kind]);
+        definition.int2(0);   // flags
+        definition.byte(types[kind] == TYPE_DOUBLE ? 31 : 0);
+        definition.zeros(2);
+        reply.add(definition);
+    }
+    reply.add(eofPacket());
+
+    for (unsigned int row = 1; row <= m_options.resultRows; row++) {
+        Packet values;
+        for (unsigned int column = 0; column < m_options.resultColumns; column++) {
+            switch (column % 3) {
+                case 0: values.lenencText(std::to_string(row)); break;
+                case 1: values.lenencText("row-" + std::to_string(row)); break;
+                default: values.lenencText(std::to_string(row) + ".5"); break;
+            }
+        }
+        reply.add(values);
+    }
+    reply.add(eofPacket());
+    reply.flush();
+}
@@ -0,0 +1,103 @@
+// bench/fake_mysql_server.h
+#ifndef FAKE_MYSQL_SERVER_H
+#define FAKE_MYSQL_SERVER_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief shape of the result set the fake server returns for every SELECT
+ *
+ * The columns cycle through id BIGINT, name VARCHAR, price DOUBLE
+ * (named id, name, price, id_1, name_1, ...), values are derived from the row number.
+ */
+struct FakeServerOptions {
+    unsigned int resultRows = 1;
+    unsigned int resultColumns = 3;
+    uint32_t seed = 1;   // seed of the per-connection generators deciding injected failures
+};
+
+/**
+ * @brief in-process server speaking enough of the MySQL client/server protocol for the pool
+ *
+ * Listens on 127.0.0.1 on an ephemeral port, serves every client on its own thread and
+ * accepts any user and password (mysql_native_password, no TLS, classic EOF packets).
+ * Understood commands: COM_QUERY, COM_PING, COM_INIT_DB, COM_RESET_CONNECTION,
+ * COM_SET_OPTION and COM_QUIT. SELECT and SHOW return the configured result set,
+ * every other statement returns OK. Prepared statements and multi-statements are rejected.
+ *
+ * Latency and failures can be injected while it runs, so benchmarks can reproduce
+ * slow backends, query errors and lost connections without a real server.
+ */
+class FakeMySQLServer {
+public:
+    explicit FakeMySQLServer(const FakeServerOptions& options = FakeServerOptions());
+    ~FakeMySQLServer();
+
+    FakeMySQLServer(const FakeMySQLServer&) = delete;
+    FakeMySQLServer& operator=(const FakeMySQLServer&) = delete;
+
+    /**
+     * @brief start listening
+     * @return the port
+     * @throws std::runtime_error if the socket cannot be bound
+     */
+    unsigned int start();
+
+    // close the listening socket and every client connection, then join the threads
+    void stop();
+
+    unsigned int getPort() const { return m_port; }
+
+    // delay before every query reply / before the handshake
+    void setQueryLatency(unsigned int micros) { m_queryLatencyMicros.store(micros); }
+    void setConnectLatency(unsigned int micros) { m_connectLatencyMicros.store(micros); }
+
+    // fraction of queries answered with an error packet (ER_UNKNOWN_ERROR)
+    void setErrorRate(double rate) { m_errorRate.store(rate); }
+
+    // fraction of queries after which the connection is closed without a reply (CR_SERVER_LOST for the client)
+    void setDropRate(double rate) { m_dropRate.store(rate); }
+
+    // close new connections right after accepting them
+    void setRefuseConnections(bool refuse) { m_refuseConnections.store(refuse); }
+
+    uint64_t getConnectionCount() const { return m_connections.load(); }
+    uint64_t getQueryCount() const { return m_queries.load(); }
+    uint64_t getInjectedFailures() const { return m_injectedFailures.load(); }
+
+private:
+    void acceptLoop();
+    void serve(int fd, uint32_t connectionId);
+
+    // reply to one COM_QUERY, returns false when the connection must be closed
+    bool handleQuery(int fd, const std::string& sql, uint32_t& random);
+
+    void writeResultSet(int fd);
+
+    FakeServerOptions m_options;
+    int m_listenFd;
+    unsigned int m_port;
+    std::atomic<bool> m_running;
+    std::thread m_acceptThread;
+
+    std::mutex m_clientsMutex;
+    std::vector<int> m_clientFds;
+    std::vector<std::thread> m_clientThreads;
+
+    std::atomic<unsigned int> m_queryLatencyMicros;
+    std::atomic<unsigned int> m_connectLatencyMicros;
+    std::atomic<double> m_errorRate;
+    std::atomic<double> m_dropRate;
+    std::atomic<bool> m_refuseConnections;
+
+    std::atomic<uint64_t> m_connections;
+    std::atomic<uint64_t> m_queries;
+    std::atomic<uint64_t> m_injectedFailures;
+};
+
+#endif // FAKE_MYSQL_SERVER_H
@@ -0,0 +1,122 @@
+#ifndef ASYNC_EXECUTOR_H
+#define ASYNC_EXECUTOR_H
+
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+#include "connection_pool.h"
+
+/**
+ * @brief runs statements on pooled connections without a thread per statement in flight
+ *
+ * Every statement borrows a connection from the pool, is started with the client
+ * library's non-blocking API and then driven by an epoll loop: a loop thread only
+ * touches a connection when its socket is readable, so a few loop threads keep
+ * as many connections busy as the pool has.
+ *
+ * The connection is borrowed on the calling thread, which waits like acquire()
+ * when the pool is exhausted; that is the executor's back pressure. It goes back
+ * to the pool as soon as the result has been read, before the callback runs. It is not
+ * kept in the loop thread's cache (PoolConfig::threadLocalCache), and one of a primary
+ * restarts the read-after-write window of the calling thread, not of the loop thread.
+ *
+ * Callbacks run on a loop thread and must not block, or every statement of that
+ * loop waits. A callback gets either a result or an exception, never both; when
+ * no connection could be borrowed it runs on the calling thread instead.
+ * Submitting from a loop thread throws: borrowing there could wait for connections
+ * only that loop gives back, so a callback hands follow-up statements to another thread.
+ *
+ * Connection errors are not retried, see Connection::startAsync(). With a client
+ * library without the non-blocking API (POOL_HAS_NONBLOCKING_API is 0) the
+ * statement runs to completion inside startAsync() on the loop thread.
+ *
+ * usage:
+ * AsyncExecutor executor(ConnectionPool::getInstance(), 2);
+ * std::vector<std::future<QueryResultPtr>> results;
+ * for (const auto& sql : reports) {
+ *     results.push_back(executor.executeQuery(sql, AccessMode::READ_ONLY));
+ * }
+ * for (auto& result : results) {
+ *     print(result.get());
+ * }
+ */
+class AsyncExecutor {
+public:
+    using QueryCallback = std::function<void(QueryResultPtr result, std::exception_ptr error)>;
+    using UpdateCallback = std::function<void(unsigned long long affectedRows, std::exception_ptr error)>;
+
+    /**
+     * @param pool connections are borrowed from it, it must outlive the executor
+     * @param loopCount event-loop threads, statements are spread over them round robin
+     * @param queryTimeout milliseconds a statement may take once started, 0 for no limit;
+     *        a statement over it fails and its connection is closed
+     * @throws std::runtime_error if epoll or the loop threads cannot be set up
+     */
+    explicit AsyncExecutor(ConnectionPool& pool, size_t loopCount = 1, unsigned int queryTimeout = 0);
+
+    // stop()
+    ~AsyncExecutor();
+
+    AsyncExecutor(const AsyncExecutor&) = delete;
+    AsyncExecutor& operator=(const AsyncExecutor&) = delete;
+
+    /**
+     * @brief run a query, the result arrives through callback
+     * @throws std::runtime_error if the executor has been stopped or when called on a loop thread
+     */
+    void executeQuery(const std::string& sql, QueryCallback callback, AccessMode mode = AccessMode::READ_WRITE);
+
+    // same, the result arrives through the future
+    std::future<QueryResultPtr> executeQuery(const std::string& sql, AccessMode mode = AccessMode::READ_WRITE);
+
+    // run an INSERT/UPDATE/DELETE on a primary, the affected rows arrive through callback
+    void executeUpdate(const std::string& sql, UpdateCallback callback);
+
+    std::future<unsigned long long> executeUpdate(const std::string& sql);
+
+    /**
+     * @brief stop the loops
+     *
+     * statements still running fail with an error and their connections are closed,
+     * later submissions throw; called by the destructor
+     */
+    void stop();
+
+    // statements submitted and not completed yet
+    size_t getInFlight() const {
+        return m_inFlight.load();
+    }
+
+    // true when statements are really driven by the event loop, see POOL_HAS_NONBLOCKING_API
+    static bool isNonBlocking() {
+        return POOL_HAS_NONBLOCKING_API != 0;
+    }
+
+private:
+    struct Operation;
+    struct Loop;
+
+    void submit(const std::string& sql, bool isQuery, AccessMode mode, QueryCallback callback);
+    void run(Loop& loop);
+    // start the statements queued for the loop
+    void startSubmitted(Loop& loop);
+    // start or continue op, then complete it or wait for its socket again
+    void advance(Loop& loop, std::unique_ptr<Operation> op, bool started);
+    // return the connection and run the callback
+    void complete(std::unique_ptr<Operation> op, QueryResultPtr result, std::exception_ptr error);
+    // fail the statements that are over queryTimeout, returns the epoll timeout until the next one
+    int expireOperations(Loop& loop);
+
+    ConnectionPool& m_pool;
+    const unsigned int m_queryTimeout;
+    std::vector<std::unique_ptr<Loop>> m_loops;
+    std::atomic<size_t> m_nextLoop;
+    std::atomic<size_t> m_inFlight;
+    std::atomic<bool> m_running;
+};
+
+#endif // ASYNC_EXECUTOR_H
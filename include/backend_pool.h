@@ -0,0 +1,131 @@
+#ifndef BACKEND_POOL_H
+#define BACKEND_POOL_H
+
+#include <atomic>
+#include <memory>
+#include "load_balancer.h"
+#include "idle_connection_store.h"
+#include "pool_config.h"
+#include "wait_queue.h"
+
+/**
+ * @brief the part of the connection pool that belongs to one database backend
+ *
+ * Every backend of the load balancer gets its own idle store, limits and
+ * counters, so a checkout can go to the backend the balancer picked for it
+ * instead of whichever connection happens to be idle.
+ *
+ * The counters are atomics, updated by the ConnectionPool next to its global ones.
+ * A backend removed from the balancer is drained: it accepts no new connections,
+ * its idle connections are closed, and borrowed ones are closed when they come back.
+ */
+class BackendPool {
+public:
+    BackendPool(BackendPtr backend, size_t shardCount, IdleOrder order);
+
+    // disable copy constructor and copy assingments
+    BackendPool(const BackendPool&) = delete;
+    BackendPool& operator=(const BackendPool&) = delete;
+
+    uint64_t getBackendId() const {
+        return m_backendId;
+    }
+
+    // primary or replica, never changes for a backend
+    DBRole getRole() const {
+        return m_role;
+    }
+
+    // latest version of the backend, its weight may change while the id stays
+    BackendPtr getBackend() const;
+    void setBackend(BackendPtr backend);
+
+    IdleConnectionStore& getIdleConnections() {
+        return m_idleConnections;
+    }
+
+    const IdleConnectionStore& getIdleConnections() const {
+        return m_idleConnections;
+    }
+
+    /**
+     * @brief derive the limits from the backend's DBConfig
+     * @param poolMaxConnections maxConnections of the whole pool, also the default maximum
+     */
+    void updateLimits(unsigned int poolMaxConnections);
+
+    unsigned int getMinConnections() const {
+        return m_minConnections.load(std::memory_order_relaxed);
+    }
+
+    unsigned int getMaxConnections() const {
+        return m_maxConnections.load(std::memory_order_relaxed);
+    }
+
+    // reserve a place for a new connection if the backend is below its maximum
+    bool tryReservePlace();
+    // give a place back
+    void releasePlace();
+    // reset the count after shutdown, only the borrowed connections are left
+    void resetPlaces(size_t count);
+
+    size_t getTotalCount() const {
+        return m_totalConnections.load();
+    }
+
+    // below its maximum, so waiting for a new connection makes sense
+    bool canGrow() const {
+        return !isDraining() && m_totalConnections.load() < getMaxConnections();
+    }
+
+    void addPending() {
+        m_pendingConnections++;
+    }
+
+    void finishPending() {
+        m_pendingConnections--;
+    }
+
+    size_t getPendingCount() const {
+        return m_pendingConnections.load();
+    }
+
+    // stop handing out and creating connections for this backend
+    void startDraining() {
+        m_draining.store(true);
+    }
+
+    bool isDraining() const {
+        return m_draining.load();
+    }
+
+    // threads of the ConnectionPool waiting for a connection of this backend, guarded by the pool's mutex
+    WaitQueue& getWaitQueue() {
+        return m_waitQueue;
+    }
+
+    // size of the wait queue, readable without the pool's mutex
+    std::atomic<size_t>& getWaiters() {
+        return m_waiters;
+    }
+
+private:
+    const uint64_t m_backendId;
+    const DBRole m_role;
+    BackendPtr m_backend;        // read and replaced with std::atomic_load/std::atomic_store
+    IdleConnectionStore m_idleConnections;
+
+    std::atomic<unsigned int> m_minConnections;
+    std::atomic<unsigned int> m_maxConnections;
+    // connections of this backend, including the ones being created
+    std::atomic<size_t> m_totalConnections;
+    std::atomic<size_t> m_pendingConnections;
+    std::atomic<bool> m_draining;
+
+    WaitQueue m_waitQueue;
+    std::atomic<size_t> m_waiters;
+};
+
+using BackendPoolPtr = std::shared_ptr<BackendPool>;
+
+#endif // BACKEND_POOL_H
@@ -0,0 +1,82 @@
+#ifndef BACKEND_STATS_H
+#define BACKEND_STATS_H
+
+#include <atomic>
+#include <cstdint>
+#include "circuit_breaker.h"
+
+// Live load, latency and health of one database backend.
+// Shared by the load balancer and every connection to the backend; connections
+// report their queries, the adaptive strategies read the numbers without locking.
+// Answered queries close the circuit breaker, connection failures count towards opening it.
+class BackendStats {
+public:
+    // latencies older than this weigh about 1/e in the average
+    static const int64_t DECAY_NANOS = 10LL * 1000 * 1000 * 1000;
+    // cost of a backend with requests in flight but no latency sample yet,
+    // and the latency recorded for a query that failed with a connection error
+    static const int64_t PENALTY_NANOS = 1LL * 1000 * 1000 * 1000;
+
+    BackendStats();
+
+    // a query was sent to the backend
+    void requestStarted() {
+        m_inFlight.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // the backend answered after latencyNanos (successfully or with an SQL error)
+    void requestFinished(int64_t latencyNanos);
+
+    // the backend did not answer, counted as PENALTY_NANOS so traffic moves away
+    void requestFailed();
+
+    // connects and reconnects report here, queries through requestFinished/requestFailed
+    CircuitBreaker& getBreaker() {
+        return m_breaker;
+    }
+
+    const CircuitBreaker& getBreaker() const {
+        return m_breaker;
+    }
+
+    void connectionOpened() {
+        m_openConnections.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void connectionClosed() {
+        m_openConnections.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    int64_t getInFlight() const {
+        return m_inFlight.load(std::memory_order_relaxed);
+    }
+
+    int64_t getOpenConnections() const {
+        return m_openConnections.load(std::memory_order_relaxed);
+    }
+
+    uint64_t getSampleCount() const {
+        return m_samples.load(std::memory_order_relaxed);
+    }
+
+    // peak-sensitive moving average of the latency, decayed up to nowNanos
+    double getEwmaNanos(int64_t nowNanos) const;
+
+    // expected wait of a new request: latency average times (requests in flight + 1)
+    double getPeakEwmaCost(int64_t nowNanos) const;
+
+    // steady clock in nanoseconds, the time base of all the methods above
+    static int64_t nowNanos();
+
+private:
+    void observe(int64_t latencyNanos);
+
+    std::atomic<int64_t> m_inFlight;
+    std::atomic<int64_t> m_openConnections;
+    std::atomic<uint64_t> m_ewmaBits;          // double, updated with compare-exchange
+    std::atomic<int64_t> m_lastSampleNanos;
+    std::atomic<uint64_t> m_samples;
+    CircuitBreaker m_breaker;
+};
+
+#endif // BACKEND_STATS_H
@@ -0,0 +1,175 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+class Connection;
+
+/**
+ * @brief typed value of a batch insert row
+ *
+ * converts implicitly from the common C++ types, so rows can be written as
+ * insert.addRow({name, age, nullptr});
+ * text values are escaped with the connection charset when the statement is built.
+ */
+class SqlValue {
+public:
+    enum class Type {
+        NULL_VALUE,
+        INTEGER,
+        UNSIGNED,
+        REAL,
+        TEXT
+    };
+
+    SqlValue();
+    SqlValue(std::nullptr_t);
+    SqlValue(int value);
+    SqlValue(long value);
+    SqlValue(long long value);
+    SqlValue(unsigned int value);
+    SqlValue(unsigned long value);
+    SqlValue(unsigned long long value);
+    SqlValue(double value);
+    SqlValue(const char* value);
+    SqlValue(const std::string& value);
+    SqlValue(std::string&& value);
+
+    Type getType() const { return m_type; }
+    bool isNull() const { return m_type == Type::NULL_VALUE; }
+
+    long long getInteger() const { return m_integer; }
+    unsigned long long getUnsigned() const { return m_unsigned; }
+    double getReal() const { return m_real; }
+    const std::string& getText() const { return m_text; }
+
+private:
+    Type m_type;
+    long long m_integer;
+    unsigned long long m_unsigned;
+    double m_real;
+    std::string m_text;
+};
+
+
+/**
+ * @brief outcome of one statement of Connection::executeBatch()
+ */
+struct BatchStatementResult {
+    bool executed;                   // false if the statement was never run by the server
+    unsigned long long affectedRows; // affected rows, or the row count of a SELECT
+    unsigned int errorCode;          // 0 on success
+    std::string error;
+
+    BatchStatementResult() : executed(false), affectedRows(0), errorCode(0) {}
+
+    bool succeeded() const { return executed && errorCode == 0; }
+};
+
+
+/**
+ * @brief per-statement results of Connection::executeBatch(), in input order
+ */
+struct BatchResult {
+    std::vector<BatchStatementResult> statements;
+    unsigned long long totalAffectedRows;
+    size_t executedCount;
+    size_t failedCount;
+    size_t roundTrips;               // multi-statement packets sent to the server
+
+    BatchResult() : totalAffectedRows(0), executedCount(0), failedCount(0), roundTrips(0) {}
+
+    // every statement ran without error
+    bool succeeded() const { return failedCount == 0 && executedCount == statements.size(); }
+};
+
+
+/**
+ * @brief builds size-bounded multi-row INSERT statements
+ *
+ * rows are appended to one "INSERT INTO t (a, b) VALUES (...), (...)" statement, which is sent
+ * when it would grow past maxStatementBytes or maxRowsPerStatement, so thousands of rows cost
+ * a handful of round trips instead of one each.
+ *
+ * usage:
+ * BatchInsert insert(*conn, "users", {"name", "age", "email"});
+ * for (const auto& user : users) {
+ *     insert.addRow({user.name, user.age, nullptr});
+ * }
+ * insert.flush();   // send the remaining rows
+ *
+ * Every statement is sent by Connection::executeUpdate(), so failures throw like a single
+ * executeUpdate(); rows of a failed statement are dropped, rows of earlier statements are
+ * already stored. Wrap the batch in a transaction if it has to be all or nothing.
+ * Rows still pending in the destructor are discarded with a warning, call flush() first.
+ */
+class BatchInsert {
+public:
+    // keeps a statement well below the default max_allowed_packet (4MB in MySQL 5.7, 64MB in 8.0)
+    static const size_t DEFAULT_MAX_STATEMENT_BYTES = 1024 * 1024;
+    static const size_t DEFAULT_MAX_ROWS_PER_STATEMENT = 1000;
+
+    /**
+     * @param connection connection executing the statements, must outlive the builder
+     * @param table table name, "schema.table" is allowed
+     * @param columns column names, every row must have one value per column
+     * @param maxStatementBytes size limit of one INSERT statement
+     * @param maxRowsPerStatement row limit of one INSERT statement
+     * @throws std::invalid_argument if no column is given or a limit is 0
+     */
+    BatchInsert(Connection& connection,
+                const std::string& table,
+                const std::vector<std::string>& columns,
+                size_t maxStatementBytes = DEFAULT_MAX_STATEMENT_BYTES,
+                size_t maxRowsPerStatement = DEFAULT_MAX_ROWS_PER_STATEMENT);
+
+    ~BatchInsert();
+
+    BatchInsert(const BatchInsert&) = delete;
+    BatchInsert& operator=(const BatchInsert&) = delete;
+
+    /**
+     * @brief append one row, sending the pending statement first if the row does not fit
+     * @throws std::invalid_argument if the value count is wrong or a double is not finite
+     * @throws std::runtime_error if sending the pending statement fails, the row is not added then
+     */
+    void addRow(const std::vector<SqlValue>& values);
+
+    /**
+     * @brief send the pending rows
+     * @return affected rows of the statement, 0 if nothing was pending
+     */
+    unsigned long long flush();
+
+    size_t getPendingRows() const { return m_pendingRows; }
+    // rows sent so far, pending rows not included
+    size_t getFlushedRows() const { return m_flushedRows; }
+    unsigned long long getAffectedRows() const { return m_affectedRows; }
+    size_t getStatementCount() const { return m_statementCount; }
+
+    /**
+     * @brief quote an identifier with backticks, "db.table" becomes `db`.`table`
+     */
+    static std::string quoteIdentifier(const std::string& name);
+
+private:
+    Connection& m_connection;
+    std::string m_prefix;            // INSERT INTO `t` (`a`, `b`) VALUES
+    size_t m_columnCount;
+    size_t m_maxStatementBytes;
+    size_t m_maxRowsPerStatement;
+
+    std::string m_sql;
+    std::string m_row;               // reused buffer of the row being formatted
+    size_t m_pendingRows;
+    size_t m_flushedRows;
+    unsigned long long m_affectedRows;
+    size_t m_statementCount;
+
+    void appendValue(std::string& out, const SqlValue& value);
+};
+
+#endif // BATCH_H
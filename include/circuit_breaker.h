@@ -0,0 +1,117 @@
+#ifndef CIRCUIT_BREAKER_H
+#define CIRCUIT_BREAKER_H
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @brief health of one backend, shared by every pool and connection that uses it
+ *
+ * CLOSED while the backend answers. After failureThreshold consecutive failures
+ * (connects, or queries that failed with a connection error) the circuit opens:
+ * selections skip the backend and connects to it fail at once, without touching
+ * the network. Once the open period is over, the next caller of tryPass() becomes
+ * the probe and the circuit is HALF_OPEN until the probe reports back. A success
+ * closes it, a failure opens it again for twice as long, up to maxOpenNanos.
+ *
+ * All methods are lock-free, isClosed() is a single relaxed load.
+ */
+class CircuitBreaker {
+public:
+    enum class State {
+        CLOSED,
+        OPEN,
+        HALF_OPEN
+    };
+
+    struct Policy {
+        uint32_t failureThreshold;  // consecutive failures that open the circuit, 0 never opens it
+        int64_t openNanos;          // first open period, the circuit stays open between half and all of it
+        int64_t maxOpenNanos;       // cap of the doubled open periods
+        int64_t probeTimeoutNanos;  // a probe that did not report back in time is replaced by the next caller
+
+        Policy()
+            : failureThreshold(5)
+            , openNanos(1000LL * 1000 * 1000)
+            , maxOpenNanos(30LL * 1000 * 1000 * 1000)
+            , probeTimeoutNanos(10LL * 1000 * 1000 * 1000) {}
+    };
+
+    CircuitBreaker();
+
+    CircuitBreaker(const CircuitBreaker&) = delete;
+    CircuitBreaker& operator=(const CircuitBreaker&) = delete;
+
+    // takes effect with the next failure or open period
+    void configure(const Policy& policy);
+
+    bool isClosed() const {
+        return m_state.load(std::memory_order_relaxed) == static_cast<int>(State::CLOSED);
+    }
+
+    /**
+     * @brief may a request or connect go to the backend now
+     * @return true when closed, or when the open period is over and the caller became the probe
+     */
+    bool tryPass();
+
+    /**
+     * @brief like tryPass(), but lets connects through while a probe is out
+     *
+     * for connects and reconnects on behalf of a checkout that a selection already let
+     * past the breaker, e.g. the probe itself; only an open circuit stops them
+     */
+    bool allowConnect();
+
+    // the backend answered, closes the circuit
+    void recordSuccess();
+
+    // the backend did not answer, may open the circuit
+    void recordFailure();
+
+    State getState() const {
+        int state = m_state.load(std::memory_order_relaxed);
+        return state == OPENING ? State::OPEN : static_cast<State>(state);
+    }
+
+    uint32_t getConsecutiveFailures() const {
+        return m_failures.load(std::memory_order_relaxed);
+    }
+
+    // how often the circuit has opened
+    uint64_t getOpenCount() const {
+        return m_openCount.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief exponential backoff with full jitter
+     * @return uniform in [0, min(cap, base * 2^(attempt - 1))], in the unit of base
+     */
+    static int64_t backoffDelay(int64_t base, unsigned int attempt, int64_t cap);
+
+    // min(cap, base * 2^(attempt - 1)), 0 when base or cap is not positive
+    static int64_t backoffCeiling(int64_t base, unsigned int attempt, int64_t cap);
+
+    static const char* stateName(State state);
+
+private:
+    // m_state while open() sets the deadline, reported as OPEN; tryPass() admits no probe
+    // until OPEN is published, so it never sees the deadline of the previous period
+    enum { OPENING = 3 };
+
+    // called by the caller that moved m_state to OPENING, sets the next period and publishes OPEN
+    void open(int64_t nowNanos);
+
+    std::atomic<int> m_state;
+    std::atomic<uint32_t> m_failures;
+    std::atomic<uint32_t> m_openStreak;     // opens since the circuit was last closed
+    std::atomic<uint64_t> m_openCount;
+    std::atomic<int64_t> m_retryAtNanos;    // end of the open period, or the probe deadline
+
+    std::atomic<uint32_t> m_failureThreshold;
+    std::atomic<int64_t> m_openNanos;
+    std::atomic<int64_t> m_maxOpenNanos;
+    std::atomic<int64_t> m_probeTimeoutNanos;
+};
+
+#endif // CIRCUIT_BREAKER_H
@@ -4,14 +4,34 @@
 
 #include <string>
 #include <memory>
+#include <atomic>
+#include <mutex>
+#include <list>
+#include <unordered_map>
+#include <chrono>
 // MYSQL C API
 #include <mysql/mysql.h>
+// MySQL 8.0.16 起客户端库提供非阻塞API（mysql_real_query_nonblocking 等）
+#if defined(MYSQL_VERSION_ID) && MYSQL_VERSION_ID >= 80016 && !defined(MARIADB_BASE_VERSION)
+#define POOL_HAS_NONBLOCKING_API 1
+#else
+#define POOL_HAS_NONBLOCKING_API 0
+#endif
 #include "query_result.h"
+#include "typed_rows.h"
+#include "prepared_statement.h"
+#include "batch.h"
+#include "backend_stats.h"
+#include "query_trace.h"
 #include "logger.h"
 
+class PerformanceMonitor;
+
 // Connection Class
 // used for connection to mysql server, and executeQuery
-class Connection {
+class Connection : public std::enable_shared_from_this<Connection> {
+    // uses m_mutex and the streaming state of its connection
+    friend class PreparedStatement;
 public:
     // /**
     //  * @brief 
@@ -67,6 +87,14 @@ public:
 
     bool isValidQuietly() const;
 
+    /**
+     * @brief 检查底层MySQL句柄是否仍然打开
+     * @return 句柄是否存在
+     *
+     * 不进行任何网络I/O，可以在持有连接池锁时调用
+     */
+    bool isOpen() const;
+
     // =========================
     // 查询执行方法
     // =========================
@@ -99,6 +127,157 @@ public:
      */
     unsigned long long executeUpdate(const std::string& sql);
 
+    /**
+     * @brief 以流式（非缓冲）方式执行SELECT查询
+     * @param sql SQL查询语句
+     * @return 只进游标，行在next()时才从服务器读取
+     * @throws std::runtime_error 如果查询失败
+     * 
+     * 基于mysql_use_result，内存占用与结果集行数无关，适合大表导出
+     * 在结果读完或close()之前，连接不能执行其他命令：
+     * - 在此期间执行其他命令，会先读掉剩余的行，原结果集的next()随后抛出异常
+     * - 把连接归还连接池时，未读完的结果集会被取消，连接被关闭而不会回到空闲队列
+     * 
+     * 使用示例：
+     * auto result = conn.executeStreamingQuery("SELECT * FROM big_table");
+     * while (result->next()) {
+     *     exportRow(result->getString(0));
+     * }
+     */
+    QueryResultPtr executeStreamingQuery(const std::string& sql);
+
+    /**
+     * @brief 执行SELECT查询并把所有行解码成Row类型
+     * @tparam Row std::tuple<...>，或者特化了RowMapping的结构体
+     * @param sql SQL查询语句
+     * @return 连续存放的行，FieldView字段指向结果自带的字符串区
+     * @throws std::invalid_argument 如果列数或列类型与Row不匹配（只检查一次）
+     * @throws std::out_of_range 如果某个值超出字段类型的范围
+     * 
+     * 不经过逐个字段的getString/getInt，每一行按列一次解码，适合大批量聚合
+     * 
+     * 使用示例：
+     * auto rows = conn.query<std::tuple<long long, FieldView, double>>("SELECT id, name, price FROM orders");
+     * for (const auto& row : rows) {
+     *     total += std::get<2>(row);
+     * }
+     */
+    template <typename Row>
+    TypedRows<Row> query(const std::string& sql) {
+        QueryResultPtr result = executeQuery(sql);
+        return fetchRows<Row>(*result);
+    }
+
+    /**
+     * @brief 批量执行多条SQL语句（多语句流水线）
+     * @param statements SQL语句列表，每个元素只能包含一条语句，末尾的分号可有可无
+     * @param stopOnError 某条语句失败后是否停止执行后续语句
+     * @param maxPacketBytes 一次发送的语句总长度上限，超出后分成多次往返
+     * @return 每条语句的影响行数和错误信息，顺序与输入一致
+     * @throws db::SQLExecutionError 如果连接未建立或无法开启多语句模式
+     * 
+     * 多条语句用分号拼接后一次发送（CLIENT_MULTI_STATEMENTS），再用mysql_next_result逐个读取结果，
+     * 每一批只需要一次网络往返；多语句模式只在本次调用期间开启
+     * 服务器遇到错误会跳过同一批中剩余的语句：
+     * - stopOnError为true时，剩余语句都标记为未执行
+     * - stopOnError为false时，从失败语句的下一条开始重新发送
+     * 语句失败不抛出异常；批量执行途中连接断开不会自动重连重试（前面的语句可能已经生效），
+     * 剩余语句标记为未执行
+     * 
+     * 使用示例：
+     * BatchResult result = conn.executeBatch({
+     *     "UPDATE accounts SET balance = balance - 10 WHERE id = 1",
+     *     "UPDATE accounts SET balance = balance + 10 WHERE id = 2"
+     * });
+     * if (!result.succeeded()) { ... }
+     */
+    BatchResult executeBatch(const std::vector<std::string>& statements,
+                             bool stopOnError = true,
+                             size_t maxPacketBytes = BatchInsert::DEFAULT_MAX_STATEMENT_BYTES);
+
+    // =========================
+    // 非阻塞执行（由AsyncExecutor驱动）
+    // =========================
+
+    /**
+     * @brief 开始以非阻塞方式执行一条SQL
+     * @param sql SQL语句
+     * @param isQuery 是否读取结果集
+     * @return 已经执行完成时返回true，否则在socket可读后调用continueAsync()
+     * @throws db::SQLExecutionError 如果执行失败，或上一次非阻塞执行还没有完成
+     *
+     * 基于 mysql_real_query_nonblocking / mysql_store_result_nonblocking，每次调用只做socket上已经就绪的读写
+     * 连接错误不会自动重连重试，由下一个借用者的同步查询重连
+     * 客户端库不支持非阻塞API时（POOL_HAS_NONBLOCKING_API为0），在本次调用中同步执行完成
+     */
+    bool startAsync(const std::string& sql, bool isQuery);
+
+    /**
+     * @brief 继续非阻塞执行
+     * @return 执行完成时返回true
+     * @throws db::SQLExecutionError 如果执行失败
+     */
+    bool continueAsync();
+
+    /**
+     * @brief 取走完成的非阻塞执行的结果
+     * @return 查询结果，更新操作只有受影响的行数
+     */
+    QueryResultPtr takeAsyncResult();
+
+    /**
+     * @brief 放弃未完成的非阻塞执行
+     *
+     * 协议已经处于中间状态，会话不能再使用，连接被关闭，归还连接池时会被销毁
+     */
+    void abortAsync();
+
+    /**
+     * @brief 获取底层socket，用于等待非阻塞执行的读写事件
+     * @return socket描述符，未连接时返回-1
+     */
+    int getSocket() const;
+
+    /**
+     * @brief 检查是否有未读完的流式结果集
+     */
+    bool hasActiveStream() const;
+
+    /**
+     * @brief 取消未读完的流式结果集
+     * 
+     * 不读取剩余的行，而是直接中断socket，所以耗时有上限，但连接会被关闭
+     * 连接池在归还连接时调用
+     */
+    void cancelActiveStream();
+
+    /**
+     * @brief 获取预处理语句（二进制协议）
+     * @param sql 带有?占位符的SQL语句
+     * @return 预处理语句
+     * @throws db::SQLExecutionError 如果预处理失败
+     * 
+     * 同一条SQL在每个物理连接上只预处理一次，之后从LRU缓存中复用（跨借用者）
+     * 返回前会清空上一次绑定的参数
+     * 
+     * 使用示例：
+     * auto stmt = conn.prepareStatement("SELECT name FROM users WHERE age > ?");
+     * stmt->setInt(0, 18);
+     * auto result = stmt->executeQuery();
+     */
+    PreparedStatementPtr prepareStatement(const std::string& sql);
+
+    /**
+     * @brief 设置预处理语句缓存的容量
+     * @param size 最多缓存的语句数量（0表示不缓存）
+     */
+    void setStatementCacheSize(size_t size);
+
+    /**
+     * @brief 获取当前缓存的预处理语句数量
+     */
+    size_t getCachedStatementCount() const;
+
     // =========================
     // 事务管理方法
     // =========================
@@ -130,6 +309,32 @@ public:
      */
     bool rollback();
 
+    /**
+     * @brief 检查是否有未结束的事务
+     *
+     * 根据服务器在上一条语句的响应里返回的状态（SERVER_STATUS_IN_TRANS），包括用SQL语句开始的事务，
+     * 以及 autocommit=0 时隐式开始的事务
+     */
+    bool isInTransaction() const;
+
+    /**
+     * @brief 检查会话状态是否可能被修改过
+     * @return 上次建连或重置会话之后执行过文本协议的SQL语句时返回true
+     *
+     * 只执行缓存的预处理语句不算，这样只用预处理语句的连接归还时不用重置，语句缓存得以保留
+     */
+    bool hasSessionChanges() const;
+
+    /**
+     * @brief 清理会话，供连接池在连接归还时调用
+     * @param fullReset true时用 mysql_reset_connection 重置整个会话（一次网络往返，不用重新握手），
+     *        缓存的预处理语句随之失效；false时只在有未结束的事务时回滚
+     * @return 是否清理成功，失败时连接被关闭
+     *
+     * 建连时协商的字符集由服务器保留，不需要重新设置
+     */
+    bool resetSession(bool fullReset);
+
     // // =========================
     // // 错误处理方法
     // // =========================
@@ -178,6 +383,21 @@ public:
      * 每次使用连接时都会调用此方法
      */
     void updateLastActiveTime();
+
+    /**
+     * @brief 获取连接自最后活动以来的空闲时间
+     * @return 空闲时间（毫秒）
+     */
+    int64_t getIdleTime() const;
+
+    /**
+     * @brief 获取/记录连接池最后一次在后台检查该空闲连接的时间
+     * @return 毫秒时间戳，从未检查过时为0
+     *
+     * 与最后活动时间分开记录，检查不会让空闲连接看起来像刚被使用过
+     */
+    int64_t getLastCheckedTime() const;
+    void markChecked();
     
     std::string getConnectionId();
 
@@ -216,6 +436,79 @@ public:
      */
     void resetReconnectStats();
 
+    // =========================
+    // 连接池簿记（由ConnectionPool使用）
+    // =========================
+
+    /**
+     * @brief 设置/获取连接在连接池槽位表中的下标
+     */
+    void setPoolSlot(size_t slot);
+    size_t getPoolSlot() const;
+
+    /**
+     * @brief 设置连接所属的数据库实例
+     * @param backendId 负载均衡器中该实例的编号，连接池据此找到连接所在的子连接池
+     * @param stats 该实例的负载统计，连接计入打开的连接数直到销毁
+     *
+     * 之后的查询会更新执行中的查询数和延迟，供LEAST_CONNECTIONS/PEAK_EWMA/POWER_OF_TWO策略使用
+     */
+    void setBackend(uint64_t backendId, std::shared_ptr<BackendStats> stats);
+
+    /**
+     * @brief 获取连接所属数据库实例的编号，没有设置时为0
+     */
+    uint64_t getBackendId() const;
+
+    /**
+     * @brief 设置/获取记录该连接查询与重连统计的性能监控实例
+     *
+     * 默认是 PerformanceMonitor::getInstance()，连接池把自己的实例交给它创建的连接，
+     * 这样不同连接池的统计互不干扰
+     */
+    void setPerformanceMonitor(PerformanceMonitor& monitor);
+    PerformanceMonitor& getPerformanceMonitor() const;
+
+    /**
+     * @brief 设置连接查询时上报span的追踪器，为空时不追踪（默认）
+     *
+     * 连接池把自己的 QueryTracer 交给它创建的连接
+     */
+    void setQueryTracer(QueryTracer* tracer);
+
+    /**
+     * @brief 记录一次借出的等待时间，由之后的第一次查询计入它的span
+     * @param checkoutStart getConnection() 开始的时间
+     *
+     * 借出等待的是为它新建的连接时，建连时间同时计入CONNECT阶段。
+     * 连接池只在追踪器开启时调用
+     */
+    void setCheckoutTrace(std::chrono::steady_clock::time_point checkoutStart);
+
+    /**
+     * @brief 标记连接被借出
+     * @return 之前未被借出时返回true
+     */
+    bool markInUse();
+
+    /**
+     * @brief 标记连接被归还
+     * @return 之前处于借出状态时返回true（用于发现重复归还）
+     */
+    bool markIdle();
+
+    bool isInUse() const;
+
+    /**
+     * @brief 获取最近一次借出的时间（微秒，Utils::currentTimeMicros()），用于统计连接使用时间
+     */
+    int64_t getBorrowedTime() const;
+
+    /**
+     * @brief 重新记录借出时间，用于留在线程缓存中、没有标记为空闲就再次借出的连接
+     */
+    void markReborrowed();
+
 
 private:
     MYSQL* m_mysql;    //msyql connection handler
@@ -226,9 +519,46 @@ private:
     unsigned int m_port;
     std::string m_connectionId;
     int64_t m_creationTime;
-    int64_t m_lastActiveTime;
+    std::atomic<int64_t> m_lastActiveTime;  // read by the pool without holding m_mutex
+    std::atomic<int64_t> m_lastCheckedTime; // last background check by the pool
+    size_t m_poolSlot;                      // index in the pool's slot table
+    std::atomic<bool> m_inUse;              // borrowed from the pool
+    int64_t m_borrowedTime;                 // set by markInUse(), read by the thread returning it
+    uint64_t m_backendId;                   // backend in the load balancer, 0 if unknown
+    std::shared_ptr<BackendStats> m_backendStats;  // load of the backend, may be null
+    PerformanceMonitor* m_monitor;          // stats of the owning pool, never null
+    QueryTracer* m_tracer;                  // tracer of the owning pool, null if not traced
+    int64_t m_connectStartMicros;           // traceClockMicros() around the last connect()
+    int64_t m_connectEndMicros;
+    int64_t m_traceWaitMicros;              // pool wait of the current checkout, taken by its first query
+    int64_t m_traceConnectMicros;           // part of the wait spent connecting this connection
     mutable std::mutex m_mutex; 
 
+    // 预处理语句LRU缓存（最近使用的在前），由m_mutex保护
+    std::list<PreparedStatementPtr> m_statementLru;
+    std::unordered_map<std::string, std::list<PreparedStatementPtr>::iterator> m_statementIndex;
+    size_t m_statementCacheSize;
+
+    // 当前的流式结果集，由m_mutex保护
+    std::weak_ptr<QueryResult> m_activeStream;
+    // 开始过流式查询，归还时不加锁就能跳过检查
+    std::atomic<bool> m_streamStarted;
+    // 上次建连或重置会话之后执行过文本协议的语句，由m_mutex保护
+    bool m_sessionChanged;
+
+
+    // 非阻塞执行的状态，由m_mutex保护
+    enum class AsyncStage {
+        IDLE,       // 没有进行中的非阻塞执行
+        QUERY,      // 发送语句、读取执行结果
+        STORE,      // 读取结果集
+        DONE        // 结果等待takeAsyncResult()取走
+    };
+    AsyncStage m_asyncStage;
+    std::string m_asyncSql;                 // 非阻塞API每次调用都要传入同一条语句
+    bool m_asyncIsQuery;
+    QueryResultPtr m_asyncResult;
+    std::chrono::steady_clock::time_point m_asyncStart;
 
     // 重连相关参数
     unsigned int m_reconnectInterval; // 重连间隔（毫秒）
@@ -240,16 +570,55 @@ private:
 
     void init();
 
+    // 关闭所有缓存的预处理语句，必须在持有m_mutex且关闭MYSQL句柄之前调用
+    void invalidateStatementsLocked();
+    // 淘汰超出容量的最久未使用的语句，必须在持有m_mutex时调用
+    void trimStatementCacheLocked();
+
+    // 执行其他命令之前，读掉未读完的流式结果集，必须在持有m_mutex时调用
+    void finishActiveStreamLocked();
+    // 中断socket并结束未读完的流式结果集，之后会话不能再使用，必须在持有m_mutex时调用
+    // @return 是否有被中断的结果集
+    bool abortActiveStreamLocked();
+
+    /**
+     * @brief 发送一批语句并读取每条语句的结果，必须在持有m_mutex时调用
+     * @param sql 用分号拼接好的语句
+     * @param first 这一批第一条语句在结果中的下标
+     * @param count 这一批的语句数量
+     * @return 失败语句的下标，全部成功时返回count + first
+     */
+    size_t executeBatchPacketLocked(const std::string& sql, size_t first, size_t count,
+                                    BatchResult& result);
+
+    // 推进非阻塞执行，必须在持有m_mutex时调用
+    bool advanceAsyncLocked();
+    // 非阻塞执行结束，记录查询统计和实例负载，必须在持有m_mutex时调用
+    void finishAsyncLocked(bool success, bool connectionError);
+    // 非阻塞执行失败，记录统计后抛出 db::SQLExecutionError，必须在持有m_mutex时调用
+    void failAsyncLocked(const std::string& what);
+
+    // 开始一次查询的追踪，需要计时时初始化timing并返回它，否则返回nullptr
+    QueryTiming* beginTrace(QueryTiming& timing);
+    // 查询结束，达到采样或慢查询条件时生成span交给追踪器
+    void finishTrace(const QueryTiming& timing, const std::string& sql, bool isQuery,
+                     bool success, unsigned int errorCode, const std::string& error);
+
     // retryQuerySql
-    QueryResultPtr executeQueryWithReconnect(const std::string& sql, bool isQuery);
+    QueryResultPtr executeQueryWithReconnect(const std::string& sql, bool isQuery,
+                                             ResultMode mode = ResultMode::BUFFERED);
 
     /**
      * @brief 执行SQL语句的内部方法
      * @param sql SQL语句
      * @param isQuery 是否是查询操作
+     * @param mode 查询结果的读取方式
+     * @param timing 追踪中的查询在这里累加QUERY和FETCH阶段的耗时，不追踪时为空
      * @return 查询结果
      */
-    QueryResultPtr executeInternal(const std::string& sql, bool isQuery);
+    QueryResultPtr executeInternal(const std::string& sql, bool isQuery,
+                                   ResultMode mode = ResultMode::BUFFERED,
+                                   QueryTiming* timing = nullptr);
 
     // Caculate Reconnect Delay
     // param: attempt times
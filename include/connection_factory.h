@@ -0,0 +1,85 @@
+#ifndef CONNECTION_FACTORY_H
+#define CONNECTION_FACTORY_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include "connection.h"
+
+/**
+ * @brief background connection creator
+ * 
+ * mysql_real_connect needs a TCP + TLS + auth handshake, so the pool never
+ * calls it on a caller's thread or while holding a lock. The pool asks the
+ * factory for connections, and the factory's threads create them and hand
+ * them back through the completion callback.
+ * 
+ * The number of threads bounds the number of handshakes in flight.
+ */
+class ConnectionFactory {
+public:
+    // creates and connects one connection, may throw
+    using CreateFunction = std::function<ConnectionPtr()>;
+    // called on a factory thread, with nullptr if the creation failed
+    using CompletionFunction = std::function<void(const ConnectionPtr&)>;
+
+    ConnectionFactory();
+    ~ConnectionFactory();
+
+    // disable copy constructor and copy assingments
+    ConnectionFactory(const ConnectionFactory&) = delete;
+    ConnectionFactory& operator=(const ConnectionFactory&) = delete;
+
+    /**
+     * @brief start the creator threads
+     * @param maxInFlight maximum number of connects running at the same time
+     * @param create function that creates one connection
+     * @param onComplete function that receives every created connection
+     */
+    void start(unsigned int maxInFlight, CreateFunction create, CompletionFunction onComplete);
+
+    /**
+     * @brief stop the creator threads
+     * @return number of requests that were dropped before they started
+     * 
+     * waits for the connects that are already in flight, their results still go to onComplete
+     */
+    size_t stop();
+
+    /**
+     * @brief ask for more connections
+     * @param count number of connections
+     * @return number of accepted requests, 0 when the factory is not running
+     */
+    size_t request(size_t count = 1);
+
+    /**
+     * @brief get count of requests not started yet
+     */
+    size_t getQueuedCount() const;
+
+    /**
+     * @brief get count of connects in flight
+     */
+    size_t getInFlightCount() const;
+
+    bool isRunning() const;
+
+private:
+    std::vector<std::thread> m_threads;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_condition;
+    size_t m_queued;
+    std::atomic<size_t> m_inFlight;
+    bool m_running;
+
+    CreateFunction m_create;
+    CompletionFunction m_onComplete;
+
+    void worker();
+};
+
+#endif // CONNECTION_FACTORY_H
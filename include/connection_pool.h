@@ -3,35 +3,103 @@
 
 #include <string>
 #include <vector>
-#include <queue>
-#include <map>
 #include <mutex>
 #include <condition_variable>
 #include <thread>
 #include <atomic>
 #include <chrono>
 #include <memory>
+#include <deque>
+#include <unordered_map>
+#include <functional>
+#include <cstdint>
 #include "connection.h"
 #include "pool_config.h"
 #include "logger.h"
 #include "load_balancer.h"
+#include "idle_connection_store.h"
+#include "backend_pool.h"
+#include "snapshot_cell.h"
+#include "connection_factory.h"
+#include "ping_workers.h"
+#include "startup_report.h"
+#include "performance_monitor.h"
+#include "pool_metrics.h"
+#include "pool_autoscaler.h"
+#include "query_cache.h"
+#include "query_trace.h"
+
+
+class ConnectionPool;
+
+/**
+ * @brief deleter of PooledConnection
+ * 
+ * returns the connection to the pool instead of deleting it.
+ * It remembers the slot of the connection, so returning is O(1), lock-free
+ * on the fast path and does not allocate.
+ */
+class PooledConnectionDeleter {
+public:
+    PooledConnectionDeleter();
+    PooledConnectionDeleter(ConnectionPool* pool, size_t slot);
+
+    void operator()(Connection* connection) const;
+
+    size_t getSlot() const;
+
+private:
+    ConnectionPool* m_pool;
+    size_t m_slot;
+};
+
+/**
+ * @brief move-only handle of a borrowed connection
+ * 
+ * the connection goes back to the pool when the handle is destroyed or reset()
+ * 
+ * usage:
+ * {
+ *     PooledConnection conn = ConnectionPool::getInstance().acquire();
+ *     conn->executeQuery("SELECT 1");
+ * }   // returned here, even if executeQuery throws
+ */
+using PooledConnection = std::unique_ptr<Connection, PooledConnectionDeleter>;
 
 
 /**
- * @brief A singleton class for connection
+ * @brief Connection pool
  * 
- * Connection pool
  * store reusable connection
+ * 
+ * getInstance() is the default pool, it uses LoadBalancer::getInstance() and
+ * PerformanceMonitor::getInstance(). getInstance(name) returns a named pool with its own
+ * PoolConfig, load balancer and stats, so workloads (OLTP, analytics, tenants) are isolated
+ * and sized separately. A pool can also be constructed directly and owned by the caller.
+ * 
+ * connections are partitioned into one BackendPool per database of the load balancer.
+ * Every checkout asks the load balancer for a database and takes a connection of that
+ * database, so a weight change or a removed database shifts traffic right away
  */
 class ConnectionPool {
 
+    // per-thread state, defined below; BorrowerState hands it out without its members
+    struct ThreadCacheSlot;
+
 public:
 
-// singleton
-static ConnectionPool& getInstance() {
-    static ConnectionPool instance;
-    return instance;
-}
+// default instance
+static ConnectionPool& getInstance();
+
+// named instance, created on first use and kept until the process exits
+// "default" is the same pool as getInstance()
+static ConnectionPool& getInstance(const std::string& name);
+
+// names of the pools created through getInstance() so far
+static std::vector<std::string> getInstanceNames();
+
+// an independent pool with its own load balancer and stats
+explicit ConnectionPool(const std::string& name);
 
 // disable copy constructor and copy assingments
 ConnectionPool(const ConnectionPool&) = delete;
@@ -43,14 +111,18 @@ ConnectionPool& operator=(const ConnectionPool&) = delete;
 /**
      * @brief init connction pool
      * @param config pool config
+     * @return warm-up report with per-backend timing
      * @throws std::runtime_error 
      * 
      * 1. store pool config
-     * 2. init load balancer
-     * 3. create connections
-     * 4. start a health-check thread
+     * 2. spread initConnections over the load balancer's databases
+     * 3. create them in parallel, at most warmupConcurrency at a time, within warmupTimeout
+     * 4. return once every database has minReadyPerBackend connections, or all are created
+     * 5. start the background factory and a health-check thread
+     * 
+     * connections not started when init returns are created by the background factory
      */
-void init(const PoolConfig& config);
+StartupReport init(const PoolConfig& config);
 
 /**
      * @brief showdown connection pool
@@ -74,27 +146,124 @@ bool isInitialized() const;
      * @return a shared pointer that points to a connection
      * @throws std::runtime_error 
      * 
-     * 1. check if has a avaliable connection in FIFO queue
-     * 2. if no avaliable connection left, and does not reach to connection limitations, try to create a connection
-     * 3. if no condtions met, wait other thread to release connection
-     * 4. validate connection
-     * 5. add the connection to the m_activeConnections
+     * 1. ask the load balancer for a database and check the idle store of its backend pool
+     * 2. if no avaliable connection left, and does not reach to connection limitations, ask the
+     *    background factory to create a connection for that database
+     * 3. wait for the first connection of that database that becomes ready, released or newly created;
+     *    when the database is at its own maxConnections, an idle connection of another database is taken
+     * 4. validate connection according to PoolConfig::validationPolicy, without holding the pool lock
+     * 5. mark the connection as in use
      */
 ConnectionPtr getConnection(unsigned int timeout = 0);
 
+/**
+     * @brief get a available connection for reads or for writes
+     * @param mode READ_WRITE goes to a primary, READ_ONLY to a replica chosen by the load balancer
+     * @param timeout 
+     * @return a shared pointer that points to a connection
+     * @throws std::runtime_error 
+     * 
+     * READ_ONLY falls back to the primaries when no replica is configured.
+     * With PoolConfig::readAfterWriteWindow set, READ_ONLY also stays on the primaries for that
+     * many milliseconds after the calling thread used a READ_WRITE connection, so a thread
+     * reads its own writes even if the replicas lag behind.
+     * getConnection(timeout) is getConnection(AccessMode::READ_WRITE, timeout)
+     */
+ConnectionPtr getConnection(AccessMode mode, unsigned int timeout = 0);
+
+/**
+     * @brief get a available connection, waiting in line with the given priority
+     * @param mode see getConnection(mode, timeout)
+     * @param timeout milliseconds, 0 uses PoolConfig::connectionTimeout
+     * @param priority when the backend is exhausted, waiters are served highest priority first,
+     *        then in arrival order; connections are handed to the first waiter directly
+     * @return a shared pointer that points to a connection
+     * @throws std::runtime_error on timeout, or right away when PoolConfig::maxWaitQueueLength waiters
+     *         are already queued or PoolConfig::failFastOnEstimatedWait predicts the timeout would expire
+     */
+ConnectionPtr getConnection(AccessMode mode, unsigned int timeout, AcquirePriority priority);
+
+/**
+     * @brief get a available connection wrapped in a RAII handle
+     * @param timeout 
+     * @return a handle that returns the connection to the pool on destruction
+     * @throws std::runtime_error 
+     * 
+     * same as getConnection(), but the caller cannot forget to release the connection,
+     * and returning does not copy a shared_ptr
+     */
+PooledConnection acquire(unsigned int timeout = 0);
+
+/**
+     * @brief same as getConnection(mode, timeout), wrapped in a RAII handle
+     */
+PooledConnection acquire(AccessMode mode, unsigned int timeout = 0,
+                         AcquirePriority priority = AcquirePriority::NORMAL);
+
+/**
+     * @brief run a read query through the pool's result cache
+     * @param sql SELECT statement, the key is the SQL with whitespace normalized
+     * @param tags names the result depends on, usually its tables, see invalidateQueryCache()
+     * @param ttl validity in milliseconds, 0 uses PoolConfig::queryCacheTtl
+     * @return a result over the cached rows, every caller gets its own cursor
+     * @throws std::runtime_error, db::SQLExecutionError like acquire() and executeQuery()
+     * 
+     * a hit does not borrow a connection. A miss runs the query on a READ_ONLY connection
+     * and stores the rows, unless an invalidation happened while it ran.
+     * With PoolConfig::queryCacheMaxBytes 0 every call is a miss and nothing is stored.
+     */
+QueryResultPtr executeCachedQuery(const std::string& sql, const std::vector<std::string>& tags = {},
+                                  unsigned int ttl = 0);
+
+/**
+     * @brief same as executeCachedQuery() for a statement with placeholders
+     * @param params bound as strings to a prepared statement, part of the cache key
+     */
+QueryResultPtr executeCachedStatement(const std::string& sql, const std::vector<std::string>& params,
+                                      const std::vector<std::string>& tags = {}, unsigned int ttl = 0);
+
+/**
+     * @brief drop the cached results stored with a tag, call it after writing to the tagged table
+     * @return number of dropped results
+     */
+size_t invalidateQueryCache(const std::string& tag);
+
+void clearQueryCache();
+
+QueryCache::Stats getQueryCacheStats() const;
+
 /**
      * @brief release a connection
      * @param connection connection to be released 
      * @return void
      * 
-     * 1. remove the connection from the m_activeConnections
-     * 2. validate the connection
-     * 3. if the connection is still valid, add the connection to the backup queue
-     * 4. if the connection is not valid, destory the connection.
-     * 5. notify other thread
+     * 1. mark the connection as idle
+     * 2. cancel a streaming result that was not read to the end, this closes the connection
+     * 3. check the connection is still open (no network I/O, liveness is checked on borrow)
+     * 4. if the connection is still open, add the connection to the idle store
+     * 5. if the connection is closed, destory the connection outside the lock.
+     * 6. wake up one waiting thread
      */
 void releaseConnection(ConnectionPtr connection);
 
+// read-after-write state of a thread (see PoolConfig::readAfterWriteWindow), see releaseFor()
+using BorrowerState = std::shared_ptr<ThreadCacheSlot>;
+
+// state of the calling thread, null when it has never written through this pool
+BorrowerState getBorrowerState();
+
+/**
+     * @brief return a connection on another thread than the one that borrowed it
+     * @param connection a connection of this pool
+     * @param borrower getBorrowerState() of the borrowing thread, taken after it borrowed the connection
+     *
+     * for code that hands connections to worker threads, like AsyncExecutor. The connection
+     * skips the calling thread's cache (PoolConfig::threadLocalCache), where no checkout of
+     * the borrower would find it, and a primary restarts the borrower's read-after-write window
+     * instead of the calling thread's
+     */
+void releaseFor(PooledConnection connection, const BorrowerState& borrower);
+
 /**
      * @brief get count of idle connection in the queue
      * @return count
@@ -114,25 +283,51 @@ size_t getActiveCount() const;
      */
 size_t getTotalCount() const;
 
+/**
+     * @brief number of connections the autoscaler is steering the pool to
+     * @return target, 0 while PoolConfig::autoScaling is off or before its first sample
+     */
+size_t getAutoscaleTarget() const;
+
 std::string getStatus() const;
 
 PoolConfig getConfig() const;
 
 std::string getLoadBalancerStatus() const;
 
+const std::string& getName() const;
+
+// backends of this pool, removing or reweighting a database here shifts its traffic
+LoadBalancer& getLoadBalancer() const;
+
+// stats of this pool and its connections
+PerformanceMonitor& getPerformanceMonitor() const;
+
+// sampled query spans and the slow-query log of this pool's connections, add sinks here
+QueryTracer& getQueryTracer();
+
 void setLoadBalanceStrategy(LoadBalanceStrategy strategy);
 
 LoadBalanceStrategy getLoadBalanceStrategy() const;
 
 
-void initWithSingleDatabase(const PoolConfig& poolConfig, const std::string& host, const std::string& user, const std::string& password, const std::string& database, unsigned int port = 3306, unsigned int weight = 1);
+StartupReport initWithSingleDatabase(const PoolConfig& poolConfig, const std::string& host, const std::string& user, const std::string& password, const std::string& database, unsigned int port = 3306, unsigned int weight = 1);
 
                                
-void initWithMultipleDatabases(const PoolConfig& poolConfig, const std::vector<DBConfig>& databases, LoadBalanceStrategy strategy = LoadBalanceStrategy::WEIGHTED);
+StartupReport initWithMultipleDatabases(const PoolConfig& poolConfig, const std::vector<DBConfig>& databases, LoadBalanceStrategy strategy = LoadBalanceStrategy::WEIGHTED);
 
 
 std::string getDetailedStatus() const;
 
+/**
+     * @brief snapshot of the gauges, counters, latencies and per-backend load
+     * @return metrics, see MetricsExporter for rendering them
+     * 
+     * reads atomics and immutable snapshots only, never the pool's mutex,
+     * so scraping does not slow down getConnection()
+     */
+PoolMetrics getMetrics() const;
+
 // performHealthCheck Manually
 void performHealthCheck();
 
@@ -145,43 +340,238 @@ bool setTimeoutSettings(unsigned int connectionTimeout, unsigned int maxIdleTime
 
 
 private:
-    // private Constructor
+    friend class PooledConnectionDeleter;
+
+    // the default pool, shares the global load balancer and stats
     ConnectionPool();
 
+    std::string m_name;
+    // null for the default pool
+    std::unique_ptr<LoadBalancer> m_ownedLoadBalancer;
+    std::unique_ptr<PerformanceMonitor> m_ownedMonitor;
+    LoadBalancer* m_loadBalancer;
+    PerformanceMonitor* m_monitor;
+
+    // guarded by m_mutex
     PoolConfig m_config;
-    // queue for connection storage
-    std::queue<ConnectionPtr> m_idleConnections;
-    // map that maps active connection's id to shared_ptr pointing to active connection
-    std::map<std::string, ConnectionPtr> m_activeConnections;
+    // m_config for the checkout and return paths, which read it without m_mutex;
+    // stored whenever m_config is assigned
+    SnapshotCell<PoolConfig> m_liveConfig;
+
+    // one sub-pool per backend of the load balancer, replaced as a whole when the backend set changes
+    struct BackendPoolTable {
+        std::vector<BackendPoolPtr> pools;      // including draining ones that still have connections
+        std::unordered_map<uint64_t, BackendPoolPtr> byId;
+        uint64_t balancerVersion = 0;           // LoadBalancer::getVersion() the table was built from
+        bool hasReplicas = false;               // read-only checkouts do not go to the primaries
+    };
+    // read without locking on every checkout and return, rebuilt under m_mutex
+    SnapshotCell<BackendPoolTable> m_backendPools;
+    // slot table that owns every connection of the pool, indexed by Connection::getPoolSlot()
+    // only changes when a connection is created or destroyed, guarded by m_mutex
+    std::vector<ConnectionPtr> m_connections;
+    std::vector<size_t> m_freeSlots;
 
     // threads synchroniztion
     mutable std::mutex m_mutex;
-    std::condition_variable m_condition;
+    // serializes init() and shutdown(), the warm-up runs without holding m_mutex
+    std::mutex m_initMutex;
+    // number of threads waiting on any sub-pool, release only takes m_mutex when it is not zero
+    std::atomic<size_t> m_waiters;
+
+    // background connection creators, a pending connection already holds a place in m_totalConnections
+    ConnectionFactory m_factory;
+    std::atomic<size_t> m_pendingConnections;
+    // backend of every request given to the factory, in request order
+    std::mutex m_createMutex;
+    std::deque<BackendPoolPtr> m_createQueue;
+    // ping the batches of checkIdleConnections(), stopped by shutdown()
+    PingWorkers m_pingers;
 
     // connection pool status
     std::atomic<bool> m_isRunning;
     std::atomic<size_t> m_totalConnections;
+    std::atomic<size_t> m_activeConnections;
     
     // background thread for connditions' health check
     std::thread m_healthCheckThread;
-
-
-    ConnectionPtr createConnection();
+    // wakes the health-check thread on shutdown and when the config changes, waited on with m_mutex
+    std::condition_variable m_healthCondition;
+
+    // returned connections whose session is cleaned up in the background, see asyncSessionReset.
+    // they stay marked as in use until they are recycled, so shutdown treats them as borrowed
+    std::thread m_resetThread;
+    std::mutex m_resetMutex;
+    std::condition_variable m_resetCondition;
+    std::deque<std::pair<Connection*, size_t>> m_resetQueue;   // (connection, slot), guarded by m_resetMutex
+    Connection* m_resetting;                                    // being cleaned up, guarded by m_resetMutex
+    bool m_resetStopping;                                       // no reset thread, guarded by m_resetMutex
+
+    // autoscaling state, only touched by the health-check thread
+    PoolAutoscaler m_autoscaler;
+
+    // results of executeCachedQuery/executeCachedStatement, sized by PoolConfig::queryCacheMaxBytes
+    QueryCache m_queryCache;
+    // configured from PoolConfig::traceSampleRate and slowQueryThreshold, given to every connection
+    QueryTracer m_tracer;
+
+    // state of one thread in this pool: the connection it returned and keeps for its next checkout
+    // (see PoolConfig::threadLocalCache) and its last write (see PoolConfig::readAfterWriteWindow).
+    // the kept connection stays marked as in use; the owner and a reclaiming thread both take it
+    // with an exchange, so exactly one of them gets it
+    struct ThreadCacheSlot {
+        std::atomic<Connection*> connection{nullptr};
+        std::atomic<int64_t> parkedMillis{0};       // Utils::currentTimeMillis() when it was returned
+        std::atomic<uint64_t> backendId{0};         // of the connection, read without touching it
+        std::atomic<bool> retired{false};           // the pool is gone, the thread drops the slot
+        std::atomic<int64_t> lastWriteMillis{0};    // 0 if the thread never wrote, set by releaseFor() too
+    };
+    // keys the thread-local lookup of the slot, unlike the address it is never reused
+    const uint64_t m_instanceId;
+    // slots of all threads that returned a connection or wrote, guarded by m_threadCacheMutex
+    std::mutex m_threadCacheMutex;
+    std::vector<std::shared_ptr<ThreadCacheSlot>> m_threadCaches;
+
+    PoolMetrics m_lastScaleMetrics;
+    // last target of the autoscaler, idle connections are not trimmed below it
+    std::atomic<size_t> m_autoscaleTarget;
+
+    // warm-up threads of init, they may still finish their last connect after init returned
+    struct WarmupState;
+    std::shared_ptr<WarmupState> m_warmupState;
+    std::vector<std::thread> m_warmupThreads;
+
+
+    // create a connection for the next request in m_createQueue, runs on a factory thread
+    ConnectionPtr createRequestedConnection();
+    // create a connection to the given backend, the connection reports its load to the backend's stats
+    ConnectionPtr createConnection(const Backend& backend);
+
+    // the cached path of executeCachedQuery/executeCachedStatement, run() executes the query on a miss
+    QueryResultPtr executeCached(const std::string& key, const std::vector<std::string>& tags, unsigned int ttl,
+                                 const std::function<ResultRowsPtr(PooledConnection&)>& run);
+
+    // create initConnections in parallel, called by init without holding m_mutex
+    StartupReport warmUp(size_t targetConnections);
+    void warmupWorker(const std::shared_ptr<WarmupState>& state);
+    // stop the warm-up threads, connections they are still creating are closed if abort is true
+    void stopWarmup(bool abort);
+
+    // shared part of getConnection() and acquire(), returns a connection marked as in use
+    Connection* acquireConnection(unsigned int timeout, AccessMode mode, AcquirePriority priority);
+    // queue the waiter on pool and sleep until it is handed a connection, told to retry or times out
+    // called and returns with lock held; throws on timeout, rejection or shutdown
+    Connection* waitForConnection(std::unique_lock<std::mutex>& lock, const BackendPoolPtr& pool,
+                                  AcquireWaiter& waiter, unsigned int timeout);
+    // shared part of releaseConnection() and PooledConnection, hands a dirty session to the reset thread
+    void returnConnection(Connection* connection, size_t slot);
+    // second half of returnConnection() after the thread cache, also used by releaseFor()
+    void returnToPool(Connection* connection, size_t slot);
+    // mark a returned connection idle and put it back into its idle store, or close it
+    // sessionClean skips the session cleanup, the reset thread has already done it
+    void recycleConnection(Connection* connection, size_t slot, bool sessionClean);
+    // second half of recycleConnection() for a connection already marked idle and counted as returned
+    void putBackConnection(Connection* connection, size_t slot, bool sessionClean);
+
+    // slot of the calling thread, registered on first use when create is true; null if there is none
+    const std::shared_ptr<ThreadCacheSlot>& threadCacheEntry(bool create);
+    ThreadCacheSlot* threadCacheSlot(bool create) {
+        return threadCacheEntry(create).get();
+    }
+    // keep a returned connection in the calling thread's slot, false if it has to go back to the pool
+    bool parkInThreadCache(Connection* connection);
+    // restart the read-after-write window of slot's thread when it returns a connection of a primary
+    void extendReadAfterWrite(ThreadCacheSlot* slot, const Connection& connection);
+    // the connection in the calling thread's slot if it can serve mode, nullptr otherwise
+    Connection* takeThreadCachedConnection(AccessMode mode);
+    // put connections parked before parkedBefore (milliseconds) back into the pool, at most limit of them,
+    // those of backendId first; slots of exited threads are dropped. returns the number reclaimed
+    size_t reclaimThreadCaches(int64_t parkedBefore, size_t limit = SIZE_MAX, uint64_t backendId = 0);
+    // the cleanup sessionResetPolicy asks for before connection can be reused, NONE if it is clean
+    SessionResetPolicy sessionResetNeeded(const Connection& connection) const;
+    // queue a connection for the reset thread, false if the thread is not running
+    bool queueSessionReset(Connection* connection, size_t slot);
+    // cleans up the sessions of queued connections and recycles them, drains the queue on shutdown
+    void sessionResetWorker();
+
+    // put a connection into the slot table, called with m_mutex held
+    void registerConnection(const ConnectionPtr& connection);
+    // remove a connection from the slot table, called with m_mutex held
+    // the caller keeps the returned pointer alive and closes it outside the lock
+    ConnectionPtr unregisterConnection(Connection* connection, size_t slot);
+
+    // pick a backend for mode with the load balancer and return its sub-pool, never a draining one
+    // anyRole ignores mode and picks among all backends, for connections created ahead of demand
+    BackendPoolPtr selectBackendPool(AccessMode mode, bool anyRole = false);
+    // sub-pool of a connection, valid as long as the connection holds its place
+    BackendPoolPtr findBackendPool(uint64_t backendId);
+    // rebuild the sub-pools from the load balancer's backends when its version changed, or always if force
+    // the idle connections of removed backends are closed outside the lock
+    void syncBackendPools(bool force = false);
+    std::vector<ConnectionPtr> syncBackendPoolsLocked(bool force);
+    // an idle connection of another backend with the same role as exclude, for a checkout whose backend is full
+    Connection* stealIdleConnection(const BackendPool* exclude);
+    // another backend with the same role as exclude that is still below its maximum
+    BackendPoolPtr findGrowableBackendPool(const BackendPool* exclude);
+
+    // reserve a place for a new connection if the pool and the backend are below maxConnections
+    bool tryReserveConnection(BackendPool& pool);
+    // give a place back if the pool is above limit
+    bool tryRetireConnection(BackendPool& pool, size_t limit);
+    // give a place back unconditionally, pool may be null when the backend is unknown
+    void releasePlace(BackendPool* pool);
+
+    // reserve places and ask the factory to create connections in the background
+    // returns the number of requested connections
+    size_t requestConnections(const BackendPoolPtr& pool, size_t count);
+    // same, with the backends chosen by the load balancer
+    size_t requestConnections(size_t count);
+    // request connections ahead of demand when idle + pending drops below lowWaterMark
+    void growToLowWaterMark();
+    // completion callback of the factory, runs on a factory thread
+    void onConnectionCreated(const ConnectionPtr& connection);
+    // put a connection back into its backend's idle store and wake up one waiter
+    // oldest puts it behind the recently used connections, for one that was only checked
+    void addIdleConnection(BackendPool& pool, Connection* connection, bool oldest = false);
+    // unregister a connection whose place has already been given back, and close it
+    void destroyConnection(Connection* connection, size_t slot);
+    // a connection of pool became idle, hand it to the first thread waiting for it,
+    // or to a waiter of a full backend that may take it instead
+    void notifyWaiter(BackendPool& pool);
+    // move idle connections to the waiters in queue order, called with m_mutex held
+    void dispatchIdleConnectionsLocked(BackendPool& pool);
+    // a place was given back, wake up the first waiter per backend so it can ask for a new connection
+    void notifyCapacityReleased();
 
     // healthCheckWorker
-    // used to perform health check
-    // 1. clean up all outdated connections
-    // 2. clean up all died connections
-    // 3. create connections to meet the minConnection condition.
+    // every healthCheckPeriod it picks up backend changes and creates connections to meet minConnections.
+    // idle connections are checked in small batches spread over the period, see checkIdleConnections()
+    // with autoScaling, it also runs autoscale() every autoScaleInterval
     void healthCheckWorker();
-
+    // check the idle connections that are due, returns the milliseconds until the next batch
+    // is due so that every idle connection is visited about once per healthCheckPeriod
+    int64_t checkIdleConnectionsStep(const PoolConfig& config);
+    // take up to healthCheckBatchSize idle connections of pool that were neither used nor checked
+    // since dueBefore, ping them in parallel without holding any lock, then put them back or close
+    // the dead and the outdated ones; returns the number of connections taken
+    size_t checkIdleConnections(const PoolConfig& config, BackendPool& pool, int64_t dueBefore);
+    // feed the demand since the last call to the autoscaler, then grow the pool to its target
+    // in the background or close idle connections above it; called without holding m_mutex
+    void autoscale(const PoolConfig& config);
+
+    // check every idle connection now, batch after batch
     void cleanupIdleConnections();
     // ensure Minimum Connections
     void ensureMinimumConnections();
-    // validate connection when release connection
-    bool validateConnection(ConnectionPtr connection, bool allowReconnect);
-
-    void shrinkPoolToSize(unsigned int targetSize);
+    // validate connection, must be called without holding m_mutex
+    bool validateConnection(Connection* connection, bool allowReconnect);
+    // decide if an idle connection needs a ping before it is handed out
+    bool needsValidationOnBorrow(const Connection* connection) const;
+
+    // remove idle connections until the pool reaches targetSize, called with m_mutex held
+    // the removed connections are returned so the caller can close them outside the lock
+    // keepBackendMinimum leaves backends at their DBConfig minimum alone
+    std::vector<ConnectionPtr> shrinkPoolToSize(unsigned int targetSize, bool keepBackendMinimum = false);
     
 
     // =========================
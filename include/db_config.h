@@ -4,6 +4,18 @@
 #include <string>
 #include <vector>
 
+/**
+ * @brief 数据库实例在主从复制中的角色
+ */
+enum class DBRole {
+    PRIMARY,    // 主库：处理写入，也可以处理读取
+    REPLICA     // 从库：只处理读取，数据可能略有延迟
+};
+
+inline std::string roleToString(DBRole role) {
+    return role == DBRole::REPLICA ? "Replica" : "Primary";
+}
+
 /**
  * @brief 单个数据库实例的配置信息
  * 
@@ -20,12 +32,15 @@ struct DBConfig {
     std::string database;   // 数据库名称
     unsigned int port;      // 端口号，MySQL默认3306
     unsigned int weight;    // 权重，用于负载均衡（数值越大，被选中概率越大）
+    unsigned int minConnections;  // 该实例子连接池的最小连接数，0表示不单独保证
+    unsigned int maxConnections;  // 该实例子连接池的最大连接数，0表示只受连接池总数限制
+    DBRole role;                  // 实例角色，默认为主库
 
     /**
      * @brief 默认构造函数
      * 设置MySQL的标准默认值
      */
-    DBConfig() : port(3306), weight(1) {}
+    DBConfig() : port(3306), weight(1), minConnections(0), maxConnections(0), role(DBRole::PRIMARY) {}
 
     /**
      * @brief 便捷构造函数
@@ -35,12 +50,14 @@ struct DBConfig {
      * @param database 数据库名
      * @param port 端口，默认3306
      * @param weight 权重，默认1
+     * @param role 实例角色，默认主库
      */
     DBConfig(const std::string& host, const std::string& user,
              const std::string& password, const std::string& database,
-             unsigned int port = 3306, unsigned int weight = 1)
+             unsigned int port = 3306, unsigned int weight = 1,
+             DBRole role = DBRole::PRIMARY)
         : host(host), user(user), password(password), database(database),
-          port(port), weight(weight) {}
+          port(port), weight(weight), minConnections(0), maxConnections(0), role(role) {}
 
     /**
      * @brief 验证配置是否有效
@@ -0,0 +1,53 @@
+#ifndef FIELD_VIEW_H
+#define FIELD_VIEW_H
+
+#include <string>
+#include <cstring>
+#include <cstddef>
+
+/**
+ * @brief read-only view of one field value of the current row
+ *
+ * points into the row buffer of the result (MYSQL_ROW or ResultRows), nothing is copied,
+ * so it is only valid until the result moves to another row, is reset, closed or destroyed.
+ * A NULL value is a view with data() == nullptr.
+ *
+ * The to*() parsers never throw and never allocate: they return false for NULL,
+ * for text that is not entirely a number in the C locale, and for values out of range.
+ */
+class FieldView {
+public:
+    FieldView() : m_data(nullptr), m_size(0) {}
+    FieldView(const char* data, size_t size) : m_data(data), m_size(size) {}
+
+    const char* data() const { return m_data; }
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    bool isNull() const { return m_data == nullptr; }
+
+    const char* begin() const { return m_data; }
+    const char* end() const { return m_data + m_size; }
+    char operator[](size_t index) const { return m_data[index]; }
+
+    // copy the value, NULL becomes an empty string
+    std::string toString() const { return m_data ? std::string(m_data, m_size) : std::string(); }
+
+    bool equals(const char* text, size_t length) const {
+        return m_data && m_size == length && std::memcmp(m_data, text, length) == 0;
+    }
+    bool operator==(const std::string& text) const { return equals(text.data(), text.size()); }
+    bool operator==(const char* text) const { return text && equals(text, std::strlen(text)); }
+    bool operator!=(const std::string& text) const { return !(*this == text); }
+    bool operator!=(const char* text) const { return !(*this == text); }
+
+    bool toInt(int& value) const;
+    bool toLong(long long& value) const;
+    bool toUnsignedLong(unsigned long long& value) const;
+    bool toDouble(double& value) const;
+
+private:
+    const char* m_data;
+    size_t m_size;
+};
+
+#endif // FIELD_VIEW_H
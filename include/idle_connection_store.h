@@ -0,0 +1,117 @@
+#ifndef IDLE_CONNECTION_STORE_H
+#define IDLE_CONNECTION_STORE_H
+
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "pool_config.h"
+
+class Connection;
+
+/**
+ * @brief Sharded store for idle connections
+ *
+ * Each thread pushes to and pops from its own shard, so concurrent
+ * acquire/release calls touch different locks and cache lines.
+ * When the local shard is empty, pop() steals from the other shards.
+ *
+ * The store does not own the connections, it only keeps raw pointers.
+ * Ownership stays with the ConnectionPool.
+ */
+class IdleConnectionStore {
+public:
+    /**
+     * @brief constructor
+     * @param shardCount number of shards, 0 means one shard per hardware thread
+     * @param order LIFO keeps hot connections warm, FIFO rotates connections
+     */
+    explicit IdleConnectionStore(size_t shardCount = 0, IdleOrder order = IdleOrder::LIFO);
+
+    // disable copy constructor and copy assingments
+    IdleConnectionStore(const IdleConnectionStore&) = delete;
+    IdleConnectionStore& operator=(const IdleConnectionStore&) = delete;
+
+    /**
+     * @brief rebuild the shards
+     * @param shardCount number of shards, 0 means one shard per hardware thread
+     * 
+     * must only be called while the store is empty and not used by other threads
+     */
+    void resize(size_t shardCount);
+
+    /**
+     * @brief change the order for following pop() calls
+     */
+    void setOrder(IdleOrder order);
+
+    IdleOrder getOrder() const;
+
+    /**
+     * @brief put an idle connection into the calling thread's shard
+     */
+    void push(Connection* connection);
+
+    /**
+     * @brief take an idle connection
+     * @return a connection, or nullptr when every shard is empty
+     * 
+     * 1. try the calling thread's shard, in LIFO or FIFO order
+     * 2. steal the oldest connection from the other shards
+     */
+    Connection* pop();
+
+    /**
+     * @brief remove and return every idle connection
+     */
+    std::vector<Connection*> drain();
+
+    /**
+     * @brief remove up to maxCount connections that match predicate, oldest first
+     * @param predicate called with a shard lock held, must be cheap and must not use the store
+     *
+     * every shard is scanned from its oldest connection, and the shards take turns,
+     * so the old connections of every shard are found, not only those of the first one
+     */
+    std::vector<Connection*> takeOldest(size_t maxCount, const std::function<bool(const Connection*)>& predicate);
+
+    /**
+     * @brief put a connection taken by takeOldest() back at the oldest end of the calling thread's shard
+     *
+     * with LIFO it stays behind the recently used connections, so a background check
+     * does not keep a connection from aging out
+     */
+    void pushOldest(Connection* connection);
+
+    /**
+     * @brief get count of idle connection, without taking any lock
+     */
+    size_t size() const;
+
+    bool empty() const;
+
+    size_t getShardCount() const;
+
+private:
+    struct Shard {
+        std::mutex mutex;
+        std::deque<Connection*> connections;
+        std::atomic<size_t> count{0};
+        // keep neighbouring shards on different cache lines
+        char padding[64];
+    };
+
+    std::unique_ptr<Shard[]> m_shards;
+    size_t m_shardCount;
+    std::atomic<size_t> m_size;
+    std::atomic<IdleOrder> m_order;
+
+    // pop from one shard, steal takes the oldest connection
+    Connection* popFromShard(Shard& shard, bool steal);
+
+    static size_t defaultShardCount();
+};
+
+#endif // IDLE_CONNECTION_STORE_H
@@ -0,0 +1,143 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "utils.h"
+
+// Log-linear bucket layout shared by LatencyHistogram and HistogramSnapshot.
+// Values below 16 get a bucket each; above that every power of two is split into
+// 16 buckets, so a recorded value is off by at most 1/16 (6.25%), like an HDR
+// histogram with one significant digit. Values are clamped at 2^40 - 1.
+struct HistogramLayout {
+    static const unsigned SUB_BUCKET_BITS = 4;
+    static const uint64_t SUB_BUCKETS = 1ULL << SUB_BUCKET_BITS;
+    static const unsigned MAX_EXPONENT = 40;
+    static const size_t BUCKET_COUNT = SUB_BUCKETS * (MAX_EXPONENT - SUB_BUCKET_BITS + 1);
+
+    static size_t bucketIndex(uint64_t value) {
+        if (value < SUB_BUCKETS) {
+            return static_cast<size_t>(value);
+        }
+        if (value >> MAX_EXPONENT) {
+            return BUCKET_COUNT - 1;
+        }
+        unsigned exponent = 63 - static_cast<unsigned>(__builtin_clzll(value));
+        unsigned shift = exponent - SUB_BUCKET_BITS;
+        return static_cast<size_t>(SUB_BUCKETS * (shift + 1) + ((value >> shift) & (SUB_BUCKETS - 1)));
+    }
+
+    // largest value that falls into the bucket
+    static uint64_t bucketUpperBound(size_t index) {
+        if (index < SUB_BUCKETS) {
+            return index;
+        }
+        unsigned shift = static_cast<unsigned>(index / SUB_BUCKETS) - 1;
+        uint64_t lower = (SUB_BUCKETS + index % SUB_BUCKETS) << shift;
+        return lower + (1ULL << shift) - 1;
+    }
+};
+
+
+/**
+ * @brief point-in-time copy of a LatencyHistogram
+ *
+ * plain numbers, so it can be merged, subtracted for an interval and queried
+ * for percentiles without touching the live histogram again
+ */
+class HistogramSnapshot {
+public:
+    HistogramSnapshot();
+
+    uint64_t getCount() const {
+        return m_count;
+    }
+
+    uint64_t getSum() const {
+        return m_sum;
+    }
+
+    // largest recorded value; for an interval, the upper bound of its highest bucket
+    uint64_t getMax() const {
+        return m_max;
+    }
+
+    double getMean() const {
+        return m_count > 0 ? static_cast<double>(m_sum) / m_count : 0.0;
+    }
+
+    /**
+     * @brief value below which percentile percent of the recorded values fall
+     * @param percentile in (0, 100], e.g. 99.9
+     * @return upper bound of the bucket holding that rank, never above getMax(); 0 when empty
+     */
+    uint64_t getPercentile(double percentile) const;
+
+    // add the values of another snapshot, e.g. of another pool
+    void merge(const HistogramSnapshot& other);
+
+    // values recorded between earlier and this snapshot of the same histogram
+    HistogramSnapshot since(const HistogramSnapshot& earlier) const;
+
+    // number of values per bucket, see HistogramLayout
+    const std::vector<uint64_t>& getBuckets() const {
+        return m_buckets;
+    }
+
+private:
+    friend class LatencyHistogram;
+
+    std::vector<uint64_t> m_buckets;
+    uint64_t m_count;
+    uint64_t m_sum;
+    uint64_t m_max;
+};
+
+
+/**
+ * @brief lock-free histogram of latencies (or any non-negative value)
+ *
+ * record() only does relaxed atomic adds on the shard of the calling thread, so
+ * threads do not share cache lines while recording. snapshot() merges the shards
+ * while threads keep recording; a value recorded at the same time may or may not
+ * be included, nothing is ever stopped.
+ */
+class LatencyHistogram {
+public:
+    static const size_t SHARD_COUNT = 8;
+
+    LatencyHistogram();
+
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    void record(uint64_t value) {
+        Shard& shard = m_shards[Utils::currentThreadIndex() % SHARD_COUNT];
+        shard.buckets[HistogramLayout::bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+        shard.sum.fetch_add(value, std::memory_order_relaxed);
+        // the shard is mostly written by one thread, so this rarely loops
+        uint64_t max = shard.max.load(std::memory_order_relaxed);
+        while (value > max && !shard.max.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+        }
+    }
+
+    HistogramSnapshot snapshot() const;
+
+    // clear every shard, values recorded meanwhile may survive
+    void reset();
+
+private:
+    struct Shard {
+        std::atomic<uint64_t> buckets[HistogramLayout::BUCKET_COUNT];
+        std::atomic<uint64_t> sum;
+        std::atomic<uint64_t> max;
+        // keeps the hot fields of neighbouring shards on different cache lines
+        char padding[64];
+    };
+
+    std::unique_ptr<Shard[]> m_shards;
+};
+
+#endif // LATENCY_HISTOGRAM_H
@@ -4,28 +4,60 @@
 
 #include <vector>
 #include "db_config.h"
+#include "backend_stats.h"
+#include "snapshot_cell.h"
 #include <mutex>
-#include <random>
+#include <memory>
+#include <atomic>
+#include <cstdint>
 
 // define loadBalance Strategy
 enum class LoadBalanceStrategy {
     RANDOM,      // RANDOM choose database instance
     ROUND_ROBIN, //ROUND ROBIN algorithm to choose database instance
-    WEIGHTED   // Use Weighted to choose database instance
+    WEIGHTED,   // Use Weighted to choose database instance
+    LEAST_CONNECTIONS, // fewest queries in flight relative to weight
+    PEAK_EWMA,         // lowest latency average times (queries in flight + 1), relative to weight
+    POWER_OF_TWO       // draw two backends by weight, keep the one with the lower peak EWMA cost
 };
 
+// what a checkout is going to do with the connection
+enum class AccessMode {
+    READ_WRITE,  // pinned to the primaries
+    READ_ONLY    // spread over the replicas, falls back to the primaries when there is none
+};
+
+
+// One database instance known to the load balancer.
+// Published inside an immutable snapshot, so a selection hands out a
+// reference-counted pointer instead of copying the config strings.
+// The stats are mutable and shared with the connections to this backend.
+struct Backend {
+    DBConfig config;
+    uint64_t id;    // stable across weight updates, never reused
+    std::shared_ptr<BackendStats> stats;   // kept across weight updates as well
+
+    Backend(const DBConfig& config, uint64_t id, std::shared_ptr<BackendStats> stats)
+        : config(config), id(id), stats(std::move(stats)) {}
+};
+
+typedef std::shared_ptr<const Backend> BackendPtr;
+
 
 class LoadBalancer {
 
 public:
 
-// singleton class
+// default instance, used by ConnectionPool::getInstance()
 static LoadBalancer& getInstance() {
     // global instance
     static LoadBalancer instance;
     return instance;
 }
 
+// an independent balancer with its own backends, every named ConnectionPool owns one
+LoadBalancer();
+
 // disable copy constructor
 LoadBalancer(const LoadBalancer&) = delete;
 // disable copy assignment
@@ -41,7 +73,7 @@ void init(
 void initSingleDatabase(const std::string& host, const std::string& user,
                            const std::string& password, const std::string& database,
                            unsigned int port = 3306, unsigned int weight = 1);
-                           
+
 
 // change loadBalance stragety
 void setStrategy(LoadBalanceStrategy strategy);
@@ -49,7 +81,20 @@ void setStrategy(LoadBalanceStrategy strategy);
 // get using strategy
 LoadBalanceStrategy getStrategy() const;
 
-// use load balancer to get db config
+// select a backend without locking or allocating.
+// backends whose circuit breaker is open are skipped, see CircuitBreaker;
+// reads the current snapshot, so it never waits for addDatabase/removeDatabase/updateWeight;
+// the returned backend stays valid even if it is removed afterwards
+BackendPtr selectBackend();
+
+// same, but only among the backends that serve mode;
+// reads go to the primaries while the circuit of every replica is open
+BackendPtr selectBackend(AccessMode mode);
+
+// whether at least one replica is configured
+bool hasReplicas() const;
+
+// use load balancer to get db config (copies the config, prefer selectBackend)
 DBConfig getNextDatabase();
 
 // addDatabase
@@ -67,24 +112,75 @@ size_t getDatabaseCount() const;
 // get databases configuration
 std::vector<DBConfig> getDatabaseConfigs() const;
 
+// get the backends of the current snapshot
+std::vector<BackendPtr> getBackends() const;
+
+// version of the backend set, changes whenever a backend is added, removed or reweighted
+uint64_t getVersion() const;
+
 std::string getStatus() const;
 
-private: 
-// multiple db configs
-std::vector<DBConfig> m_configs;
-LoadBalanceStrategy m_strategy;
-size_t m_roundRobinIndex;
+private:
+
+// backends a selection chooses from, with everything the strategies need precomputed
+struct BackendGroup {
+    std::vector<BackendPtr> backends;
+    // alias table for WEIGHTED: column i keeps itself when the low 32 random bits
+    // are below aliasThreshold[i] (scaled to 2^32), otherwise it yields alias[i]
+    std::vector<uint64_t> aliasThreshold;
+    std::vector<uint32_t> alias;
+    uint64_t totalWeight = 0;
+};
+
+// immutable view of the backend set, replaced as a whole on every change
+struct Snapshot {
+    BackendGroup all;
+    BackendGroup primaries;
+    BackendGroup replicas;
+};
+
+typedef std::shared_ptr<const Snapshot> SnapshotPtr;
+
+// current snapshot, selection reads it through a thread-local cache
+SnapshotCell<Snapshot> m_snapshot;
+std::atomic<LoadBalanceStrategy> m_strategy;
+std::atomic<uint64_t> m_roundRobinIndex;
+uint64_t m_nextBackendId;
+// serializes writers only, selection never takes it
 mutable std::mutex m_mutex;
-std::mt19937 m_rng;
 
-LoadBalancer();
+// split the backends by role, build the alias tables and publish a new snapshot, must hold m_mutex
+void publishLocked(std::vector<BackendPtr> backends);
+// build the alias table of a group
+static void buildGroup(BackendGroup& group, std::vector<BackendPtr> backends);
+
+// apply the current strategy to a group, skipping backends whose circuit breaker is open
+// throws std::runtime_error when every backend of the group is open
+BackendPtr selectFrom(const BackendGroup& group);
+// same for a non-empty group, nullptr when every backend is open
+BackendPtr trySelectFrom(const BackendGroup& group);
+// the backend the current strategy picks, a group of at least two
+const BackendPtr& applyStrategy(const BackendGroup& group);
+// chosen is not closed: chosen itself if it is due for a probe, else another closed or probe-due backend
+BackendPtr selectPassing(const BackendGroup& group, const BackendPtr& chosen);
+
+// index of a backend drawn in proportion to its weight, O(1) through the alias table
+static size_t weightedIndex(const BackendGroup& group);
+// weight used by the adaptive strategies, 0 means the backend is skipped
+static unsigned int effectiveWeight(const BackendGroup& group, size_t index);
 
 // use random alogrithm to select a database
-DBConfig selectRandom();
+const BackendPtr& selectRandom(const BackendGroup& group);
 // use round robin alogrithm to select a database
-DBConfig selectRoundRobin();
-// use weight to select a database
-DBConfig selectWeighted();
+const BackendPtr& selectRoundRobin(const BackendGroup& group);
+// use weight to select a database in O(1) through the alias table
+const BackendPtr& selectWeighted(const BackendGroup& group);
+// scan for the fewest queries in flight per unit of weight
+const BackendPtr& selectLeastConnections(const BackendGroup& group);
+// scan for the lowest peak EWMA cost per unit of weight
+const BackendPtr& selectPeakEwma(const BackendGroup& group);
+// compare two weighted draws by peak EWMA cost
+const BackendPtr& selectPowerOfTwo(const BackendGroup& group);
 
 
 };
@@ -95,9 +191,12 @@ inline std::string strategyToString(LoadBalanceStrategy strategy) {
         case LoadBalanceStrategy::RANDOM:      return "Random";
         case LoadBalanceStrategy::ROUND_ROBIN: return "RoundRobin";
         case LoadBalanceStrategy::WEIGHTED:    return "Weighted";
+        case LoadBalanceStrategy::LEAST_CONNECTIONS: return "LeastConnections";
+        case LoadBalanceStrategy::PEAK_EWMA:   return "PeakEwma";
+        case LoadBalanceStrategy::POWER_OF_TWO: return "PowerOfTwo";
         default:                              return "Unknown";
     }
 }
 
 
-#endif // LOAD_BALANCER_H
\ No newline at end of file
+#endif // LOAD_BALANCER_H
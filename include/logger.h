@@ -7,6 +7,13 @@
 #include <mutex>
 #include <chrono>
 #include <iomanip>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <ctime>
 #include <iostream>
 
 /**
@@ -21,14 +28,31 @@ ERROR = 3,   // 错误信息：出现错误，但程序可以继续
 FATAL = 4    // 致命错误：严重错误，程序可能崩溃
 };
 
+/**
+ * @brief 日志的写出方式
+ */
+struct LoggerOptions {
+    bool async = true;                  // 由后台线程批量写出，调用方只把日志放进环形缓冲区
+    size_t bufferCapacity = 8192;       // 环形缓冲区容量（条），向上取整为2的幂
+    unsigned int flushInterval = 1000;  // 文件刷新间隔（毫秒），0表示每批写完都刷新；ERROR及以上立即刷新
+    bool dropWhenFull = false;          // 缓冲区满时丢弃DEBUG/INFO日志而不是等待，WARNING及以上总是等待
+};
+
+// 无锁的多生产者单消费者环形缓冲区，定义在logger.cpp中
+class LogRingBuffer;
+
 /**
  * @brief 线程安全的日志类，使用单例模式
- * 
+ *
  * 特点：
  * 1. 单例模式：全局唯一实例，避免资源冲突
  * 2. 线程安全：多线程环境下安全使用
  * 3. 灵活输出：支持文件和控制台输出
  * 4. 格式化：自动添加时间戳和日志级别
+ * 5. 异步写出：调用线程只做一次无锁入队，格式化、写文件和刷新都在后台线程批量完成
+ *
+ * LOG_*宏先检查日志级别，级别未开启时不会计算消息参数（不会拼接字符串）
+ * 异步模式下日志不是立即出现在输出中，需要立即看到时调用flush()；FATAL日志会等待写完再返回
  */
 class Logger {
 public:
@@ -41,71 +65,58 @@ static Logger& getInstance() {
     return instance;
 }
 
+~Logger();
+
 /**
      * @brief 初始化日志系统
      * @param logFile 日志文件路径，如果为空则只输出到控制台
      * @param level 日志级别，低于此级别的日志不会输出
      * @param toConsole 是否同时输出到控制台
+     * @param options 写出方式（异步、缓冲区容量、刷新间隔）
+     *
+     * 可以重复调用，之前缓冲的日志会先全部写出
      */
-void init(const std::string& logFile = "", LogLevel level = LogLevel::INFO, bool toConsole = true) {
-    std::lock_guard<std::mutex> lock(m_mutex);
-
-    m_level = level;
-    m_toConsole = toConsole;
-
-    // 如果指定了日志文件，尝试打开
-    if (!logFile.empty()) {
-        m_fileStream.open(logFile, std::ios::app);  // 追加模式
-        if (!m_fileStream.is_open()) {
-            std::cerr << "Failed to open log file: " << logFile << std::endl;
-        }
-    }
-
-    m_initialized = true;
-
-    // 记录初始化信息
-    std::cout << "Logger initialized, level=" + levelToString(level) + 
-             ", file=" + (logFile.empty() ? "none" : logFile) << std::endl;
-}
+void init(const std::string& logFile = "", LogLevel level = LogLevel::INFO, bool toConsole = true,
+          const LoggerOptions& options = LoggerOptions());
 
 /**
      * @brief 记录调试日志
      * @param message 日志消息
      */
-void debug(const std::string& message) {
-    log(LogLevel::DEBUG, message);
+void debug(std::string message) {
+    log(LogLevel::DEBUG, std::move(message));
 }
 
 /**
      * @brief 记录信息日志
      * @param message 日志消息
      */
-void info(const std::string& message) {
-    log(LogLevel::INFO, message);
+void info(std::string message) {
+    log(LogLevel::INFO, std::move(message));
 }
 
 /**
      * @brief 记录警告日志
      * @param message 日志消息
      */
-void warning(const std::string& message) {
-    log(LogLevel::WARNING, message);
+void warning(std::string message) {
+    log(LogLevel::WARNING, std::move(message));
 }
 
 /**
      * @brief 记录错误日志
      * @param message 日志消息
      */
-void error(const std::string& message) {
-    log(LogLevel::ERROR, message);
+void error(std::string message) {
+    log(LogLevel::ERROR, std::move(message));
 }
 
 /**
      * @brief 记录致命错误日志
      * @param message 日志消息
      */
-void fatal(const std::string& message) {
-    log(LogLevel::FATAL, message);
+void fatal(std::string message) {
+    log(LogLevel::FATAL, std::move(message));
 }
 
 /**
@@ -113,8 +124,7 @@ void fatal(const std::string& message) {
      * @param level 新的日志级别
      */
 void setLevel(LogLevel level) {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    m_level = level;
+    m_level.store(static_cast<int>(level), std::memory_order_relaxed);
 }
 
 /**
@@ -122,112 +132,123 @@ void setLevel(LogLevel level) {
      * @return 当前日志级别
      */
 LogLevel getLevel() const {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    return m_level;
+    return static_cast<LogLevel>(m_level.load(std::memory_order_relaxed));
+}
+
+/**
+     * @brief 检查某个级别的日志是否会输出
+     * @param level 日志级别
+     * @return 是否会输出
+     *
+     * 只有一次relaxed原子读，LOG_*宏在计算消息之前调用
+     */
+bool isEnabled(LogLevel level) const {
+    return static_cast<int>(level) >= m_level.load(std::memory_order_relaxed);
+}
+
+/**
+     * @brief 等待目前为止记录的日志全部写出并刷新到文件
+     */
+void flush();
+
+/**
+     * @brief 获取因缓冲区满而丢弃的日志条数（只在dropWhenFull时发生）
+     */
+uint64_t getDroppedCount() const {
+    return m_dropped.load(std::memory_order_relaxed);
 }
 
 private:
+    friend class LogRingBuffer;
+
 // 私有构造函数（单例模式）
-Logger() : m_level(LogLevel::DEBUG), m_initialized(false), m_toConsole(true) {}
+Logger();
 
 // 禁用拷贝构造和赋值操作（单例模式）
 Logger(const Logger&) = delete;
 Logger& operator=(const Logger&) = delete;
 
-/**
+    // 一条待写出的日志，时间戳在调用线程记录
+    struct Record {
+        LogLevel level;
+        int64_t timestamp;     // 毫秒时间戳
+        std::string message;
+    };
+
+    /**
      * @brief 记录日志的内部方法
      * @param level 日志级别
      * @param message 日志消息
      */
-    void log(LogLevel level, const std::string& message) {
-        // 如果未初始化，使用默认设置初始化
-        if (!m_initialized) {
-            init();
-        }
-
-        // 如果日志级别低于设置的级别，则忽略
-        if (level < m_level) {
-            return;
-        }
-
-        // 格式化日志消息
-        std::string formattedMessage = formatMessage(level, message);
-
-        // 加锁保证线程安全
-        std::lock_guard<std::mutex> lock(m_mutex);
-
-        // 输出到文件
-        if (m_fileStream.is_open()) {
-            m_fileStream << formattedMessage << std::endl;
-            m_fileStream.flush();  // 立即刷新到磁盘
-        }
-
-        // 输出到控制台
-        if (m_toConsole) {
-            if (level == LogLevel::ERROR || level == LogLevel::FATAL) {
-                std::cerr << formattedMessage << std::endl;  // 错误输出到stderr
-            } else {
-                std::cout << formattedMessage << std::endl;  // 普通输出到stdout
-            }
-        }
-    }
+    void log(LogLevel level, std::string message);
+
+    // 后台写线程
+    void writerLoop();
+    // 启动/停止后台写线程，停止时写出所有缓冲的日志，必须在持有m_initMutex时调用
+    void startWriter();
+    void stopWriter();
 
     /**
-     * @brief 格式化日志消息
-     * @param level 日志级别
-     * @param message 原始消息
-     * @return 格式化后的消息
+     * @brief 格式化并写出一批日志，必须在持有m_mutex时调用
+     * @return 其中是否有ERROR及以上的日志
      */
-    std::string formatMessage(LogLevel level, const std::string& message) {
-        std::stringstream ss;
-
-        // 添加时间戳
-        auto now = std::chrono::system_clock::now();
-        auto now_time_t = std::chrono::system_clock::to_time_t(now);
-        auto now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-            now.time_since_epoch()) % 1000;
-
-        ss << std::put_time(std::localtime(&now_time_t), "%Y-%m-%d %H:%M:%S");
-        ss << '.' << std::setfill('0') << std::setw(3) << now_ms.count();
+    bool writeRecordsLocked(const Record* records, size_t count);
 
-        // 添加日志级别
-        ss << " [" << levelToString(level) << "] ";
-
-        // 添加消息
-        ss << message;
-
-        return ss.str();
-    }
+    /**
+     * @brief 格式化日志消息，追加到out
+     * 时间戳的"年-月-日 时:分:秒"部分按秒缓存，同一秒内不再调用localtime
+     */
+    void formatMessage(std::string& out, const Record& record);
 
     /**
      * @brief 将日志级别转换为字符串
      * @param level 日志级别
      * @return 对应的字符串
      */
-    std::string levelToString(LogLevel level) {
-        switch (level) {
-        case LogLevel::DEBUG:   return "DEBUG";
-        case LogLevel::INFO:    return "INFO";
-        case LogLevel::WARNING: return "WARN";
-        case LogLevel::ERROR:   return "ERROR";
-        case LogLevel::FATAL:   return "FATAL";
-        default:                return "UNKNOWN";
-        }
-    }
+    static const char* levelToString(LogLevel level);
 
 private:
-    mutable std::mutex m_mutex;       // 互斥锁，确保线程安全，mutable允许在const方法中使用
+    mutable std::mutex m_mutex;       // 保护文件流、控制台输出和时间戳缓存
+    std::mutex m_initMutex;           // 串行化init()与析构
     std::ofstream m_fileStream;       // 日志文件流
-    LogLevel m_level;                 // 当前日志级别
-    bool m_initialized;               // 是否已初始化
+    std::atomic<int> m_level;         // 当前日志级别
+    std::atomic<bool> m_initialized;  // 是否已初始化
     bool m_toConsole;                 // 是否输出到控制台
+    LoggerOptions m_options;
+
+    // 异步写出
+    std::atomic<LogRingBuffer*> m_buffer;                 // 当前的环形缓冲区，生产者不加锁读取
+    std::vector<std::unique_ptr<LogRingBuffer>> m_buffers; // 分配过的所有缓冲区，换下的缓冲区在停止时读空
+    std::thread m_writer;
+    std::atomic<bool> m_running;      // 后台线程正在运行，生产者可以入队
+    std::atomic<bool> m_writerIdle;   // 后台线程即将休眠，生产者入队后需要唤醒它
+    std::atomic<bool> m_dropWhenFull; // m_options.dropWhenFull，生产者不加锁读取
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wakeCondition;     // 唤醒后台线程
+    std::condition_variable m_writtenCondition;  // 通知flush()日志已写出
+    std::atomic<uint64_t> m_enqueued;  // 已入队的日志条数
+    std::atomic<uint64_t> m_written;   // 已写出的日志条数
+    std::atomic<uint64_t> m_dropped;   // 缓冲区满时丢弃的日志条数
+
+    // 时间戳缓存，由m_mutex保护
+    std::time_t m_cachedSecond;
+    char m_cachedTime[32];
 };
 
 // 方便使用的宏定义
-#define LOG_DEBUG(message)   Logger::getInstance().debug(message)
-#define LOG_INFO(message)    Logger::getInstance().info(message)
-#define LOG_WARNING(message) Logger::getInstance().warning(message)
-#define LOG_ERROR(message)   Logger::getInstance().error(message)
-#define LOG_FATAL(message)   Logger::getInstance().fatal(message)
+// 先检查级别，级别未开启时message表达式不会被计算
+#define LOGGER_LOG_IF_ENABLED(level, method, message)          \
+    do {                                                        \
+        Logger& logger_instance_ = Logger::getInstance();       \
+        if (logger_instance_.isEnabled(level)) {                \
+            logger_instance_.method(message);                   \
+        }                                                       \
+    } while (0)
+
+#define LOG_DEBUG(message)   LOGGER_LOG_IF_ENABLED(LogLevel::DEBUG, debug, message)
+#define LOG_INFO(message)    LOGGER_LOG_IF_ENABLED(LogLevel::INFO, info, message)
+#define LOG_WARNING(message) LOGGER_LOG_IF_ENABLED(LogLevel::WARNING, warning, message)
+#define LOG_ERROR(message)   LOGGER_LOG_IF_ENABLED(LogLevel::ERROR, error, message)
+#define LOG_FATAL(message)   LOGGER_LOG_IF_ENABLED(LogLevel::FATAL, fatal, message)
 
 #endif // LOGGER_H
@@ -0,0 +1,80 @@
+#ifndef METRICS_EXPORTER_H
+#define METRICS_EXPORTER_H
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include "pool_metrics.h"
+
+class ConnectionPool;
+
+/**
+ * @brief renders PoolMetrics in the OpenMetrics text format (readable by Prometheus)
+ *
+ * Every sample carries a pool label, backend samples add backend and role labels.
+ * Latencies are summaries in seconds with the 0.5, 0.9, 0.99 and 0.999 quantiles.
+ * Rendering only formats numbers, take the PoolMetrics with ConnectionPool::getMetrics().
+ */
+class MetricsExporter {
+public:
+    // one pool, ends with "# EOF"
+    static std::string toOpenMetrics(const PoolMetrics& metrics);
+
+    // several pools in one exposition, each metric family is written once
+    static std::string toOpenMetrics(const std::vector<PoolMetrics>& pools);
+
+    // content type to send with the text, e.g. in an HTTP handler
+    static const char* contentType();
+};
+
+
+/**
+ * @brief calls back with the activity of a pool every interval, for pushing to a collector
+ *
+ * The worker thread takes ConnectionPool::getMetrics() every intervalMs and passes the
+ * delta since the previous snapshot (counters and latencies of the interval, gauges as
+ * they are now) together with the full snapshot. The first callback covers the time
+ * since start(). Callbacks never run concurrently and never hold the pool's mutex;
+ * an exception thrown by the callback is logged and the reporter keeps going.
+ */
+class MetricsReporter {
+public:
+    typedef std::function<void(const PoolMetrics& delta, const PoolMetrics& current)> Callback;
+
+    MetricsReporter(const ConnectionPool& pool, unsigned int intervalMs, Callback callback);
+    ~MetricsReporter();
+
+    MetricsReporter(const MetricsReporter&) = delete;
+    MetricsReporter& operator=(const MetricsReporter&) = delete;
+
+    void start();
+
+    // waits for a running callback to return
+    void stop();
+
+    bool isRunning() const;
+
+    // report the interval up to now immediately, also works when not started
+    void reportNow();
+
+private:
+    void run();
+
+    const ConnectionPool& m_pool;
+    const unsigned int m_intervalMs;
+    Callback m_callback;
+
+    std::mutex m_reportMutex;   // orders the callbacks, guards m_previous
+    PoolMetrics m_previous;
+
+    std::mutex m_stopMutex;
+    std::condition_variable m_stopCondition;
+    std::atomic<bool> m_running;
+    std::thread m_thread;
+};
+
+#endif // METRICS_EXPORTER_H
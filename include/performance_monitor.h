@@ -9,7 +9,7 @@
 #include <fstream>
 #include <sstream>
 #include <cmath>
-//#include "utils.h"
+#include "latency_histogram.h"
 
 /**
  * @brief 性能统计信息结构体
@@ -26,6 +26,11 @@ struct PerformanceStats {
     uint64_t totalConnectionsReleased = 0;     // 总共释放的连接数
     uint64_t failedConnectionAttempts = 0;     // 连接失败次数
 
+    // === 等待队列统计 ===
+    uint64_t queuedAcquires = 0;               // 需要排队等待的获取次数
+    uint64_t rejectedAcquires = 0;             // 队列过长被立即拒绝的获取次数
+    uint64_t acquireTimeouts = 0;              // 排队等到超时的获取次数
+
     // === 查询相关统计 ===
     uint64_t totalQueriesExecuted = 0;         // 总查询执行次数
     uint64_t failedQueries = 0;                // 查询失败次数
@@ -34,6 +39,14 @@ struct PerformanceStats {
     uint64_t reconnectionAttempts = 0;         // 重连尝试次数
     uint64_t successfulReconnections = 0;      // 成功重连次数
 
+    // === 预处理语句缓存统计 ===
+    uint64_t statementCacheHits = 0;           // 复用已预处理语句的次数
+    uint64_t statementCacheMisses = 0;         // 需要重新预处理的次数
+
+    // === 查询结果缓存统计 ===
+    uint64_t queryCacheHits = 0;               // 直接由缓存返回结果的查询次数
+    uint64_t queryCacheMisses = 0;             // 需要到数据库执行的可缓存查询次数
+
     // === 时间统计（微秒为单位，更精确） ===
     uint64_t totalConnectionAcquireTime = 0;   // 总连接获取时间
     uint64_t totalConnectionUsageTime = 0;     // 总连接使用时间
@@ -73,6 +86,24 @@ struct PerformanceStats {
             static_cast<double>(successfulReconnections) / reconnectionAttempts * 100.0 : 0.0;
     }
 
+    /**
+     * @brief 计算预处理语句缓存命中率（百分比）
+     */
+    double statementCacheHitRate() const {
+        uint64_t lookups = statementCacheHits + statementCacheMisses;
+        return lookups > 0 ?
+            static_cast<double>(statementCacheHits) / lookups * 100.0 : 0.0;
+    }
+
+    /**
+     * @brief 计算查询结果缓存命中率（百分比）
+     */
+    double queryCacheHitRate() const {
+        uint64_t lookups = queryCacheHits + queryCacheMisses;
+        return lookups > 0 ?
+            static_cast<double>(queryCacheHits) / lookups * 100.0 : 0.0;
+    }
+
     /**
      * @brief 计算查询成功率（百分比）
      */
@@ -91,34 +122,74 @@ struct PerformanceStats {
     }
 };
 
+/**
+ * @brief 记录延迟分布的指标（单位都是微秒）
+ */
+enum class LatencyMetric {
+    CONNECTION_ACQUIRE,   // 获取连接的等待时间
+    CONNECTION_USAGE,     // 连接从借出到归还的时间
+    QUERY_EXECUTION,      // 查询执行时间
+    CONNECT,              // 建立新连接（握手）的时间
+    QUEUE_WAIT            // 在等待队列中排队的时间（只统计排过队的获取）
+};
+
 /**
  * @brief 连接池性能监控类
  * 
  * 设计特点：
- * 1. 单例模式 - 全局唯一，方便访问
+ * 1. 每个连接池各有一个实例，getInstance() 是默认连接池使用的全局实例
  * 2. 线程安全 - 使用原子操作，避免锁竞争
- * 3. 高性能 - 记录操作极快，不影响主业务
- * 4. 易使用 - 接口简单，一行代码搞定
+ * 3. 高性能 - 计数器按线程分片并隔开缓存行，记录时线程之间不抢同一个缓存行，
+ *    getStats() 时才把各分片加起来
+ * 4. 可关闭 - setEnabled(false) 后记录接口只剩一次判断（对应 PoolConfig::enablePerformanceStats）
+ * 5. 易使用 - 接口简单，一行代码搞定
  */
 class PerformanceMonitor {
 public:
     /**
-     * @brief 获取性能监控单例实例
+     * @brief 获取默认的全局性能监控实例
      */
     static PerformanceMonitor& getInstance() {
         static PerformanceMonitor instance;
         return instance;
     }
 
+    /**
+     * @brief 创建独立的性能监控实例（命名连接池各自持有一个）
+     */
+    PerformanceMonitor();
+
+    // 禁用拷贝
+    PerformanceMonitor(const PerformanceMonitor&) = delete;
+    PerformanceMonitor& operator=(const PerformanceMonitor&) = delete;
+
+    /**
+     * @brief 开启/关闭统计
+     *
+     * 关闭后记录接口直接返回，已有的统计保留；连接池按 PoolConfig::enablePerformanceStats 设置
+     */
+    void setEnabled(bool enabled) {
+        m_enabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    bool isEnabled() const {
+        return m_enabled.load(std::memory_order_relaxed);
+    }
+
     // === 数据记录接口（高频调用，必须极快） ===
     
     /**
      * @brief 记录连接创建
+     * @param connectTime 建立连接所花费的时间（微秒）
      * 
      * 使用场景：在 createConnection() 成功后调用
      */
-    void recordConnectionCreated() {
-        m_totalConnectionsCreated.fetch_add(1, std::memory_order_relaxed);
+    void recordConnectionCreated(int64_t connectTime) {
+        if (!isEnabled()) {
+            return;
+        }
+        add(CONNECTIONS_CREATED, 1);
+        recordLatency(m_connectLatency, connectTime);
     }
 
     /**
@@ -128,8 +199,13 @@ public:
      * 使用场景：在 getConnection() 返回前调用
      */
     void recordConnectionAcquired(int64_t timeTaken) {
-        m_totalConnectionsAcquired.fetch_add(1, std::memory_order_relaxed);
-        m_totalConnectionAcquireTime.fetch_add(timeTaken, std::memory_order_relaxed);
+        if (!isEnabled()) {
+            return;
+        }
+        CounterShard& shard = currentShard();
+        add(shard, CONNECTIONS_ACQUIRED, 1);
+        add(shard, CONNECTION_ACQUIRE_TIME, timeTaken);
+        recordLatency(m_acquireLatency, timeTaken);
     }
 
     /**
@@ -139,8 +215,13 @@ public:
      * 使用场景：在 releaseConnection() 中调用
      */
     void recordConnectionReleased(int64_t usageTime) {
-        m_totalConnectionsReleased.fetch_add(1, std::memory_order_relaxed);
-        m_totalConnectionUsageTime.fetch_add(usageTime, std::memory_order_relaxed);
+        if (!isEnabled()) {
+            return;
+        }
+        CounterShard& shard = currentShard();
+        add(shard, CONNECTIONS_RELEASED, 1);
+        add(shard, CONNECTION_USAGE_TIME, usageTime);
+        recordLatency(m_usageLatency, usageTime);
     }
 
     /**
@@ -149,7 +230,44 @@ public:
      * 使用场景：在 getConnection() 失败时调用
      */
     void recordConnectionFailed() {
-        m_failedConnectionAttempts.fetch_add(1, std::memory_order_relaxed);
+        if (!isEnabled()) {
+            return;
+        }
+        add(FAILED_CONNECTION_ATTEMPTS, 1);
+    }
+
+    /**
+     * @brief 记录一次排过队的获取，无论最后是否拿到连接
+     * @param waitTime 在等待队列中的时间（微秒）
+     *
+     * 使用场景：在 getConnection() 离开等待队列时调用
+     */
+    void recordAcquireQueued(int64_t waitTime) {
+        if (!isEnabled()) {
+            return;
+        }
+        add(QUEUED_ACQUIRES, 1);
+        recordLatency(m_queueWaitLatency, waitTime);
+    }
+
+    /**
+     * @brief 记录因队列过长或预计等待过久被立即拒绝的获取
+     */
+    void recordAcquireRejected() {
+        if (!isEnabled()) {
+            return;
+        }
+        add(REJECTED_ACQUIRES, 1);
+    }
+
+    /**
+     * @brief 记录排队等到超时的获取
+     */
+    void recordAcquireTimeout() {
+        if (!isEnabled()) {
+            return;
+        }
+        add(ACQUIRE_TIMEOUTS, 1);
     }
 
     /**
@@ -160,10 +278,15 @@ public:
      * 使用场景：在 executeQuery() 或 executeUpdate() 中调用
      */
     void recordQueryExecuted(int64_t queryTime, bool success) {
-        m_totalQueriesExecuted.fetch_add(1, std::memory_order_relaxed);
-        m_totalQueryExecutionTime.fetch_add(queryTime, std::memory_order_relaxed);
+        if (!isEnabled()) {
+            return;
+        }
+        CounterShard& shard = currentShard();
+        add(shard, QUERIES_EXECUTED, 1);
+        add(shard, QUERY_EXECUTION_TIME, queryTime);
+        recordLatency(m_queryLatency, queryTime);
         if (!success) {
-            m_failedQueries.fetch_add(1, std::memory_order_relaxed);
+            add(shard, FAILED_QUERIES, 1);
         }
     }
 
@@ -174,23 +297,72 @@ public:
      * 使用场景：在 reconnect() 方法中调用
      */
     void recordReconnection(bool success) {
-        m_reconnectionAttempts.fetch_add(1, std::memory_order_relaxed);
+        if (!isEnabled()) {
+            return;
+        }
+        CounterShard& shard = currentShard();
+        add(shard, RECONNECTION_ATTEMPTS, 1);
         if (success) {
-            m_successfulReconnections.fetch_add(1, std::memory_order_relaxed);
+            add(shard, SUCCESSFUL_RECONNECTIONS, 1);
         }
     }
 
+    /**
+     * @brief 记录预处理语句缓存查找
+     * @param hit 是否命中（命中时不需要再调用 mysql_stmt_prepare）
+     * 
+     * 使用场景：在 Connection::prepareStatement() 中调用
+     */
+    void recordStatementCacheLookup(bool hit) {
+        if (!isEnabled()) {
+            return;
+        }
+        add(hit ? STATEMENT_CACHE_HITS : STATEMENT_CACHE_MISSES, 1);
+    }
+
+    /**
+     * @brief 记录查询结果缓存查找
+     * @param hit 是否命中（命中时不需要借出连接）
+     * 
+     * 使用场景：在 ConnectionPool::executeCachedQuery() 中调用
+     */
+    void recordQueryCacheLookup(bool hit) {
+        if (!isEnabled()) {
+            return;
+        }
+        add(hit ? QUERY_CACHE_HITS : QUERY_CACHE_MISSES, 1);
+    }
+
     // === 数据查询接口（低频调用，可以稍慢） ===
     
     /**
      * @brief 获取性能统计信息快照
      * @return 当前的性能统计信息
      * 
-     * 注意：返回的是快照，不保证绝对一致性
+     * 注意：返回的是各分片相加的快照，不保证绝对一致性
      * 但对于监控来说，这种精度已经足够了
      */
     PerformanceStats getStats() const;
 
+    /**
+     * @brief 获取某项指标的延迟分布快照
+     * @param metric 延迟指标
+     * @return 快照，可以查询分位数、与之前的快照相减得到区间内的分布
+     *
+     * 记录线程不会被阻塞，快照期间记录的数据可能计入也可能不计入
+     */
+    HistogramSnapshot getLatencySnapshot(LatencyMetric metric) const;
+
+    /**
+     * @brief 获取某项指标的延迟分位数（微秒）
+     * @param metric 延迟指标
+     * @param percentile 百分位，例如 99.9 表示 P999
+     * @return 分位数，误差不超过 6.25%；没有数据时返回0
+     */
+    uint64_t getLatencyPercentile(LatencyMetric metric, double percentile) const {
+        return getLatencySnapshot(metric).getPercentile(percentile);
+    }
+
     /**
      * @brief 重置所有统计信息
      * 
@@ -222,33 +394,72 @@ public:
 
 
 private:
-    // 私有构造函数（单例模式）
-    PerformanceMonitor() = default;
-    
-    // 禁用拷贝
-    PerformanceMonitor(const PerformanceMonitor&) = delete;
-    PerformanceMonitor& operator=(const PerformanceMonitor&) = delete;
+    // 计数器在分片中的下标，与 PerformanceStats 的字段一一对应
+    enum Counter {
+        CONNECTIONS_CREATED,
+        CONNECTIONS_ACQUIRED,
+        CONNECTIONS_RELEASED,
+        FAILED_CONNECTION_ATTEMPTS,
+        QUEUED_ACQUIRES,
+        REJECTED_ACQUIRES,
+        ACQUIRE_TIMEOUTS,
+        QUERIES_EXECUTED,
+        FAILED_QUERIES,
+        RECONNECTION_ATTEMPTS,
+        SUCCESSFUL_RECONNECTIONS,
+        STATEMENT_CACHE_HITS,
+        STATEMENT_CACHE_MISSES,
+        QUERY_CACHE_HITS,
+        QUERY_CACHE_MISSES,
+        CONNECTION_ACQUIRE_TIME,
+        CONNECTION_USAGE_TIME,
+        QUERY_EXECUTION_TIME,
+        COUNTER_COUNT
+    };
+
+    // 分片数，线程按 Utils::currentThreadIndex() 分到各分片，线程不多于分片数时互不竞争
+    static const size_t COUNTER_SHARDS = 32;
+
+    // 一个分片的全部计数器，后面的填充让相邻分片的计数器不落在同一缓存行
+    struct CounterShard {
+        std::atomic<uint64_t> values[COUNTER_COUNT];
+        char padding[64];
+    };
+
+    CounterShard& currentShard() {
+        return m_shards[Utils::currentThreadIndex() % COUNTER_SHARDS];
+    }
 
-    // === 原子变量存储（无锁高性能） ===
-    
-    // 连接统计
-    std::atomic<uint64_t> m_totalConnectionsCreated{0};
-    std::atomic<uint64_t> m_totalConnectionsAcquired{0};
-    std::atomic<uint64_t> m_totalConnectionsReleased{0};
-    std::atomic<uint64_t> m_failedConnectionAttempts{0};
-
-    // 查询统计
-    std::atomic<uint64_t> m_totalQueriesExecuted{0};
-    std::atomic<uint64_t> m_failedQueries{0};
-
-    // 重连统计
-    std::atomic<uint64_t> m_reconnectionAttempts{0};
-    std::atomic<uint64_t> m_successfulReconnections{0};
-
-    // 时间统计（微秒）
-    std::atomic<uint64_t> m_totalConnectionAcquireTime{0};
-    std::atomic<uint64_t> m_totalConnectionUsageTime{0};
-    std::atomic<uint64_t> m_totalQueryExecutionTime{0};
+    // 分片基本只被一个线程写，relaxed 的加法不会在线程之间来回传递缓存行
+    static void add(CounterShard& shard, Counter counter, int64_t value) {
+        shard.values[counter].fetch_add(static_cast<uint64_t>(value), std::memory_order_relaxed);
+    }
+
+    void add(Counter counter, int64_t value) {
+        add(currentShard(), counter, value);
+    }
+
+    // 把所有分片的某个计数器加起来
+    uint64_t sum(Counter counter) const;
+
+    // 负数是时钟调整造成的，按0记录
+    static void recordLatency(LatencyHistogram& histogram, int64_t value) {
+        histogram.record(value > 0 ? static_cast<uint64_t>(value) : 0);
+    }
+
+    const LatencyHistogram& getHistogram(LatencyMetric metric) const;
+
+    std::atomic<bool> m_enabled;
+
+    // 计数器分片（无锁，按需汇总）
+    CounterShard m_shards[COUNTER_SHARDS];
+
+    // 延迟分布（微秒），按线程分片，记录时只有relaxed原子加法
+    LatencyHistogram m_acquireLatency;
+    LatencyHistogram m_usageLatency;
+    LatencyHistogram m_queryLatency;
+    LatencyHistogram m_connectLatency;
+    LatencyHistogram m_queueWaitLatency;
 };
 
 #endif // PERFORMANCE_MONITOR_H
\ No newline at end of file
@@ -0,0 +1,58 @@
+#ifndef PING_WORKERS_H
+#define PING_WORKERS_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+/**
+ * @brief threads that ping a batch of idle connections in parallel for the health check
+ *
+ * The threads are started on first use and kept until stop(), like the creator
+ * threads of ConnectionFactory, so a health check step does not start threads of
+ * its own. Every thread registers with the client library (mysql_thread_init) when
+ * it starts and releases its state (mysql_thread_end) when it exits.
+ */
+class PingWorkers {
+public:
+    // checks one item of the batch, an exception is logged and dropped
+    using Task = std::function<void(size_t index)>;
+
+    PingWorkers();
+    ~PingWorkers();
+
+    PingWorkers(const PingWorkers&) = delete;
+    PingWorkers& operator=(const PingWorkers&) = delete;
+
+    /**
+     * @brief run task for every index below count and wait for all of them
+     * @param concurrency items checked at the same time, the calling thread included
+     *
+     * starts missing threads first; when that fails the batch runs on the threads there are
+     */
+    void run(size_t count, size_t concurrency, const Task& task);
+
+    // stop and join the threads, the next run() starts them again
+    void stop();
+
+private:
+    std::vector<std::thread> m_threads;
+    // one batch at a time
+    std::mutex m_runMutex;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::condition_variable m_doneCondition;
+    const Task* m_task;
+    size_t m_count;
+    size_t m_next;
+    size_t m_done;
+    bool m_stopping;
+
+    void worker();
+    // run the next item of the batch, called and returns with lock held; false if none is left
+    bool runNext(std::unique_lock<std::mutex>& lock);
+};
+
+#endif // PING_WORKERS_H
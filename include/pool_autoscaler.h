@@ -0,0 +1,98 @@
+#ifndef POOL_AUTOSCALER_H
+#define POOL_AUTOSCALER_H
+
+#include <cstdint>
+#include <cstddef>
+#include "pool_config.h"
+#include "pool_metrics.h"
+
+// bounds and thresholds of the autoscaler, taken from PoolConfig
+struct AutoscalePolicy {
+    unsigned int minConnections;
+    unsigned int maxConnections;
+    double targetUtilization;       // (0, 1], share of the connections expected to be busy
+    int64_t maxAcquireWaitMicros;   // acquire p99 above this grows the pool by the waiters, at least by one; 0 for never
+    int64_t scaleDownDelayMicros;   // demand must stay below the pool size this long before it shrinks
+    unsigned int scaleDownStep;     // connections closed per interval while shrinking
+
+    AutoscalePolicy()
+        : minConnections(0), maxConnections(0), targetUtilization(1.0)
+        , maxAcquireWaitMicros(0), scaleDownDelayMicros(0), scaleDownStep(1) {}
+
+    static AutoscalePolicy fromConfig(const PoolConfig& config);
+};
+
+// demand seen by the pool during one interval
+struct AutoscaleSample {
+    int64_t nowMicros;              // end of the interval, steady clock
+    uint64_t arrivals;              // checkouts asked for: acquired, rejected or timed out
+    double meanUsageMicros;         // how long a connection was held on average, 0 if nothing was returned
+    uint64_t acquireWaitP99Micros;
+    size_t activeConnections;       // at the end of the interval
+    size_t waiters;
+    size_t totalConnections;        // including the ones being created
+
+    AutoscaleSample()
+        : nowMicros(0), arrivals(0), meanUsageMicros(0.0), acquireWaitP99Micros(0)
+        , activeConnections(0), waiters(0), totalConnections(0) {}
+
+    // the interval between two metrics snapshots of the same pool
+    static AutoscaleSample between(const PoolMetrics& earlier, const PoolMetrics& current, int64_t nowMicros);
+};
+
+/**
+ * @brief decides how many connections a pool should have from the demand it observes
+ *
+ * The arrival rate is smoothed with a level and a trend (Holt's linear method). The
+ * expected number of busy connections is the forecast rate LEAD_INTERVALS ahead times
+ * the mean usage time (Little's law), or the connections actually busy and waited for
+ * if that is more. Divided by the target utilization, this is the size the pool grows
+ * to right away.
+ * Shrinking has hysteresis: the target only goes down once the demand stayed below the
+ * current size for scaleDownDelay, and then by scaleDownStep per interval, so a short
+ * lull inside a busy period does not close connections that are needed again right after.
+ *
+ * Not thread-safe, driven by the pool's health-check thread.
+ */
+class PoolAutoscaler {
+public:
+    // intervals the growth trend is projected ahead, covers the time to open connections
+    static const int LEAD_INTERVALS = 2;
+
+    PoolAutoscaler();
+
+    /**
+     * @brief feed the demand of the last interval
+     * @return target number of connections, within policy.minConnections and policy.maxConnections
+     *
+     * the first sample only sets the starting point and returns the current size
+     */
+    unsigned int update(const AutoscalePolicy& policy, const AutoscaleSample& sample);
+
+    unsigned int getTarget() const {
+        return m_target;
+    }
+
+    // checkouts per second expected LEAD_INTERVALS ahead
+    double getForecastRate() const {
+        return m_forecastRate;
+    }
+
+    // forget the history, e.g. when the pool restarts
+    void reset();
+
+private:
+    static unsigned int clamp(const AutoscalePolicy& policy, double value);
+
+    bool m_started;
+    bool m_hasRate;
+    int64_t m_lastMicros;
+    double m_level;             // smoothed checkouts per second
+    double m_trend;             // change of the level per interval
+    double m_forecastRate;
+    unsigned int m_target;
+    bool m_belowTarget;         // the demand has been below the target since m_lowSinceMicros
+    int64_t m_lowSinceMicros;
+};
+
+#endif // POOL_AUTOSCALER_H
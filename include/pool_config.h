@@ -5,6 +5,38 @@
 #include <vector>
 #include <chrono>
 
+/**
+ * @brief 连接校验策略
+ *
+ * 决定连接池在什么时候用 mysql_ping 校验连接
+ * 校验永远不会在持有连接池锁的情况下进行
+ */
+enum class ValidationPolicy {
+    NEVER,          // 从不校验（依赖查询失败后的自动重连）
+    IDLE_TIMEOUT,   // 借出时，若空闲时间超过 validationIdleThreshold 才校验
+    ALWAYS,         // 每次借出都校验
+    BACKGROUND      // 只由健康检查线程在后台校验空闲连接
+};
+
+/**
+ * @brief 空闲连接的取用顺序
+ */
+enum class IdleOrder {
+    LIFO,   // 后进先出：优先复用刚归还的连接，热连接保持活跃，冷连接自然老化
+    FIFO    // 先进先出：连接轮流使用，空闲时间更均匀
+};
+
+/**
+ * @brief 连接归还时的会话清理方式
+ *
+ * 清理失败的连接被关闭，不会被下一个借用者拿到
+ */
+enum class SessionResetPolicy {
+    NONE,       // 不清理，下一个借用者可能拿到未结束的事务
+    ROLLBACK,   // 有未结束的事务时执行 ROLLBACK
+    RESET       // 执行过SQL语句或有未结束的事务时用 mysql_reset_connection 重置会话：回滚事务，清除用户变量、临时表、表锁和预处理语句，会话变量恢复为全局值
+};
+
 /**
  * @brief 连接池配置信息
  * 
@@ -40,12 +72,101 @@ struct PoolConfig {
     unsigned int maxIdleTime;        // 连接最大空闲时间（超过则关闭）
     unsigned int healthCheckPeriod;  // 健康检查周期
 
+    // =========================
+    // 后台健康检查设置
+    // =========================
+    unsigned int healthCheckBatchSize;   // 每次取出检查的空闲连接数量上限（每个数据库实例），检查分散在整个 healthCheckPeriod 内进行
+    unsigned int healthCheckConcurrency; // 同时ping的连接数量上限
+
     // =========================
     // 重连设置
     // =========================
     unsigned int reconnectInterval;  // 重连间隔（毫秒）
     unsigned int reconnectAttempts;  // 最大重连尝试次数
 
+    // =========================
+    // 熔断设置
+    // =========================
+    unsigned int circuitBreakerThreshold;    // 连续失败多少次后熔断该数据库实例，熔断期间跳过它且建连立即失败（0表示关闭）
+    unsigned int circuitBreakerOpenTime;     // 第一次熔断的时长（毫秒），每次探测失败翻倍，实际时长在一半到全部之间随机
+    unsigned int circuitBreakerMaxOpenTime;  // 熔断时长的最大值（毫秒）
+    unsigned int circuitBreakerProbeTimeout; // 半开状态下探测请求的超时（毫秒），超时后由下一个请求重新探测
+
+    // =========================
+    // 连接校验设置
+    // =========================
+    ValidationPolicy validationPolicy;     // 连接校验策略
+    unsigned int validationIdleThreshold;  // IDLE_TIMEOUT策略下，空闲超过该时间（毫秒）才校验
+
+    // =========================
+    // 空闲连接存储设置
+    // =========================
+    IdleOrder idleOrder;            // 空闲连接取用顺序
+    unsigned int idleShardCount;    // 空闲连接分片数量（0表示按CPU核数自动选择）
+
+    // =========================
+    // 后台建连设置
+    // =========================
+    unsigned int maxPendingConnects; // 后台同时进行的建连数量上限（建连线程数）
+    unsigned int lowWaterMark;       // 空闲连接（含建连中）低于该值时提前扩容（0表示关闭）
+
+    // =========================
+    // 预处理语句设置
+    // =========================
+    unsigned int statementCacheSize; // 每个连接缓存的预处理语句数量（0表示不缓存）
+
+    // =========================
+    // 查询结果缓存设置
+    // =========================
+    size_t queryCacheMaxBytes;       // executeCachedQuery的结果缓存占用的内存上限（字节，0表示不缓存）
+    unsigned int queryCacheTtl;      // 缓存结果的默认有效期（毫秒）
+
+    // =========================
+    // 查询追踪设置
+    // =========================
+    double traceSampleRate;          // 生成span交给追踪sink的查询比例（0到1，0表示不采样）
+    unsigned int slowQueryThreshold; // 借出等待加执行超过该时长（毫秒）的查询写入慢查询日志并交给sink（0表示关闭）
+
+    // =========================
+    // 启动预热设置
+    // =========================
+    unsigned int warmupConcurrency;  // 启动时并行建连的线程数上限
+    unsigned int warmupTimeout;      // 启动预热的总时限（毫秒，0表示不限时）
+    unsigned int minReadyPerBackend; // 每个数据库实例建好该数量的连接后即可返回，其余在后台继续（0表示等待全部完成）
+
+    // =========================
+    // 读写分离设置
+    // =========================
+    unsigned int readAfterWriteWindow; // 同一线程的读写借出归还后，该时长内（毫秒）的只读借出仍走主库（0表示关闭）
+
+    // =========================
+    // 等待队列设置
+    // =========================
+    unsigned int maxWaitQueueLength;  // 每个实例排队等待连接的线程数上限，超过时立即失败（0表示不限制）
+    bool failFastOnEstimatedWait;     // 实例已满且预计等待时间超过剩余超时时间时立即失败，而不是排队等到超时
+
+    // =========================
+    // 自动伸缩设置
+    // =========================
+    bool autoScaling;                         // 是否按观察到的需求在 minConnections 和 maxConnections 之间自动调整连接数
+    unsigned int autoScaleInterval;           // 采样和调整的周期（毫秒）
+    unsigned int autoScaleTargetUtilization;  // 目标使用率（百分比），预测的并发借出数按该比例换算成连接数
+    unsigned int autoScaleMaxAcquireWait;     // 借出耗时 P99 超过该值（毫秒）时，按排队数量（至少1个）立即扩容（0表示不按借出耗时扩容）
+    unsigned int autoScaleDownDelay;          // 需求持续低于当前连接数该时长（毫秒）后才开始收缩
+    unsigned int autoScaleDownStep;           // 收缩时每个周期最多关闭的连接数
+
+    // =========================
+    // 归还清理设置
+    // =========================
+    SessionResetPolicy sessionResetPolicy; // 连接归还时的会话清理方式
+    bool asyncSessionReset;                // 在后台线程清理，归还的线程不用等待网络往返；清理完成前连接不能被借出
+
+    // =========================
+    // 线程本地缓存设置
+    // =========================
+    bool threadLocalCache;               // 每个线程留下一个它归还的连接，同一线程下次借出时直接复用，不经过共享的空闲连接
+    unsigned int threadCacheIdleTimeout; // 线程留下的连接超过该时长（毫秒）未被复用时收回连接池；有线程等待连接时立即收回
+
     // =========================
     // 其他设置
     // =========================
@@ -64,8 +185,41 @@ struct PoolConfig {
         , connectionTimeout(5000)       // 5秒获取连接超时
         , maxIdleTime(600000)          // 10分钟空闲超时
         , healthCheckPeriod(30000)     // 30秒健康检查
+        , healthCheckBatchSize(8)      // 每次最多检查8个空闲连接
+        , healthCheckConcurrency(4)    // 最多同时ping 4个连接
         , reconnectInterval(1000)      // 1秒重连间隔
         , reconnectAttempts(3)         // 最多重试3次
+        , circuitBreakerThreshold(5)   // 连续失败5次后熔断
+        , circuitBreakerOpenTime(1000) // 第一次最多熔断1秒
+        , circuitBreakerMaxOpenTime(30000) // 最多熔断30秒
+        , circuitBreakerProbeTimeout(10000) // 探测10秒未返回则重新探测
+        , validationPolicy(ValidationPolicy::IDLE_TIMEOUT) // 空闲较久的连接才校验
+        , validationIdleThreshold(5000) // 空闲超过5秒才校验
+        , idleOrder(IdleOrder::LIFO)   // 默认优先复用热连接
+        , idleShardCount(0)            // 按CPU核数自动分片
+        , maxPendingConnects(2)        // 最多同时进行2个建连
+        , lowWaterMark(0)              // 默认不提前扩容
+        , statementCacheSize(32)       // 每个连接缓存32条预处理语句
+        , queryCacheMaxBytes(0)        // 默认不缓存查询结果
+        , queryCacheTtl(1000)          // 缓存结果1秒有效
+        , traceSampleRate(0)           // 默认不采样
+        , slowQueryThreshold(0)        // 默认不记录慢查询
+        , warmupConcurrency(4)         // 启动时最多4个并行建连
+        , warmupTimeout(10000)         // 启动预热最多10秒
+        , minReadyPerBackend(0)        // 默认等待全部初始连接建好
+        , readAfterWriteWindow(0)      // 默认只读借出总是走从库
+        , maxWaitQueueLength(0)        // 默认不限制排队长度
+        , failFastOnEstimatedWait(false) // 默认等到超时
+        , autoScaling(false)           // 默认连接数只由借出和空闲超时决定
+        , autoScaleInterval(1000)      // 每秒采样一次
+        , autoScaleTargetUtilization(70) // 目标使用率70%
+        , autoScaleMaxAcquireWait(50)  // 排队超过50ms即扩容
+        , autoScaleDownDelay(60000)    // 需求回落1分钟后才收缩
+        , autoScaleDownStep(1)         // 每个周期最多关闭1个连接
+        , sessionResetPolicy(SessionResetPolicy::ROLLBACK) // 默认只回滚未结束的事务
+        , asyncSessionReset(true)      // 默认在后台清理
+        , threadLocalCache(false)      // 默认每次都经过共享的空闲连接
+        , threadCacheIdleTimeout(1000) // 线程1秒未复用就收回
         , logQueries(false)            // 默认不记录查询
         , enablePerformanceStats(true) // 默认启用性能统计
     {}
@@ -107,6 +261,49 @@ struct PoolConfig {
             return false;
         }
 
+        // 检查后台健康检查参数
+        if (healthCheckBatchSize == 0 || healthCheckConcurrency == 0) {
+            return false;
+        }
+
+        // 检查查询结果缓存参数
+        if (queryCacheMaxBytes > 0 && queryCacheTtl == 0) {
+            return false;
+        }
+
+        // 检查线程本地缓存参数
+        if (threadLocalCache && threadCacheIdleTimeout == 0) {
+            return false;
+        }
+
+        // 检查查询追踪参数
+        if (!(traceSampleRate >= 0 && traceSampleRate <= 1)) {
+            return false;
+        }
+
+        // 检查熔断参数
+        if (circuitBreakerThreshold > 0 &&
+            (circuitBreakerOpenTime == 0 || circuitBreakerMaxOpenTime < circuitBreakerOpenTime ||
+             circuitBreakerProbeTimeout == 0)) {
+            return false;
+        }
+
+        // 检查后台建连参数
+        if (maxPendingConnects == 0 || lowWaterMark > maxConnections) {
+            return false;
+        }
+
+        // 检查启动预热参数
+        if (warmupConcurrency == 0) {
+            return false;
+        }
+
+        // 检查自动伸缩参数
+        if (autoScaling && (autoScaleInterval == 0 || autoScaleTargetUtilization == 0 ||
+                            autoScaleTargetUtilization > 100 || autoScaleDownStep == 0)) {
+            return false;
+        }
+
         // 检查数据库配置
         // if (!dbInstances.empty()) {
         //     // 多数据库模式：检查每个实例配置
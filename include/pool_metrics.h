@@ -0,0 +1,86 @@
+#ifndef POOL_METRICS_H
+#define POOL_METRICS_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "db_config.h"
+#include "performance_monitor.h"
+#include "circuit_breaker.h"
+
+/**
+ * @brief gauges and load of one backend sub-pool at the time of the snapshot
+ */
+struct BackendMetrics {
+    uint64_t id;                // Backend::id
+    std::string host;
+    unsigned int port;
+    DBRole role;
+    unsigned int weight;
+    size_t totalConnections;    // including the ones being created
+    size_t idleConnections;
+    size_t pendingConnections;  // creations requested but not finished
+    size_t waiters;             // threads waiting for a connection of this backend
+    unsigned int maxConnections;
+    bool draining;              // removed from the balancer, its connections are closing
+    int64_t inFlight;           // queries sent and not answered yet
+    double ewmaLatencyMs;       // moving average used by the adaptive strategies
+    uint64_t latencySamples;
+    CircuitBreaker::State circuitState;
+    uint64_t circuitOpenCount;  // how often the circuit breaker has opened
+
+    BackendMetrics()
+        : id(0), port(0), role(DBRole::PRIMARY), weight(0)
+        , totalConnections(0), idleConnections(0), pendingConnections(0), waiters(0)
+        , maxConnections(0), draining(false), inFlight(0), ewmaLatencyMs(0.0), latencySamples(0)
+        , circuitState(CircuitBreaker::State::CLOSED), circuitOpenCount(0) {}
+};
+
+/**
+ * @brief everything a metrics scraper needs from one pool
+ *
+ * filled by ConnectionPool::getMetrics() from atomics and immutable snapshots,
+ * without taking the pool's mutex, so it is cheap to take on every scrape.
+ * The values are read one by one and are not guaranteed to be consistent
+ * with each other, e.g. idle + active may briefly differ from total.
+ */
+struct PoolMetrics {
+    std::string pool;           // ConnectionPool::getName()
+    int64_t timestampMs;        // wall clock of the snapshot, milliseconds since the epoch
+    bool running;
+
+    // gauges
+    size_t totalConnections;
+    size_t idleConnections;
+    size_t activeConnections;
+    size_t waiters;
+    size_t pendingConnections;
+    size_t targetConnections;   // autoscaling target, 0 while autoscaling is off
+
+    // counters since start (or since the last resetStats)
+    PerformanceStats stats;
+
+    // latency distributions in microseconds
+    HistogramSnapshot acquireLatency;
+    HistogramSnapshot usageLatency;
+    HistogramSnapshot queryLatency;
+    HistogramSnapshot connectLatency;
+    HistogramSnapshot queueWaitLatency;
+
+    std::vector<BackendMetrics> backends;
+
+    PoolMetrics()
+        : timestampMs(0), running(false)
+        , totalConnections(0), idleConnections(0), activeConnections(0), waiters(0)
+        , pendingConnections(0), targetConnections(0) {}
+
+    /**
+     * @brief activity between an earlier snapshot of the same pool and this one
+     *
+     * counters and latency distributions become the interval's deltas,
+     * gauges and backends keep the values of this snapshot
+     */
+    PoolMetrics since(const PoolMetrics& earlier) const;
+};
+
+#endif // POOL_METRICS_H
@@ -0,0 +1,136 @@
+#ifndef PREPARED_STATEMENT_H
+#define PREPARED_STATEMENT_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <mysql/mysql.h>
+#include "query_result.h"
+
+class Connection;
+
+/**
+ * @brief server-side prepared statement using the binary protocol
+ *
+ * created by Connection::prepareStatement(), which caches it per connection,
+ * so a statement is parsed and planned by the server only once per physical connection.
+ *
+ * usage:
+ * auto stmt = conn->prepareStatement("SELECT name FROM users WHERE id = ? AND status = ?");
+ * stmt->setLong(0, userId);
+ * stmt->setInt(1, 1);
+ * auto result = stmt->executeQuery();
+ *
+ * Parameters are sent in binary form, so no escaping is needed.
+ * A statement belongs to its connection: use it only while the connection is borrowed,
+ * and never after the connection is destroyed. After a reconnect the cached statements are
+ * closed, calling execute on a closed statement throws db::SQLExecutionError.
+ */
+class PreparedStatement {
+public:
+    /**
+     * @param stmt prepared handle, the statement takes ownership
+     * @param sql SQL text, also the cache key
+     * @param connection owning connection, its mutex guards the MYSQL handle
+     */
+    PreparedStatement(MYSQL_STMT* stmt, const std::string& sql, Connection& connection);
+
+    ~PreparedStatement();
+
+    // disable copy constructor and copy assingments
+    PreparedStatement(const PreparedStatement&) = delete;
+    PreparedStatement& operator=(const PreparedStatement&) = delete;
+
+    // =========================
+    // parameter binding, index starts from 0
+    // =========================
+
+    void setInt(unsigned int index, int value);
+    void setLong(unsigned int index, long long value);
+    void setUnsignedLong(unsigned int index, unsigned long long value);
+    void setDouble(unsigned int index, double value);
+    void setString(unsigned int index, const std::string& value);
+    void setNull(unsigned int index);
+
+    /**
+     * @brief set every parameter back to NULL
+     *
+     * called when a cached statement is handed out again, so values never leak between borrowers
+     */
+    void clearParameters();
+
+    // =========================
+    // execution
+    // =========================
+
+    /**
+     * @brief execute a statement that returns rows
+     * @return all rows, fetched into memory
+     * @throws db::SQLExecutionError
+     */
+    QueryResultPtr executeQuery();
+
+    /**
+     * @brief execute INSERT, UPDATE, DELETE, etc.
+     * @return the number of affected rows
+     * @throws db::SQLExecutionError
+     */
+    unsigned long long executeUpdate();
+
+    /**
+     * @brief AUTO_INCREMENT value generated by the last execution
+     */
+    unsigned long long getLastInsertId() const;
+
+    unsigned long getParamCount() const;
+
+    const std::string& getSql() const;
+
+    /**
+     * @brief check if the statement handle is still open
+     */
+    bool isOpen() const;
+
+    /**
+     * @brief close the statement handle
+     */
+    void close();
+
+private:
+    friend class Connection;
+
+    // bool in MySQL 8, my_bool before
+    using BindFlag = std::remove_pointer<decltype(MYSQL_BIND::is_null)>::type;
+
+    struct Parameter {
+        enum_field_types type;
+        bool isUnsigned;
+        long long integer;
+        double real;
+        std::string text;
+        unsigned long length;
+        BindFlag isNull;
+    };
+
+    MYSQL_STMT* m_stmt;
+    std::string m_sql;
+    Connection& m_connection;
+    std::vector<Parameter> m_parameters;
+    std::vector<MYSQL_BIND> m_binds;
+    unsigned long long m_lastInsertId;
+
+    Parameter& parameter(unsigned int index);
+    // bind parameters and execute, called with the connection mutex held
+    void executeLocked();
+    // read the rows of the last execution, called with the connection mutex held
+    ResultRowsPtr fetchRowsLocked(MYSQL_RES* metadata);
+    // close without taking the connection mutex, used by Connection that already holds it
+    void closeLocked();
+    [[noreturn]] void throwError(const std::string& action) const;
+};
+
+using PreparedStatementPtr = std::shared_ptr<PreparedStatement>;
+
+#endif // PREPARED_STATEMENT_H
@@ -0,0 +1,135 @@
+#ifndef QUERY_CACHE_H
+#define QUERY_CACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "query_result.h"
+
+/**
+ * @brief client-side cache of read query results
+ *
+ * Keyed by the normalized SQL text plus the bound parameters. An entry holds the
+ * immutable ResultRows of the query, so a hit only wraps the shared rows in a new
+ * QueryResult and never touches the pool or the server.
+ *
+ * Entries expire after their TTL, the least recently used ones are evicted when the
+ * memory budget is exceeded, and invalidate(tag) drops every entry that was stored
+ * with the tag, typically the name of a table the query reads.
+ *
+ * The keys are spread over SHARD_COUNT shards with their own lock and LRU list, each
+ * shard gets an equal part of the budget.
+ */
+class QueryCache {
+public:
+    static const size_t SHARD_COUNT = 16;
+
+    struct Stats {
+        size_t entries;
+        size_t bytes;
+        uint64_t evictions;      // dropped to stay within the memory budget
+        uint64_t expirations;    // dropped because their TTL was over
+        uint64_t invalidations;  // dropped by invalidate() or clear()
+
+        Stats() : entries(0), bytes(0), evictions(0), expirations(0), invalidations(0) {}
+    };
+
+    QueryCache();
+
+    QueryCache(const QueryCache&) = delete;
+    QueryCache& operator=(const QueryCache&) = delete;
+
+    /**
+     * @brief set the memory budget and the TTL used when put() gets none
+     * @param maxBytes 0 disables the cache and drops every entry
+     *
+     * a smaller budget takes effect with the next put()
+     */
+    void configure(size_t maxBytes, int64_t defaultTtlNanos);
+
+    bool isEnabled() const {
+        return m_maxBytes.load(std::memory_order_relaxed) > 0;
+    }
+
+    /**
+     * @brief SQL text with runs of whitespace outside quotes collapsed to one space,
+     *        without leading and trailing whitespace or a trailing semicolon
+     */
+    static std::string normalize(const std::string& sql);
+
+    // the cache key of a query and its parameters
+    static std::string makeKey(const std::string& sql, const std::vector<std::string>& params);
+
+    /**
+     * @brief look up a key
+     * @return the cached rows, or nullptr when missing or expired
+     */
+    ResultRowsPtr get(const std::string& key);
+
+    /**
+     * @brief invalidation count, read it before running the query that fills an entry
+     */
+    uint64_t getEpoch() const {
+        return m_epoch.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief store the rows of a query
+     * @param ttlNanos 0 uses the default TTL
+     * @param epoch getEpoch() from before the query ran, the rows are dropped when an
+     *        invalidation happened since, they may predate the change it announced
+     * @return whether the rows were stored
+     */
+    bool put(const std::string& key, ResultRowsPtr rows, const std::vector<std::string>& tags,
+             int64_t ttlNanos, uint64_t epoch);
+
+    /**
+     * @brief drop every entry that was stored with the tag
+     * @return number of dropped entries
+     */
+    size_t invalidate(const std::string& tag);
+
+    void clear();
+
+    Stats getStats() const;
+
+private:
+    struct Entry {
+        std::string key;
+        ResultRowsPtr rows;
+        std::vector<std::string> tags;
+        int64_t expiresAt;
+        size_t bytes;
+    };
+
+    struct Shard {
+        mutable std::mutex mutex;
+        std::list<Entry> lru;  // most recently used first
+        std::unordered_map<std::string, std::list<Entry>::iterator> index;
+        size_t bytes = 0;
+        uint64_t evictions = 0;
+        uint64_t expirations = 0;
+        uint64_t invalidations = 0;
+    };
+
+    Shard& shardFor(const std::string& key);
+
+    void eraseLocked(Shard& shard, std::list<Entry>::iterator it);
+
+    // memory held by an entry, the rows are counted by capacity
+    static size_t entryBytes(const std::string& key, const ResultRows& rows, const std::vector<std::string>& tags);
+
+    static int64_t nowNanos();
+
+    std::atomic<size_t> m_maxBytes;
+    std::atomic<int64_t> m_defaultTtlNanos;
+    std::atomic<uint64_t> m_epoch;
+    Shard m_shards[SHARD_COUNT];
+};
+
+#endif // QUERY_CACHE_H
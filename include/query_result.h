@@ -4,9 +4,100 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <mutex>
 #include <mysql/mysql.h>
 #include <stdexcept>
+#include <cstring>
 #include "logger.h"
+#include "field_view.h"
+
+/**
+ * @brief 已经读取到内存中的结果集
+ * 
+ * 预处理语句走二进制协议，结果不是MYSQL_RES，而是逐行fetch到绑定的缓冲区
+ * 这里把每个值以文本形式连续存放，并在值后面补'\0'
+ * 这样QueryResult可以像访问MYSQL_ROW一样访问它们，所有getter保持不变
+ * 
+ * 构建完成后只读，可以被多个QueryResult共享
+ */
+struct ResultRows {
+    static const size_t NULL_VALUE = static_cast<size_t>(-1);
+
+    std::vector<std::string> fieldNames;
+    std::vector<enum_field_types> fieldTypes;  // 各字段的MySQL类型（可以为空，表示未知）
+    std::string data;                     // 所有值，每个值后面跟一个'\0'
+    std::vector<size_t> offsets;          // 第row行第field列的值在data中的偏移（NULL为NULL_VALUE）
+    std::vector<unsigned long> lengths;   // 第row行第field列的值的长度
+    unsigned long long rowCount = 0;
+
+    // 追加当前行的一个值，按列顺序调用
+    void appendValue(const char* value, unsigned long length) {
+        offsets.push_back(data.size());
+        lengths.push_back(length);
+        data.append(value, length);
+        data.push_back('\0');
+    }
+
+    void appendNull() {
+        offsets.push_back(NULL_VALUE);
+        lengths.push_back(0);
+    }
+};
+
+using ResultRowsPtr = std::shared_ptr<const ResultRows>;
+
+/**
+ * @brief 结果集的读取方式
+ */
+enum class ResultMode {
+    BUFFERED,   // mysql_store_result：整个结果集一次性读到客户端内存
+    STREAMING   // mysql_use_result：逐行从服务器读取，内存占用与行数无关
+};
+
+/**
+ * @brief 按名称访问字段时使用的字段名
+ * 
+ * 可以由const char*或std::string隐式构造，只保存指针和长度，不会构造临时的std::string
+ * 只在调用期间有效，不要保存
+ */
+class ColumnName {
+public:
+    ColumnName(const char* name) : m_data(name), m_size(name ? std::strlen(name) : 0) {}
+    ColumnName(const std::string& name) : m_data(name.data()), m_size(name.size()) {}
+    ColumnName(const char* name, size_t size) : m_data(name), m_size(size) {}
+
+    const char* data() const { return m_data; }
+    size_t size() const { return m_size; }
+    std::string toString() const { return m_data ? std::string(m_data, m_size) : std::string(); }
+
+private:
+    const char* m_data;
+    size_t m_size;
+};
+
+/**
+ * @brief 已经解析好的字段句柄
+ * 
+ * 由QueryResult::findColumn()按名称解析一次，之后每一行都直接按下标访问
+ * 可以在同一个结果集（或字段顺序相同的结果集）的所有行之间复用
+ * 
+ * 使用示例：
+ * Column name = result->findColumn("name");
+ * while (result->next()) {
+ *     FieldView value = result->getView(name);
+ * }
+ */
+class Column {
+public:
+    explicit Column(unsigned int index) : m_index(index) {}
+
+    unsigned int index() const { return m_index; }
+    // 所有按索引访问的方法都可以直接使用Column
+    operator unsigned int() const { return m_index; }
+
+private:
+    unsigned int m_index;
+};
 
 /**
  * @brief MySQL查询结果封装类
@@ -30,6 +121,27 @@ public:
      */
     explicit QueryResult(MYSQL_RES* result, unsigned long long affectedRows = 0);
 
+    /**
+     * @brief 构造函数（内存结果集）
+     * @param rows 已读取的结果集（例如预处理语句的结果）
+     */
+    explicit QueryResult(ResultRowsPtr rows);
+
+    /**
+     * @brief 构造函数（指定读取方式）
+     * @param result MySQL结果集指针
+     * @param mysql 结果集所属的连接句柄（STREAMING模式下用于区分读到末尾和读取出错）
+     * @param mode 读取方式
+     * 
+     * STREAMING模式是只进游标：
+     * - next() 每次从服务器读一行，出错时抛出 db::SQLExecutionError
+     * - reset() 不支持，返回false
+     * - getRowCount() 返回目前已经读取的行数，读到末尾后才是总行数
+     * - isEmpty() 读到末尾后才有意义
+     * - 在读完或close()之前，所属连接不能执行其他命令
+     */
+    QueryResult(MYSQL_RES* result, MYSQL* mysql, ResultMode mode);
+
     /**
      * @brief 析构函数，自动释放MySQL结果集
      * 这是RAII原则的体现：资源获取即初始化，对象销毁即资源释放
@@ -63,10 +175,29 @@ public:
     /**
      * @brief 重置到第一行（如果支持）
      * @return 是否成功重置
-     * 注意：某些MySQL配置可能不支持重置
+     * 注意：某些MySQL配置可能不支持重置，STREAMING模式不支持重置
      */
     bool reset();
 
+    /**
+     * @brief 结束读取并释放结果集
+     * 
+     * STREAMING模式下会读掉服务器剩余的行，之后连接可以继续使用
+     * BUFFERED模式下只是提前释放内存
+     */
+    void close();
+
+    /**
+     * @brief 获取读取方式
+     */
+    ResultMode getMode() const;
+
+    /**
+     * @brief STREAMING模式下，是否还有没有读取的行
+     * @return 结果集仍然占用着连接时返回true
+     */
+    bool isStreamOpen() const;
+
     // =========================
     // 元数据获取方法
     // =========================
@@ -80,7 +211,7 @@ public:
     /**
      * @brief 获取行数
      * @return 结果集中的总行数
-     * 注意：只有使用mysql_store_result()才能获取准确行数
+     * 注意：只有使用mysql_store_result()才能获取准确行数，STREAMING模式下返回已读取的行数
      */
     unsigned long long getRowCount() const;
 
@@ -96,6 +227,27 @@ public:
      */
     std::vector<std::string> getFieldNames() const;
 
+    /**
+     * @brief 获取所有字段的MySQL类型
+     * @return 字段类型向量，顺序与字段名一致；来源不提供类型时为空
+     */
+    const std::vector<enum_field_types>& getFieldTypes() const;
+
+    /**
+     * @brief 按名称解析字段，返回可以在各行之间复用的句柄
+     * @param fieldName 字段名称（区分大小写，同名字段取第一个）
+     * @return 字段句柄
+     * @throws std::out_of_range 如果字段名不存在
+     * 
+     * 字段名在构造结果集时建立哈希索引，查找是O(1)的
+     */
+    Column findColumn(ColumnName fieldName) const;
+
+    /**
+     * @brief 检查是否存在指定名称的字段
+     */
+    bool hasColumn(ColumnName fieldName) const;
+
     // =========================
     // 数据访问方法（按索引）
     // =========================
@@ -138,6 +290,38 @@ public:
      */
     bool isNull(unsigned int index) const;
 
+    /**
+     * @brief 获取指定索引的字段值（零拷贝视图）
+     * @param index 字段索引
+     * @return 指向当前行缓冲区的视图（NULL值的data()为nullptr）
+     * 
+     * 不分配内存，视图在next()、reset()、close()或结果集析构之后失效
+     * 
+     * 使用示例：
+     * while (result->next()) {
+     *     FieldView name = result->getView(0);
+     *     out.write(name.data(), name.size());
+     * }
+     */
+    FieldView getView(unsigned int index) const;
+
+    /**
+     * @brief 不抛出异常地读取整数/浮点数
+     * @param index 字段索引
+     * @param value 成功时写入转换结果，失败时保持不变
+     * @return NULL、不是完整的数字或超出范围时返回false
+     * 
+     * 不分配内存，也不依赖locale；索引越界或没有当前行时仍然抛出异常
+     * 
+     * 使用示例：
+     * long long id = 0;
+     * if (result->tryGetLong(0, id)) { ... }
+     */
+    bool tryGetInt(unsigned int index, int& value) const;
+    bool tryGetLong(unsigned int index, long long& value) const;
+    bool tryGetUnsignedLong(unsigned int index, unsigned long long& value) const;
+    bool tryGetDouble(unsigned int index, double& value) const;
+
     // =========================
     // 数据访问方法（按字段名）
     // =========================
@@ -148,35 +332,45 @@ public:
      * @return 字段值
      * @throws std::out_of_range 如果字段名不存在
      */
-    std::string getString(const std::string& fieldName) const;
+    std::string getString(ColumnName fieldName) const;
 
     /**
      * @brief 获取指定名称的字段值（整数）
      * @param fieldName 字段名称
      * @return 字段值
      */
-    int getInt(const std::string& fieldName) const;
+    int getInt(ColumnName fieldName) const;
 
     /**
      * @brief 获取指定名称的字段值（长整数）
      * @param fieldName 字段名称
      * @return 字段值
      */
-    long long getLong(const std::string& fieldName) const;
+    long long getLong(ColumnName fieldName) const;
 
     /**
      * @brief 获取指定名称的字段值（浮点数）
      * @param fieldName 字段名称
      * @return 字段值
      */
-    double getDouble(const std::string& fieldName) const;
+    double getDouble(ColumnName fieldName) const;
 
     /**
      * @brief 检查指定名称的字段是否为NULL
      * @param fieldName 字段名称
      * @return 是否为NULL
      */
-    bool isNull(const std::string& fieldName) const;
+    bool isNull(ColumnName fieldName) const;
+
+    /**
+     * @brief 按字段名获取零拷贝视图 / 不抛出异常地读取数值
+     * @throws std::out_of_range 如果字段名不存在
+     */
+    FieldView getView(ColumnName fieldName) const;
+    bool tryGetInt(ColumnName fieldName, int& value) const;
+    bool tryGetLong(ColumnName fieldName, long long& value) const;
+    bool tryGetUnsignedLong(ColumnName fieldName, unsigned long long& value) const;
+    bool tryGetDouble(ColumnName fieldName, double& value) const;
 
     // =========================
     // 便利方法
@@ -194,7 +388,26 @@ public:
      */
     bool hasResultSet() const;
 
+    /**
+     * @brief 把整个结果集复制成只读的内存结果集
+     * @return 内存结果集，可以被多个QueryResult共享（例如放进查询缓存）；没有结果集时返回nullptr
+     * @throws std::runtime_error STREAMING模式下不支持
+     * 
+     * 已经是内存结果集时直接共享，不复制；调用后当前位置回到第一行之前
+     */
+    ResultRowsPtr toRows();
+
 private:
+    friend class Connection;
+    friend class RowCursor;
+
+    // STREAMING模式的结果集状态
+    enum class StreamState {
+        OPEN,       // 还有行没有读取
+        FINISHED,   // 读到末尾或被close()，连接可以继续使用
+        ABORTED     // 没读完就被连接强制结束（连接执行了其他命令、被归还或被关闭）
+    };
+
     MYSQL_RES* m_result;                    // MySQL结果集指针
     MYSQL_ROW m_currentRow;                 // 当前行数据, 这是一行数据的类型安全表示, 它目前被实现为一个计数字节字符串的数组
     unsigned long* m_lengths;               // 当前行各字段的长度
@@ -202,6 +415,16 @@ private:
     unsigned long long m_rowCount;          // 行数
     unsigned long long m_affectedRows;      // 受影响的行数
     std::vector<std::string> m_fieldNames;  // 字段名列表
+    std::vector<enum_field_types> m_fieldTypes;  // 字段类型列表
+    std::vector<int> m_fieldSlots;          // 字段名哈希表（开放寻址），存放字段下标，-1为空槽
+    ResultRowsPtr m_rows;                   // 内存结果集（与m_result二选一）
+    unsigned long long m_nextRow;           // 内存结果集中下一行的下标
+    std::vector<char*> m_rowPointers;       // 内存结果集当前行各字段的指针，充当MYSQL_ROW
+    ResultMode m_mode;                      // 读取方式
+    MYSQL* m_mysql;                         // STREAMING模式下结果集所属的连接句柄
+    StreamState m_streamState;              // STREAMING模式的状态
+    // STREAMING模式下，连接可能在另一个线程结束结果集，next()和结束操作用它互斥
+    std::unique_ptr<std::mutex> m_streamMutex;
 
     /**
      * @brief 初始化结果集信息
@@ -209,13 +432,25 @@ private:
      */
     void initializeMetadata();
 
+    /**
+     * @brief 根据m_fieldNames建立字段名哈希表
+     * m_fieldNames设置之后调用
+     */
+    void buildFieldIndex();
+
+    /**
+     * @brief 在字段名哈希表中查找字段
+     * @return 字段下标，不存在时返回-1
+     */
+    int lookupField(const char* name, size_t size) const;
+
     /**
      * @brief 根据字段名获取字段索引
      * @param fieldName 字段名称
      * @return 字段索引
      * @throws std::out_of_range 如果字段名不存在
      */
-    unsigned int getFieldIndex(const std::string& fieldName) const;
+    unsigned int getFieldIndex(ColumnName fieldName) const;
 
     /**
      * @brief 检查索引是否有效
@@ -229,6 +464,15 @@ private:
      * @throws std::runtime_error 如果当前没有有效行
      */
     void checkRow() const;
+
+    /**
+     * @brief 由连接强制结束STREAMING结果集
+     * 连接要执行其他命令、被归还或被关闭时调用，之后next()会抛出异常
+     */
+    void abortStream();
+
+    // 释放结果集，STREAMING模式下由mysql_free_result读掉剩余的行
+    void freeResult();
     int safeConvert(const char* value, int defaultValue) const;
     long long safeConvert(const char* value, long long defaultValue) const;
     double safeConvert(const char* value, double defaultValue) const;
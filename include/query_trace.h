@@ -0,0 +1,180 @@
+#ifndef QUERY_TRACE_H
+#define QUERY_TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "snapshot_cell.h"
+
+/**
+ * @brief sampled per-query spans and the slow-query log
+ *
+ * A span covers one executeQuery()/executeUpdate()/executeStreamingQuery() call and
+ * the checkout it ran on: the time waited in getConnection() (which includes connecting
+ * a new connection the checkout waited for), reconnects after connection errors,
+ * mysql_query() and reading the result. The pool wait is attributed to the first
+ * query after the checkout.
+ *
+ * A fraction of the queries (the sample rate) is traced and handed to the sinks.
+ * With a slow-query threshold every query is timed, and the ones that take longer are
+ * handed to the sinks and written to the log at WARNING level whether sampled or not.
+ *
+ * With both off a query pays one relaxed atomic load and a branch.
+ */
+
+enum class TracePhase {
+    POOL_WAIT,      // getConnection() until the connection was handed over, CONNECT is part of it
+    CONNECT,        // connecting a new connection while the checkout waited for it
+    RECONNECT,      // reconnects after connection errors, including their backoff
+    QUERY,          // mysql_query(): sending the statement and reading the first response
+    FETCH           // mysql_store_result() or mysql_use_result()
+};
+
+const size_t TRACE_PHASE_COUNT = 5;
+
+const char* tracePhaseName(TracePhase phase);
+
+// monotonic clock of the phase timestamps, in microseconds
+inline int64_t traceClockMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+inline int64_t traceClockMicros(std::chrono::steady_clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(time.time_since_epoch()).count();
+}
+
+// phase times of a query while it runs, turned into a QuerySpan when it is emitted
+struct QueryTiming {
+    int64_t startMicros;                        // traceClockMicros() when the query started
+    int64_t phaseMicros[TRACE_PHASE_COUNT];
+    unsigned int reconnects;
+    bool sampled;
+
+    void reset(bool isSampled) {
+        startMicros = traceClockMicros();
+        for (size_t i = 0; i < TRACE_PHASE_COUNT; i++) {
+            phaseMicros[i] = 0;
+        }
+        reconnects = 0;
+        sampled = isSampled;
+    }
+
+    void add(TracePhase phase, int64_t micros) {
+        phaseMicros[static_cast<size_t>(phase)] += micros;
+    }
+};
+
+/**
+ * @brief record of one traced query
+ */
+struct QuerySpan {
+    std::string pool;
+    std::string backend;            // host:port
+    uint64_t backendId;
+    std::string connectionId;
+    std::string sql;
+    bool isQuery;                   // false for executeUpdate()
+    int64_t startMicros;            // wall clock (microseconds since the Unix epoch) when the checkout started
+    int64_t durationMicros;         // pool wait plus execution
+    int64_t phaseMicros[TRACE_PHASE_COUNT];
+    unsigned int reconnects;
+    bool success;
+    unsigned int errorCode;         // MySQL error code of a failed query, 0 if unknown
+    std::string error;
+    bool sampled;                   // picked by the sample rate
+    bool slow;                      // reached the slow-query threshold
+
+    QuerySpan();
+
+    int64_t getPhase(TracePhase phase) const {
+        return phaseMicros[static_cast<size_t>(phase)];
+    }
+
+    // one line of JSON, times in microseconds
+    std::string toJson() const;
+};
+
+// receives emitted spans on the thread that ran the query, must not block for long
+typedef std::function<void(const QuerySpan&)> TraceSink;
+
+/**
+ * @brief decides which queries are traced and hands their spans to the sinks
+ *
+ * Every pool has one, its connections report to it. configure() may be called at any
+ * time, queries already running keep the decision they started with.
+ */
+class QueryTracer {
+public:
+    explicit QueryTracer(const std::string& poolName = "");
+
+    QueryTracer(const QueryTracer&) = delete;
+    QueryTracer& operator=(const QueryTracer&) = delete;
+
+    /**
+     * @brief set the sampling and the slow-query log
+     * @param sampleRate fraction of the queries that is traced, 0 to 1
+     * @param slowQueryThreshold queries taking at least this long (milliseconds) are
+     *        always emitted and logged, 0 turns the slow-query log off
+     */
+    void configure(double sampleRate, unsigned int slowQueryThreshold);
+
+    // whether any query can be traced, the only check on the path of an untraced query
+    bool isActive() const {
+        return m_active.load(std::memory_order_relaxed);
+    }
+
+    double getSampleRate() const;
+    int64_t getSlowThresholdMicros() const;
+
+    /**
+     * @brief decide for a query that is about to start
+     * @param sampled set to whether the query is sampled
+     * @return whether the query has to be timed at all
+     */
+    bool shouldTrace(bool& sampled) const;
+
+    // whether a timed query is emitted, build the span only when it is
+    bool shouldEmit(bool sampled, int64_t durationMicros) const;
+
+    /**
+     * @brief hand a span to the sinks, slow spans are also written to the log
+     *
+     * sets span.pool and span.slow; an exception thrown by a sink is logged and dropped
+     */
+    void emit(QuerySpan& span);
+
+    /**
+     * @brief register a sink for emitted spans
+     * @return id for removeSink()
+     */
+    size_t addSink(TraceSink sink);
+
+    bool removeSink(size_t id);
+
+    uint64_t getEmittedCount() const;
+    uint64_t getSlowCount() const;
+
+private:
+    typedef std::vector<std::pair<size_t, TraceSink>> SinkList;
+
+    std::string m_poolName;
+    std::atomic<bool> m_active;
+    std::atomic<double> m_sampleRate;
+    std::atomic<int64_t> m_slowThresholdMicros;
+
+    // read on every emit without locking, replaced under m_sinkMutex
+    SnapshotCell<SinkList> m_sinks;
+    std::mutex m_sinkMutex;
+    size_t m_nextSinkId;
+
+    std::atomic<uint64_t> m_emitted;
+    std::atomic<uint64_t> m_slow;
+};
+
+#endif // QUERY_TRACE_H
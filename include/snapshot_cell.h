@@ -0,0 +1,117 @@
+#ifndef SNAPSHOT_CELL_H
+#define SNAPSHOT_CELL_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+// versions are shared by every cell, so a thread-local cache can never
+// mistake one cell's value for another's
+inline uint64_t nextSnapshotVersion() {
+    static std::atomic<uint64_t> version(1);
+    return version.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * @brief holder of an immutable value that is replaced as a whole (read-copy-update)
+ *
+ * Writers build a new value and store() it, they must be serialized by the caller.
+ * Readers call get(), which keeps the value in a thread-local cache and only
+ * goes through std::atomic_load when the version changed, so the usual read is
+ * two atomic loads and no reference count traffic.
+ *
+ * The cache holds a reference, so a cell's last value outlives the cell in the
+ * threads that read it: destroying a cell makes every thread drop its cached
+ * values of this type on its next get(). A thread that never calls get() again
+ * keeps them until it exits.
+ */
+template <typename T>
+class SnapshotCell {
+public:
+    explicit SnapshotCell(T value = T())
+        : m_version(0) {
+        store(std::move(value));
+    }
+
+    ~SnapshotCell() {
+        destroyedCells().fetch_add(1, std::memory_order_relaxed);
+    }
+
+    SnapshotCell(const SnapshotCell&) = delete;
+    SnapshotCell& operator=(const SnapshotCell&) = delete;
+
+    // publish a new value, readers see it on their next get()
+    void store(T value) {
+        auto entry = std::make_shared<Entry>(std::move(value), nextSnapshotVersion());
+        uint64_t version = entry->version;
+        std::atomic_store(&m_entry, std::shared_ptr<const Entry>(std::move(entry)));
+        // stored after the entry, so a matching version means the cached entry is the latest one
+        m_version.store(version, std::memory_order_release);
+    }
+
+    // current value, kept alive by the returned pointer
+    std::shared_ptr<const T> load() const {
+        std::shared_ptr<const Entry> entry = std::atomic_load(&m_entry);
+        return std::shared_ptr<const T>(entry, &entry->value);
+    }
+
+    // current value through the calling thread's cache; the reference stays valid
+    // until the same thread calls get() on another SnapshotCell<T> or sees a newer version
+    const T& get() const {
+        struct Cache {
+            const SnapshotCell* owner = nullptr;
+            uint64_t version = 0;
+            std::shared_ptr<const Entry> entry;
+        };
+        struct Caches {
+            // a few direct-mapped slots, so a thread using several cells (one per pool) does not thrash
+            Cache slots[CACHE_SLOTS];
+            uint64_t destroyed = 0;     // destroyedCells() when the slots were last swept
+        };
+        static thread_local Caches caches;
+        uint64_t destroyed = destroyedCells().load(std::memory_order_relaxed);
+        if (caches.destroyed != destroyed) {
+            // a slot may hold the last value of a destroyed cell, which only this thread can release
+            for (Cache& stale : caches.slots) {
+                stale = Cache();
+            }
+            caches.destroyed = destroyed;
+        }
+        Cache& cache = caches.slots[(reinterpret_cast<uintptr_t>(this) * 0x9E3779B97F4A7C15ULL) >> (64 - CACHE_BITS)];
+
+        uint64_t version = m_version.load(std::memory_order_acquire);
+        if (cache.owner != this || cache.version != version) {
+            cache.entry = std::atomic_load(&m_entry);
+            cache.owner = this;
+            cache.version = cache.entry->version;
+        }
+        return cache.entry->value;
+    }
+
+    // version of the latest value, changes with every store()
+    uint64_t getVersion() const {
+        return m_version.load(std::memory_order_acquire);
+    }
+
+private:
+    static const unsigned CACHE_BITS = 2;
+    static const unsigned CACHE_SLOTS = 1u << CACHE_BITS;
+
+    // cells of this type destroyed so far, rarely written, so reading it stays cheap
+    static std::atomic<uint64_t>& destroyedCells() {
+        static std::atomic<uint64_t> count(0);
+        return count;
+    }
+
+    struct Entry {
+        T value;
+        uint64_t version;
+
+        Entry(T value, uint64_t version) : value(std::move(value)), version(version) {}
+    };
+
+    std::shared_ptr<const Entry> m_entry;
+    std::atomic<uint64_t> m_version;
+};
+
+#endif // SNAPSHOT_CELL_H
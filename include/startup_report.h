@@ -0,0 +1,90 @@
+#ifndef STARTUP_REPORT_H
+#define STARTUP_REPORT_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+/**
+ * @brief warm-up result of one database instance
+ *
+ * all times are in milliseconds, measured from the start of ConnectionPool::init
+ */
+struct BackendStartupStats {
+    std::string backend;        // DBConfig::getConnectionString()
+    unsigned int requested;     // connections planned for this backend
+    unsigned int created;       // connections created successfully
+    unsigned int failed;        // connects that threw
+    int64_t firstReadyMs;       // first connection created, -1 if none
+    int64_t readyMs;            // the backend reached its ready target, -1 if it did not
+    int64_t totalConnectMs;     // sum of the handshake times
+    int64_t maxConnectMs;       // slowest handshake
+    std::string lastError;      // message of the last failure
+
+    BackendStartupStats()
+        : requested(0)
+        , created(0)
+        , failed(0)
+        , firstReadyMs(-1)
+        , readyMs(-1)
+        , totalConnectMs(0)
+        , maxConnectMs(0) {}
+
+    int64_t averageConnectMs() const {
+        unsigned int attempts = created + failed;
+        return attempts == 0 ? 0 : totalConnectMs / attempts;
+    }
+};
+
+/**
+ * @brief result of ConnectionPool::init
+ *
+ * ready is true when every backend reached its ready target:
+ * PoolConfig::minReadyPerBackend connections, or all of its planned
+ * connections when minReadyPerBackend is 0.
+ * Connections that were not started when init returned are created by the
+ * background factory, they are counted in backgroundConnections.
+ */
+struct StartupReport {
+    bool ready;
+    bool timedOut;                       // warmupTimeout expired before the warm-up finished
+    unsigned int requested;
+    unsigned int created;
+    unsigned int failed;
+    unsigned int backgroundConnections;  // handed to the background after init returned
+    int64_t elapsedMs;
+    std::vector<BackendStartupStats> backends;
+
+    StartupReport()
+        : ready(false)
+        , timedOut(false)
+        , requested(0)
+        , created(0)
+        , failed(0)
+        , backgroundConnections(0)
+        , elapsedMs(0) {}
+
+    std::string toString() const {
+        std::string report = "StartupReport{ready=" + std::string(ready ? "true" : "false");
+        report += ", timedOut=" + std::string(timedOut ? "true" : "false");
+        report += ", created=" + std::to_string(created) + "/" + std::to_string(requested);
+        report += ", failed=" + std::to_string(failed);
+        report += ", background=" + std::to_string(backgroundConnections);
+        report += ", elapsed=" + std::to_string(elapsedMs) + "ms}";
+        for (const auto& backend : backends) {
+            report += "\n  " + backend.backend + ": created=" + std::to_string(backend.created) +
+                      "/" + std::to_string(backend.requested) +
+                      ", failed=" + std::to_string(backend.failed) +
+                      ", firstReady=" + std::to_string(backend.firstReadyMs) + "ms" +
+                      ", ready=" + std::to_string(backend.readyMs) + "ms" +
+                      ", avgConnect=" + std::to_string(backend.averageConnectMs()) + "ms" +
+                      ", maxConnect=" + std::to_string(backend.maxConnectMs) + "ms";
+            if (!backend.lastError.empty()) {
+                report += ", lastError=" + backend.lastError;
+            }
+        }
+        return report;
+    }
+};
+
+#endif // STARTUP_REPORT_H
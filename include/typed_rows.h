@@ -0,0 +1,386 @@
+#ifndef TYPED_ROWS_H
+#define TYPED_ROWS_H
+
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <mysql/mysql.h>
+#include "field_view.h"
+#include "query_result.h"
+
+/**
+ * @brief append-only storage for the string values of a TypedRows
+ *
+ * Values are copied into large chunks that are never moved, so a FieldView into the
+ * arena stays valid as long as the arena, also after the arena itself is moved.
+ */
+class StringArena {
+public:
+    static const size_t DEFAULT_CHUNK_SIZE = 64 * 1024;
+
+    explicit StringArena(size_t chunkSize = DEFAULT_CHUNK_SIZE);
+
+    StringArena(const StringArena&) = delete;
+    StringArena& operator=(const StringArena&) = delete;
+    StringArena(StringArena&&) = default;
+    StringArena& operator=(StringArena&&) = default;
+
+    // copy size bytes into the arena and return the copy, a value larger than a chunk gets its own chunk
+    const char* append(const char* data, size_t size);
+
+    // drop every value, one chunk is kept for reuse; views into the arena become invalid
+    void clear();
+
+    // bytes held by the chunks
+    size_t capacity() const { return m_capacity; }
+
+private:
+    size_t m_chunkSize;
+    std::vector<std::unique_ptr<char[]>> m_chunks;
+    char* m_next;        // free space of the last chunk
+    size_t m_remaining;
+    size_t m_capacity;
+};
+
+/**
+ * @brief maps the columns of a result to the members of a user struct, in column order
+ *
+ * Specialize it with a static fields() returning a tuple of member pointers:
+ *
+ * struct Order { long long id; FieldView name; double price; };
+ * template <> struct RowMapping<Order> {
+ *     static std::tuple<long long Order::*, FieldView Order::*, double Order::*> fields() {
+ *         return std::make_tuple(&Order::id, &Order::name, &Order::price);
+ *     }
+ * };
+ *
+ * std::tuple<...> rows need no mapping.
+ */
+template <typename Row>
+struct RowMapping;
+
+/**
+ * @brief conversion of one column to a C++ type
+ *
+ * Supported: signed and unsigned integers, float, double, std::string and FieldView.
+ * accepts() is checked once per result against the MYSQL_FIELD type, decode() runs per cell
+ * and returns false when the text does not fit the type (e.g. out of range).
+ * NULL decodes to 0 or an empty string like the QueryResult getters, and to a null FieldView.
+ */
+template <typename T, typename Enable = void>
+struct ColumnType;
+
+namespace typed_rows_detail {
+
+bool isIntegerType(enum_field_types type);
+bool isNumericType(enum_field_types type);
+const char* fieldTypeName(enum_field_types type);
+
+} // namespace typed_rows_detail
+
+template <typename T>
+struct ColumnType<T, typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type> {
+    static const char* name() { return "signed integer"; }
+    static bool accepts(enum_field_types type) { return typed_rows_detail::isIntegerType(type); }
+    static bool decode(const char* data, unsigned long length, T& value, StringArena&) {
+        long long parsed = 0;
+        if (data == nullptr) {
+            value = 0;
+            return true;
+        }
+        if (!FieldView(data, length).toLong(parsed) ||
+            parsed < static_cast<long long>(std::numeric_limits<T>::min()) ||
+            parsed > static_cast<long long>(std::numeric_limits<T>::max())) {
+            return false;
+        }
+        value = static_cast<T>(parsed);
+        return true;
+    }
+};
+
+template <typename T>
+struct ColumnType<T, typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value &&
+                                             !std::is_same<T, bool>::value>::type> {
+    static const char* name() { return "unsigned integer"; }
+    static bool accepts(enum_field_types type) { return typed_rows_detail::isIntegerType(type); }
+    static bool decode(const char* data, unsigned long length, T& value, StringArena&) {
+        unsigned long long parsed = 0;
+        if (data == nullptr) {
+            value = 0;
+            return true;
+        }
+        if (!FieldView(data, length).toUnsignedLong(parsed) ||
+            parsed > static_cast<unsigned long long>(std::numeric_limits<T>::max())) {
+            return false;
+        }
+        value = static_cast<T>(parsed);
+        return true;
+    }
+};
+
+template <typename T>
+struct ColumnType<T, typename std::enable_if<std::is_floating_point<T>::value>::type> {
+    static const char* name() { return "floating point"; }
+    static bool accepts(enum_field_types type) { return typed_rows_detail::isNumericType(type); }
+    static bool decode(const char* data, unsigned long length, T& value, StringArena&) {
+        double parsed = 0.0;
+        if (data == nullptr) {
+            value = 0;
+            return true;
+        }
+        if (!FieldView(data, length).toDouble(parsed)) {
+            return false;
+        }
+        value = static_cast<T>(parsed);
+        return true;
+    }
+};
+
+template <>
+struct ColumnType<std::string> {
+    static const char* name() { return "std::string"; }
+    static bool accepts(enum_field_types) { return true; }
+    static bool decode(const char* data, unsigned long length, std::string& value, StringArena&) {
+        if (data == nullptr) {
+            value.clear();
+        } else {
+            value.assign(data, length);
+        }
+        return true;
+    }
+};
+
+template <>
+struct ColumnType<FieldView> {
+    static const char* name() { return "FieldView"; }
+    static bool accepts(enum_field_types) { return true; }
+    static bool decode(const char* data, unsigned long length, FieldView& value, StringArena& arena) {
+        value = data == nullptr ? FieldView() : FieldView(arena.append(data, length), length);
+        return true;
+    }
+};
+
+/**
+ * @brief column layout of a row type: the type of column I and where it is stored in a row
+ */
+template <typename Row>
+struct RowLayout {
+private:
+    using Fields = decltype(RowMapping<Row>::fields());
+
+    template <typename Member>
+    struct MemberType;
+    template <typename Class, typename T>
+    struct MemberType<T Class::*> {
+        using type = T;
+    };
+
+public:
+    static const size_t COLUMN_COUNT = std::tuple_size<Fields>::value;
+
+    template <size_t I>
+    using Type = typename MemberType<typename std::tuple_element<I, Fields>::type>::type;
+
+    template <size_t I>
+    static Type<I>& get(Row& row, const Fields& fields) {
+        return row.*std::get<I>(fields);
+    }
+
+    static Fields fields() {
+        return RowMapping<Row>::fields();
+    }
+};
+
+template <typename... Ts>
+struct RowLayout<std::tuple<Ts...>> {
+private:
+    struct Fields {};
+
+public:
+    static const size_t COLUMN_COUNT = sizeof...(Ts);
+
+    template <size_t I>
+    using Type = typename std::tuple_element<I, std::tuple<Ts...>>::type;
+
+    template <size_t I>
+    static Type<I>& get(std::tuple<Ts...>& row, const Fields&) {
+        return std::get<I>(row);
+    }
+
+    static Fields fields() {
+        return Fields();
+    }
+};
+
+/**
+ * @brief rows of a result decoded into Row values, stored contiguously
+ *
+ * FieldView members point into the arena owned by this object, they stay valid until it is
+ * destroyed; moving it keeps them valid, copying is not allowed.
+ */
+template <typename Row>
+class TypedRows {
+public:
+    using const_iterator = typename std::vector<Row>::const_iterator;
+
+    TypedRows() = default;
+    TypedRows(const TypedRows&) = delete;
+    TypedRows& operator=(const TypedRows&) = delete;
+    TypedRows(TypedRows&&) = default;
+    TypedRows& operator=(TypedRows&&) = default;
+
+    size_t size() const { return m_rows.size(); }
+    bool empty() const { return m_rows.empty(); }
+    const Row& operator[](size_t index) const { return m_rows[index]; }
+    const_iterator begin() const { return m_rows.begin(); }
+    const_iterator end() const { return m_rows.end(); }
+    const std::vector<Row>& rows() const { return m_rows; }
+
+    // drop the rows but keep their memory, so a batch loop does not allocate again
+    void clear() {
+        m_rows.clear();
+        m_arena.clear();
+    }
+
+    // bytes held by the string arena
+    size_t arenaBytes() const { return m_arena.capacity(); }
+
+private:
+    template <typename>
+    friend class RowDecoder;
+
+    std::vector<Row> m_rows;
+    StringArena m_arena;
+};
+
+/**
+ * @brief access to the current row of a QueryResult without the per-cell checks of the getters
+ */
+class RowCursor {
+public:
+    static const char* const* values(const QueryResult& result) { return result.m_currentRow; }
+    static const unsigned long* lengths(const QueryResult& result) { return result.m_lengths; }
+};
+
+/**
+ * @brief decodes the rows of a QueryResult into Row values
+ *
+ * The constructor checks once that the result has one column per Row field and that every
+ * column type can be converted to its field, afterwards fetch() decodes whole rows with no
+ * per-cell index, row or type checks.
+ *
+ * Usage:
+ * auto result = conn->executeStreamingQuery("SELECT id, name, price FROM orders");
+ * RowDecoder<std::tuple<long long, FieldView, double>> decoder(*result);
+ * TypedRows<std::tuple<long long, FieldView, double>> batch;
+ * while (decoder.fetch(*result, batch, 10000) > 0) {
+ *     aggregate(batch);
+ *     batch.clear();
+ * }
+ */
+template <typename Row>
+class RowDecoder {
+public:
+    static const size_t COLUMN_COUNT = RowLayout<Row>::COLUMN_COUNT;
+
+    /**
+     * @throws std::invalid_argument if the column count or a column type does not match Row
+     */
+    explicit RowDecoder(const QueryResult& result) {
+        if (result.getFieldCount() != COLUMN_COUNT) {
+            throw std::invalid_argument("RowDecoder: the result has " + std::to_string(result.getFieldCount()) +
+                                        " columns, the row type has " + std::to_string(COLUMN_COUNT));
+        }
+        checkTypes(result, std::make_index_sequence<COLUMN_COUNT>());
+    }
+
+    /**
+     * @brief decode the next rows of result and append them to rows
+     * @param maxRows at most this many rows, 0 for all remaining rows
+     * @return number of decoded rows, 0 at the end of the result
+     * @throws std::out_of_range if a value does not fit its field, e.g. an overflowing integer
+     */
+    size_t fetch(QueryResult& result, TypedRows<Row>& rows, size_t maxRows = 0) {
+        if (maxRows == 0 && result.getMode() == ResultMode::BUFFERED) {
+            rows.m_rows.reserve(rows.m_rows.size() + static_cast<size_t>(result.getRowCount()));
+        } else if (maxRows > 0) {
+            rows.m_rows.reserve(rows.m_rows.size() + maxRows);
+        }
+        auto fields = RowLayout<Row>::fields();
+        size_t count = 0;
+        while ((maxRows == 0 || count < maxRows) && result.next()) {
+            rows.m_rows.emplace_back();
+            try {
+                decodeRow(result, rows.m_rows.back(), fields, rows.m_arena, std::make_index_sequence<COLUMN_COUNT>());
+            } catch (...) {
+                // rows only gets whole rows
+                rows.m_rows.pop_back();
+                throw;
+            }
+            count++;
+        }
+        return count;
+    }
+
+private:
+    template <size_t... I>
+    static void checkTypes(const QueryResult& result, std::index_sequence<I...>) {
+        int checks[] = {0, (checkType<I>(result), 0)...};
+        (void)checks;
+    }
+
+    template <size_t I>
+    static void checkType(const QueryResult& result) {
+        using Decoder = ColumnType<typename RowLayout<Row>::template Type<I>>;
+        const std::vector<enum_field_types>& types = result.getFieldTypes();
+        // results built without metadata are only checked per value
+        if (types.empty() || types[I] == MYSQL_TYPE_NULL || Decoder::accepts(types[I])) {
+            return;
+        }
+        throw std::invalid_argument("RowDecoder: column " + std::to_string(I) + " '" + result.getFieldNames()[I] +
+                                    "' of type " + typed_rows_detail::fieldTypeName(types[I]) +
+                                    " cannot be decoded as " + Decoder::name());
+    }
+
+    template <typename Fields, size_t... I>
+    static void decodeRow(const QueryResult& result, Row& row, const Fields& fields, StringArena& arena,
+                          std::index_sequence<I...>) {
+        const char* const* values = RowCursor::values(result);
+        const unsigned long* lengths = RowCursor::lengths(result);
+        int columns[] = {0, (decodeColumn<I>(result, values, lengths, row, fields, arena), 0)...};
+        (void)columns;
+    }
+
+    template <size_t I, typename Fields>
+    static void decodeColumn(const QueryResult& result, const char* const* values, const unsigned long* lengths,
+                             Row& row, const Fields& fields, StringArena& arena) {
+        using Decoder = ColumnType<typename RowLayout<Row>::template Type<I>>;
+        if (!Decoder::decode(values[I], lengths[I], RowLayout<Row>::template get<I>(row, fields), arena)) {
+            throw std::out_of_range("RowDecoder: value '" + std::string(values[I], lengths[I]) + "' of column " +
+                                    std::to_string(I) + " '" + result.getFieldNames()[I] +
+                                    "' does not fit " + Decoder::name());
+        }
+    }
+};
+
+template <typename Row>
+const size_t RowDecoder<Row>::COLUMN_COUNT;
+
+/**
+ * @brief decode every remaining row of result
+ * @throws std::invalid_argument, std::out_of_range like RowDecoder
+ */
+template <typename Row>
+TypedRows<Row> fetchRows(QueryResult& result) {
+    TypedRows<Row> rows;
+    RowDecoder<Row>(result).fetch(result, rows);
+    return rows;
+}
+
+#endif // TYPED_ROWS_H
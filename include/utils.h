@@ -6,6 +6,10 @@
 #include <sstream>
 #include <random>
 #include <chrono>
+#include <atomic>
+#include <algorithm>
+#include <cstdio>
+#include <locale.h>
 
 /**
  * @brief 通用工具类和功能
@@ -86,6 +90,18 @@ namespace Utils {
             std::chrono::steady_clock::now().time_since_epoch()).count();
     }
 
+    /**
+     * @brief 获取当前线程的稳定编号
+     * @return 线程编号（按线程首次调用的顺序递增）
+     *
+     * 用途：把线程分散到不同的分片上（空闲连接分片、计数器分片等），减少锁和缓存行竞争
+     */
+    inline size_t currentThreadIndex() {
+        static std::atomic<size_t> nextIndex{0};
+        static thread_local size_t index = nextIndex.fetch_add(1, std::memory_order_relaxed);
+        return index;
+    }
+
     /**
      * @brief 将任意类型数据转换为字符串
      * @tparam T 数据类型
@@ -177,6 +193,37 @@ inline std::string quoteMySQLString(const std::string& value) {
         return str.substr(first, (last - first + 1));
     }
 
+    /**
+     * @brief 只设置了LC_NUMERIC的"C" locale，所有线程共用一个句柄
+     * @return 无法创建时返回 (locale_t)0
+     *
+     * 数字和SQL、指标之间的转换都用'.'作小数点，与进程的locale无关
+     */
+    inline locale_t cNumericLocale() {
+        static locale_t locale = newlocale(LC_NUMERIC_MASK, "C", static_cast<locale_t>(0));
+        return locale;
+    }
+
+    /**
+     * @brief 在"C" locale下用snprintf格式化一个double
+     * @param value 要格式化的值
+     * @param format 只含一个double转换的格式，如 "%.17g"
+     * @return 格式化后的字符串，小数点总是'.'
+     */
+    inline std::string formatDouble(double value, const char* format) {
+        // uselocale只影响当前线程
+        locale_t previous = cNumericLocale() ? uselocale(cNumericLocale()) : static_cast<locale_t>(0);
+        char buffer[64];
+        int length = std::snprintf(buffer, sizeof(buffer), format, value);
+        if (previous) {
+            uselocale(previous);
+        }
+        if (length < 0) {
+            return std::string();
+        }
+        return std::string(buffer, std::min(static_cast<size_t>(length), sizeof(buffer) - 1));
+    }
+
 } // namespace Utils
 
 #endif // UTILS_H
\ No newline at end of file
@@ -0,0 +1,109 @@
+#ifndef WAIT_QUEUE_H
+#define WAIT_QUEUE_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <set>
+
+class Connection;
+
+// order in which waiting checkouts are served, FIFO inside the same priority
+enum class AcquirePriority {
+    LOW = 0,
+    NORMAL = 1,
+    HIGH = 2
+};
+
+/**
+ * @brief one thread waiting in ConnectionPool::getConnection()
+ *
+ * lives on the waiting thread's stack; every field is guarded by the pool's mutex
+ */
+struct AcquireWaiter {
+    AcquireWaiter(AcquirePriority priority, std::chrono::steady_clock::time_point deadline)
+        : priority(priority)
+        , deadline(deadline)
+        , sequence(0)
+        , enqueuedMicros(0)
+        , connection(nullptr)
+        , retry(false) {}
+
+    const AcquirePriority priority;
+    const std::chrono::steady_clock::time_point deadline;
+    uint64_t sequence;          // position inside the priority, kept when the waiter queues again
+    int64_t enqueuedMicros;     // first time the waiter queued, Utils::currentTimeMicros()
+    Connection* connection;     // handed over by the pool, belongs to the waiter once set
+    bool retry;                 // capacity was released or the pool changed: look again
+    std::condition_variable condition;
+};
+
+/**
+ * @brief waiters of one backend sub-pool, highest priority first, then first come first served
+ *
+ * A released or newly created connection is handed straight to the first waiter
+ * instead of going through the idle store, so a thread arriving later cannot take it.
+ * Not thread-safe, the ConnectionPool calls it with its mutex held.
+ */
+class WaitQueue {
+public:
+    WaitQueue();
+
+    WaitQueue(const WaitQueue&) = delete;
+    WaitQueue& operator=(const WaitQueue&) = delete;
+
+    // a waiter queuing again keeps the place it had
+    void push(AcquireWaiter* waiter);
+
+    // no-op if the waiter has already been served
+    void remove(AcquireWaiter* waiter);
+
+    bool empty() const {
+        return m_waiters.empty();
+    }
+
+    size_t size() const {
+        return m_waiters.size();
+    }
+
+    // waiters that are served before a new waiter of this priority
+    size_t countAhead(AcquirePriority priority) const;
+
+    // give the connection to the first waiter and wake it, false if nobody waits
+    bool handOff(Connection* connection);
+
+    // wake the first waiter so it looks for capacity again
+    void wakeFront();
+
+    // wake every waiter, e.g. on shutdown; connections already handed over stay with their waiter
+    void wakeAll();
+
+    /**
+     * @brief expected wait of a waiter with ahead waiters in front of it
+     * @return microseconds, -1 while too few hand-offs have been seen to tell
+     *
+     * based on the average time between hand-offs while the queue was never empty,
+     * i.e. the rate at which the backend frees connections under load
+     */
+    int64_t estimateWaitMicros(size_t ahead) const;
+
+private:
+    struct Order {
+        bool operator()(const AcquireWaiter* a, const AcquireWaiter* b) const {
+            if (a->priority != b->priority) {
+                return a->priority > b->priority;
+            }
+            return a->sequence < b->sequence;
+        }
+    };
+
+    // hand-offs needed before estimateWaitMicros() answers
+    static const uint64_t MIN_SAMPLES = 4;
+
+    std::set<AcquireWaiter*, Order> m_waiters;
+    int64_t m_lastHandOffMicros;     // 0 while the queue has been empty since the last hand-off
+    double m_handOffIntervalMicros;  // moving average
+    uint64_t m_samples;
+};
+
+#endif // WAIT_QUEUE_H
@@ -0,0 +1,388 @@
+#include "async_executor.h"
+#include "utils.h"
+#include <list>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <cerrno>
+#include <cstring>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+
+namespace {
+
+// statements larger than what the socket buffer takes at once may stall while
+// being sent, those also wait for the socket to become writable
+const size_t LARGE_STATEMENT_BYTES = 64 * 1024;
+
+const int MAX_EVENTS = 64;
+
+// set on the loop threads of every executor, borrowing there could wait for
+// connections only that loop can give back
+thread_local bool onLoopThread = false;
+
+std::runtime_error systemError(const std::string& what) {
+    return std::runtime_error("AsyncExecutor: " + what + ": " + std::strerror(errno));
+}
+
+} // namespace
+
+
+struct AsyncExecutor::Operation {
+    PooledConnection connection;
+    // of the submitting thread, the connection is returned for it
+    ConnectionPool::BorrowerState borrower;
+    std::string sql;
+    bool isQuery = false;
+    QueryCallback callback;
+    int fd = -1;
+    // entry in Loop::deadlines while the statement runs under a timeout
+    std::list<std::pair<int64_t, Operation*>>::iterator deadline;
+    bool hasDeadline = false;
+};
+
+
+struct AsyncExecutor::Loop {
+    int epollFd = -1;
+    int wakeFd = -1;
+    std::thread thread;
+
+    // handed over by the submitting threads
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Operation>> submitted;
+    bool stopping = false;
+
+    // only touched by the loop thread
+    std::unordered_map<int, std::unique_ptr<Operation>> waiting;    // by socket
+    // every statement gets the same timeout, so the deadlines are in start order;
+    // a statement removes its entry when it completes
+    std::list<std::pair<int64_t, Operation*>> deadlines;
+
+    void dropDeadline(Operation& op) {
+        if (op.hasDeadline) {
+            deadlines.erase(op.deadline);
+            op.hasDeadline = false;
+        }
+    }
+
+    ~Loop() {
+        if (wakeFd >= 0) {
+            ::close(wakeFd);
+        }
+        if (epollFd >= 0) {
+            ::close(epollFd);
+        }
+    }
+
+    void wakeUp() {
+        uint64_t one = 1;
+        ssize_t ignored = ::write(wakeFd, &one, sizeof(one));
+        (void)ignored;
+    }
+};
+
+
+AsyncExecutor::AsyncExecutor(ConnectionPool& pool, size_t loopCount, unsigned int queryTimeout)
+    : m_pool(pool)
+    , m_queryTimeout(queryTimeout)
+    , m_nextLoop(0)
+    , m_inFlight(0)
+    , m_running(true) {
+    if (loopCount == 0) {
+        loopCount = 1;
+    }
+    for (size_t i = 0; i < loopCount; i++) {
+        std::unique_ptr<Loop> loop(new Loop());
+        loop->epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+        if (loop->epollFd < 0) {
+            throw systemError("epoll_create1 failed");
+        }
+        loop->wakeFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (loop->wakeFd < 0) {
+            throw systemError("eventfd failed");
+        }
+        epoll_event event;
+        std::memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN;
+        event.data.fd = loop->wakeFd;
+        if (::epoll_ctl(loop->epollFd, EPOLL_CTL_ADD, loop->wakeFd, &event) != 0) {
+            throw systemError("epoll_ctl failed");
+        }
+        m_loops.push_back(std::move(loop));
+    }
+    for (auto& loop : m_loops) {
+        Loop* target = loop.get();
+        loop->thread = std::thread([this, target]() {
+            this->run(*target);
+        });
+    }
+    LOG_INFO("AsyncExecutor started with " + std::to_string(loopCount) + " loops" +
+             (isNonBlocking() ? "" : ", the client library has no non-blocking API"));
+}
+
+
+AsyncExecutor::~AsyncExecutor() {
+    stop();
+}
+
+
+void AsyncExecutor::stop() {
+    if (!m_running.exchange(false)) {
+        return;
+    }
+    for (auto& loop : m_loops) {
+        {
+            std::lock_guard<std::mutex> lock(loop->mutex);
+            loop->stopping = true;
+        }
+        loop->wakeUp();
+    }
+    for (auto& loop : m_loops) {
+        if (loop->thread.joinable()) {
+            loop->thread.join();
+        }
+    }
+}
+
+
+void AsyncExecutor::executeQuery(const std::string& sql, QueryCallback callback, AccessMode mode) {
+    submit(sql, true, mode, std::move(callback));
+}
+
+
+std::future<QueryResultPtr> AsyncExecutor::executeQuery(const std::string& sql, AccessMode mode) {
+    auto promise = std::make_shared<std::promise<QueryResultPtr>>();
+    std::future<QueryResultPtr> future = promise->get_future();
+    submit(sql, true, mode, [promise](QueryResultPtr result, std::exception_ptr error) {
+        if (error) {
+            promise->set_exception(error);
+        } else {
+            promise->set_value(std::move(result));
+        }
+    });
+    return future;
+}
+
+
+void AsyncExecutor::executeUpdate(const std::string& sql, UpdateCallback callback) {
+    submit(sql, false, AccessMode::READ_WRITE,
+        [callback](QueryResultPtr result, std::exception_ptr error) {
+            callback(result ? result->getAffectedRows() : 0, error);
+        });
+}
+
+
+std::future<unsigned long long> AsyncExecutor::executeUpdate(const std::string& sql) {
+    auto promise = std::make_shared<std::promise<unsigned long long>>();
+    std::future<unsigned long long> future = promise->get_future();
+    executeUpdate(sql, [promise](unsigned long long affectedRows, std::exception_ptr error) {
+        if (error) {
+            promise->set_exception(error);
+        } else {
+            promise->set_value(affectedRows);
+        }
+    });
+    return future;
+}
+
+
+void AsyncExecutor::submit(const std::string& sql, bool isQuery, AccessMode mode, QueryCallback callback) {
+    if (!m_running) {
+        throw std::runtime_error("AsyncExecutor has been stopped");
+    }
+    if (onLoopThread) {
+        throw std::runtime_error("AsyncExecutor: statements cannot be submitted from a loop thread, "
+                                 "hand them to another thread");
+    }
+    std::unique_ptr<Operation> op(new Operation());
+    op->sql = sql;
+    op->isQuery = isQuery;
+    op->callback = std::move(callback);
+    m_inFlight++;
+    try {
+        op->connection = m_pool.acquire(mode);
+        op->borrower = m_pool.getBorrowerState();
+    } catch (...) {
+        complete(std::move(op), nullptr, std::current_exception());
+        return;
+    }
+
+    Loop& loop = *m_loops[m_nextLoop.fetch_add(1) % m_loops.size()];
+    {
+        std::lock_guard<std::mutex> lock(loop.mutex);
+        if (!loop.stopping) {
+            loop.submitted.push_back(std::move(op));
+        }
+    }
+    if (op) {
+        complete(std::move(op), nullptr, std::make_exception_ptr(std::runtime_error("AsyncExecutor has been stopped")));
+        return;
+    }
+    loop.wakeUp();
+}
+
+
+void AsyncExecutor::run(Loop& loop) {
+    onLoopThread = true;
+    epoll_event events[MAX_EVENTS];
+    for (;;) {
+        int timeout = expireOperations(loop);
+        int count = ::epoll_wait(loop.epollFd, events, MAX_EVENTS, timeout);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            LOG_ERROR(systemError("epoll_wait failed").what());
+            break;
+        }
+        for (int i = 0; i < count; i++) {
+            int fd = events[i].data.fd;
+            if (fd == loop.wakeFd) {
+                uint64_t ignored;
+                while (::read(loop.wakeFd, &ignored, sizeof(ignored)) > 0) {
+                }
+                continue;
+            }
+            auto it = loop.waiting.find(fd);
+            if (it == loop.waiting.end()) {
+                continue;
+            }
+            std::unique_ptr<Operation> op = std::move(it->second);
+            loop.waiting.erase(it);
+            advance(loop, std::move(op), true);
+        }
+        {
+            std::lock_guard<std::mutex> lock(loop.mutex);
+            if (loop.stopping) {
+                break;
+            }
+        }
+        startSubmitted(loop);
+    }
+
+    // fail what is left, the connections of started statements cannot be reused
+    std::vector<std::unique_ptr<Operation>> submitted;
+    {
+        std::lock_guard<std::mutex> lock(loop.mutex);
+        loop.stopping = true;
+        submitted.swap(loop.submitted);
+    }
+    auto stopped = std::make_exception_ptr(std::runtime_error("AsyncExecutor has been stopped"));
+    loop.deadlines.clear();
+    for (auto& entry : loop.waiting) {
+        ::epoll_ctl(loop.epollFd, EPOLL_CTL_DEL, entry.first, nullptr);
+        entry.second->connection->abortAsync();
+        complete(std::move(entry.second), nullptr, stopped);
+    }
+    loop.waiting.clear();
+    for (auto& op : submitted) {
+        complete(std::move(op), nullptr, stopped);
+    }
+}
+
+
+void AsyncExecutor::startSubmitted(Loop& loop) {
+    std::vector<std::unique_ptr<Operation>> submitted;
+    {
+        std::lock_guard<std::mutex> lock(loop.mutex);
+        submitted.swap(loop.submitted);
+    }
+    for (auto& op : submitted) {
+        if (m_queryTimeout > 0) {
+            op->deadline = loop.deadlines.emplace(loop.deadlines.end(),
+                Utils::currentTimeMicros() + static_cast<int64_t>(m_queryTimeout) * 1000, op.get());
+            op->hasDeadline = true;
+        }
+        advance(loop, std::move(op), false);
+    }
+}
+
+
+void AsyncExecutor::advance(Loop& loop, std::unique_ptr<Operation> op, bool started) {
+    bool done = false;
+    try {
+        done = started ? op->connection->continueAsync() : op->connection->startAsync(op->sql, op->isQuery);
+    } catch (...) {
+        if (started) {
+            ::epoll_ctl(loop.epollFd, EPOLL_CTL_DEL, op->fd, nullptr);
+        }
+        loop.dropDeadline(*op);
+        complete(std::move(op), nullptr, std::current_exception());
+        return;
+    }
+    if (done) {
+        if (started) {
+            ::epoll_ctl(loop.epollFd, EPOLL_CTL_DEL, op->fd, nullptr);
+        }
+        loop.dropDeadline(*op);
+        QueryResultPtr result = op->connection->takeAsyncResult();
+        complete(std::move(op), std::move(result), nullptr);
+        return;
+    }
+
+    epoll_event event;
+    std::memset(&event, 0, sizeof(event));
+    // one shot, so the socket only wakes the loop again once the statement asked for it
+    event.events = EPOLLIN | EPOLLONESHOT;
+    if (op->sql.size() > LARGE_STATEMENT_BYTES) {
+        event.events |= EPOLLOUT;
+    }
+    if (!started) {
+        op->fd = op->connection->getSocket();
+    }
+    event.data.fd = op->fd;
+    if (op->fd < 0 || ::epoll_ctl(loop.epollFd, started ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, op->fd, &event) != 0) {
+        auto error = std::make_exception_ptr(systemError("cannot wait for the socket of connection " +
+                                                         op->connection->getConnectionId()));
+        op->connection->abortAsync();
+        loop.dropDeadline(*op);
+        complete(std::move(op), nullptr, error);
+        return;
+    }
+    int fd = op->fd;
+    loop.waiting[fd] = std::move(op);
+}
+
+
+int AsyncExecutor::expireOperations(Loop& loop) {
+    if (m_queryTimeout == 0) {
+        return -1;
+    }
+    int64_t now = Utils::currentTimeMicros();
+    while (!loop.deadlines.empty() && loop.deadlines.front().first <= now) {
+        // only waiting statements have an entry, the others completed and removed theirs
+        auto it = loop.waiting.find(loop.deadlines.front().second->fd);
+        std::unique_ptr<Operation> op = std::move(it->second);
+        loop.waiting.erase(it);
+        loop.dropDeadline(*op);
+        ::epoll_ctl(loop.epollFd, EPOLL_CTL_DEL, op->fd, nullptr);
+        op->connection->abortAsync();
+        complete(std::move(op), nullptr, std::make_exception_ptr(std::runtime_error(
+            "Statement timed out after " + std::to_string(m_queryTimeout) + "ms")));
+    }
+    if (loop.deadlines.empty()) {
+        return -1;
+    }
+    // round up, so the loop does not wake just before the deadline
+    return static_cast<int>((loop.deadlines.front().first - now + 999) / 1000);
+}
+
+
+void AsyncExecutor::complete(std::unique_ptr<Operation> op, QueryResultPtr result, std::exception_ptr error) {
+    QueryCallback callback = std::move(op->callback);
+    // back to the pool before the callback, so a thread waiting in submit() gets it right away.
+    // not into the loop thread's cache, and a write keeps the submitter reading from the primary
+    m_pool.releaseFor(std::move(op->connection), op->borrower);
+    op.reset();
+    try {
+        callback(std::move(result), error);
+    } catch (const std::exception& e) {
+        LOG_ERROR("AsyncExecutor callback threw: " + std::string(e.what()));
+    } catch (...) {
+        LOG_ERROR("AsyncExecutor callback threw");
+    }
+    m_inFlight--;
+}
@@ -0,0 +1,67 @@
+#include "backend_pool.h"
+#include <algorithm>
+
+
+BackendPool::BackendPool(BackendPtr backend, size_t shardCount, IdleOrder order)
+    : m_backendId(backend->id)
+    , m_role(backend->config.role)
+    , m_backend(std::move(backend))
+    , m_idleConnections(shardCount, order)
+    , m_minConnections(0)
+    , m_maxConnections(0)
+    , m_totalConnections(0)
+    , m_pendingConnections(0)
+    , m_draining(false)
+    , m_waiters(0) {
+}
+
+
+BackendPtr BackendPool::getBackend() const {
+    return std::atomic_load(&m_backend);
+}
+
+
+void BackendPool::setBackend(BackendPtr backend) {
+    std::atomic_store(&m_backend, std::move(backend));
+}
+
+
+void BackendPool::updateLimits(unsigned int poolMaxConnections) {
+    const DBConfig& config = getBackend()->config;
+    unsigned int maxConnections = poolMaxConnections;
+    if (config.maxConnections > 0) {
+        maxConnections = std::min(config.maxConnections, poolMaxConnections);
+    }
+    m_maxConnections.store(maxConnections, std::memory_order_relaxed);
+    m_minConnections.store(std::min(config.minConnections, maxConnections), std::memory_order_relaxed);
+}
+
+
+bool BackendPool::tryReservePlace() {
+    if (isDraining()) {
+        return false;
+    }
+    size_t current = m_totalConnections.load();
+    while (current < getMaxConnections()) {
+        if (m_totalConnections.compare_exchange_weak(current, current + 1)) {
+            // draining may have started after the first check
+            if (isDraining()) {
+                m_totalConnections--;
+                return false;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+
+void BackendPool::releasePlace() {
+    m_totalConnections--;
+}
+
+
+void BackendPool::resetPlaces(size_t count) {
+    m_totalConnections = count;
+    m_pendingConnections = 0;
+}
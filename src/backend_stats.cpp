@@ -0,0 +1,95 @@
+#include "backend_stats.h"
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+const int64_t BackendStats::DECAY_NANOS;
+const int64_t BackendStats::PENALTY_NANOS;
+
+namespace {
+
+uint64_t toBits(double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+double fromBits(uint64_t bits) {
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+} // namespace
+
+
+BackendStats::BackendStats()
+    : m_inFlight(0)
+    , m_openConnections(0)
+    , m_ewmaBits(toBits(0.0))
+    , m_lastSampleNanos(nowNanos())
+    , m_samples(0) {
+}
+
+
+int64_t BackendStats::nowNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+void BackendStats::requestFinished(int64_t latencyNanos) {
+    m_inFlight.fetch_sub(1, std::memory_order_relaxed);
+    observe(latencyNanos < 0 ? 0 : latencyNanos);
+    m_breaker.recordSuccess();
+}
+
+
+void BackendStats::requestFailed() {
+    m_inFlight.fetch_sub(1, std::memory_order_relaxed);
+    observe(PENALTY_NANOS);
+    m_breaker.recordFailure();
+}
+
+
+void BackendStats::observe(int64_t latencyNanos) {
+    int64_t now = nowNanos();
+    int64_t elapsed = now - m_lastSampleNanos.exchange(now, std::memory_order_relaxed);
+    double weight = std::exp(-static_cast<double>(elapsed > 0 ? elapsed : 0) / DECAY_NANOS);
+    double latency = static_cast<double>(latencyNanos);
+
+    uint64_t expected = m_ewmaBits.load(std::memory_order_relaxed);
+    for (;;) {
+        double current = fromBits(expected);
+        // a slower sample replaces the average at once, faster ones pull it down gradually
+        double next = latency > current ? latency : current * weight + latency * (1.0 - weight);
+        if (m_ewmaBits.compare_exchange_weak(expected, toBits(next), std::memory_order_relaxed)) {
+            break;
+        }
+    }
+    m_samples.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+double BackendStats::getEwmaNanos(int64_t nowNanos) const {
+    double current = fromBits(m_ewmaBits.load(std::memory_order_relaxed));
+    int64_t elapsed = nowNanos - m_lastSampleNanos.load(std::memory_order_relaxed);
+    if (elapsed <= 0) {
+        return current;
+    }
+    // an idle backend slowly loses its bad reputation, so it gets probed again
+    return current * std::exp(-static_cast<double>(elapsed) / DECAY_NANOS);
+}
+
+
+double BackendStats::getPeakEwmaCost(int64_t nowNanos) const {
+    double ewma = getEwmaNanos(nowNanos);
+    int64_t inFlight = getInFlight();
+    if (inFlight < 0) {
+        inFlight = 0;
+    }
+    if (ewma == 0.0 && inFlight > 0) {
+        return static_cast<double>(PENALTY_NANOS) + inFlight;
+    }
+    return ewma * (inFlight + 1);
+}
@@ -0,0 +1,179 @@
+#include "batch.h"
+#include "connection.h"
+#include <cmath>
+#include <stdexcept>
+#include "logger.h"
+#include "utils.h"
+
+const size_t BatchInsert::DEFAULT_MAX_STATEMENT_BYTES;
+const size_t BatchInsert::DEFAULT_MAX_ROWS_PER_STATEMENT;
+
+
+SqlValue::SqlValue()
+    : m_type(Type::NULL_VALUE), m_integer(0), m_unsigned(0), m_real(0.0) {}
+
+SqlValue::SqlValue(std::nullptr_t) : SqlValue() {}
+
+SqlValue::SqlValue(int value) : SqlValue(static_cast<long long>(value)) {}
+
+SqlValue::SqlValue(long value) : SqlValue(static_cast<long long>(value)) {}
+
+SqlValue::SqlValue(long long value)
+    : m_type(Type::INTEGER), m_integer(value), m_unsigned(0), m_real(0.0) {}
+
+SqlValue::SqlValue(unsigned int value) : SqlValue(static_cast<unsigned long long>(value)) {}
+
+SqlValue::SqlValue(unsigned long value) : SqlValue(static_cast<unsigned long long>(value)) {}
+
+SqlValue::SqlValue(unsigned long long value)
+    : m_type(Type::UNSIGNED), m_integer(0), m_unsigned(value), m_real(0.0) {}
+
+SqlValue::SqlValue(double value)
+    : m_type(Type::REAL), m_integer(0), m_unsigned(0), m_real(value) {}
+
+SqlValue::SqlValue(const char* value) : SqlValue() {
+    if (value) {
+        m_type = Type::TEXT;
+        m_text = value;
+    }
+}
+
+SqlValue::SqlValue(const std::string& value)
+    : m_type(Type::TEXT), m_integer(0), m_unsigned(0), m_real(0.0), m_text(value) {}
+
+SqlValue::SqlValue(std::string&& value)
+    : m_type(Type::TEXT), m_integer(0), m_unsigned(0), m_real(0.0), m_text(std::move(value)) {}
+
+
+BatchInsert::BatchInsert(Connection& connection,
+                         const std::string& table,
+                         const std::vector<std::string>& columns,
+                         size_t maxStatementBytes,
+                         size_t maxRowsPerStatement)
+    : m_connection(connection)
+    , m_columnCount(columns.size())
+    , m_maxStatementBytes(maxStatementBytes)
+    , m_maxRowsPerStatement(maxRowsPerStatement)
+    , m_pendingRows(0)
+    , m_flushedRows(0)
+    , m_affectedRows(0)
+    , m_statementCount(0) {
+    if (columns.empty()) {
+        throw std::invalid_argument("BatchInsert needs at least one column");
+    }
+    if (maxStatementBytes == 0 || maxRowsPerStatement == 0) {
+        throw std::invalid_argument("BatchInsert limits must be greater than 0");
+    }
+
+    m_prefix = "INSERT INTO " + quoteIdentifier(table) + " (";
+    for (size_t i = 0; i < columns.size(); i++) {
+        if (i > 0) {
+            m_prefix += ", ";
+        }
+        m_prefix += quoteIdentifier(columns[i]);
+    }
+    m_prefix += ") VALUES ";
+}
+
+
+BatchInsert::~BatchInsert() {
+    // flushing here could throw from a destructor
+    if (m_pendingRows > 0) {
+        LOG_WARNING("BatchInsert destroyed with " + std::to_string(m_pendingRows) +
+                    " rows not flushed, they are discarded");
+    }
+}
+
+
+void BatchInsert::addRow(const std::vector<SqlValue>& values) {
+    if (values.size() != m_columnCount) {
+        throw std::invalid_argument("BatchInsert row has " + std::to_string(values.size()) +
+                                    " values, expected " + std::to_string(m_columnCount));
+    }
+
+    // format first, so a bad value leaves the pending statement untouched
+    m_row.clear();
+    m_row += '(';
+    for (size_t i = 0; i < values.size(); i++) {
+        if (i > 0) {
+            m_row += ',';
+        }
+        appendValue(m_row, values[i]);
+    }
+    m_row += ')';
+
+    if (m_pendingRows > 0 &&
+        (m_pendingRows >= m_maxRowsPerStatement ||
+         m_sql.size() + 1 + m_row.size() > m_maxStatementBytes)) {
+        flush();
+    }
+
+    if (m_pendingRows == 0) {
+        m_sql = m_prefix;
+    } else {
+        m_sql += ',';
+    }
+    m_sql += m_row;
+    m_pendingRows++;
+}
+
+
+unsigned long long BatchInsert::flush() {
+    if (m_pendingRows == 0) {
+        return 0;
+    }
+    size_t rows = m_pendingRows;
+    // the statement is dropped even if it fails, retrying is up to the caller
+    m_pendingRows = 0;
+    unsigned long long affected = m_connection.executeUpdate(m_sql);
+    m_flushedRows += rows;
+    m_affectedRows += affected;
+    m_statementCount++;
+    LOG_DEBUG("BatchInsert flushed " + std::to_string(rows) + " rows, " +
+              std::to_string(m_sql.size()) + " bytes");
+    return affected;
+}
+
+
+void BatchInsert::appendValue(std::string& out, const SqlValue& value) {
+    switch (value.getType()) {
+        case SqlValue::Type::NULL_VALUE:
+            out += "NULL";
+            break;
+        case SqlValue::Type::INTEGER:
+            out += std::to_string(value.getInteger());
+            break;
+        case SqlValue::Type::UNSIGNED:
+            out += std::to_string(value.getUnsigned());
+            break;
+        case SqlValue::Type::REAL: {
+            if (!std::isfinite(value.getReal())) {
+                throw std::invalid_argument("BatchInsert cannot store a non-finite double");
+            }
+            // 17 significant digits round-trip every double; a ',' decimal point would split the value
+            out += Utils::formatDouble(value.getReal(), "%.17g");
+            break;
+        }
+        case SqlValue::Type::TEXT:
+            out += '\'';
+            out += m_connection.escapeString(value.getText());
+            out += '\'';
+            break;
+    }
+}
+
+
+std::string BatchInsert::quoteIdentifier(const std::string& name) {
+    std::string quoted = "`";
+    for (char c : name) {
+        if (c == '.') {
+            quoted += "`.`";
+        } else if (c == '`') {
+            quoted += "``";
+        } else {
+            quoted += c;
+        }
+    }
+    quoted += '`';
+    return quoted;
+}
@@ -0,0 +1,149 @@
+#include "circuit_breaker.h"
+#include "backend_stats.h"
+#include "logger.h"
+#include <algorithm>
+#include <random>
+
+
+CircuitBreaker::CircuitBreaker()
+    : m_state(static_cast<int>(State::CLOSED))
+    , m_failures(0)
+    , m_openStreak(0)
+    , m_openCount(0)
+    , m_retryAtNanos(0) {
+    configure(Policy());
+}
+
+
+void CircuitBreaker::configure(const Policy& policy) {
+    m_failureThreshold.store(policy.failureThreshold, std::memory_order_relaxed);
+    m_openNanos.store(std::max<int64_t>(0, policy.openNanos), std::memory_order_relaxed);
+    m_maxOpenNanos.store(std::max<int64_t>(0, policy.maxOpenNanos), std::memory_order_relaxed);
+    m_probeTimeoutNanos.store(std::max<int64_t>(0, policy.probeTimeoutNanos), std::memory_order_relaxed);
+}
+
+
+bool CircuitBreaker::tryPass() {
+    int state = m_state.load(std::memory_order_acquire);
+    if (state == static_cast<int>(State::CLOSED)) {
+        return true;
+    }
+    if (state == OPENING) {
+        return false;
+    }
+    int64_t now = BackendStats::nowNanos();
+    int64_t retryAt = m_retryAtNanos.load(std::memory_order_acquire);
+    if (now < retryAt) {
+        return false;
+    }
+    // only one caller moves the deadline, it is the probe until it reports back or times out
+    if (!m_retryAtNanos.compare_exchange_strong(retryAt, now + m_probeTimeoutNanos.load(std::memory_order_relaxed),
+                                                std::memory_order_acq_rel)) {
+        return false;
+    }
+    // a late success may have closed the circuit meanwhile, that stays closed
+    state = m_state.load(std::memory_order_acquire);
+    while (state == static_cast<int>(State::OPEN) &&
+           !m_state.compare_exchange_weak(state, static_cast<int>(State::HALF_OPEN), std::memory_order_acq_rel)) {
+    }
+    LOG_INFO("CircuitBreaker half-open, probing the backend");
+    return true;
+}
+
+
+bool CircuitBreaker::allowConnect() {
+    int state = m_state.load(std::memory_order_relaxed);
+    if (state != static_cast<int>(State::OPEN) && state != OPENING) {
+        return true;
+    }
+    return tryPass();
+}
+
+
+void CircuitBreaker::recordSuccess() {
+    // the common case costs two relaxed loads
+    if (isClosed() && m_failures.load(std::memory_order_relaxed) == 0) {
+        return;
+    }
+    m_failures.store(0, std::memory_order_relaxed);
+    m_openStreak.store(0, std::memory_order_relaxed);
+    if (m_state.exchange(static_cast<int>(State::CLOSED), std::memory_order_acq_rel) != static_cast<int>(State::CLOSED)) {
+        LOG_INFO("CircuitBreaker closed, the backend answers again");
+    }
+}
+
+
+void CircuitBreaker::recordFailure() {
+    int state = m_state.load(std::memory_order_acquire);
+    if (state == static_cast<int>(State::HALF_OPEN)) {
+        int expected = state;
+        if (m_state.compare_exchange_strong(expected, OPENING, std::memory_order_acq_rel)) {
+            open(BackendStats::nowNanos());
+        }
+        return;
+    }
+    if (state == static_cast<int>(State::OPEN) || state == OPENING) {
+        // requests that started before the circuit opened
+        return;
+    }
+    uint32_t failures = m_failures.fetch_add(1, std::memory_order_relaxed) + 1;
+    uint32_t threshold = m_failureThreshold.load(std::memory_order_relaxed);
+    if (threshold == 0 || failures < threshold) {
+        return;
+    }
+    int expected = static_cast<int>(State::CLOSED);
+    if (m_state.compare_exchange_strong(expected, OPENING, std::memory_order_acq_rel)) {
+        open(BackendStats::nowNanos());
+    }
+}
+
+
+void CircuitBreaker::open(int64_t nowNanos) {
+    unsigned int streak = m_openStreak.fetch_add(1, std::memory_order_relaxed) + 1;
+    // half of the period is jitter, so the backends that failed together retry apart,
+    // but the circuit stays open for at least the other half
+    int64_t period = backoffCeiling(m_openNanos.load(std::memory_order_relaxed), streak,
+                                    m_maxOpenNanos.load(std::memory_order_relaxed));
+    int64_t delay = period / 2 + backoffDelay(period / 2, 1, period / 2);
+    m_retryAtNanos.store(nowNanos + delay, std::memory_order_release);
+    // publish the period, unless a success closed the circuit in between
+    int expected = OPENING;
+    m_state.compare_exchange_strong(expected, static_cast<int>(State::OPEN), std::memory_order_acq_rel);
+    m_openCount.fetch_add(1, std::memory_order_relaxed);
+    LOG_WARNING("CircuitBreaker open for " + std::to_string(delay / 1000000) + "ms after " +
+                std::to_string(m_failures.load(std::memory_order_relaxed)) + " consecutive failures");
+}
+
+
+int64_t CircuitBreaker::backoffCeiling(int64_t base, unsigned int attempt, int64_t cap) {
+    if (base <= 0 || cap <= 0) {
+        return 0;
+    }
+    // doubling stops at the cap, so it never overflows
+    int64_t ceiling = base;
+    for (unsigned int i = 1; i < attempt && ceiling < cap; i++) {
+        ceiling *= 2;
+    }
+    return std::min(ceiling, cap);
+}
+
+
+int64_t CircuitBreaker::backoffDelay(int64_t base, unsigned int attempt, int64_t cap) {
+    int64_t ceiling = backoffCeiling(base, attempt, cap);
+    if (ceiling == 0) {
+        return 0;
+    }
+    static thread_local std::mt19937_64 rng{std::random_device{}()};
+    std::uniform_int_distribution<int64_t> dist(0, ceiling);
+    return dist(rng);
+}
+
+
+const char* CircuitBreaker::stateName(State state) {
+    switch (state) {
+        case State::CLOSED:    return "closed";
+        case State::OPEN:      return "open";
+        case State::HALF_OPEN: return "half_open";
+        default:               return "unknown";
+    }
+}
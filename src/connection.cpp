@@ -7,6 +7,8 @@
 #include <algorithm>
 #include <stdexcept>
 #include "performance_monitor.h"
+#include "circuit_breaker.h"
+#include <sys/socket.h>
 
 Connection::Connection(
     const std::string& host,
@@ -26,6 +28,22 @@ Connection::Connection(
 , m_connectionId(Utils::generateRandomString(16))
 , m_creationTime(Utils::currentTimeMillis())
 , m_lastActiveTime(m_creationTime) 
+, m_lastCheckedTime(0)
+, m_poolSlot(0)
+, m_inUse(false)
+, m_borrowedTime(0)
+, m_backendId(0)
+, m_monitor(&PerformanceMonitor::getInstance())
+, m_tracer(nullptr)
+, m_connectStartMicros(0)
+, m_connectEndMicros(0)
+, m_traceWaitMicros(0)
+, m_traceConnectMicros(0)
+, m_statementCacheSize(32)
+, m_streamStarted(false)
+, m_sessionChanged(false)
+, m_asyncStage(AsyncStage::IDLE)
+, m_asyncIsQuery(false)
 , m_reconnectInterval(reconnectInterval)
 , m_reconnectAttempts(reconnectAttempts)
 , m_totalReconnectAttempts(0)
@@ -39,6 +57,9 @@ Connection::Connection(
 Connection::~Connection() {
     LOG_INFO("Destroying connection [" + m_connectionId + "]");
     close();
+    if (m_backendStats) {
+        m_backendStats->connectionClosed();
+    }
 }
 
 
@@ -81,6 +102,7 @@ void Connection::init() {
 bool Connection::connect() {
     // use mutex lock to avoid multiple thread to connect to mysql_server
     std::lock_guard<std::mutex> lock(m_mutex);
+    m_connectStartMicros = traceClockMicros();
     MYSQL * result = mysql_real_connect(
         m_mysql, 
         m_host.c_str(), 
@@ -97,6 +119,7 @@ bool Connection::connect() {
                   error + " (Code: " + std::to_string(errorCode) + ")");
         return false;
     }
+    m_connectEndMicros = traceClockMicros();
     updateLastActiveTime();
     LOG_DEBUG("Success to connect to MySQL server [" + m_connectionId + "]");
     return true;
@@ -108,22 +131,30 @@ bool Connection::reconnect() {
     // use more flexible lock
     std::unique_lock<std::mutex> lock(m_mutex);
 
-    // relase my_sql first
+    // relase my_sql first, a streaming result and statements of the old session are gone
+    abortActiveStreamLocked();
+    invalidateStatementsLocked();
     if (m_mysql) {
         mysql_close(m_mysql);
         m_mysql = nullptr;
     }
+    m_sessionChanged = false;
 
     init();
 
     if (!m_mysql) {
         LOG_ERROR("Failed to initialize MySQL object during reconnection [" + m_connectionId + "]: ");
-        PerformanceMonitor::getInstance().recordReconnection(false);
+        m_monitor->recordReconnection(false);
         return false;
     }    
 
     // iterate over attempt
     for (unsigned int attempt = 1; attempt <= m_reconnectAttempts; attempt++) {
+        // the backend is known to be down, fail right away instead of waiting for the connect timeout
+        if (m_backendStats && !m_backendStats->getBreaker().allowConnect()) {
+            LOG_WARNING("Reconnection skipped, the circuit breaker of the backend is open [" + m_connectionId + "]");
+            break;
+        }
         m_totalReconnectAttempts++;
 
         MYSQL * result = mysql_real_connect(
@@ -137,9 +168,12 @@ bool Connection::reconnect() {
         0);
 
         if (result != nullptr) {
+            if (m_backendStats) {
+                m_backendStats->getBreaker().recordSuccess();
+            }
             m_successfulReconnects++;
             LOG_DEBUG("Success to reconnect to MySQL server [" + m_connectionId + "]"  + " attempt times:" + std::to_string(attempt));
-            PerformanceMonitor::getInstance().recordReconnection(true);
+            m_monitor->recordReconnection(true);
             return true;
         }
         // record reconnection error
@@ -149,22 +183,28 @@ bool Connection::reconnect() {
 
         LOG_WARNING("Reconnection attempt " + std::to_string(attempt) + " failed [" +
                     m_connectionId + "]: " + error + " (Code: " + std::to_string(errorCode) + ")");
+        if (m_backendStats) {
+            m_backendStats->getBreaker().recordFailure();
+        }
         // compute delay
         auto delay = calculateReconnectDelay(attempt);
         // wait duration
         if (attempt < m_reconnectAttempts) {
             lock.unlock();
-            std::this_thread::sleep_for(std::chrono::microseconds(delay));
+            std::this_thread::sleep_for(std::chrono::milliseconds(delay));
             lock.lock();
         }        
     }
-    PerformanceMonitor::getInstance().recordReconnection(false);
+    m_monitor->recordReconnection(false);
     return false;
 }
 
 
 void Connection::close() {
     std::lock_guard<std::mutex> lock(m_mutex);
+    abortActiveStreamLocked();
+    invalidateStatementsLocked();
+    m_asyncStage = AsyncStage::IDLE;
     if (m_mysql) {
         mysql_close(m_mysql);
         m_mysql = nullptr;
@@ -179,6 +219,12 @@ std::string Connection::getConnectionId() {
 }
 
 
+bool Connection::isOpen() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_mysql != nullptr;
+}
+
+
 bool Connection::isValidQuietly() const {
     std::lock_guard<std::mutex> lock(m_mutex);
     if (!m_mysql) {
@@ -202,6 +248,7 @@ bool Connection::isValid(bool tryReconnect) {
             LOG_INFO("MySQL isNotValid  [" + m_connectionId + "]" + "since no m_mysql");
             return false;
         }
+        finishActiveStreamLocked();
 
         auto ping_result = mysql_ping(m_mysql);
         if (ping_result != 0) {
@@ -215,7 +262,7 @@ bool Connection::isValid(bool tryReconnect) {
             }
         }
         // Valid
-        LOG_INFO("MySQL isValid  [" + m_connectionId + "]");
+        LOG_DEBUG("MySQL isValid  [" + m_connectionId + "]");
         updateLastActiveTime();
         return true;
     }
@@ -227,9 +274,13 @@ bool Connection::isValid(bool tryReconnect) {
 
 // updateLastActiveTime
 void Connection::updateLastActiveTime() {
-    m_lastActiveTime = Utils::currentTimeMillis();
+    m_lastActiveTime.store(Utils::currentTimeMillis(), std::memory_order_relaxed);
 };
 
+int64_t Connection::getIdleTime() const {
+    return Utils::currentTimeMillis() - m_lastActiveTime.load(std::memory_order_relaxed);
+}
+
 
 QueryResultPtr Connection::executeQuery(const std::string& sql) {
     return executeQueryWithReconnect(sql, true);
@@ -240,11 +291,452 @@ unsigned long long Connection::executeUpdate(const std::string& sql) {
     return queryResult_ptr? queryResult_ptr->getAffectedRows() : 0;
 }
 
+QueryResultPtr Connection::executeStreamingQuery(const std::string& sql) {
+    return executeQueryWithReconnect(sql, true, ResultMode::STREAMING);
+}
+
+
+
+BatchResult Connection::executeBatch(const std::vector<std::string>& statements,
+                                     bool stopOnError,
+                                     size_t maxPacketBytes) {
+    BatchResult result;
+    result.statements.resize(statements.size());
+    if (statements.empty()) {
+        return result;
+    }
+
+    // statements are joined with ';', so trailing separators are dropped first
+    std::vector<size_t> lengths(statements.size());
+    for (size_t i = 0; i < statements.size(); i++) {
+        size_t last = statements[i].find_last_not_of(" \t\r\n;");
+        if (last == std::string::npos) {
+            throw std::invalid_argument("Empty statement in batch at index " + std::to_string(i));
+        }
+        lengths[i] = last + 1;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_mysql) {
+        std::string error = "Connection not established [" + m_connectionId + "]";
+        LOG_ERROR(error);
+        throw db::SQLExecutionError(error, CR_SERVER_GONE_ERROR);
+    }
+    // an unfinished streaming result still owns the session
+    finishActiveStreamLocked();
+
+    // multi-statement mode is only on for the batch, plain queries never run stacked statements
+    if (mysql_set_server_option(m_mysql, MYSQL_OPTION_MULTI_STATEMENTS_ON) != 0) {
+        unsigned int errorCode = mysql_errno(m_mysql);
+        std::string errorMsg = mysql_error(m_mysql);
+        LOG_ERROR("Failed to enable multi statements [" + m_connectionId + "]: " + errorMsg);
+        throw db::SQLExecutionError(errorMsg + " (Code: " + std::to_string(errorCode) + ")", errorCode);
+    }
+    updateLastActiveTime();
+
+    std::string packet;
+    size_t next = 0;
+    while (next < statements.size()) {
+        // fill one packet up to maxPacketBytes, a single longer statement is sent alone
+        size_t first = next;
+        packet.clear();
+        while (next < statements.size()) {
+            if (next > first && packet.size() + 1 + lengths[next] > maxPacketBytes) {
+                break;
+            }
+            if (next > first) {
+                packet += ';';
+            }
+            packet.append(statements[next], 0, lengths[next]);
+            next++;
+        }
+
+        size_t failed = executeBatchPacketLocked(packet, first, next - first, result);
+        if (failed >= next) {
+            continue;
+        }
+        // the server skipped the rest of the packet
+        if (stopOnError || isConnectionError(result.statements[failed].errorCode)) {
+            break;
+        }
+        next = failed + 1;
+    }
+
+    if (mysql_set_server_option(m_mysql, MYSQL_OPTION_MULTI_STATEMENTS_OFF) != 0) {
+        LOG_WARNING("Failed to disable multi statements [" + m_connectionId + "]: " +
+                    std::string(mysql_error(m_mysql)));
+    }
+
+    for (const auto& statement : result.statements) {
+        if (!statement.executed) {
+            continue;
+        }
+        result.executedCount++;
+        if (statement.errorCode != 0) {
+            result.failedCount++;
+        } else {
+            result.totalAffectedRows += statement.affectedRows;
+        }
+    }
+    return result;
+}
+
+
+size_t Connection::executeBatchPacketLocked(const std::string& sql, size_t first, size_t count,
+                                            BatchResult& result) {
+    auto startTime = std::chrono::steady_clock::now();
+    size_t end = first + count;
+    size_t index = first;
+    result.roundTrips++;
+
+    LOG_DEBUG("Executing batch of " + std::to_string(count) + " statements [" + m_connectionId + "]");
+    m_sessionChanged = true;
+    int status = mysql_real_query(m_mysql, sql.data(), static_cast<unsigned long>(sql.size()));
+    while (true) {
+        if (status != 0) {
+            // the error belongs to the statement whose result was being read
+            BatchStatementResult& failed = result.statements[std::min(index, end - 1)];
+            failed.executed = true;
+            failed.errorCode = mysql_errno(m_mysql);
+            failed.error = mysql_error(m_mysql);
+            LOG_ERROR("Batch statement " + std::to_string(index) + " failed [" + m_connectionId + "]: " +
+                      failed.error + " (Code: " + std::to_string(failed.errorCode) + ")");
+            auto takenTime = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - startTime);
+            m_monitor->recordQueryExecuted(takenTime.count(), false);
+            return std::min(index, end - 1);
+        }
+
+        MYSQL_RES* rows = mysql_store_result(m_mysql);
+        if (rows == nullptr && mysql_field_count(m_mysql) > 0) {
+            status = 1;
+            continue;
+        }
+        // one element is one statement, extra result sets are counted on the last statement
+        BatchStatementResult& current = result.statements[std::min(index, end - 1)];
+        current.executed = true;
+        if (rows) {
+            current.affectedRows += mysql_num_rows(rows);
+            mysql_free_result(rows);
+        } else {
+            current.affectedRows += mysql_affected_rows(m_mysql);
+        }
+        index++;
+
+        // 0: another result, -1: no more results, > 0: the next statement failed
+        status = mysql_next_result(m_mysql);
+        if (status == -1) {
+            break;
+        }
+    }
+
+    auto takenTime = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - startTime);
+    m_monitor->recordQueryExecuted(takenTime.count(), true);
+    return end;
+}
+
+bool Connection::hasActiveStream() const {
+    if (!m_streamStarted.load(std::memory_order_acquire)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    QueryResultPtr stream = m_activeStream.lock();
+    return stream && stream->isStreamOpen();
+}
+
+
+void Connection::cancelActiveStream() {
+    if (!m_streamStarted.load(std::memory_order_acquire)) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!abortActiveStreamLocked()) {
+        return;
+    }
+    // the socket is broken, the session cannot be used any more
+    invalidateStatementsLocked();
+    if (m_mysql) {
+        mysql_close(m_mysql);
+        m_mysql = nullptr;
+        LOG_INFO("MySQL connection closed [" + m_connectionId + "]");
+    }
+}
+
+
+void Connection::finishActiveStreamLocked() {
+    if (!m_streamStarted.load(std::memory_order_relaxed)) {
+        return;
+    }
+    QueryResultPtr stream = m_activeStream.lock();
+    m_activeStream.reset();
+    m_streamStarted.store(false, std::memory_order_release);
+    if (stream && stream->isStreamOpen()) {
+        LOG_WARNING("Streaming result was not read to the end, reading the remaining rows before the next command [" +
+                    m_connectionId + "]");
+        // mysql_free_result reads the remaining rows, the session stays usable
+        stream->abortStream();
+    }
+}
+
+
+bool Connection::abortActiveStreamLocked() {
+    if (!m_streamStarted.load(std::memory_order_relaxed)) {
+        return false;
+    }
+    QueryResultPtr stream = m_activeStream.lock();
+    m_activeStream.reset();
+    m_streamStarted.store(false, std::memory_order_release);
+    if (!stream || !stream->isStreamOpen()) {
+        return false;
+    }
+    LOG_WARNING("Cancelling a streaming result after " + std::to_string(stream->getRowCount()) +
+                " rows [" + m_connectionId + "]");
+    // with the socket shut down the remaining rows fail fast instead of being read
+    if (m_mysql) {
+        ::shutdown(m_mysql->net.fd, SHUT_RDWR);
+    }
+    stream->abortStream();
+    return true;
+}
+
+
+bool Connection::startAsync(const std::string& sql, bool isQuery) {
+#if POOL_HAS_NONBLOCKING_API
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_mysql) {
+        throw db::SQLExecutionError("Connection not established [" + m_connectionId + "]", CR_SERVER_GONE_ERROR);
+    }
+    if (m_asyncStage != AsyncStage::IDLE) {
+        throw db::SQLExecutionError("Previous asynchronous execution has not finished [" + m_connectionId + "]",
+                                    CR_COMMANDS_OUT_OF_SYNC);
+    }
+    // an unfinished streaming result still owns the session
+    finishActiveStreamLocked();
+
+    updateLastActiveTime();
+    LOG_DEBUG("Executing asynchronous " + std::string(isQuery ? "query" : "update") +
+              " [" + m_connectionId + "]: " + sql);
+    m_asyncSql = sql;
+    m_asyncIsQuery = isQuery;
+    m_asyncResult.reset();
+    m_asyncStart = std::chrono::steady_clock::now();
+    m_asyncStage = AsyncStage::QUERY;
+    m_sessionChanged = true;
+    if (m_backendStats) {
+        m_backendStats->requestStarted();
+    }
+    return advanceAsyncLocked();
+#else
+    // without the non-blocking API the statement runs to completion here
+    QueryResultPtr result = executeQueryWithReconnect(sql, isQuery);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_asyncResult = result;
+    m_asyncStage = AsyncStage::DONE;
+    return true;
+#endif
+}
+
+
+bool Connection::continueAsync() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return advanceAsyncLocked();
+}
+
+
+QueryResultPtr Connection::takeAsyncResult() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_asyncStage != AsyncStage::DONE) {
+        return nullptr;
+    }
+    m_asyncStage = AsyncStage::IDLE;
+    QueryResultPtr result = std::move(m_asyncResult);
+    m_asyncResult.reset();
+    return result;
+}
+
+
+void Connection::abortAsync() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_asyncStage == AsyncStage::QUERY || m_asyncStage == AsyncStage::STORE) {
+        LOG_WARNING("Aborting asynchronous execution [" + m_connectionId + "]: " + m_asyncSql);
+        finishAsyncLocked(false, true);
+    }
+    m_asyncStage = AsyncStage::IDLE;
+    m_asyncResult.reset();
+    // the reply may still be on its way, the session cannot be used any more
+    invalidateStatementsLocked();
+    if (m_mysql) {
+        ::shutdown(m_mysql->net.fd, SHUT_RDWR);
+        mysql_close(m_mysql);
+        m_mysql = nullptr;
+        LOG_INFO("MySQL connection closed [" + m_connectionId + "]");
+    }
+}
+
+
+int Connection::getSocket() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_mysql ? static_cast<int>(m_mysql->net.fd) : -1;
+}
+
+
+bool Connection::advanceAsyncLocked() {
+#if POOL_HAS_NONBLOCKING_API
+    if (m_asyncStage == AsyncStage::DONE) {
+        return true;
+    }
+    if (m_asyncStage == AsyncStage::IDLE || !m_mysql) {
+        throw db::SQLExecutionError("No asynchronous execution in progress [" + m_connectionId + "]",
+                                    CR_COMMANDS_OUT_OF_SYNC);
+    }
+    if (m_asyncStage == AsyncStage::QUERY) {
+        net_async_status status = mysql_real_query_nonblocking(m_mysql, m_asyncSql.data(), m_asyncSql.size());
+        if (status == NET_ASYNC_NOT_READY) {
+            return false;
+        }
+        if (status == NET_ASYNC_ERROR) {
+            failAsyncLocked("Failed to execute");
+        }
+        if (!m_asyncIsQuery) {
+            m_asyncResult = std::make_shared<QueryResult>(nullptr, mysql_affected_rows(m_mysql));
+            finishAsyncLocked(true, false);
+            return true;
+        }
+        m_asyncStage = AsyncStage::STORE;
+    }
+    MYSQL_RES* queryResult = nullptr;
+    net_async_status status = mysql_store_result_nonblocking(m_mysql, &queryResult);
+    if (status == NET_ASYNC_NOT_READY) {
+        return false;
+    }
+    if (status == NET_ASYNC_ERROR || (queryResult == nullptr && mysql_field_count(m_mysql) > 0)) {
+        failAsyncLocked("Failed to store result");
+    }
+    m_asyncResult = std::make_shared<QueryResult>(queryResult);
+    finishAsyncLocked(true, false);
+    return true;
+#else
+    return m_asyncStage == AsyncStage::DONE;
+#endif
+}
+
+
+void Connection::finishAsyncLocked(bool success, bool connectionError) {
+    auto takenTime = std::chrono::steady_clock::now() - m_asyncStart;
+    m_monitor->recordQueryExecuted(std::chrono::duration_cast<std::chrono::microseconds>(takenTime).count(), success);
+    if (m_backendStats) {
+        if (connectionError) {
+            m_backendStats->requestFailed();
+        } else {
+            m_backendStats->requestFinished(std::chrono::duration_cast<std::chrono::nanoseconds>(takenTime).count());
+        }
+    }
+    m_asyncStage = success ? AsyncStage::DONE : AsyncStage::IDLE;
+}
+
+
+void Connection::failAsyncLocked(const std::string& what) {
+    unsigned int errorCode = mysql_errno(m_mysql);
+    std::string errorMsg = mysql_error(m_mysql);
+    LOG_ERROR(what + " asynchronous " + std::string(m_asyncIsQuery ? "query" : "update") +
+              " [" + m_connectionId + "]: " + errorMsg + ", SQL: " + m_asyncSql);
+    finishAsyncLocked(false, isConnectionError(errorCode));
+    throw db::SQLExecutionError(what + ": " + errorMsg + " (Code: " + std::to_string(errorCode) + ")", errorCode);
+}
+
+
+PreparedStatementPtr Connection::prepareStatement(const std::string& sql) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (!m_mysql) {
+        std::string error = "Connection not established [" + m_connectionId + "]";
+        LOG_ERROR(error);
+        throw db::SQLExecutionError(error, CR_SERVER_GONE_ERROR);
+    }
+    finishActiveStreamLocked();
+
+    auto cached = m_statementIndex.find(sql);
+    if (cached != m_statementIndex.end()) {
+        // move to the front of the LRU list
+        m_statementLru.splice(m_statementLru.begin(), m_statementLru, cached->second);
+        m_monitor->recordStatementCacheLookup(true);
+        PreparedStatementPtr stmt = *cached->second;
+        stmt->clearParameters();
+        return stmt;
+    }
+    m_monitor->recordStatementCacheLookup(false);
+
+    MYSQL_STMT* handle = mysql_stmt_init(m_mysql);
+    if (!handle) {
+        unsigned int errorCode = mysql_errno(m_mysql);
+        std::string errorMsg = mysql_error(m_mysql);
+        LOG_ERROR("Failed to allocate prepared statement [" + m_connectionId + "]: " + errorMsg);
+        throw db::SQLExecutionError(errorMsg + " (Code: " + std::to_string(errorCode) + ")", errorCode);
+    }
+    LOG_DEBUG("Preparing statement [" + m_connectionId + "]: " + sql);
+    if (mysql_stmt_prepare(handle, sql.c_str(), sql.length()) != 0) {
+        unsigned int errorCode = mysql_stmt_errno(handle);
+        std::string errorMsg = mysql_stmt_error(handle);
+        mysql_stmt_close(handle);
+        LOG_ERROR("Failed to prepare statement [" + m_connectionId + "]: " + errorMsg + ", SQL: " + sql);
+        throw db::SQLExecutionError(errorMsg + " (Code: " + std::to_string(errorCode) + ")", errorCode);
+    }
+    updateLastActiveTime();
+
+    auto stmt = std::make_shared<PreparedStatement>(handle, sql, *this);
+    if (m_statementCacheSize == 0) {
+        return stmt;
+    }
+    m_statementLru.push_front(stmt);
+    m_statementIndex[sql] = m_statementLru.begin();
+    trimStatementCacheLocked();
+    return stmt;
+}
+
+
+void Connection::setStatementCacheSize(size_t size) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_statementCacheSize = size;
+    trimStatementCacheLocked();
+}
+
+
+size_t Connection::getCachedStatementCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_statementLru.size();
+}
+
+
+void Connection::trimStatementCacheLocked() {
+    while (m_statementLru.size() > m_statementCacheSize) {
+        // evict the least recently used statement, closing it releases it on the server
+        PreparedStatementPtr& victim = m_statementLru.back();
+        victim->closeLocked();
+        m_statementIndex.erase(victim->getSql());
+        m_statementLru.pop_back();
+    }
+}
+
+
+void Connection::invalidateStatementsLocked() {
+    if (m_statementLru.empty()) {
+        return;
+    }
+    for (auto& stmt : m_statementLru) {
+        stmt->closeLocked();
+    }
+    LOG_DEBUG("Closed " + std::to_string(m_statementLru.size()) + " cached statements [" + m_connectionId + "]");
+    m_statementLru.clear();
+    m_statementIndex.clear();
+}
+
 
 // exectueQuery.
 // sql: row sql
 // isQuery: used for query
-QueryResultPtr Connection::executeInternal(const std::string& sql, bool isQuery) {
+QueryResultPtr Connection::executeInternal(const std::string& sql, bool isQuery, ResultMode mode,
+                                           QueryTiming* timing) {
     std::lock_guard<std::mutex> lock(m_mutex);
 
     if (!m_mysql) {
@@ -252,13 +744,23 @@ QueryResultPtr Connection::executeInternal(const std::string& sql, bool isQuery)
         LOG_ERROR(error);
         throw db::SQLExecutionError(error, CR_SERVER_GONE_ERROR);
     }
+    // an unfinished streaming result still owns the session
+    finishActiveStreamLocked();
 
     // execute sql
     updateLastActiveTime();
     // run debug log
     LOG_DEBUG("Executing " + std::string(isQuery ? "query" : "update") + 
               " [" + m_connectionId + "]: " + sql);
-    if (mysql_query(m_mysql, sql.c_str()) != 0) {
+    m_sessionChanged = true;
+    int64_t phaseStart = timing ? traceClockMicros() : 0;
+    int queryStatus = mysql_query(m_mysql, sql.c_str());
+    if (timing) {
+        int64_t now = traceClockMicros();
+        timing->add(TracePhase::QUERY, now - phaseStart);
+        phaseStart = now;
+    }
+    if (queryStatus != 0) {
         // erorr when execut query
         unsigned int errorCode = mysql_errno(m_mysql);
         std::string errorMsg = mysql_error(m_mysql);
@@ -268,8 +770,30 @@ QueryResultPtr Connection::executeInternal(const std::string& sql, bool isQuery)
                                 errorCode);
     }
     // use different api to get result
-    if (isQuery) {
+    if (isQuery && mode == ResultMode::STREAMING) {
+        // rows stay on the server until next() reads them
+        MYSQL_RES * queryResult = mysql_use_result(m_mysql);
+        if (timing) {
+            timing->add(TracePhase::FETCH, traceClockMicros() - phaseStart);
+        }
+        if (queryResult == nullptr && mysql_field_count(m_mysql) > 0) {
+            unsigned int errorCode = mysql_errno(m_mysql);
+            std::string errorMsg = mysql_error(m_mysql);
+            throw db::SQLExecutionError("Failed to use result: " + errorMsg +
+                                        " (Code: " + std::to_string(errorCode) + ")",
+                                    errorCode);
+        }
+        auto stream = std::make_shared<QueryResult>(queryResult, m_mysql, ResultMode::STREAMING);
+        if (queryResult) {
+            m_activeStream = stream;
+            m_streamStarted.store(true, std::memory_order_release);
+        }
+        return stream;
+    } else if (isQuery) {
         MYSQL_RES * queryResult = mysql_store_result(m_mysql);
+        if (timing) {
+            timing->add(TracePhase::FETCH, traceClockMicros() - phaseStart);
+        }
         // if not valid, have field count but queryReuslt is NULL , throw runtime error
         if (queryResult == nullptr && mysql_field_count(m_mysql) > 0) {
             unsigned int errorCode = mysql_errno(m_mysql);
@@ -287,15 +811,109 @@ QueryResultPtr Connection::executeInternal(const std::string& sql, bool isQuery)
 }
 
 
-QueryResultPtr Connection::executeQueryWithReconnect(const std::string& sql, bool isQuery) {
+namespace {
+
+// counts a query as in flight on its backend for the lifetime of the guard,
+// a guard that is not finished counts as a failed request
+class BackendRequestGuard {
+public:
+    explicit BackendRequestGuard(BackendStats* stats)
+        : m_stats(stats), m_start(std::chrono::steady_clock::now()) {
+        if (m_stats) {
+            m_stats->requestStarted();
+        }
+    }
+
+    ~BackendRequestGuard() {
+        if (m_stats) {
+            m_stats->requestFailed();
+        }
+    }
+
+    // the server answered, with rows or with an SQL error
+    void finish() {
+        if (m_stats) {
+            m_stats->requestFinished(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - m_start).count());
+            m_stats = nullptr;
+        }
+    }
+
+private:
+    BackendStats* m_stats;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+} // namespace
+
+
+QueryTiming* Connection::beginTrace(QueryTiming& timing) {
+    bool sampled = false;
+    bool traced = m_tracer->shouldTrace(sampled);
+    // the wait of the checkout belongs to its first query, traced or not
+    int64_t waitMicros = m_traceWaitMicros;
+    int64_t connectMicros = m_traceConnectMicros;
+    m_traceWaitMicros = 0;
+    m_traceConnectMicros = 0;
+    if (!traced) {
+        return nullptr;
+    }
+    timing.reset(sampled);
+    timing.add(TracePhase::POOL_WAIT, waitMicros);
+    timing.add(TracePhase::CONNECT, connectMicros);
+    return &timing;
+}
+
+
+void Connection::finishTrace(const QueryTiming& timing, const std::string& sql, bool isQuery,
+                             bool success, unsigned int errorCode, const std::string& error) {
+    int64_t executionMicros = traceClockMicros() - timing.startMicros;
+    int64_t waitMicros = timing.phaseMicros[static_cast<size_t>(TracePhase::POOL_WAIT)];
+    if (!m_tracer->shouldEmit(timing.sampled, waitMicros + executionMicros)) {
+        return;
+    }
+    QuerySpan span;
+    span.backend = m_host + ":" + std::to_string(m_port);
+    span.backendId = m_backendId;
+    span.connectionId = m_connectionId;
+    span.sql = sql;
+    span.isQuery = isQuery;
+    span.durationMicros = waitMicros + executionMicros;
+    span.startMicros = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count() - span.durationMicros;
+    for (size_t i = 0; i < TRACE_PHASE_COUNT; i++) {
+        span.phaseMicros[i] = timing.phaseMicros[i];
+    }
+    span.reconnects = timing.reconnects;
+    span.success = success;
+    span.errorCode = errorCode;
+    span.error = error;
+    span.sampled = timing.sampled;
+    m_tracer->emit(span);
+}
+
+
+QueryResultPtr Connection::executeQueryWithReconnect(const std::string& sql, bool isQuery, ResultMode mode) {
     auto startTime = std::chrono::steady_clock::now();
+    BackendRequestGuard backendRequest(m_backendStats.get());
+    // phases are only timed when the pool's tracer samples this query or watches for slow ones
+    QueryTiming timing;
+    QueryTiming* traced = nullptr;
+    if (m_tracer && m_tracer->isActive()) {
+        traced = beginTrace(timing);
+    }
     // first retry mysql connection
     unsigned int errorCode = 0;
     std::string errorMessage;
     // retry query sql
     for (unsigned int attempt = 0; attempt <= m_reconnectAttempts; attempt++) {
         if (attempt > 0) {
+            int64_t reconnectStart = traced ? traceClockMicros() : 0;
             bool reconnect_res = reconnect();
+            if (traced) {
+                traced->add(TracePhase::RECONNECT, traceClockMicros() - reconnectStart);
+                traced->reconnects++;
+            }
             if (!reconnect_res) {
                 // 
                 errorMessage = "Failed to reconnect";
@@ -306,10 +924,14 @@ QueryResultPtr Connection::executeQueryWithReconnect(const std::string& sql, boo
         }
 
         try {
-            auto queryResult = executeInternal(sql, isQuery);
+            auto queryResult = executeInternal(sql, isQuery, mode, traced);
+            backendRequest.finish();
             auto endTime = std::chrono::steady_clock::now();
-            auto takenTime = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime);
-            PerformanceMonitor::getInstance().recordQueryExecuted(takenTime.count(), true);
+            auto takenTime = std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime);
+            m_monitor->recordQueryExecuted(takenTime.count(), true);
+            if (traced) {
+                finishTrace(*traced, sql, isQuery, true, 0, "");
+            }
             return queryResult;
         } catch(const db::SQLExecutionError& e) {
             // catch database errorMesg, and code
@@ -317,10 +939,14 @@ QueryResultPtr Connection::executeQueryWithReconnect(const std::string& sql, boo
             errorMessage = e.what();
             
             if (!isConnectionError(errorCode)) {
+                backendRequest.finish();
                 LOG_ERROR("exectuteQueryWithReconnection meet other errors, errorCode: " + std::to_string(errorCode));
                 auto endTime = std::chrono::steady_clock::now();
-                auto takenTime = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime);
-                PerformanceMonitor::getInstance().recordQueryExecuted(takenTime.count(), false);
+                auto takenTime = std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime);
+                m_monitor->recordQueryExecuted(takenTime.count(), false);
+                if (traced) {
+                    finishTrace(*traced, sql, isQuery, false, errorCode, errorMessage);
+                }
                 throw std::runtime_error("exectuteQueryWithReconnection meet other errors");
             }
 
@@ -335,8 +961,11 @@ QueryResultPtr Connection::executeQueryWithReconnect(const std::string& sql, boo
                         m_connectionId + "]: " + errorMessage + " SQL: " + sql;
     LOG_ERROR(error);
     auto endTime = std::chrono::steady_clock::now();
-    auto takenTime = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime);
-    PerformanceMonitor::getInstance().recordQueryExecuted(takenTime.count(), false);
+    auto takenTime = std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime);
+    m_monitor->recordQueryExecuted(takenTime.count(), false);
+    if (traced) {
+        finishTrace(*traced, sql, isQuery, false, errorCode, errorMessage);
+    }
     throw std::runtime_error(error);
 }
 
@@ -403,6 +1032,51 @@ bool Connection::rollback()
 }
 
 
+bool Connection::isInTransaction() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_mysql && (m_mysql->server_status & SERVER_STATUS_IN_TRANS) != 0;
+}
+
+
+bool Connection::hasSessionChanges() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_sessionChanged;
+}
+
+
+bool Connection::resetSession(bool fullReset) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_mysql) {
+        return false;
+    }
+    finishActiveStreamLocked();
+
+    int status = 0;
+    if (fullReset) {
+        LOG_DEBUG("Resetting session [" + m_connectionId + "]");
+        status = mysql_reset_connection(m_mysql);
+        if (status == 0) {
+            // the server has released the statements of the session
+            invalidateStatementsLocked();
+            m_sessionChanged = false;
+        }
+    } else if (m_mysql->server_status & SERVER_STATUS_IN_TRANS) {
+        LOG_DEBUG("Rolling back unfinished transaction on release [" + m_connectionId + "]");
+        status = mysql_real_query(m_mysql, "ROLLBACK", 8);
+    }
+    if (status == 0) {
+        return true;
+    }
+
+    LOG_WARNING("Failed to clean up session [" + m_connectionId + "], closing it: " +
+                std::string(mysql_error(m_mysql)) + " (Code: " + std::to_string(mysql_errno(m_mysql)) + ")");
+    invalidateStatementsLocked();
+    mysql_close(m_mysql);
+    m_mysql = nullptr;
+    return false;
+}
+
+
 // get Last Error for mysql_server
 // std::string Connection::getLastError() const {
 //     if (!m_mysql) {
@@ -446,7 +1120,17 @@ int64_t Connection::getCreationTime() const {
 }
 
 int64_t Connection::getLastActiveTime() const {
-    return m_lastActiveTime;
+    return m_lastActiveTime.load(std::memory_order_relaxed);
+}
+
+
+int64_t Connection::getLastCheckedTime() const {
+    return m_lastCheckedTime.load(std::memory_order_relaxed);
+}
+
+
+void Connection::markChecked() {
+    m_lastCheckedTime.store(Utils::currentTimeMillis(), std::memory_order_relaxed);
 }
 
 
@@ -477,19 +1161,11 @@ bool Connection::isConnectionError(unsigned int errorCode) const {
 
 // Compute reconnect delay
 unsigned int Connection::calculateReconnectDelay(unsigned int attempt) {
-    unsigned int baseDelay = m_reconnectInterval;
-
-    // 计算指数退避延迟
-    unsigned int exponentialDelay = baseDelay * (1 << (attempt - 1));
+    // 指数退避加全抖动：在 [0, min(30秒, 间隔 * 2^(attempt-1))] 内均匀分布，
+    // 同时断开的大量连接不会在同一时刻一起重连
     unsigned int maxDelay = 30000;
-    unsigned int delay = std::min(exponentialDelay, maxDelay);
-
-    // 更安全的随机抖动计算
-    static thread_local std::mt19937 rng{std::random_device{}()};
-    std::uniform_real_distribution<double> dist(0.8, 1.2); // 80% 到 120%
-
-    double jitteredDelay = delay * dist(rng);
-    delay = static_cast<unsigned int>(std::max(1.0, jitteredDelay)); // 确保至少1ms
+    unsigned int delay = static_cast<unsigned int>(
+        CircuitBreaker::backoffDelay(m_reconnectInterval, attempt, maxDelay));
 
     LOG_DEBUG("Calculated reconnect delay: " + std::to_string(delay) +
               "ms for attempt " + std::to_string(attempt) +
@@ -519,4 +1195,86 @@ void Connection::resetReconnectStats()
     m_totalReconnectAttempts = 0;
     m_successfulReconnects = 0;
     LOG_INFO("Reconnection statistics reset [" + m_connectionId + "]");
-}
\ No newline at end of file
+}
+
+
+void Connection::setPoolSlot(size_t slot) {
+    m_poolSlot = slot;
+}
+
+
+size_t Connection::getPoolSlot() const {
+    return m_poolSlot;
+}
+
+
+void Connection::setBackend(uint64_t backendId, std::shared_ptr<BackendStats> stats) {
+    if (m_backendStats) {
+        m_backendStats->connectionClosed();
+    }
+    m_backendId = backendId;
+    m_backendStats = std::move(stats);
+    if (m_backendStats) {
+        m_backendStats->connectionOpened();
+    }
+}
+
+
+uint64_t Connection::getBackendId() const {
+    return m_backendId;
+}
+
+
+void Connection::setPerformanceMonitor(PerformanceMonitor& monitor) {
+    m_monitor = &monitor;
+}
+
+
+PerformanceMonitor& Connection::getPerformanceMonitor() const {
+    return *m_monitor;
+}
+
+
+void Connection::setQueryTracer(QueryTracer* tracer) {
+    m_tracer = tracer;
+}
+
+
+void Connection::setCheckoutTrace(std::chrono::steady_clock::time_point checkoutStart) {
+    int64_t start = traceClockMicros(checkoutStart);
+    m_traceWaitMicros = traceClockMicros() - start;
+    // only a connect that overlapped the wait was waited for, a warm connection connected long before
+    m_traceConnectMicros = m_connectEndMicros > start
+        ? m_connectEndMicros - std::max(m_connectStartMicros, start) : 0;
+}
+
+
+bool Connection::markInUse() {
+    bool expected = false;
+    if (!m_inUse.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
+        return false;
+    }
+    m_borrowedTime = Utils::currentTimeMicros();
+    return true;
+}
+
+
+void Connection::markReborrowed() {
+    m_borrowedTime = Utils::currentTimeMicros();
+}
+
+
+bool Connection::markIdle() {
+    bool expected = true;
+    return m_inUse.compare_exchange_strong(expected, false, std::memory_order_acq_rel);
+}
+
+
+bool Connection::isInUse() const {
+    return m_inUse.load(std::memory_order_acquire);
+}
+
+
+int64_t Connection::getBorrowedTime() const {
+    return m_borrowedTime;
+}
@@ -0,0 +1,124 @@
+#include "connection_factory.h"
+#include <algorithm>
+#include "logger.h"
+
+ConnectionFactory::ConnectionFactory()
+    : m_queued(0)
+    , m_inFlight(0)
+    , m_running(false) {
+}
+
+
+ConnectionFactory::~ConnectionFactory() {
+    stop();
+}
+
+
+void ConnectionFactory::start(unsigned int maxInFlight, CreateFunction create, CompletionFunction onComplete) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_running) {
+        LOG_WARNING("ConnectionFactory::start called, but it is in running status");
+        return;
+    }
+    m_create = std::move(create);
+    m_onComplete = std::move(onComplete);
+    m_queued = 0;
+    m_running = true;
+
+    unsigned int threadCount = std::max(1u, maxInFlight);
+    for (unsigned int i = 0; i < threadCount; i++) {
+        m_threads.emplace_back([this]() {
+            this->worker();
+        });
+    }
+    LOG_DEBUG("ConnectionFactory started with " + std::to_string(threadCount) + " creator threads");
+}
+
+
+size_t ConnectionFactory::stop() {
+    size_t dropped = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_running) {
+            return 0;
+        }
+        m_running = false;
+        dropped = m_queued;
+        m_queued = 0;
+    }
+    m_condition.notify_all();
+
+    for (auto& thread : m_threads) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    m_threads.clear();
+    LOG_DEBUG("ConnectionFactory stopped, dropped requests: " + std::to_string(dropped));
+    return dropped;
+}
+
+
+size_t ConnectionFactory::request(size_t count) {
+    if (count == 0) {
+        return 0;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_running) {
+            return 0;
+        }
+        m_queued += count;
+    }
+    if (count == 1) {
+        m_condition.notify_one();
+    } else {
+        m_condition.notify_all();
+    }
+    return count;
+}
+
+
+size_t ConnectionFactory::getQueuedCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_queued;
+}
+
+
+size_t ConnectionFactory::getInFlightCount() const {
+    return m_inFlight.load();
+}
+
+
+bool ConnectionFactory::isRunning() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_running;
+}
+
+
+void ConnectionFactory::worker() {
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [this]() {
+                return !m_running || m_queued > 0;
+            });
+            if (!m_running) {
+                return;
+            }
+            m_queued--;
+            m_inFlight++;
+        }
+
+        // the handshake runs without holding any lock
+        ConnectionPtr connection;
+        try {
+            connection = m_create();
+        } catch (const std::exception& e) {
+            LOG_WARNING("ConnectionFactory failed to create connection: " + std::string(e.what()));
+        }
+
+        m_inFlight--;
+        m_onComplete(connection);
+    }
+}
@@ -4,29 +4,175 @@
 #include <chrono>
 #include <vector>
 #include <future>
+#include <algorithm>
+#include <map>
 #include "connection_pool.h"
 #include "pool_config.h"
 #include "logger.h"
 #include "utils.h"
 #include <performance_monitor.h>
 
-ConnectionPool::ConnectionPool() {
+namespace {
+
+uint64_t nextPoolInstanceId() {
+    static std::atomic<uint64_t> id(1);
+    return id.fetch_add(1);
+}
+
+} // namespace
+
+
+ConnectionPool::ConnectionPool()
+    : m_name("default")
+    , m_loadBalancer(&LoadBalancer::getInstance())
+    , m_monitor(&PerformanceMonitor::getInstance())
+    , m_tracer(m_name)
+    , m_instanceId(nextPoolInstanceId()) {
     LOG_DEBUG("ConnectionPool instance created");
     m_isRunning = false;
     m_totalConnections = 0;
+    m_activeConnections = 0;
+    m_pendingConnections = 0;
+    m_waiters = 0;
+    m_autoscaleTarget = 0;
+    m_resetting = nullptr;
+    m_resetStopping = true;
+}
+
+
+ConnectionPool::ConnectionPool(const std::string& name)
+    : m_name(name)
+    , m_ownedLoadBalancer(new LoadBalancer())
+    , m_ownedMonitor(new PerformanceMonitor())
+    , m_loadBalancer(m_ownedLoadBalancer.get())
+    , m_monitor(m_ownedMonitor.get())
+    , m_tracer(m_name)
+    , m_instanceId(nextPoolInstanceId()) {
+    LOG_DEBUG("ConnectionPool instance created: " + m_name);
+    m_isRunning = false;
+    m_totalConnections = 0;
+    m_activeConnections = 0;
+    m_pendingConnections = 0;
+    m_waiters = 0;
+    m_autoscaleTarget = 0;
+    m_resetting = nullptr;
+    m_resetStopping = true;
+}
+
+
+namespace {
+
+std::mutex& registryMutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+// named pools, never erased, so the references handed out stay valid
+std::map<std::string, std::unique_ptr<ConnectionPool>>& registry() {
+    static std::map<std::string, std::unique_ptr<ConnectionPool>> pools;
+    return pools;
+}
+
+} // namespace
+
+
+ConnectionPool& ConnectionPool::getInstance() {
+    static ConnectionPool instance;
+    return instance;
+}
+
+
+ConnectionPool& ConnectionPool::getInstance(const std::string& name) {
+    if (name == "default") {
+        return getInstance();
+    }
+    std::lock_guard<std::mutex> lock(registryMutex());
+    auto& pool = registry()[name];
+    if (!pool) {
+        pool.reset(new ConnectionPool(name));
+    }
+    return *pool;
+}
+
+
+std::vector<std::string> ConnectionPool::getInstanceNames() {
+    std::vector<std::string> names = {"default"};
+    std::lock_guard<std::mutex> lock(registryMutex());
+    for (const auto& entry : registry()) {
+        names.push_back(entry.first);
+    }
+    return names;
+}
+
+
+const std::string& ConnectionPool::getName() const {
+    return m_name;
+}
+
+
+LoadBalancer& ConnectionPool::getLoadBalancer() const {
+    return *m_loadBalancer;
+}
+
+
+PerformanceMonitor& ConnectionPool::getPerformanceMonitor() const {
+    return *m_monitor;
+}
+
+
+QueryTracer& ConnectionPool::getQueryTracer() {
+    return m_tracer;
 }
 
 
 ConnectionPool::~ConnectionPool() {
     LOG_DEBUG("ConnectionPool destructor called");
     shutdown();
+    // threads still holding a slot drop it the next time they look one up
+    std::lock_guard<std::mutex> lock(m_threadCacheMutex);
+    for (const auto& slot : m_threadCaches) {
+        slot->retired = true;
+    }
 }
 
 
-ConnectionPtr ConnectionPool::createConnection() {
+ConnectionPtr ConnectionPool::createRequestedConnection() {
+    BackendPoolPtr pool;
+    {
+        std::lock_guard<std::mutex> lock(m_createMutex);
+        if (!m_createQueue.empty()) {
+            pool = std::move(m_createQueue.front());
+            m_createQueue.pop_front();
+        }
+    }
+    if (!pool) {
+        m_monitor->recordConnectionFailed();
+        throw std::runtime_error("ConnectionPool::createConnection no database was requested");
+    }
     try {
-        DBConfig config = LoadBalancer::getInstance().getNextDatabase();
+        if (pool->isDraining()) {
+            throw std::runtime_error("the database has been removed from the load balancer");
+        }
+        return createConnection(*pool->getBackend());
+    } catch (std::exception& e) {
+        // the global place is given back by onConnectionCreated
+        pool->finishPending();
+        pool->releasePlace();
+        LOG_DEBUG("ConnectionPool::createRequestedConnection failed: " + std::string(e.what()));
+        throw;
+    }
+}
 
+
+ConnectionPtr ConnectionPool::createConnection(const Backend& backend) {
+    const DBConfig& config = backend.config;
+    CircuitBreaker& breaker = backend.stats->getBreaker();
+    try {
+        // a backend that is known to be down fails at once instead of after the connect timeout
+        if (!breaker.allowConnect()) {
+            throw std::runtime_error("the circuit breaker of " + config.host + ":" +
+                                     std::to_string(config.port) + " is open");
+        }
         // call connection method
         ConnectionPtr conn = std::make_shared<Connection>(
             config.host,
@@ -34,22 +180,29 @@ ConnectionPtr ConnectionPool::createConnection() {
             config.password,
             config.database,
             config.port,
-            m_config.reconnectInterval,
-            m_config.reconnectAttempts
+            m_liveConfig.get().reconnectInterval,
+            m_liveConfig.get().reconnectAttempts
         );
+        conn->setStatementCacheSize(m_liveConfig.get().statementCacheSize);
+        conn->setPerformanceMonitor(*m_monitor);
+        conn->setQueryTracer(&m_tracer);
 
+        int64_t connectStart = Utils::currentTimeMicros();
         auto conn_res = conn->connect();
         if (!conn_res) {
             std::string error = "cannot create a connectionId";
-            PerformanceMonitor::getInstance().recordConnectionFailed();
+            breaker.recordFailure();
+            m_monitor->recordConnectionFailed();
             throw std::runtime_error(error);
         }
-        PerformanceMonitor::getInstance().recordConnectionCreated();
+        breaker.recordSuccess();
+        conn->setBackend(backend.id, backend.stats);
+        m_monitor->recordConnectionCreated(Utils::currentTimeMicros() - connectStart);
         // create the connection successfully
         LOG_DEBUG("create a connection successfully. connectionId: " + conn->getConnectionId());
         return conn;
     } catch(std::exception& e) {
-        PerformanceMonitor::getInstance().recordConnectionFailed();
+        m_monitor->recordConnectionFailed();
         LOG_ERROR("ConnectionPool::createConnection createConnection has error: " + std::string(e.what()));
         throw;
     }
@@ -59,6 +212,7 @@ ConnectionPtr ConnectionPool::createConnection() {
 
 
 void ConnectionPool::shutdown() {
+    std::lock_guard<std::mutex> initLock(m_initMutex);
     {
         std::lock_guard<std::mutex> lock(m_mutex);
 
@@ -67,34 +221,86 @@ void ConnectionPool::shutdown() {
         }
 
         m_isRunning = false;
+        // a stopped pool serves no cached results either, init() enables the cache again
+        m_queryCache.configure(0, 0);
 
-        m_condition.notify_all();
+        for (const auto& pool : m_backendPools.load()->pools) {
+            pool->getWaitQueue().wakeAll();
+        }
+        m_healthCondition.notify_all();
     }
+
+    // connections kept by threads are closed, a thread taking its own first keeps it until it returns it
+    reclaimThreadCaches(INT64_MAX);
     
     // join all the healthCheckThread
     if (m_healthCheckThread.joinable()) {
         m_healthCheckThread.join();
     }
+    m_pingers.stop();
 
-    std::lock_guard<std::mutex> lock(m_mutex);
-    // close all connections in the queue
-    while (!m_idleConnections.empty()) {
-        ConnectionPtr conn = m_idleConnections.front();
+    // connections still waiting for their session cleanup are closed by the reset thread
+    {
+        std::lock_guard<std::mutex> lock(m_resetMutex);
+        m_resetStopping = true;
+    }
+    m_resetCondition.notify_all();
+    if (m_resetThread.joinable()) {
+        m_resetThread.join();
+    }
+
+    // warm-up connects still in flight are closed when they finish
+    stopWarmup(true);
+
+    // connects already in flight finish and are dropped by onConnectionCreated
+    size_t dropped = m_factory.stop();
+    m_pendingConnections -= dropped;
+    m_totalConnections -= dropped;
+    {
+        // the requests the factory dropped never reached createRequestedConnection
+        std::lock_guard<std::mutex> lock(m_createMutex);
+        m_createQueue.clear();
+    }
+
+    std::vector<ConnectionPtr> idleConnections;
+    std::vector<ConnectionPtr> activeConnections;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto table = m_backendPools.load();
+        for (const auto& pool : table->pools) {
+            pool->getIdleConnections().drain();
+        }
+        size_t stillInUse = 0;
+        std::unordered_map<uint64_t, size_t> inUseByBackend;
+        for (size_t slot = 0; slot < m_connections.size(); slot++) {
+            ConnectionPtr& conn = m_connections[slot];
+            if (!conn) {
+                continue;
+            }
+            if (conn->isInUse()) {
+                // borrowed connections stay in the slot table, so a PooledConnection handle
+                // still points to a live object; they are removed when they come back
+                activeConnections.push_back(conn);
+                inUseByBackend[conn->getBackendId()]++;
+                stillInUse++;
+            } else {
+                idleConnections.push_back(std::move(conn));
+                m_freeSlots.push_back(slot);
+            }
+        }
+        m_totalConnections = stillInUse;
+        for (const auto& pool : table->pools) {
+            pool->resetPlaces(inUseByBackend[pool->getBackendId()]);
+        }
+    }
+
+    // close all connections outside the lock
+    for (auto& conn : idleConnections) {
         conn->close();
-        m_idleConnections.pop();
     }
-    // close all connections in the activePool.
-    auto activeConnectionIter = m_activeConnections.begin();
-    while (activeConnectionIter != m_activeConnections.end()) {
-        ConnectionPtr conn = activeConnectionIter->second;
+    for (auto& conn : activeConnections) {
         conn->close();
-        ++activeConnectionIter;
     }
-    // make the activeConnections clear
-    m_activeConnections.clear();
-    
-    m_totalConnections = 0;
-    
 }
 
 bool ConnectionPool::isInitialized() const {
@@ -104,13 +310,19 @@ bool ConnectionPool::isInitialized() const {
 }
 
 size_t ConnectionPool::getActiveCount() const {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    return m_activeConnections.size();
+    return m_activeConnections.load();
 }
 
 size_t ConnectionPool::getIdleCount() const {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    return m_idleConnections.size();
+    size_t idle = 0;
+    for (const auto& pool : m_backendPools.get().pools) {
+        idle += pool->getIdleConnections().size();
+    }
+    return idle;
+}
+
+size_t ConnectionPool::getAutoscaleTarget() const {
+    return m_autoscaleTarget.load();
 }
 
 size_t ConnectionPool::getTotalCount() const {
@@ -123,12 +335,22 @@ std::string ConnectionPool::getStatus() const {
     std::string status = "ConnectionPool Status:\n";
     status += "  Running: " + std::string(m_isRunning ? "Yes" : "No") + "\n";
     status += "  Total Connections: " + std::to_string(m_totalConnections.load()) + "\n";
-    status += "  Idle Connections: " + std::to_string(m_idleConnections.size()) + "\n";
-    status += "  Active Connections: " + std::to_string(m_activeConnections.size()) + "\n";
+    status += "  Idle Connections: " + std::to_string(getIdleCount()) + "\n";
+    status += "  Active Connections: " + std::to_string(m_activeConnections.load()) + "\n";
     status += "  Min Connections: " + std::to_string(m_config.minConnections) + "\n";
     status += "  Max Connections: " + std::to_string(m_config.maxConnections) + "\n";
     status += "  Connection Timeout: " + std::to_string(m_config.connectionTimeout) + "ms\n";
     status += "  Max Idle Time: " + std::to_string(m_config.maxIdleTime) + "ms\n";
+    for (const auto& pool : m_backendPools.load()->pools) {
+        status += "  Backend " + pool->getBackend()->config.getConnectionString() +
+                  ": total=" + std::to_string(pool->getTotalCount()) +
+                  " idle=" + std::to_string(pool->getIdleConnections().size()) +
+                  " pending=" + std::to_string(pool->getPendingCount()) +
+                  " role=" + roleToString(pool->getRole()) +
+                  " limits=" + std::to_string(pool->getMinConnections()) + "/" +
+                  std::to_string(pool->getMaxConnections()) +
+                  (pool->isDraining() ? " (draining)" : "") + "\n";
+    }
 
     return status;
 }
@@ -140,9 +362,100 @@ PoolConfig ConnectionPool::getConfig() const {
 
 
 ConnectionPtr ConnectionPool::getConnection(unsigned int timeout) {
+    return getConnection(AccessMode::READ_WRITE, timeout);
+}
+
+
+ConnectionPtr ConnectionPool::getConnection(AccessMode mode, unsigned int timeout) {
+    return getConnection(mode, timeout, AcquirePriority::NORMAL);
+}
+
+
+ConnectionPtr ConnectionPool::getConnection(AccessMode mode, unsigned int timeout, AcquirePriority priority) {
+    return acquireConnection(timeout, mode, priority)->shared_from_this();
+}
+
+
+PooledConnection ConnectionPool::acquire(unsigned int timeout) {
+    return acquire(AccessMode::READ_WRITE, timeout);
+}
+
+
+PooledConnection ConnectionPool::acquire(AccessMode mode, unsigned int timeout, AcquirePriority priority) {
+    Connection* connection = acquireConnection(timeout, mode, priority);
+    return PooledConnection(connection, PooledConnectionDeleter(this, connection->getPoolSlot()));
+}
+
+
+QueryResultPtr ConnectionPool::executeCachedQuery(const std::string& sql, const std::vector<std::string>& tags,
+                                                  unsigned int ttl) {
+    return executeCached(QueryCache::makeKey(sql, {}), tags, ttl, [&sql](PooledConnection& conn) {
+        return conn->executeQuery(sql)->toRows();
+    });
+}
+
+
+QueryResultPtr ConnectionPool::executeCachedStatement(const std::string& sql, const std::vector<std::string>& params,
+                                                      const std::vector<std::string>& tags, unsigned int ttl) {
+    return executeCached(QueryCache::makeKey(sql, params), tags, ttl, [&sql, &params](PooledConnection& conn) {
+        PreparedStatementPtr stmt = conn->prepareStatement(sql);
+        for (size_t i = 0; i < params.size(); i++) {
+            stmt->setString(static_cast<unsigned int>(i), params[i]);
+        }
+        return stmt->executeQuery()->toRows();
+    });
+}
+
+
+QueryResultPtr ConnectionPool::executeCached(const std::string& key, const std::vector<std::string>& tags,
+                                             unsigned int ttl, const std::function<ResultRowsPtr(PooledConnection&)>& run) {
+    // a disabled cache is neither looked up nor counted as a miss, the statement just runs
+    bool enabled = m_queryCache.isEnabled();
+    ResultRowsPtr rows;
+    if (enabled) {
+        rows = m_queryCache.get(key);
+        if (rows) {
+            m_monitor->recordQueryCacheLookup(true);
+            return std::make_shared<QueryResult>(std::move(rows));
+        }
+        m_monitor->recordQueryCacheLookup(false);
+    }
+
+    // read before the query, a write that invalidates while it runs keeps its result out of the cache
+    uint64_t epoch = m_queryCache.getEpoch();
+    {
+        PooledConnection conn = acquire(AccessMode::READ_ONLY);
+        rows = run(conn);
+    }
+    if (!rows) {
+        throw std::runtime_error("ConnectionPool::executeCached the statement returned no result set");
+    }
+    m_queryCache.put(key, rows, tags, static_cast<int64_t>(ttl) * 1000 * 1000, epoch);
+    return std::make_shared<QueryResult>(std::move(rows));
+}
+
+
+size_t ConnectionPool::invalidateQueryCache(const std::string& tag) {
+    size_t dropped = m_queryCache.invalidate(tag);
+    LOG_DEBUG("ConnectionPool::invalidateQueryCache " + tag + " dropped: " + std::to_string(dropped));
+    return dropped;
+}
+
+
+void ConnectionPool::clearQueryCache() {
+    m_queryCache.clear();
+}
+
+
+QueryCache::Stats ConnectionPool::getQueryCacheStats() const {
+    return m_queryCache.getStats();
+}
+
+
+Connection* ConnectionPool::acquireConnection(unsigned int timeout, AccessMode mode, AcquirePriority priority) {
 
     if (!m_isRunning) {
-        PerformanceMonitor::getInstance().recordConnectionFailed();
+        m_monitor->recordConnectionFailed();
         throw std::runtime_error("Connection pool is not in running status, cannot get a Connection from the pool");
     }
 
@@ -151,68 +464,186 @@ ConnectionPtr ConnectionPool::getConnection(unsigned int timeout) {
 
     // use default value
     if (timeout == 0) {
-        timeout = m_config.connectionTimeout;
+        timeout = m_liveConfig.get().connectionTimeout;
     }
 
-    std::unique_lock<std::mutex> lock(m_mutex);
-    // compuete the timeout time point
-    auto tiemoutPoint = std::chrono::steady_clock::now() + std::chrono::microseconds(timeout);
+    // a thread that has just written reads from the primary, the replicas may not have the write yet
+    unsigned int readAfterWriteWindow = m_liveConfig.get().readAfterWriteWindow;
+    if (readAfterWriteWindow > 0) {
+        // a thread that never wrote has no slot to look at
+        ThreadCacheSlot* slot = threadCacheSlot(mode == AccessMode::READ_WRITE);
+        int64_t now = Utils::currentTimeMillis();
+        if (mode == AccessMode::READ_WRITE) {
+            slot->lastWriteMillis = now;
+        } else if (slot && slot->lastWriteMillis > 0 &&
+                   now - slot->lastWriteMillis < static_cast<int64_t>(readAfterWriteWindow)) {
+            mode = AccessMode::READ_WRITE;
+        }
+    }
+    // the connection this thread returned last, taken without touching the shared idle stores
+    if (m_liveConfig.get().threadLocalCache) {
+        Connection* cached = takeThreadCachedConnection(mode);
+        if (cached) {
+            if (!needsValidationOnBorrow(cached) || validateConnection(cached, false)) {
+                cached->markReborrowed();
+                m_monitor->recordConnectionAcquired(std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - startTime).count());
+                if (m_tracer.isActive()) {
+                    cached->setCheckoutTrace(startTime);
+                }
+                return cached;
+            }
+            // it went stale in the cache, dropped like an invalid idle connection
+            cached->markIdle();
+            m_activeConnections--;
+            releasePlace(findBackendPool(cached->getBackendId()).get());
+            destroyConnection(cached, cached->getPoolSlot());
+        }
+    }
+    // the load balancer decides once per checkout, a waiter keeps its backend unless it is removed
+    BackendPoolPtr pool = selectBackendPool(mode);
+    // the timeout is in milliseconds; the waiter keeps its place in the queue across retries
+    AcquireWaiter waiter(priority, startTime + std::chrono::milliseconds(timeout));
     // run loop
     while (true) {
-        // fetch the idel connection from the FIFO queue
-        if (m_idleConnections.size() > 0) {
-            LOG_DEBUG("ConnectionPool::getConnection has ideal Connections");
-            ConnectionPtr idelConnection = m_idleConnections.front();
-            // check if it is valid connection
-            if (this->validateConnection(idelConnection, false)) {
-                m_idleConnections.pop();
-                m_activeConnections[idelConnection->getConnectionId()] =  idelConnection;
-                idelConnection->updateLastActiveTime();
-                auto endTime = std::chrono::steady_clock::now();
-                auto takenTime = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime);
-                PerformanceMonitor::getInstance().recordConnectionAcquired(takenTime.count());
-                return idelConnection;
-            } else {
-                m_totalConnections--;
-                LOG_INFO("ConnectionPool::getConnection fetch ideal connection from the pool, but it is not valid, connectionId: " + idelConnection->getConnectionId());
-                // continue looking for connections from the FIFO queue
+        if (pool->isDraining()) {
+            pool = selectBackendPool(mode);
+        }
+        // fetch the idel connection from the backend's idle store, it only takes the lock of one shard;
+        // threads already queued for the backend are served first, an arriving thread does not overtake them
+        Connection* idelConnection = nullptr;
+        if (pool->getWaiters().load() == 0) {
+            idelConnection = pool->getIdleConnections().pop();
+        }
+        if (!idelConnection && !pool->canGrow()) {
+            // the backend is at its own limit, an idle connection of another backend beats waiting
+            idelConnection = stealIdleConnection(pool.get());
+            if (!idelConnection) {
+                // nothing to take over either, wait for a new connection of a backend that still has room
+                BackendPoolPtr growable = findGrowableBackendPool(pool.get());
+                if (growable) {
+                    pool = growable;
+                }
+            }
+        }
+        if (idelConnection) {
+            idelConnection->markInUse();
+            m_activeConnections++;
+        } else {
+            // no idle connection: queue up until one is handed over, either released or newly created
+            std::unique_lock<std::mutex> lock(m_mutex);
+            idelConnection = waitForConnection(lock, pool, waiter, timeout);
+            if (!idelConnection) {
+                // capacity was released or the backend is draining, look again
                 continue;
             }
         }
 
-        
-        if (m_totalConnections < m_config.maxConnections) {
-        // try to create a connection, and return the connection
-        try {
-            // concurrently create Connection
-            // unlock first
-            lock.unlock();
-            ConnectionPtr conn = createConnection();
-            lock.lock();
-            
-            if (conn) {
-                if (this->validateConnection(conn, false)) {
-                    m_totalConnections++;
-                    m_activeConnections[conn->getConnectionId()] = conn;
-                    conn->updateLastActiveTime();
-                    LOG_DEBUG("ConnectionPool::getConnection no avaliable connection and create a connection and success");
-                    return conn;
-                }
-            }
-        } catch(const std::exception& e) {
-                LOG_ERROR("ConnectionPool::getConnection no avaliable connection and try to create a connection, but failed");
-                if (!lock.owns_lock()) {
-                    lock.lock();
-                }
+        // never ping while holding a lock
+        if (!needsValidationOnBorrow(idelConnection) || validateConnection(idelConnection, false)) {
+            // grow ahead of demand when the pool runs low on idle connections
+            growToLowWaterMark();
+            idelConnection->updateLastActiveTime();
+            auto endTime = std::chrono::steady_clock::now();
+            auto takenTime = std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime);
+            m_monitor->recordConnectionAcquired(takenTime.count());
+            if (m_tracer.isActive()) {
+                idelConnection->setCheckoutTrace(startTime);
             }
+            return idelConnection;
+        }
+
+        LOG_INFO("ConnectionPool::getConnection fetch ideal connection from the pool, but it is not valid, connectionId: " + idelConnection->getConnectionId());
+        idelConnection->markIdle();
+        m_activeConnections--;
+        releasePlace(findBackendPool(idelConnection->getBackendId()).get());
+        destroyConnection(idelConnection, idelConnection->getPoolSlot());
+        // continue looking for connections from the idle store
+    }
+}
+
+
+Connection* ConnectionPool::waitForConnection(std::unique_lock<std::mutex>& lock, const BackendPoolPtr& pool,
+                                              AcquireWaiter& waiter, unsigned int timeout) {
+    WaitQueue& queue = pool->getWaitQueue();
+    if (waiter.sequence == 0) {
+        // admission control, only when the thread first queues up
+        if (m_config.maxWaitQueueLength > 0 && queue.size() >= m_config.maxWaitQueueLength) {
+            m_monitor->recordAcquireRejected();
+            throw std::runtime_error("Wait queue of " + pool->getBackend()->config.getConnectionString() +
+                                     " is full (" + std::to_string(queue.size()) + " waiters)");
         }
-        LOG_INFO("no avaliable connections from the pool, and cannot create connections, try to wait other thread to release connection...");
-        auto wait_result = m_condition.wait_until(lock, tiemoutPoint);
-        if (wait_result == std::cv_status::timeout) {
-            throw std::runtime_error("Timeout waiting for available connection after " + 
-                                   std::to_string(timeout) + "ms");
+        if (m_config.failFastOnEstimatedWait && !pool->canGrow()) {
+            // nothing new is coming, the connections in use are all the queue can get
+            int64_t estimate = queue.estimateWaitMicros(queue.countAhead(waiter.priority));
+            int64_t remaining = std::chrono::duration_cast<std::chrono::microseconds>(
+                waiter.deadline - std::chrono::steady_clock::now()).count();
+            if (estimate >= 0 && estimate > remaining) {
+                m_monitor->recordAcquireRejected();
+                throw std::runtime_error("Estimated wait of " + std::to_string(estimate / 1000) +
+                                         "ms exceeds the timeout of " + std::to_string(timeout) + "ms");
+            }
         }
     }
+
+    // register as waiter before checking, pairs with notifyWaiter()
+    m_waiters++;
+    pool->getWaiters()++;
+    queue.push(&waiter);
+    // a connection may have become idle before this thread queued up
+    dispatchIdleConnectionsLocked(*pool);
+    // a connection kept by another thread serves a waiter before a new one is created;
+    // registered as waiter first, so a thread keeping one from now on sees it, see parkInThreadCache()
+    if (!waiter.connection && m_config.threadLocalCache) {
+        lock.unlock();
+        reclaimThreadCaches(INT64_MAX, 1, pool->getBackendId());
+        lock.lock();
+    }
+    // ask the factory for a connection, unless enough creations are already pending for the
+    // threads that are waiting. The handshake never runs on this thread.
+    if (!waiter.connection && pool->getPendingCount() < pool->getWaiters().load()) {
+        lock.unlock();
+        requestConnections(pool, 1);
+        lock.lock();
+    }
+
+    LOG_DEBUG("no avaliable connections from the pool, wait for a released or newly created connection...");
+    BackendPool* waitingPool = pool.get();
+    bool ready = waiter.condition.wait_until(lock, waiter.deadline, [this, &waiter, waitingPool]() {
+        return waiter.connection || waiter.retry || !m_isRunning || waitingPool->isDraining();
+    });
+    queue.remove(&waiter);
+    pool->getWaiters()--;
+    m_waiters--;
+
+    Connection* connection = waiter.connection;
+    waiter.connection = nullptr;
+    if (connection) {
+        // marked under m_mutex, so shutdown counts it as borrowed rather than idle
+        connection->markInUse();
+        m_activeConnections++;
+    }
+    if (connection || !ready || !m_isRunning) {
+        m_monitor->recordAcquireQueued(Utils::currentTimeMicros() - waiter.enqueuedMicros);
+    }
+    if (connection && !m_isRunning) {
+        lock.unlock();
+        returnConnection(connection, connection->getPoolSlot());
+        lock.lock();
+        connection = nullptr;
+    }
+    if (connection) {
+        return connection;
+    }
+    if (!ready) {
+        m_monitor->recordAcquireTimeout();
+        throw std::runtime_error("Timeout waiting for available connection after " + 
+                               std::to_string(timeout) + "ms");
+    }
+    if (!m_isRunning) {
+        throw std::runtime_error("Connection pool is shutting down, cannot get a Connection from the pool");
+    }
+    return nullptr;
 }
 
 
@@ -223,133 +654,743 @@ void ConnectionPool::releaseConnection(ConnectionPtr connection) {
         return;
     }
 
-    std::lock_guard<std::mutex> lock(m_mutex);
-    // remove the connecetion from the activeConnections
-    auto connId = connection->getConnectionId();
-    LOG_INFO("release  a connection conId: " + connId);
-    m_activeConnections.erase(connId);
-    auto usageTime = Utils::currentTimeMillis() - connection->getLastActiveTime();
-    // check total Connections
-    if (m_totalConnections > m_config.maxConnections) {
-        connection->close();
-        m_totalConnections--;
-        m_condition.notify_all();
-        PerformanceMonitor::getInstance().recordConnectionReleased(usageTime);
+    LOG_DEBUG("release  a connection conId: " + connection->getConnectionId());
+    returnConnection(connection.get(), connection->getPoolSlot());
+}
+
+
+void ConnectionPool::returnConnection(Connection* connection, size_t slot) {
+    // on the borrower's thread, a session reset may finish the return on another one
+    if (m_liveConfig.get().readAfterWriteWindow > 0) {
+        extendReadAfterWrite(threadCacheSlot(false), *connection);
+    }
+    if (m_liveConfig.get().threadLocalCache && parkInThreadCache(connection)) {
         return;
     }
+    returnToPool(connection, slot);
+}
 
-    if (this->validateConnection(connection, false)) {
-        // put the connection to the FIFO Queue
-        m_idleConnections.push(connection);
-    } else {
-        connection->close();
-        m_totalConnections--;
-        // check if the pool needs to create a another new connection
-        if (m_totalConnections < m_config.minConnections) {
-            try {
-                ConnectionPtr conn = createConnection();
-                if (conn) {
-                    if (this->validateConnection(conn, false)) {
-                        m_totalConnections++;
-                        // put it into FIFO queue
-                        m_idleConnections.push(conn);
-                        LOG_DEBUG("ConnectionPool::releaseConnection Replacement connection created: " + conn->getConnectionId());
-                    }
-                }
-            } catch(std::exception& e) {
-                LOG_ERROR("ConnectionPool::releaseConnection failed to create a replacement connection error msg: " + std::string(e.what()));
-            }
+
+ConnectionPool::BorrowerState ConnectionPool::getBorrowerState() {
+    return threadCacheEntry(false);
+}
+
+
+void ConnectionPool::releaseFor(PooledConnection connection, const BorrowerState& borrower) {
+    if (!connection) {
+        return;
+    }
+    size_t slot = connection.get_deleter().getSlot();
+    Connection* raw = connection.release();
+    if (borrower && m_liveConfig.get().readAfterWriteWindow > 0) {
+        extendReadAfterWrite(borrower.get(), *raw);
+    }
+    returnToPool(raw, slot);
+}
+
+
+void ConnectionPool::returnToPool(Connection* connection, size_t slot) {
+    if (m_isRunning && m_liveConfig.get().asyncSessionReset && connection->isInUse()) {
+        // an unread streaming result is cancelled right away, the reset thread must not drain it
+        connection->cancelActiveStream();
+        if (sessionResetNeeded(*connection) != SessionResetPolicy::NONE && queueSessionReset(connection, slot)) {
+            return;
         }
     }
-    PerformanceMonitor::getInstance().recordConnectionReleased(usageTime);
-    // notify other threads
-    m_condition.notify_all();   
+    recycleConnection(connection, slot, false);
 }
 
 
-void ConnectionPool::init(const PoolConfig& config) {
-    // grab the mutex lock
-    std::lock_guard<std::mutex> lock(m_mutex);
-    if (m_isRunning) {
-        LOG_WARNING("ConnectionPool::init init connectionPool, but it is in running status");
+void ConnectionPool::recycleConnection(Connection* connection, size_t slot, bool sessionClean) {
+    if (!connection->markIdle()) {
+        LOG_WARNING("Attempted to release a connection that is not in use, connectionId: " + connection->getConnectionId());
+        return;
+    }
+    m_activeConnections--;
+    auto usageTime = Utils::currentTimeMicros() - connection->getBorrowedTime();
+    m_monitor->recordConnectionReleased(usageTime);
+    putBackConnection(connection, slot, sessionClean);
+}
+
+
+void ConnectionPool::putBackConnection(Connection* connection, size_t slot, bool sessionClean) {
+    BackendPoolPtr pool = findBackendPool(connection->getBackendId());
+    if (!m_isRunning || !pool) {
+        // the pool has been shut down and already closed the connection, drop it from the slot table
+        releasePlace(pool.get());
+        destroyConnection(connection, slot);
         return;
     }
-    // if (m_initialized) {
-    //     return;
-    // }
-    if (!config.isValid()) {
-        throw std::runtime_error("ConnectionPool::init init connectionPool, but config is not valid");
+
+    // a streaming result that was not read to the end still owns the session. Draining it
+    // could take as long as the whole result, so it is cancelled and the connection is closed
+    connection->cancelActiveStream();
+
+    // leftovers of the last borrower, such as an open transaction, must not reach the next one;
+    // a connection whose cleanup failed is closed and dropped below
+    SessionResetPolicy reset = sessionClean ? SessionResetPolicy::NONE : sessionResetNeeded(*connection);
+    if (reset != SessionResetPolicy::NONE) {
+        connection->resetSession(reset == SessionResetPolicy::RESET);
+    }
+
+    // a closed handle can be detected without any network I/O; liveness is checked on borrow
+    // or in the background according to the validation policy
+    bool open = connection->isOpen();
+    bool draining = pool->isDraining();
+    if (open && !draining && !tryRetireConnection(*pool, m_liveConfig.get().maxConnections)) {
+        // stamp the release time, so idle time is measured from here
+        connection->updateLastActiveTime();
+        addIdleConnection(*pool, connection);
         return;
     }
-    m_config = config;
+
+    // a connection of a removed backend is closed instead of being reused
+    if (!open || draining) {
+        releasePlace(pool.get());
+    }
+    destroyConnection(connection, slot);
+
+    // check if the pool needs to create a another new connection, it is created in the background
+    size_t total = m_totalConnections.load();
+    size_t minConnections = m_liveConfig.get().minConnections;
+    if (total < minConnections) {
+        requestConnections(minConnections - total);
+    }
+    notifyCapacityReleased();
+}
+
+
+SessionResetPolicy ConnectionPool::sessionResetNeeded(const Connection& connection) const {
+    switch (m_liveConfig.get().sessionResetPolicy) {
+        case SessionResetPolicy::ROLLBACK:
+            return connection.isInTransaction() ? SessionResetPolicy::ROLLBACK : SessionResetPolicy::NONE;
+        case SessionResetPolicy::RESET:
+            return connection.hasSessionChanges() || connection.isInTransaction()
+                ? SessionResetPolicy::RESET : SessionResetPolicy::NONE;
+        case SessionResetPolicy::NONE:
+        default:
+            return SessionResetPolicy::NONE;
+    }
+}
+
+
+bool ConnectionPool::queueSessionReset(Connection* connection, size_t slot) {
+    std::lock_guard<std::mutex> lock(m_resetMutex);
+    if (m_resetStopping) {
+        return false;
+    }
+    if (m_resetting == connection ||
+        std::find_if(m_resetQueue.begin(), m_resetQueue.end(),
+                     [connection](const std::pair<Connection*, size_t>& entry) {
+                         return entry.first == connection;
+                     }) != m_resetQueue.end()) {
+        LOG_WARNING("Attempted to release a connection that is not in use, connectionId: " + connection->getConnectionId());
+        return true;
+    }
+    m_resetQueue.emplace_back(connection, slot);
+    m_resetCondition.notify_one();
+    return true;
+}
+
+
+void ConnectionPool::sessionResetWorker() {
+    std::unique_lock<std::mutex> lock(m_resetMutex);
+    for (;;) {
+        m_resetCondition.wait(lock, [this]() {
+            return m_resetStopping || !m_resetQueue.empty();
+        });
+        if (m_resetQueue.empty()) {
+            break;
+        }
+        std::pair<Connection*, size_t> entry = m_resetQueue.front();
+        m_resetQueue.pop_front();
+        m_resetting = entry.first;
+        lock.unlock();
+
+        // after shutdown the connection is only dropped, there is no point in cleaning it up
+        if (m_isRunning) {
+            SessionResetPolicy reset = sessionResetNeeded(*entry.first);
+            if (reset != SessionResetPolicy::NONE) {
+                entry.first->resetSession(reset == SessionResetPolicy::RESET);
+            }
+        }
+        // the usage time recorded here includes the cleanup, the connection was not available meanwhile
+        recycleConnection(entry.first, entry.second, true);
+
+        lock.lock();
+        m_resetting = nullptr;
+    }
+}
+
+
+const std::shared_ptr<ConnectionPool::ThreadCacheSlot>& ConnectionPool::threadCacheEntry(bool create) {
+    // one entry per pool the thread has returned connections to or written through, usually a single one
+    static thread_local std::vector<std::pair<uint64_t, std::shared_ptr<ThreadCacheSlot>>> slots;
+    static const std::shared_ptr<ThreadCacheSlot> none;
+    for (const auto& entry : slots) {
+        if (entry.first == m_instanceId) {
+            return entry.second;
+        }
+    }
+    if (!create) {
+        return none;
+    }
+    slots.erase(std::remove_if(slots.begin(), slots.end(),
+                               [](const std::pair<uint64_t, std::shared_ptr<ThreadCacheSlot>>& entry) {
+                                   return entry.second->retired.load();
+                               }),
+                slots.end());
+    auto slot = std::make_shared<ThreadCacheSlot>();
+    {
+        std::lock_guard<std::mutex> lock(m_threadCacheMutex);
+        m_threadCaches.push_back(slot);
+    }
+    slots.emplace_back(m_instanceId, std::move(slot));
+    return slots.back().second;
+}
+
+
+bool ConnectionPool::parkInThreadCache(Connection* connection) {
+    // a waiting thread gets the connection right away; one that needs cleanup, one over the
+    // limit after a shrink and one of a draining backend take the normal path
+    if (!m_isRunning || m_waiters.load() > 0 || !connection->isInUse() || !connection->isOpen() ||
+        m_totalConnections.load() > m_liveConfig.get().maxConnections ||
+        sessionResetNeeded(*connection) != SessionResetPolicy::NONE || connection->hasActiveStream()) {
+        return false;
+    }
+    const BackendPoolTable& table = m_backendPools.get();
+    auto it = table.byId.find(connection->getBackendId());
+    if (it == table.byId.end() || it->second->isDraining()) {
+        return false;
+    }
+    ThreadCacheSlot* slot = threadCacheSlot(true);
+    Connection* kept = slot->connection.load();
+    if (kept == connection) {
+        LOG_WARNING("Attempted to release a connection that is not in use, connectionId: " + connection->getConnectionId());
+        return true;
+    }
+    if (kept != nullptr) {
+        // the thread already keeps one
+        return false;
+    }
+    m_monitor->recordConnectionReleased(Utils::currentTimeMicros() - connection->getBorrowedTime());
+    connection->updateLastActiveTime();
+    slot->parkedMillis = Utils::currentTimeMillis();
+    slot->backendId = connection->getBackendId();
+    slot->connection = connection;
+
+    // pairs with waitForConnection() and shutdown(): a thread that queued up in the meantime
+    // may have missed this connection, so it goes back to the pool unless it was reclaimed already
+    if (m_waiters.load() > 0 || !m_isRunning) {
+        Connection* parked = connection;
+        if (slot->connection.compare_exchange_strong(parked, nullptr) && connection->markIdle()) {
+            m_activeConnections--;
+            putBackConnection(connection, connection->getPoolSlot(), true);
+        }
+    }
+    return true;
+}
+
+
+void ConnectionPool::extendReadAfterWrite(ThreadCacheSlot* slot, const Connection& connection) {
+    if (!slot || slot->lastWriteMillis == 0) {
+        return;
+    }
+    // the window of a thread that has written is counted from the end of the write
+    BackendPoolPtr pool = findBackendPool(connection.getBackendId());
+    if (pool && pool->getRole() == DBRole::PRIMARY) {
+        slot->lastWriteMillis = Utils::currentTimeMillis();
+    }
+}
+
+
+Connection* ConnectionPool::takeThreadCachedConnection(AccessMode mode) {
+    ThreadCacheSlot* slot = threadCacheSlot(false);
+    if (!slot || slot->connection.load(std::memory_order_relaxed) == nullptr) {
+        return nullptr;
+    }
+    Connection* connection = slot->connection.exchange(nullptr);
+    if (!connection) {
+        // reclaimed by the pool
+        return nullptr;
+    }
+    const BackendPoolTable& table = m_backendPools.get();
+    auto it = table.byId.find(connection->getBackendId());
+    if (it != table.byId.end() && !it->second->isDraining()) {
+        // only where the load balancer could have sent this checkout
+        DBRole role = it->second->getRole();
+        bool fits = mode == AccessMode::READ_WRITE ? role == DBRole::PRIMARY
+                                                   : role == DBRole::REPLICA || !table.hasReplicas;
+        if (fits) {
+            return connection;
+        }
+    }
+    // the thread wants another kind of connection now, this one goes back to the pool
+    if (connection->markIdle()) {
+        m_activeConnections--;
+        putBackConnection(connection, connection->getPoolSlot(), true);
+    }
+    return nullptr;
+}
+
+
+size_t ConnectionPool::reclaimThreadCaches(int64_t parkedBefore, size_t limit, uint64_t backendId) {
+    std::vector<Connection*> reclaimed;
+    {
+        std::lock_guard<std::mutex> lock(m_threadCacheMutex);
+        // with a preferred backend, the first pass only takes its connections
+        for (int pass = backendId != 0 ? 0 : 1; pass < 2 && reclaimed.size() < limit; pass++) {
+            for (const auto& slot : m_threadCaches) {
+                if (reclaimed.size() >= limit) {
+                    break;
+                }
+                // the connection is not touched before it is taken, its owner may be using it
+                Connection* connection = slot->connection.load();
+                if (!connection || slot->parkedMillis.load() > parkedBefore ||
+                    (pass == 0 && slot->backendId.load() != backendId)) {
+                    continue;
+                }
+                if (slot->connection.compare_exchange_strong(connection, nullptr)) {
+                    reclaimed.push_back(connection);
+                }
+            }
+        }
+        // a slot only the pool still holds belongs to a thread that has exited
+        m_threadCaches.erase(std::remove_if(m_threadCaches.begin(), m_threadCaches.end(),
+                                            [](const std::shared_ptr<ThreadCacheSlot>& slot) {
+                                                return slot.use_count() == 1 && !slot->connection.load();
+                                            }),
+                             m_threadCaches.end());
+    }
+    for (Connection* connection : reclaimed) {
+        if (connection->markIdle()) {
+            m_activeConnections--;
+            putBackConnection(connection, connection->getPoolSlot(), true);
+        }
+    }
+    if (!reclaimed.empty()) {
+        LOG_DEBUG("ConnectionPool::reclaimThreadCaches reclaimed " + std::to_string(reclaimed.size()) +
+                  " connections kept by threads");
+    }
+    return reclaimed.size();
+}
+
+
+StartupReport ConnectionPool::init(const PoolConfig& config) {
+    // init and shutdown never overlap, the warm-up itself runs without holding m_mutex
+    std::lock_guard<std::mutex> initLock(m_initMutex);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_isRunning) {
+            LOG_WARNING("ConnectionPool::init init connectionPool, but it is in running status");
+            StartupReport report;
+            report.ready = true;
+            return report;
+        }
+        if (!config.isValid()) {
+            throw std::runtime_error("ConnectionPool::init init connectionPool, but config is not valid");
+        }
+        m_config = config;
+        m_liveConfig.store(config);
+        m_monitor->setEnabled(config.enablePerformanceStats);
+        m_queryCache.configure(config.queryCacheMaxBytes, static_cast<int64_t>(config.queryCacheTtl) * 1000 * 1000);
+        m_tracer.configure(config.traceSampleRate, config.slowQueryThreshold);
+        // sub-pools kept from before a shutdown are empty, so their stores can be rebuilt
+        for (const auto& pool : m_backendPools.load()->pools) {
+            pool->getIdleConnections().resize(config.idleShardCount);
+            pool->getIdleConnections().setOrder(config.idleOrder);
+        }
+    }
+    syncBackendPools(true);
     try {
-        // init load balancer
-        LoadBalanceStrategy strategy = LoadBalanceStrategy::WEIGHTED;
-        // disable copy constructor
-        LoadBalancer& balancer = LoadBalancer::getInstance();
         // create connections
         size_t targetConnections = std::min(config.initConnections, config.maxConnections);
-        size_t createdConnections = 0;
-        for (size_t i = 1; i <= targetConnections; i++) {
-            try {
-                ConnectionPtr conn = createConnection();
-                if (conn) {
-                    // check if the conn is valid
-                    if (!this->validateConnection(conn, false)) {
-                        LOG_DEBUG("ConnectionPool::init creatd Connection but is valid: connectionId: " + conn->getConnectionId());
-                        conn->close();
-                    } else {
-                        // put the connection into queue
-                        m_idleConnections.push(conn);
-                        m_totalConnections++;
-                        createdConnections++;
-                    }
-                }  
-            } catch(const std::exception& e) {
-                LOG_ERROR("created Connection failed retry time " + std::to_string(i) + "error msg: " + e.what());
-            }
-        }
-
-        LOG_DEBUG("the number of created connections is: " + std::to_string(createdConnections));
+        StartupReport report = warmUp(targetConnections);
+
+        LOG_DEBUG("the number of created connections is: " + std::to_string(report.created));
 
         // throw error when no connections has been built
-        if (targetConnections > 0 && createdConnections == 0) {
+        if (targetConnections > 0 && report.created == 0) {
             LOG_ERROR("no connections has been created");
             std::string error = "no connections has been created";
             throw std::runtime_error(error);
         }
 
         // if created connections count less than minConnections, log warning.
-        if (createdConnections < m_config.minConnections) {
-            LOG_WARNING("the number of created connections is: " + std::to_string(createdConnections) + " the number is less than minConnectons: " + std::to_string(m_config.minConnections));
+        if (report.created < config.minConnections) {
+            LOG_WARNING("the number of created connections is: " + std::to_string(report.created) + " the number is less than minConnectons: " + std::to_string(config.minConnections));
+        }
+        if (!report.ready) {
+            LOG_WARNING("ConnectionPool::init not every database reached its ready target");
         }
-        // m_initialized = true;
         m_isRunning = true;
+        // start the background connection creators
+        m_factory.start(config.maxPendingConnects,
+            [this]() { return this->createRequestedConnection(); },
+            [this](const ConnectionPtr& conn) { this->onConnectionCreated(conn); });
+        {
+            std::lock_guard<std::mutex> lock(m_resetMutex);
+            m_resetStopping = false;
+        }
+        m_resetThread = std::thread([this]() {
+            this->sessionResetWorker();
+        });
         // start a health-check thread
         m_healthCheckThread = std::thread([this]() -> void {
             return this->healthCheckWorker();
         });
         // no need to detach the thread
         // healthCheckThread.detach();
-        
+        LOG_INFO("ConnectionPool::init " + report.toString());
+        return report;
     } catch (const std::exception& e) {
+        // connects still in flight are closed as soon as they finish
+        stopWarmup(true);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
         m_isRunning = false;
         // clear all created connections
-        while (!m_idleConnections.empty()) {
-            ConnectionPtr conn = m_idleConnections.front();
-            m_idleConnections.pop();
-            if (conn) {
-                conn->close();
+        // connections still borrowed from before a shutdown() stay in the slot table
+        auto table = m_backendPools.load();
+        for (const auto& pool : table->pools) {
+            pool->getIdleConnections().drain();
+        }
+        size_t stillInUse = 0;
+        std::unordered_map<uint64_t, size_t> inUseByBackend;
+        for (size_t slot = 0; slot < m_connections.size(); slot++) {
+            ConnectionPtr& conn = m_connections[slot];
+            if (!conn) {
+                continue;
+            }
+            if (conn->isInUse()) {
+                inUseByBackend[conn->getBackendId()]++;
+                stillInUse++;
+                continue;
             }
+            conn->close();
+            conn.reset();
+            m_freeSlots.push_back(slot);
+        }
+        m_totalConnections = stillInUse;
+        for (const auto& pool : table->pools) {
+            pool->resetPlaces(inUseByBackend[pool->getBackendId()]);
         }
-        m_totalConnections = 0;
         LOG_ERROR("ConnectionPool::init init connections has error, abort the process, err msg: " +  std::string(e.what()));
         throw;
     }
 }
 
 
-void ConnectionPool::initWithSingleDatabase(
+/**
+ * shared state of the warm-up threads and init
+ * 
+ * the plan (pools, tasks, readyTargets) is written before the threads start and never changes,
+ * everything else is guarded by mutex
+ */
+struct ConnectionPool::WarmupState {
+    std::mutex mutex;
+    std::condition_variable condition;
+
+    std::vector<BackendPoolPtr> pools;
+    // backend index of every planned connection, interleaved so every backend gets its first connections early
+    std::vector<size_t> tasks;
+    // number of connections a backend needs to be ready
+    std::vector<unsigned int> readyTargets;
+
+    size_t nextTask;
+    size_t finishedTasks;
+    size_t readyBackends;
+    // no new connect is started
+    bool stopped;
+    // connections that finish are closed instead of being added to the pool
+    std::atomic<bool> aborted;
+
+    bool hasDeadline;
+    std::chrono::steady_clock::time_point startTime;
+    std::chrono::steady_clock::time_point deadline;
+
+    StartupReport report;
+
+    WarmupState()
+        : nextTask(0)
+        , finishedTasks(0)
+        , readyBackends(0)
+        , stopped(false)
+        , aborted(false)
+        , hasDeadline(false) {}
+};
+
+
+namespace {
+
+CircuitBreaker::Policy breakerPolicy(const PoolConfig& config) {
+    const int64_t nanosPerMilli = 1000 * 1000;
+    CircuitBreaker::Policy policy;
+    policy.failureThreshold = config.circuitBreakerThreshold;
+    policy.openNanos = config.circuitBreakerOpenTime * nanosPerMilli;
+    policy.maxOpenNanos = config.circuitBreakerMaxOpenTime * nanosPerMilli;
+    policy.probeTimeoutNanos = config.circuitBreakerProbeTimeout * nanosPerMilli;
+    return policy;
+}
+
+int64_t millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+// split count over the backends in proportion to their weights (largest remainder),
+// every backend gets minEach connections first as long as count allows it
+std::vector<unsigned int> planWarmup(const std::vector<DBConfig>& configs, size_t count, unsigned int minEach) {
+    std::vector<unsigned int> plan(configs.size(), 0);
+    if (configs.empty() || count == 0) {
+        return plan;
+    }
+
+    size_t base = std::min<size_t>(minEach, count / configs.size());
+    for (auto& connections : plan) {
+        connections = static_cast<unsigned int>(base);
+    }
+    size_t rest = count - base * configs.size();
+
+    unsigned long long totalWeight = 0;
+    for (const auto& config : configs) {
+        totalWeight += config.weight;
+    }
+
+    std::vector<std::pair<unsigned long long, size_t>> remainders;
+    size_t assigned = 0;
+    for (size_t i = 0; i < configs.size(); i++) {
+        unsigned long long weight = totalWeight == 0 ? 1 : configs[i].weight;
+        unsigned long long share = rest * weight;
+        unsigned long long divisor = totalWeight == 0 ? configs.size() : totalWeight;
+        plan[i] += static_cast<unsigned int>(share / divisor);
+        assigned += static_cast<size_t>(share / divisor);
+        remainders.emplace_back(share % divisor, i);
+    }
+    std::stable_sort(remainders.begin(), remainders.end(),
+        [](const std::pair<unsigned long long, size_t>& a, const std::pair<unsigned long long, size_t>& b) {
+            return a.first > b.first;
+        });
+    for (size_t i = 0; assigned < rest; i = (i + 1) % remainders.size()) {
+        plan[remainders[i].second]++;
+        assigned++;
+    }
+    return plan;
+}
+
+} // namespace
+
+
+StartupReport ConnectionPool::warmUp(size_t targetConnections) {
+    std::shared_ptr<const PoolConfig> config = m_liveConfig.load();
+    auto state = std::make_shared<WarmupState>();
+    state->startTime = std::chrono::steady_clock::now();
+    state->report.requested = static_cast<unsigned int>(targetConnections);
+    if (targetConnections == 0) {
+        state->report.ready = true;
+        return state->report;
+    }
+
+    for (const auto& pool : m_backendPools.load()->pools) {
+        if (!pool->isDraining()) {
+            state->pools.push_back(pool);
+        }
+    }
+    if (state->pools.empty()) {
+        throw std::runtime_error("ConnectionPool::init no database has been added to the load balancer");
+    }
+
+    std::vector<DBConfig> configs;
+    for (const auto& pool : state->pools) {
+        configs.push_back(pool->getBackend()->config);
+    }
+    std::vector<unsigned int> plan = planWarmup(configs, targetConnections, config->minReadyPerBackend);
+    // a backend never gets more than its own maximum, the rest goes to the backends with room
+    size_t spare = 0;
+    for (size_t i = 0; i < plan.size(); i++) {
+        unsigned int limit = state->pools[i]->getMaxConnections();
+        if (plan[i] > limit) {
+            spare += plan[i] - limit;
+            plan[i] = limit;
+        }
+    }
+    bool hasRoom = true;
+    while (spare > 0 && hasRoom) {
+        hasRoom = false;
+        for (size_t i = 0; i < plan.size() && spare > 0; i++) {
+            if (plan[i] < state->pools[i]->getMaxConnections()) {
+                plan[i]++;
+                spare--;
+                hasRoom = true;
+            }
+        }
+    }
+    unsigned int rounds = 0;
+    for (size_t i = 0; i < configs.size(); i++) {
+        BackendStartupStats stats;
+        stats.backend = configs[i].getConnectionString();
+        stats.requested = plan[i];
+        unsigned int readyTarget = config->minReadyPerBackend > 0 ?
+            std::min(config->minReadyPerBackend, plan[i]) : plan[i];
+        if (readyTarget == 0) {
+            stats.readyMs = 0;
+            state->readyBackends++;
+        }
+        state->readyTargets.push_back(readyTarget);
+        state->report.backends.push_back(stats);
+        rounds = std::max(rounds, plan[i]);
+    }
+    for (unsigned int round = 0; round < rounds; round++) {
+        for (size_t i = 0; i < plan.size(); i++) {
+            if (plan[i] > round) {
+                state->tasks.push_back(i);
+            }
+        }
+    }
+    if (config->warmupTimeout > 0) {
+        state->hasDeadline = true;
+        state->deadline = state->startTime + std::chrono::milliseconds(config->warmupTimeout);
+    }
+
+    m_warmupState = state;
+    size_t threadCount = std::min<size_t>(config->warmupConcurrency, state->tasks.size());
+    for (size_t i = 0; i < threadCount; i++) {
+        m_warmupThreads.emplace_back([this, state]() {
+            this->warmupWorker(state);
+        });
+    }
+    LOG_DEBUG("ConnectionPool::init warm up " + std::to_string(targetConnections) + " connections over " +
+              std::to_string(state->pools.size()) + " databases with " + std::to_string(threadCount) + " threads");
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    auto finished = [&state]() {
+        return state->finishedTasks == state->tasks.size() ||
+               state->readyBackends == state->report.backends.size();
+    };
+    if (state->hasDeadline) {
+        if (!state->condition.wait_until(lock, state->deadline, finished)) {
+            // whatever is not ready is left to the health check and to on-demand creation
+            state->stopped = true;
+            state->report.timedOut = true;
+        }
+    } else {
+        state->condition.wait(lock, finished);
+    }
+
+    StartupReport report = state->report;
+    report.ready = state->readyBackends == state->report.backends.size();
+    report.backgroundConnections = static_cast<unsigned int>(
+        (state->stopped ? state->nextTask : state->tasks.size()) - state->finishedTasks);
+    report.elapsedMs = millisecondsSince(state->startTime);
+    bool allDone = report.backgroundConnections == 0;
+    lock.unlock();
+
+    if (allDone) {
+        // the threads are exiting, join them now instead of in shutdown()
+        stopWarmup(false);
+    }
+    return report;
+}
+
+
+void ConnectionPool::warmupWorker(const std::shared_ptr<WarmupState>& state) {
+    while (true) {
+        size_t backendIndex = 0;
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (state->stopped || state->nextTask >= state->tasks.size()) {
+                return;
+            }
+            if (state->hasDeadline && std::chrono::steady_clock::now() >= state->deadline) {
+                return;
+            }
+            backendIndex = state->tasks[state->nextTask++];
+        }
+
+        auto connectStart = std::chrono::steady_clock::now();
+        BackendPool& pool = *state->pools[backendIndex];
+        ConnectionPtr conn;
+        std::string error;
+        if (!tryReserveConnection(pool)) {
+            error = "the pool reached maxConnections";
+        } else {
+            try {
+                conn = createConnection(*pool.getBackend());
+            } catch (const std::exception& e) {
+                releasePlace(&pool);
+                error = e.what();
+            }
+        }
+        int64_t connectTime = millisecondsSince(connectStart);
+
+        if (conn) {
+            bool added = false;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (!state->aborted && !pool.isDraining()) {
+                    registerConnection(conn);
+                    pool.getIdleConnections().push(conn.get());
+                    added = true;
+                }
+            }
+            if (added) {
+                // init may have returned already, someone could be waiting for it
+                notifyWaiter(pool);
+            } else {
+                releasePlace(&pool);
+                conn->close();
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            BackendStartupStats& stats = state->report.backends[backendIndex];
+            int64_t sinceStart = millisecondsSince(state->startTime);
+            stats.totalConnectMs += connectTime;
+            stats.maxConnectMs = std::max(stats.maxConnectMs, connectTime);
+            if (conn) {
+                stats.created++;
+                state->report.created++;
+                if (stats.firstReadyMs < 0) {
+                    stats.firstReadyMs = sinceStart;
+                }
+                if (stats.readyMs < 0 && stats.created >= state->readyTargets[backendIndex]) {
+                    stats.readyMs = sinceStart;
+                    state->readyBackends++;
+                }
+            } else {
+                stats.failed++;
+                state->report.failed++;
+                stats.lastError = error;
+            }
+            state->finishedTasks++;
+        }
+        state->condition.notify_all();
+    }
+}
+
+
+void ConnectionPool::stopWarmup(bool abort) {
+    std::shared_ptr<WarmupState> state = m_warmupState;
+    if (state) {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->stopped = true;
+        if (abort) {
+            state->aborted = true;
+        }
+    }
+    // waits for connects already in flight
+    for (auto& thread : m_warmupThreads) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    m_warmupThreads.clear();
+    m_warmupState.reset();
+}
+
+
+StartupReport ConnectionPool::initWithSingleDatabase(
     const PoolConfig& poolConfig,
     const std::string& host, 
     const std::string& user,
@@ -358,26 +1399,26 @@ void ConnectionPool::initWithSingleDatabase(
     unsigned int port, 
     unsigned int weight) {
     LOG_INFO("initWithSingleDatabase called");
-    LoadBalancer::getInstance().initSingleDatabase(host, user, password, database, port, weight);
+    m_loadBalancer->initSingleDatabase(host, user, password, database, port, weight);
     LOG_DEBUG("initSingleDatabase before called");
-    init(poolConfig);
+    return init(poolConfig);
 }
 
 
-void ConnectionPool::initWithMultipleDatabases(
+StartupReport ConnectionPool::initWithMultipleDatabases(
     const PoolConfig& poolConfig,
     const std::vector<DBConfig>& databases,
     LoadBalanceStrategy strategy) {
     
-    LoadBalancer::getInstance().init(databases, strategy);
+    m_loadBalancer->init(databases, strategy);
 
-    init(poolConfig);
+    return init(poolConfig);
 }
 
 
 std::string ConnectionPool::getLoadBalancerStatus() const {
     try {
-        return LoadBalancer::getInstance().getStatus();
+        return m_loadBalancer->getStatus();
     } catch (const std::exception& e) {
         return "Failed to get load balancer status: " + std::string(e.what());
     }
@@ -386,7 +1427,7 @@ std::string ConnectionPool::getLoadBalancerStatus() const {
 
 void ConnectionPool::setLoadBalanceStrategy(LoadBalanceStrategy strategy) {
     try {
-        LoadBalancer::getInstance().setStrategy(strategy);
+        m_loadBalancer->setStrategy(strategy);
         LOG_INFO("Load balance strategy changed to: " + strategyToString(strategy));
     } catch (const std::exception& e) {
         LOG_ERROR("Failed to change load balance strategy: " + std::string(e.what()));
@@ -397,7 +1438,7 @@ void ConnectionPool::setLoadBalanceStrategy(LoadBalanceStrategy strategy) {
 
 LoadBalanceStrategy ConnectionPool::getLoadBalanceStrategy() const {
     try {
-        return LoadBalancer::getInstance().getStrategy();
+        return m_loadBalancer->getStrategy();
     } catch (const std::exception& e) {
         LOG_WARNING("Failed to get load balance strategy: " + std::string(e.what()));
         return LoadBalanceStrategy::WEIGHTED;  // 返回默认值
@@ -406,26 +1447,104 @@ LoadBalanceStrategy ConnectionPool::getLoadBalanceStrategy() const {
 
 
 void ConnectionPool::healthCheckWorker() {
-    
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_autoscaler.reset();
+    m_lastScaleMetrics = PoolMetrics();
+    m_autoscaleTarget = 0;
+    auto now = std::chrono::steady_clock::now();
+    auto nextHealthCheck = now + std::chrono::milliseconds(m_config.healthCheckPeriod);
+    auto nextIdleCheck = nextHealthCheck;
+    auto nextAutoscale = now + std::chrono::milliseconds(m_config.autoScaleInterval);
+    auto nextCacheSweep = now + std::chrono::milliseconds(std::max(1u, m_config.threadCacheIdleTimeout));
+
     while(m_isRunning) {
+        auto wakeUp = std::min(nextHealthCheck, nextIdleCheck);
+        if (m_config.autoScaling) {
+            wakeUp = std::min(wakeUp, nextAutoscale);
+        }
+        if (m_config.threadLocalCache) {
+            wakeUp = std::min(wakeUp, nextCacheSweep);
+        }
+        // adjustConfiguration() and shutdown() notify, so a new period or autoScaling takes effect right away
+        m_healthCondition.wait_until(lock, wakeUp);
+        if (!m_isRunning) {
+            return;
+        }
+        // the config is only written under m_mutex, work on a copy without holding it
+        PoolConfig config = m_config;
+        lock.unlock();
+        now = std::chrono::steady_clock::now();
         try {
-            // sleep
-            std::this_thread::sleep_for(std::chrono::microseconds(m_config.healthCheckPeriod));
-            if (!m_isRunning) {
-                return;
+            if (!config.autoScaling) {
+                m_autoscaler.reset();
+                m_autoscaleTarget = 0;
+            } else if (now >= nextAutoscale) {
+                autoscale(config);
+                nextAutoscale = now + std::chrono::milliseconds(config.autoScaleInterval);
+            }
+            if (now >= nextIdleCheck) {
+                nextIdleCheck = now + std::chrono::milliseconds(checkIdleConnectionsStep(config));
+            }
+            if (config.threadLocalCache && now >= nextCacheSweep) {
+                // a thread that has not come back for its connection does not keep it from the others;
+                // sweeping twice per timeout keeps a connection at most 1.5 timeouts
+                reclaimThreadCaches(Utils::currentTimeMillis() - config.threadCacheIdleTimeout);
+                nextCacheSweep = now + std::chrono::milliseconds(std::max(1u, config.threadCacheIdleTimeout / 2));
+            }
+            if (now >= nextHealthCheck) {
+                LOG_INFO("ConnectionPool::healthCheckWorker perform health check");
+                // picks up backend changes without traffic and drops drained sub-pools
+                syncBackendPools(true);
+                if (!config.threadLocalCache) {
+                    // nothing is parked, this only drops the slots of exited threads
+                    reclaimThreadCaches(INT64_MIN);
+                }
+                ensureMinimumConnections();
+                LOG_INFO("ConnectionPool::healthCheckWorker health check completed");
+                nextHealthCheck = now + std::chrono::milliseconds(config.healthCheckPeriod);
             }
-            LOG_INFO("ConnectionPool::healthCheckWorker perform health check");
-            cleanupIdleConnections();
-            ensureMinimumConnections();
-            LOG_INFO("ConnectionPool::healthCheckWorker health check completed");
-
         } catch(std::exception& e) {
             LOG_ERROR("Error in health check worker: " + std::string(e.what()));
         }
+        lock.lock();
+        // a shorter period set in the meantime
+        nextHealthCheck = std::min(nextHealthCheck, now + std::chrono::milliseconds(m_config.healthCheckPeriod));
+        nextIdleCheck = std::min(nextIdleCheck, now + std::chrono::milliseconds(m_config.healthCheckPeriod));
+        nextAutoscale = std::min(nextAutoscale, now + std::chrono::milliseconds(m_config.autoScaleInterval));
+        nextCacheSweep = std::min(nextCacheSweep,
+                                  now + std::chrono::milliseconds(std::max(1u, m_config.threadCacheIdleTimeout)));
+    }
+}
+
+
+void ConnectionPool::autoscale(const PoolConfig& config) {
+    PoolMetrics current = getMetrics();
+    AutoscaleSample sample = AutoscaleSample::between(m_lastScaleMetrics, current, Utils::currentTimeMicros());
+    m_lastScaleMetrics = std::move(current);
+
+    size_t target = m_autoscaler.update(AutoscalePolicy::fromConfig(config), sample);
+    m_autoscaleTarget = target;
+    size_t total = m_totalConnections.load();
+    if (target > total) {
+        // created by the factory in the background, checkouts arriving meanwhile find them ready
+        size_t requested = requestConnections(target - total);
+        LOG_DEBUG("ConnectionPool::autoscale grow to " + std::to_string(target) + ", requested: " +
+                  std::to_string(requested) + ", forecast: " + std::to_string(m_autoscaler.getForecastRate()) + "/s");
+    } else if (target < total) {
+        std::vector<ConnectionPtr> removed;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            removed = shrinkPoolToSize(static_cast<unsigned int>(target), true);
+        }
+        for (auto& conn : removed) {
+            conn->close();
+        }
+        LOG_DEBUG("ConnectionPool::autoscale shrink to " + std::to_string(target) + ", closed: " +
+                  std::to_string(removed.size()));
     }
 }
 
-bool ConnectionPool::validateConnection(ConnectionPtr connection, bool allowReconnect) {
+bool ConnectionPool::validateConnection(Connection* connection, bool allowReconnect) {
 
     if (!connection) {
         LOG_INFO("ConnectionPool::validateConnection conn is nullptr");
@@ -433,7 +1552,7 @@ bool ConnectionPool::validateConnection(ConnectionPtr connection, bool allowReco
     }
 
     if (connection->isValid(allowReconnect)) {
-        LOG_INFO("ConnectionPool::validateConnection conn: " + connection->getConnectionId() + " is valid");
+        LOG_DEBUG("ConnectionPool::validateConnection conn: " + connection->getConnectionId() + " is valid");
         return true;
     }
     LOG_INFO("ConnectionPool::validateConnection conn: " + connection->getConnectionId() + " is not valid");
@@ -441,76 +1560,510 @@ bool ConnectionPool::validateConnection(ConnectionPtr connection, bool allowReco
 }
 
 
-void ConnectionPool::ensureMinimumConnections() {
+bool ConnectionPool::needsValidationOnBorrow(const Connection* connection) const {
+    const PoolConfig& config = m_liveConfig.get();
+    switch (config.validationPolicy) {
+        case ValidationPolicy::ALWAYS:
+            return true;
+        case ValidationPolicy::IDLE_TIMEOUT:
+            return connection->getIdleTime() > static_cast<int64_t>(config.validationIdleThreshold);
+        case ValidationPolicy::NEVER:
+        case ValidationPolicy::BACKGROUND:
+        default:
+            return false;
+    }
+}
+
+
+void ConnectionPool::registerConnection(const ConnectionPtr& connection) {
+    size_t slot;
+    if (!m_freeSlots.empty()) {
+        slot = m_freeSlots.back();
+        m_freeSlots.pop_back();
+        m_connections[slot] = connection;
+    } else {
+        slot = m_connections.size();
+        m_connections.push_back(connection);
+    }
+    connection->setPoolSlot(slot);
+}
+
+
+ConnectionPtr ConnectionPool::unregisterConnection(Connection* connection, size_t slot) {
+    if (slot >= m_connections.size() || m_connections[slot].get() != connection) {
+        // not owned by the slot table, e.g. the pool has been shut down
+        return nullptr;
+    }
+    ConnectionPtr owned = std::move(m_connections[slot]);
+    m_freeSlots.push_back(slot);
+    return owned;
+}
+
+
+bool ConnectionPool::tryReserveConnection(BackendPool& pool) {
+    if (!pool.tryReservePlace()) {
+        return false;
+    }
+    size_t limit = m_liveConfig.get().maxConnections;
+    size_t current = m_totalConnections.load();
+    while (current < limit) {
+        if (m_totalConnections.compare_exchange_weak(current, current + 1)) {
+            return true;
+        }
+    }
+    pool.releasePlace();
+    return false;
+}
+
+
+bool ConnectionPool::tryRetireConnection(BackendPool& pool, size_t limit) {
+    size_t current = m_totalConnections.load();
+    while (current > limit) {
+        if (m_totalConnections.compare_exchange_weak(current, current - 1)) {
+            pool.releasePlace();
+            return true;
+        }
+    }
+    return false;
+}
+
+
+void ConnectionPool::releasePlace(BackendPool* pool) {
+    m_totalConnections--;
+    if (pool) {
+        pool->releasePlace();
+    }
+}
+
+
+size_t ConnectionPool::requestConnections(const BackendPoolPtr& pool, size_t count) {
+    size_t requested = 0;
+    // a backend behind an open or half-open circuit gets one connect at a time, not a burst
+    if (!pool->getBackend()->stats->getBreaker().isClosed()) {
+        count = std::min<size_t>(count, 1);
+    }
+    for (size_t i = 0; i < count; i++) {
+        // pending connections hold a reserved place, so maxConnections is never exceeded
+        if (!tryReserveConnection(*pool)) {
+            break;
+        }
+        m_pendingConnections++;
+        pool->addPending();
+        {
+            std::lock_guard<std::mutex> lock(m_createMutex);
+            m_createQueue.push_back(pool);
+        }
+        if (m_factory.request(1) == 0) {
+            // factory is stopped, take the request back
+            {
+                std::lock_guard<std::mutex> lock(m_createMutex);
+                auto it = std::find(m_createQueue.rbegin(), m_createQueue.rend(), pool);
+                if (it != m_createQueue.rend()) {
+                    m_createQueue.erase(std::next(it).base());
+                }
+            }
+            m_pendingConnections--;
+            pool->finishPending();
+            releasePlace(pool.get());
+            break;
+        }
+        requested++;
+    }
+    if (requested > 0) {
+        LOG_DEBUG("ConnectionPool::requestConnections requested connections: " + std::to_string(requested));
+    }
+    return requested;
+}
+
+
+size_t ConnectionPool::requestConnections(size_t count) {
+    size_t requested = 0;
+    for (size_t i = 0; i < count; i++) {
+        BackendPoolPtr pool;
+        try {
+            pool = selectBackendPool(AccessMode::READ_WRITE, true);
+        } catch (const std::exception& e) {
+            LOG_WARNING("ConnectionPool::requestConnections no database available: " + std::string(e.what()));
+            break;
+        }
+        if (!pool->canGrow()) {
+            pool = findGrowableBackendPool(pool.get());
+        }
+        if (!pool || requestConnections(pool, 1) == 0) {
+            break;
+        }
+        requested++;
+    }
+    return requested;
+}
+
+
+void ConnectionPool::growToLowWaterMark() {
+    size_t lowWaterMark = m_liveConfig.get().lowWaterMark;
+    if (lowWaterMark == 0) {
+        return;
+    }
+    size_t available = getIdleCount() + m_pendingConnections.load();
+    if (available < lowWaterMark) {
+        requestConnections(lowWaterMark - available);
+    }
+}
+
+
+void ConnectionPool::onConnectionCreated(const ConnectionPtr& connection) {
+    m_pendingConnections--;
+    if (!connection) {
+        // the backend's place has been given back by createRequestedConnection
+        m_totalConnections--;
+        m_monitor->recordConnectionFailed();
+        // let a waiter retry instead of sleeping until its timeout
+        notifyCapacityReleased();
+        return;
+    }
+
+    BackendPoolPtr pool = findBackendPool(connection->getBackendId());
+    if (pool) {
+        pool->finishPending();
+    }
+    if (!m_isRunning || !pool || pool->isDraining()) {
+        releasePlace(pool.get());
+        connection->close();
+        notifyCapacityReleased();
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        registerConnection(connection);
+    }
+    addIdleConnection(*pool, connection.get());
+    LOG_DEBUG("ConnectionPool::onConnectionCreated created connection: " + connection->getConnectionId());
+}
+
+
+void ConnectionPool::addIdleConnection(BackendPool& pool, Connection* connection, bool oldest) {
+    if (oldest) {
+        pool.getIdleConnections().pushOldest(connection);
+    } else {
+        pool.getIdleConnections().push(connection);
+    }
+    notifyWaiter(pool);
+}
+
+
+void ConnectionPool::destroyConnection(Connection* connection, size_t slot) {
+    ConnectionPtr owned;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        owned = unregisterConnection(connection, slot);
+    }
+    // close outside the lock, mysql_close sends COM_QUIT to the server
+    connection->close();
+}
+
+
+void ConnectionPool::notifyWaiter(BackendPool& pool) {
+    if (m_waiters.load() == 0) {
+        return;
+    }
+    // waiters check the idle store while holding m_mutex, so dispatching under it avoids lost wakeups
     std::lock_guard<std::mutex> lock(m_mutex);
-    LOG_INFO("ConnectionPool::ensureMinimumConnections called. current totalConnections: " + std::to_string(m_totalConnections) + " minConnections: " + std::to_string(m_config.minConnections));
-    int successCount = 0;
-    if (m_totalConnections < m_config.minConnections) { 
-        size_t neededCreationCount = m_config.minConnections - m_totalConnections;
-        LOG_INFO("ConnectionPool::ensureMinimumConnections need to create more connections: " + std::to_string(neededCreationCount));
-        for (size_t i = 1; i <= neededCreationCount; i++) {
-            ConnectionPtr conn = createConnection();
-            // check if it is a valid conn
-            if (validateConnection(conn, false)) {
-                m_idleConnections.push(conn);
-                m_totalConnections++;
-                successCount++;
-                LOG_INFO("ConnectionPool::ensureMinimumConnections created connection: " + conn->getConnectionId() + " success.");
-            } else {
-                conn->close();
-                LOG_INFO("ConnectionPool::ensureMinimumConnections created connection: " + conn->getConnectionId() + " is not valid.");
+    dispatchIdleConnectionsLocked(pool);
+}
+
+
+void ConnectionPool::dispatchIdleConnectionsLocked(BackendPool& pool) {
+    if (!m_isRunning || pool.isDraining()) {
+        return;
+    }
+    // hand off in queue order instead of letting the woken threads race for the connections
+    WaitQueue& queue = pool.getWaitQueue();
+    while (!queue.empty()) {
+        Connection* conn = pool.getIdleConnections().pop();
+        if (!conn && !pool.canGrow()) {
+            conn = stealIdleConnection(&pool);
+        }
+        if (!conn) {
+            return;
+        }
+        queue.handOff(conn);
+    }
+    // nobody waits for this backend, a waiter whose backend is full may take the connection
+    for (const auto& other : m_backendPools.get().pools) {
+        if (other.get() == &pool || other->getRole() != pool.getRole() || other->canGrow() || other->isDraining()) {
+            continue;
+        }
+        WaitQueue& otherQueue = other->getWaitQueue();
+        while (!otherQueue.empty()) {
+            Connection* conn = pool.getIdleConnections().pop();
+            if (!conn) {
+                return;
+            }
+            otherQueue.handOff(conn);
+        }
+    }
+}
+
+
+void ConnectionPool::notifyCapacityReleased() {
+    if (m_waiters.load() == 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto& pool : m_backendPools.get().pools) {
+        pool->getWaitQueue().wakeFront();
+    }
+}
+
+
+BackendPoolPtr ConnectionPool::selectBackendPool(AccessMode mode, bool anyRole) {
+    LoadBalancer& balancer = *m_loadBalancer;
+    for (int attempt = 0; ; attempt++) {
+        if (m_backendPools.get().balancerVersion != balancer.getVersion()) {
+            syncBackendPools();
+        }
+        BackendPtr backend = anyRole ? balancer.selectBackend() : balancer.selectBackend(mode);
+        const BackendPoolTable& table = m_backendPools.get();
+        auto it = table.byId.find(backend->id);
+        if (it != table.byId.end() && !it->second->isDraining()) {
+            return it->second;
+        }
+        // the backend set changed between the version check and the selection
+        if (attempt >= 3) {
+            throw std::runtime_error("ConnectionPool::selectBackendPool no sub-pool for database " +
+                                     backend->config.getConnectionString());
+        }
+        syncBackendPools(true);
+    }
+}
+
+
+BackendPoolPtr ConnectionPool::findBackendPool(uint64_t backendId) {
+    // a copy, a drained sub-pool may leave the table while the caller still uses it
+    const BackendPoolTable& table = m_backendPools.get();
+    auto it = table.byId.find(backendId);
+    return it == table.byId.end() ? nullptr : it->second;
+}
+
+
+void ConnectionPool::syncBackendPools(bool force) {
+    std::vector<ConnectionPtr> closing;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        closing = syncBackendPoolsLocked(force);
+    }
+    for (auto& conn : closing) {
+        conn->close();
+    }
+    if (!closing.empty()) {
+        notifyCapacityReleased();
+    }
+}
+
+
+std::vector<ConnectionPtr> ConnectionPool::syncBackendPoolsLocked(bool force) {
+    std::vector<ConnectionPtr> closing;
+    LoadBalancer& balancer = *m_loadBalancer;
+    // read the version first, a change in between only causes another sync
+    uint64_t version = balancer.getVersion();
+    auto current = m_backendPools.load();
+    if (!force && current->balancerVersion == version) {
+        return closing;
+    }
+
+    BackendPoolTable next;
+    next.balancerVersion = version;
+    for (const auto& backend : balancer.getBackends()) {
+        BackendPoolPtr pool;
+        auto it = current->byId.find(backend->id);
+        if (it != current->byId.end()) {
+            pool = it->second;
+            // a new weight or new limits, the connections stay
+            pool->setBackend(backend);
+        } else {
+            pool = std::make_shared<BackendPool>(backend, m_config.idleShardCount, m_config.idleOrder);
+            LOG_INFO("ConnectionPool::syncBackendPools add sub-pool for " + backend->config.getConnectionString());
+        }
+        pool->updateLimits(m_config.maxConnections);
+        backend->stats->getBreaker().configure(breakerPolicy(m_config));
+        next.pools.push_back(pool);
+        next.byId[backend->id] = pool;
+        if (pool->getRole() == DBRole::REPLICA) {
+            next.hasReplicas = true;
+        }
+    }
+
+    for (const auto& pool : current->pools) {
+        if (next.byId.count(pool->getBackendId())) {
+            continue;
+        }
+        if (!pool->isDraining()) {
+            // no new checkouts or connects; borrowed connections are closed when they come back
+            pool->startDraining();
+            pool->getWaitQueue().wakeAll();
+            LOG_INFO("ConnectionPool::syncBackendPools drain sub-pool of " +
+                     pool->getBackend()->config.getConnectionString());
+        }
+        for (Connection* conn : pool->getIdleConnections().drain()) {
+            ConnectionPtr owned = unregisterConnection(conn, conn->getPoolSlot());
+            releasePlace(pool.get());
+            if (owned) {
+                closing.push_back(std::move(owned));
             }
         }
+        // the returns of borrowed and pending connections still need to find the sub-pool
+        if (pool->getTotalCount() > 0) {
+            next.pools.push_back(pool);
+            next.byId[pool->getBackendId()] = pool;
+        }
+    }
+    m_backendPools.store(std::move(next));
+    return closing;
+}
+
+
+Connection* ConnectionPool::stealIdleConnection(const BackendPool* exclude) {
+    for (const auto& pool : m_backendPools.get().pools) {
+        // a read-write checkout must not end up on a replica, reads stay off the primaries
+        // skip backends with their own waiters, they get their idle connections first
+        if (pool.get() == exclude || pool->getRole() != exclude->getRole() || pool->isDraining() ||
+            pool->getWaiters().load() > 0) {
+            continue;
+        }
+        Connection* conn = pool->getIdleConnections().pop();
+        if (conn) {
+            return conn;
+        }
+    }
+    return nullptr;
+}
+
+
+BackendPoolPtr ConnectionPool::findGrowableBackendPool(const BackendPool* exclude) {
+    for (const auto& pool : m_backendPools.get().pools) {
+        if (pool.get() != exclude && pool->getRole() == exclude->getRole() && pool->canGrow()) {
+            return pool;
+        }
+    }
+    return nullptr;
+}
+
+
+void ConnectionPool::ensureMinimumConnections() {
+    size_t minConnections = m_liveConfig.get().minConnections;
+    LOG_INFO("ConnectionPool::ensureMinimumConnections called. current totalConnections: " + std::to_string(m_totalConnections) + " minConnections: " + std::to_string(minConnections));
+    size_t requested = 0;
+    // the connections are created by the factory threads, the health check does not wait for them
+    // every backend gets its own minimum first
+    auto table = m_backendPools.load();
+    for (const auto& pool : table->pools) {
+        size_t total = pool->getTotalCount();
+        if (!pool->isDraining() && total < pool->getMinConnections()) {
+            requested += requestConnections(pool, pool->getMinConnections() - total);
+        }
     }
-    LOG_INFO("ConnectionPool::ensureMinimumConnections successfully created: " + std::to_string(successCount) + " connections");
+    size_t total = m_totalConnections.load();
+    if (total < minConnections) {
+        requested += requestConnections(minConnections - total);
+    }
+    LOG_INFO("ConnectionPool::ensureMinimumConnections requested: " + std::to_string(requested) + " connections");
     return;
 }
 
 void ConnectionPool::cleanupIdleConnections() {
-    std::lock_guard<std::mutex> lock(m_mutex);
     LOG_INFO("ConnectionPool::cleanupIdleConnections called");
+    PoolConfig config;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        config = m_config;
+    }
+    // everything not used or checked since now, the connections checked here are not taken again
+    int64_t sweepStart = Utils::currentTimeMillis();
+    size_t checked = 0;
+    auto table = m_backendPools.load();
+    for (const auto& pool : table->pools) {
+        while (size_t taken = checkIdleConnections(config, *pool, sweepStart)) {
+            checked += taken;
+        }
+    }
+    LOG_INFO("ConnectionPool::cleanupIdleConnections checked " + std::to_string(checked) + " connections, " +
+             std::to_string(getIdleCount()) + " are idle");
+}
 
-    LOG_INFO("ConnectionPool::cleanupIdleConnections before the cleanup stage, current pool has: " + std::to_string(m_idleConnections.size()) + "connections" );
-    std::queue<ConnectionPtr> keepConnections;
-    
-    int64_t now = Utils::currentTimeMillis();
-
-    while(!m_idleConnections.empty()) {
-        ConnectionPtr conn = m_idleConnections.front();
-        // popup the conn
-        m_idleConnections.pop();
-        bool isValid = conn->isValidQuietly();
-        // the reason the pool discard the conn
-        std::string reason;
-        // check if it is a died connection
-        if (isValid) {
-            // check if it is outdated
-            int64_t lastActiveTime = conn->getLastActiveTime();
-            //auto nowTime = std::chrono::steady_clock::now();
-            int64_t idelTime = now - lastActiveTime;
-
-            if (idelTime <= static_cast<int64_t>(m_config.maxIdleTime)) {
-                keepConnections.push(conn);
-                LOG_INFO("ConnectionPool::cleanupIdleConnections conn is kept, connId: " + conn->getConnectionId()); 
-                continue;
-            } else {
-                // is outdated, but current connection pool does not have enough connections. push back the connection to the pool
-                if (m_totalConnections < m_config.minConnections) {
-                    keepConnections.push(conn);
-                    LOG_INFO("ConnectionPool::cleanupIdleConnections conn is kept, connId: " + conn->getConnectionId()); 
+
+int64_t ConnectionPool::checkIdleConnectionsStep(const PoolConfig& config) {
+    int64_t dueBefore = Utils::currentTimeMillis() - static_cast<int64_t>(config.healthCheckPeriod);
+    size_t largest = 0;
+    auto table = m_backendPools.load();
+    for (const auto& pool : table->pools) {
+        checkIdleConnections(config, *pool, dueBefore);
+        largest = std::max(largest, pool->getIdleConnections().size());
+    }
+    // a batch per backend and step: the largest backend needs this many steps per period
+    size_t steps = std::max<size_t>(1, (largest + config.healthCheckBatchSize - 1) / config.healthCheckBatchSize);
+    return std::max<int64_t>(1, static_cast<int64_t>(config.healthCheckPeriod / steps));
+}
+
+
+size_t ConnectionPool::checkIdleConnections(const PoolConfig& config, BackendPool& pool, int64_t dueBefore) {
+    // only the taken connections are unavailable meanwhile, checkouts keep using the others
+    std::vector<Connection*> candidates = pool.getIdleConnections().takeOldest(config.healthCheckBatchSize,
+        [dueBefore](const Connection* conn) {
+            return std::max(conn->getLastActiveTime(), conn->getLastCheckedTime()) < dueBefore;
+        });
+    if (candidates.empty()) {
+        return 0;
+    }
+
+    // the candidates not handled yet go back to the store if anything below throws
+    size_t handled = 0;
+    try {
+        // check if they are died connections, a slow backend only delays its own batch
+        bool needPing = config.validationPolicy != ValidationPolicy::NEVER;
+        std::vector<char> alive(candidates.size(), 0);
+        auto check = [&candidates, &alive, needPing](size_t index) {
+            alive[index] = needPing ? candidates[index]->isValidQuietly() : candidates[index]->isOpen();
+        };
+        if (needPing) {
+            m_pingers.run(candidates.size(), config.healthCheckConcurrency, check);
+        } else {
+            for (size_t i = 0; i < candidates.size(); i++) {
+                check(i);
+            }
+        }
+
+        // connections the autoscaler keeps for the expected demand are not idle-trimmed
+        size_t minimum = std::max<size_t>(config.minConnections, m_autoscaleTarget.load());
+        int64_t now = Utils::currentTimeMillis();
+        for (size_t i = 0; i < candidates.size(); i++) {
+            Connection* conn = candidates[i];
+            handled = i + 1;
+            if (alive[i]) {
+                // check if it is outdated
+                int64_t idelTime = now - conn->getLastActiveTime();
+                // is outdated, but the pool or the backend does not have enough connections. push back the connection to the pool
+                if (idelTime <= static_cast<int64_t>(config.maxIdleTime) ||
+                    pool.getTotalCount() <= pool.getMinConnections() ||
+                    !tryRetireConnection(pool, minimum)) {
+                    conn->markChecked();
+                    addIdleConnection(pool, conn, true);
                     continue;
                 }
-            } 
+            } else {
+                releasePlace(&pool);
+            }
+            // discard the conn
+            LOG_INFO("ConnectionPool::checkIdleConnections conn is cleaned up, connId: " + conn->getConnectionId());
+            destroyConnection(conn, conn->getPoolSlot());
+            notifyCapacityReleased();
         }
-        // discard the conn
-        conn->close();
-        m_totalConnections--;
-        LOG_INFO("ConnectionPool::cleanupIdleConnections conn is cleaned up, connId: " + conn->getConnectionId());        
+    } catch (...) {
+        for (size_t i = handled; i < candidates.size(); i++) {
+            addIdleConnection(pool, candidates[i], true);
+        }
+        throw;
     }
-
-    m_idleConnections = std::move(keepConnections);
-    LOG_INFO("ConnectionPool::cleanupIdleConnections after the cleanup stage, current pool has: " + std::to_string(m_idleConnections.size()) + "connections" );
-    return;
+    return candidates.size();
 }
 
 
@@ -523,6 +2076,7 @@ void ConnectionPool::performHealthCheck() {
     LOG_INFO("Manual health check triggered");
     
     try {
+        syncBackendPools(true);
         cleanupIdleConnections();
         ensureMinimumConnections();
         LOG_INFO("Manual health check completed successfully");
@@ -534,51 +2088,94 @@ void ConnectionPool::performHealthCheck() {
 
 
 
-void ConnectionPool::shrinkPoolToSize(unsigned int targetSize) {
+std::vector<ConnectionPtr> ConnectionPool::shrinkPoolToSize(unsigned int targetSize, bool keepBackendMinimum) {
     
     LOG_INFO("ConnectionPool::shrinkPoolToSize targetSize: " + std::to_string(targetSize)); 
-    
+    std::vector<ConnectionPtr> removed;
+
     if (!m_isRunning) {
-        return;
+        return removed;
     }
 
     if (m_totalConnections <= targetSize) {
-        return;
+        return removed;
     }
 
     size_t needToRemoveCount = m_totalConnections - targetSize;
     LOG_INFO("ConnectionPool::shrinkPoolToSize needToRemoveCount: " + std::to_string(needToRemoveCount)); 
 
     size_t removedCount = 0;
-    // remove the connection from the idelPool
-    while(m_idleConnections.size() > 0 && m_totalConnections > targetSize) {
-        ConnectionPtr conn = m_idleConnections.front();
-        conn->close();
-        m_totalConnections--;
-        m_idleConnections.pop();
-        removedCount++;
+    // remove idle connections from every backend in turn
+    auto table = m_backendPools.load();
+    bool progress = true;
+    while(m_totalConnections > targetSize && progress) {
+        progress = false;
+        for (const auto& pool : table->pools) {
+            if (m_totalConnections <= targetSize) {
+                break;
+            }
+            if (keepBackendMinimum && pool->getTotalCount() <= pool->getMinConnections()) {
+                continue;
+            }
+            Connection* conn = pool->getIdleConnections().pop();
+            if (!conn) {
+                continue;
+            }
+            // the caller closes the removed connections after releasing the lock
+            ConnectionPtr owned = unregisterConnection(conn, conn->getPoolSlot());
+            if (owned) {
+                removed.push_back(owned);
+            }
+            releasePlace(pool.get());
+            removedCount++;
+            progress = true;
+        }
     }
     LOG_INFO("ConnectionPool::shrinkPoolToSize removed connections count: " + std::to_string(removedCount));
-    return;
+    return removed;
 }
 
 bool ConnectionPool::adjustConfiguration(const PoolConfig& newConfig) {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    LOG_INFO("ConnectionPool::adjustConfiguration called");
-    PoolConfig& oldConfig = m_config;
-    try {
-        m_config = newConfig;
-        if (m_totalConnections > newConfig.maxConnections) {
-            shrinkPoolToSize(newConfig.maxConnections);
+    std::vector<ConnectionPtr> removed;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        LOG_INFO("ConnectionPool::adjustConfiguration called");
+        PoolConfig oldConfig = m_config;
+        try {
+            m_config = newConfig;
+            m_liveConfig.store(newConfig);
+            m_monitor->setEnabled(newConfig.enablePerformanceStats);
+            m_queryCache.configure(newConfig.queryCacheMaxBytes,
+                                   static_cast<int64_t>(newConfig.queryCacheTtl) * 1000 * 1000);
+            m_tracer.configure(newConfig.traceSampleRate, newConfig.slowQueryThreshold);
+            for (const auto& pool : m_backendPools.load()->pools) {
+                pool->getIdleConnections().setOrder(newConfig.idleOrder);
+                pool->updateLimits(newConfig.maxConnections);
+            }
+            if (m_totalConnections > newConfig.maxConnections) {
+                removed = shrinkPoolToSize(newConfig.maxConnections);
+            }
+            m_healthCondition.notify_all();
+            // Only perform shrink operation, healthChcek thread is responsbile for creating more connections to meet the mini threshold
+            LOG_INFO("ConnectionPool::adjustConfiguration adjust successfully");
+        } catch(std::exception& e) {
+            m_config = oldConfig;
+            m_liveConfig.store(oldConfig);
+            m_monitor->setEnabled(oldConfig.enablePerformanceStats);
+            m_queryCache.configure(oldConfig.queryCacheMaxBytes,
+                                   static_cast<int64_t>(oldConfig.queryCacheTtl) * 1000 * 1000);
+            m_tracer.configure(oldConfig.traceSampleRate, oldConfig.slowQueryThreshold);
+            LOG_ERROR("ConnectionPool::adjustConfiguration has error: roll back" + std::string(e.what()));
+            return false;
         }
-        // Only perform shrink operation, healthChcek thread is responsbile for creating more connections to meet the mini threshold
-        LOG_INFO("ConnectionPool::adjustConfiguration adjust successfully");
-        return true;
-    } catch(std::exception& e) {
-        m_config = oldConfig;
-        LOG_ERROR("ConnectionPool::adjustConfiguration has error: roll back" + std::string(e.what()));
-        return false;
     }
+    for (auto& conn : removed) {
+        conn->close();
+    }
+    if (!newConfig.threadLocalCache) {
+        reclaimThreadCaches(INT64_MAX);
+    }
+    return true;
 }
 
 bool ConnectionPool::setConnectionLimits(unsigned int minConnections, unsigned int maxConnections) {
@@ -588,7 +2185,7 @@ bool ConnectionPool::setConnectionLimits(unsigned int minConnections, unsigned i
         return false;
     }
 
-    PoolConfig config = m_config;
+    PoolConfig config = getConfig();
     config.minConnections = minConnections;
     config.maxConnections = maxConnections;
     LOG_INFO("ConnectionPool::setConnectionLimits minConnections: " + std::to_string(minConnections) + " maxConnections: " + std::to_string(maxConnections));
@@ -600,7 +2197,7 @@ bool ConnectionPool::setTimeoutSettings(unsigned int connectionTimeout, unsigned
         LOG_ERROR("Invalid timeout settings: values cannot be zero");
         return false;
     }
-    PoolConfig config = m_config;
+    PoolConfig config = getConfig();
     config.connectionTimeout = connectionTimeout;
     config.maxIdleTime = maxIdleTime;
     config.healthCheckPeriod = healthCheckPeriod;
@@ -609,6 +2206,53 @@ bool ConnectionPool::setTimeoutSettings(unsigned int connectionTimeout, unsigned
 
 
 
+PoolMetrics ConnectionPool::getMetrics() const {
+    PoolMetrics metrics;
+    metrics.pool = m_name;
+    metrics.timestampMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    metrics.running = m_isRunning.load();
+    metrics.totalConnections = m_totalConnections.load();
+    metrics.activeConnections = m_activeConnections.load();
+    metrics.waiters = m_waiters.load();
+    metrics.pendingConnections = m_pendingConnections.load();
+    metrics.targetConnections = m_autoscaleTarget.load();
+
+    metrics.stats = m_monitor->getStats();
+    metrics.acquireLatency = m_monitor->getLatencySnapshot(LatencyMetric::CONNECTION_ACQUIRE);
+    metrics.usageLatency = m_monitor->getLatencySnapshot(LatencyMetric::CONNECTION_USAGE);
+    metrics.queryLatency = m_monitor->getLatencySnapshot(LatencyMetric::QUERY_EXECUTION);
+    metrics.connectLatency = m_monitor->getLatencySnapshot(LatencyMetric::CONNECT);
+    metrics.queueWaitLatency = m_monitor->getLatencySnapshot(LatencyMetric::QUEUE_WAIT);
+
+    int64_t now = BackendStats::nowNanos();
+    for (const auto& pool : m_backendPools.load()->pools) {
+        BackendPtr backend = pool->getBackend();
+        BackendMetrics entry;
+        entry.id = backend->id;
+        entry.host = backend->config.host;
+        entry.port = backend->config.port;
+        entry.role = pool->getRole();
+        entry.weight = backend->config.weight;
+        entry.totalConnections = pool->getTotalCount();
+        entry.idleConnections = pool->getIdleConnections().size();
+        entry.pendingConnections = pool->getPendingCount();
+        entry.waiters = pool->getWaiters().load();
+        entry.maxConnections = pool->getMaxConnections();
+        entry.draining = pool->isDraining();
+        if (backend->stats) {
+            entry.inFlight = backend->stats->getInFlight();
+            entry.ewmaLatencyMs = backend->stats->getEwmaNanos(now) / 1e6;
+            entry.latencySamples = backend->stats->getSampleCount();
+            entry.circuitState = backend->stats->getBreaker().getState();
+            entry.circuitOpenCount = backend->stats->getBreaker().getOpenCount();
+        }
+        metrics.idleConnections += entry.idleConnections;
+        metrics.backends.push_back(std::move(entry));
+    }
+    return metrics;
+}
+
 std::string ConnectionPool::getDetailedStatus() const {
     std::lock_guard<std::mutex> lock(m_mutex);
 
@@ -617,8 +2261,8 @@ std::string ConnectionPool::getDetailedStatus() const {
     ss << "Pool State:\n";
     ss << "  Running: " << (m_isRunning ? "Yes" : "No") << "\n";
     ss << "  Total Connections: " << m_totalConnections.load() << "\n";
-    ss << "  Idle Connections: " << m_idleConnections.size() << "\n";
-    ss << "  Active Connections: " << m_activeConnections.size() << "\n";
+    ss << "  Idle Connections: " << getIdleCount() << "\n";
+    ss << "  Active Connections: " << m_activeConnections.load() << "\n";
     
     ss << "Configuration:\n";
     ss << "  Min Connections: " << m_config.minConnections << "\n";
@@ -629,16 +2273,42 @@ std::string ConnectionPool::getDetailedStatus() const {
     
     ss << "Health Status:\n";
     ss << "  Pool Utilization: " << std::fixed << std::setprecision(1)
-       << (double)m_activeConnections.size() / m_config.maxConnections * 100 << "%\n";
+       << (double)m_activeConnections.load() / m_config.maxConnections * 100 << "%\n";
     
-    if (!m_activeConnections.empty()) {
+    if (m_activeConnections.load() > 0) {
         ss << "Active Connections:\n";
-        for (const auto& pair : m_activeConnections) {
-            ss << "  [" << pair.first << "] - Active since: " 
-               << pair.second->getLastActiveTime() << "\n";
+        for (const auto& conn : m_connections) {
+            if (conn && conn->isInUse()) {
+                ss << "  [" << conn->getConnectionId() << "] - Active since: " 
+                   << conn->getLastActiveTime() << "\n";
+            }
         }
     }
     
     ss << "=======================================";
     return ss.str();
-}
\ No newline at end of file
+}
+
+
+PooledConnectionDeleter::PooledConnectionDeleter()
+    : m_pool(nullptr)
+    , m_slot(0) {
+}
+
+
+PooledConnectionDeleter::PooledConnectionDeleter(ConnectionPool* pool, size_t slot)
+    : m_pool(pool)
+    , m_slot(slot) {
+}
+
+
+void PooledConnectionDeleter::operator()(Connection* connection) const {
+    if (connection && m_pool) {
+        m_pool->returnConnection(connection, m_slot);
+    }
+}
+
+
+size_t PooledConnectionDeleter::getSlot() const {
+    return m_slot;
+}
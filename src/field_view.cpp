@@ -0,0 +1,217 @@
+#include "field_view.h"
+#include "utils.h"
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+namespace {
+
+// powers of ten that are exact doubles
+const double EXACT_POWERS_OF_TEN[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+const int MAX_EXACT_POWER = 22;
+// integers up to 2^53 are exact doubles
+const uint64_t MAX_EXACT_MANTISSA = 1ULL << 53;
+// 19 decimal digits always fit in uint64_t
+const int MAX_MANTISSA_DIGITS = 19;
+
+bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+// parse [p, end) as digits only, false if empty, not a digit or above ULLONG_MAX
+bool parseDigits(const char* p, const char* end, unsigned long long& value) {
+    if (p == end) {
+        return false;
+    }
+    unsigned long long result = 0;
+    for (; p != end; ++p) {
+        if (!isDigit(*p)) {
+            return false;
+        }
+        unsigned int digit = static_cast<unsigned int>(*p - '0');
+        if (result > (ULLONG_MAX - digit) / 10) {
+            return false;
+        }
+        result = result * 10 + digit;
+    }
+    value = result;
+    return true;
+}
+
+// strtod under the C locale, the server always sends '.' as decimal point
+bool parseDoubleSlow(const char* data, size_t size, double& value) {
+    locale_t cLocale = Utils::cNumericLocale();
+
+    // the view is not necessarily NUL-terminated
+    char small[64];
+    std::vector<char> large;
+    char* buffer = small;
+    if (size >= sizeof(small)) {
+        large.resize(size + 1);
+        buffer = large.data();
+    }
+    std::memcpy(buffer, data, size);
+    buffer[size] = '\0';
+
+    char* parsedEnd = nullptr;
+    double result = cLocale ? strtod_l(buffer, &parsedEnd, cLocale) : std::strtod(buffer, &parsedEnd);
+    // overflow gives HUGE_VAL, which is out of range rather than a value
+    if (parsedEnd != buffer + size || std::isinf(result)) {
+        return false;
+    }
+    value = result;
+    return true;
+}
+
+} // namespace
+
+
+bool FieldView::toUnsignedLong(unsigned long long& value) const {
+    if (!m_data) {
+        return false;
+    }
+    const char* p = m_data;
+    if (p != end() && *p == '+') {
+        ++p;
+    }
+    return parseDigits(p, end(), value);
+}
+
+
+bool FieldView::toLong(long long& value) const {
+    if (!m_data || m_size == 0) {
+        return false;
+    }
+    const char* p = m_data;
+    bool negative = false;
+    if (*p == '-' || *p == '+') {
+        negative = *p == '-';
+        ++p;
+    }
+    unsigned long long magnitude = 0;
+    if (!parseDigits(p, end(), magnitude)) {
+        return false;
+    }
+    const unsigned long long limit = static_cast<unsigned long long>(LLONG_MAX);
+    if (negative) {
+        if (magnitude > limit + 1) {
+            return false;
+        }
+        // -(LLONG_MAX + 1) cannot be negated as a long long
+        value = magnitude == limit + 1 ? LLONG_MIN : -static_cast<long long>(magnitude);
+    } else {
+        if (magnitude > limit) {
+            return false;
+        }
+        value = static_cast<long long>(magnitude);
+    }
+    return true;
+}
+
+
+bool FieldView::toInt(int& value) const {
+    long long result = 0;
+    if (!toLong(result) || result < INT_MIN || result > INT_MAX) {
+        return false;
+    }
+    value = static_cast<int>(result);
+    return true;
+}
+
+
+bool FieldView::toDouble(double& value) const {
+    if (!m_data || m_size == 0) {
+        return false;
+    }
+
+    // decompose into mantissa * 10^exponent
+    const char* p = m_data;
+    const char* last = end();
+    bool negative = false;
+    if (*p == '-' || *p == '+') {
+        negative = *p == '-';
+        ++p;
+    }
+
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    bool anyDigit = false;
+    bool truncated = false;
+
+    for (; p != last && isDigit(*p); ++p) {
+        anyDigit = true;
+        unsigned int digit = static_cast<unsigned int>(*p - '0');
+        if (digits < MAX_MANTISSA_DIGITS) {
+            mantissa = mantissa * 10 + digit;
+            if (mantissa != 0) {
+                digits++;
+            }
+        } else {
+            exponent++;
+            truncated = truncated || digit != 0;
+        }
+    }
+    if (p != last && *p == '.') {
+        ++p;
+        for (; p != last && isDigit(*p); ++p) {
+            anyDigit = true;
+            unsigned int digit = static_cast<unsigned int>(*p - '0');
+            if (digits < MAX_MANTISSA_DIGITS) {
+                mantissa = mantissa * 10 + digit;
+                if (mantissa != 0) {
+                    digits++;
+                }
+                exponent--;
+            } else {
+                truncated = truncated || digit != 0;
+            }
+        }
+    }
+    if (!anyDigit) {
+        // the server never sends inf or nan
+        return false;
+    }
+    if (p != last && (*p == 'e' || *p == 'E')) {
+        ++p;
+        bool negativeExponent = false;
+        if (p != last && (*p == '-' || *p == '+')) {
+            negativeExponent = *p == '-';
+            ++p;
+        }
+        if (p == last) {
+            return false;
+        }
+        int written = 0;
+        for (; p != last && isDigit(*p); ++p) {
+            // anything this large is 0 or infinity anyway, strtod decides
+            if (written < 100000) {
+                written = written * 10 + (*p - '0');
+            }
+        }
+        exponent += negativeExponent ? -written : written;
+    }
+    if (p != last) {
+        return false;
+    }
+
+    // Clinger's fast path: an exact mantissa times or divided by an exact power of ten
+    // is correctly rounded by a single IEEE operation
+    if (!truncated && mantissa <= MAX_EXACT_MANTISSA &&
+        exponent >= -MAX_EXACT_POWER && exponent <= MAX_EXACT_POWER) {
+        double result = static_cast<double>(mantissa);
+        if (exponent < 0) {
+            result /= EXACT_POWERS_OF_TEN[-exponent];
+        } else {
+            result *= EXACT_POWERS_OF_TEN[exponent];
+        }
+        value = negative ? -result : result;
+        return true;
+    }
+    return parseDoubleSlow(m_data, m_size, value);
+}
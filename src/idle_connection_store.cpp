@@ -0,0 +1,173 @@
+#include "idle_connection_store.h"
+#include <thread>
+#include <algorithm>
+#include "utils.h"
+
+IdleConnectionStore::IdleConnectionStore(size_t shardCount, IdleOrder order)
+    : m_shardCount(0)
+    , m_size(0)
+    , m_order(order) {
+    resize(shardCount);
+}
+
+
+size_t IdleConnectionStore::defaultShardCount() {
+    size_t cores = std::thread::hardware_concurrency();
+    // hardware_concurrency may return 0 when it is not computable
+    return std::max<size_t>(1, std::min<size_t>(cores, 64));
+}
+
+
+void IdleConnectionStore::resize(size_t shardCount) {
+    if (shardCount == 0) {
+        shardCount = defaultShardCount();
+    }
+    m_shards.reset(new Shard[shardCount]);
+    m_shardCount = shardCount;
+    m_size.store(0, std::memory_order_relaxed);
+}
+
+
+void IdleConnectionStore::setOrder(IdleOrder order) {
+    m_order.store(order, std::memory_order_relaxed);
+}
+
+
+IdleOrder IdleConnectionStore::getOrder() const {
+    return m_order.load(std::memory_order_relaxed);
+}
+
+
+void IdleConnectionStore::push(Connection* connection) {
+    if (!connection) {
+        return;
+    }
+    Shard& shard = m_shards[Utils::currentThreadIndex() % m_shardCount];
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.connections.push_back(connection);
+        shard.count.fetch_add(1, std::memory_order_relaxed);
+        // inside the lock like the decrements, so m_size never drops below the connections stored
+        m_size.fetch_add(1, std::memory_order_seq_cst);
+    }
+}
+
+
+Connection* IdleConnectionStore::pop() {
+    if (m_size.load(std::memory_order_seq_cst) == 0) {
+        return nullptr;
+    }
+
+    size_t local = Utils::currentThreadIndex() % m_shardCount;
+    Connection* connection = popFromShard(m_shards[local], false);
+    if (connection) {
+        return connection;
+    }
+
+    // local shard is empty, steal from the others
+    for (size_t i = 1; i < m_shardCount; i++) {
+        Shard& victim = m_shards[(local + i) % m_shardCount];
+        // skip empty shards without touching their locks
+        if (victim.count.load(std::memory_order_relaxed) == 0) {
+            continue;
+        }
+        connection = popFromShard(victim, true);
+        if (connection) {
+            return connection;
+        }
+    }
+    return nullptr;
+}
+
+
+Connection* IdleConnectionStore::popFromShard(Shard& shard, bool steal) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (shard.connections.empty()) {
+        return nullptr;
+    }
+
+    Connection* connection = nullptr;
+    if (steal || m_order.load(std::memory_order_relaxed) == IdleOrder::FIFO) {
+        connection = shard.connections.front();
+        shard.connections.pop_front();
+    } else {
+        connection = shard.connections.back();
+        shard.connections.pop_back();
+    }
+    shard.count.fetch_sub(1, std::memory_order_relaxed);
+    m_size.fetch_sub(1, std::memory_order_seq_cst);
+    return connection;
+}
+
+
+std::vector<Connection*> IdleConnectionStore::drain() {
+    std::vector<Connection*> connections;
+    for (size_t i = 0; i < m_shardCount; i++) {
+        Shard& shard = m_shards[i];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        connections.insert(connections.end(), shard.connections.begin(), shard.connections.end());
+        m_size.fetch_sub(shard.connections.size(), std::memory_order_seq_cst);
+        shard.connections.clear();
+        shard.count.store(0, std::memory_order_relaxed);
+    }
+    return connections;
+}
+
+
+std::vector<Connection*> IdleConnectionStore::takeOldest(size_t maxCount,
+                                                        const std::function<bool(const Connection*)>& predicate) {
+    std::vector<Connection*> connections;
+    bool progress = true;
+    while (connections.size() < maxCount && progress) {
+        progress = false;
+        // one connection per shard and round
+        for (size_t i = 0; i < m_shardCount && connections.size() < maxCount; i++) {
+            Shard& shard = m_shards[i];
+            if (shard.count.load(std::memory_order_relaxed) == 0) {
+                continue;
+            }
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            auto it = std::find_if(shard.connections.begin(), shard.connections.end(), predicate);
+            if (it == shard.connections.end()) {
+                continue;
+            }
+            connections.push_back(*it);
+            shard.connections.erase(it);
+            shard.count.fetch_sub(1, std::memory_order_relaxed);
+            m_size.fetch_sub(1, std::memory_order_seq_cst);
+            progress = true;
+        }
+    }
+    return connections;
+}
+
+
+void IdleConnectionStore::pushOldest(Connection* connection) {
+    if (!connection) {
+        return;
+    }
+    Shard& shard = m_shards[Utils::currentThreadIndex() % m_shardCount];
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.connections.push_front(connection);
+        shard.count.fetch_add(1, std::memory_order_relaxed);
+        // see push()
+        m_size.fetch_add(1, std::memory_order_seq_cst);
+    }
+}
+
+
+size_t IdleConnectionStore::size() const {
+    // seq_cst pairs with the waiter counter in ConnectionPool, so a push never misses a sleeping waiter
+    return m_size.load(std::memory_order_seq_cst);
+}
+
+
+bool IdleConnectionStore::empty() const {
+    return size() == 0;
+}
+
+
+size_t IdleConnectionStore::getShardCount() const {
+    return m_shardCount;
+}
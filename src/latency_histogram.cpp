@@ -0,0 +1,103 @@
+#include "latency_histogram.h"
+#include <algorithm>
+#include <cmath>
+
+
+const unsigned HistogramLayout::SUB_BUCKET_BITS;
+const uint64_t HistogramLayout::SUB_BUCKETS;
+const unsigned HistogramLayout::MAX_EXPONENT;
+const size_t HistogramLayout::BUCKET_COUNT;
+const size_t LatencyHistogram::SHARD_COUNT;
+
+
+HistogramSnapshot::HistogramSnapshot()
+    : m_buckets(HistogramLayout::BUCKET_COUNT, 0)
+    , m_count(0)
+    , m_sum(0)
+    , m_max(0) {
+}
+
+
+uint64_t HistogramSnapshot::getPercentile(double percentile) const {
+    if (m_count == 0) {
+        return 0;
+    }
+    percentile = std::min(std::max(percentile, 0.0), 100.0);
+    // rank of the value, 1-based: P50 of 10 values is the 5th, P100 the 10th
+    uint64_t rank = static_cast<uint64_t>(std::ceil(percentile / 100.0 * m_count));
+    rank = std::max<uint64_t>(rank, 1);
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < m_buckets.size(); i++) {
+        seen += m_buckets[i];
+        if (seen >= rank) {
+            return std::min(HistogramLayout::bucketUpperBound(i), m_max);
+        }
+    }
+    return m_max;
+}
+
+
+void HistogramSnapshot::merge(const HistogramSnapshot& other) {
+    for (size_t i = 0; i < m_buckets.size(); i++) {
+        m_buckets[i] += other.m_buckets[i];
+    }
+    m_count += other.m_count;
+    m_sum += other.m_sum;
+    m_max = std::max(m_max, other.m_max);
+}
+
+
+HistogramSnapshot HistogramSnapshot::since(const HistogramSnapshot& earlier) const {
+    HistogramSnapshot delta;
+    size_t highest = 0;
+    for (size_t i = 0; i < m_buckets.size(); i++) {
+        // a reset in between makes the counters go backwards, the interval then starts at the reset
+        uint64_t before = earlier.m_buckets[i] <= m_buckets[i] ? earlier.m_buckets[i] : 0;
+        delta.m_buckets[i] = m_buckets[i] - before;
+        delta.m_count += delta.m_buckets[i];
+        if (delta.m_buckets[i] > 0) {
+            highest = i;
+        }
+    }
+    delta.m_sum = m_sum >= earlier.m_sum ? m_sum - earlier.m_sum : m_sum;
+    // the exact maximum of the interval is not known, the bucket bound is within 6.25%
+    if (delta.m_count > 0) {
+        delta.m_max = std::min(HistogramLayout::bucketUpperBound(highest), m_max);
+    }
+    return delta;
+}
+
+
+LatencyHistogram::LatencyHistogram()
+    : m_shards(new Shard[SHARD_COUNT]) {
+    reset();
+}
+
+
+HistogramSnapshot LatencyHistogram::snapshot() const {
+    HistogramSnapshot result;
+    for (size_t s = 0; s < SHARD_COUNT; s++) {
+        const Shard& shard = m_shards[s];
+        for (size_t i = 0; i < HistogramLayout::BUCKET_COUNT; i++) {
+            uint64_t count = shard.buckets[i].load(std::memory_order_relaxed);
+            result.m_buckets[i] += count;
+            result.m_count += count;
+        }
+        result.m_sum += shard.sum.load(std::memory_order_relaxed);
+        result.m_max = std::max(result.m_max, shard.max.load(std::memory_order_relaxed));
+    }
+    return result;
+}
+
+
+void LatencyHistogram::reset() {
+    for (size_t s = 0; s < SHARD_COUNT; s++) {
+        Shard& shard = m_shards[s];
+        for (size_t i = 0; i < HistogramLayout::BUCKET_COUNT; i++) {
+            shard.buckets[i].store(0, std::memory_order_relaxed);
+        }
+        shard.sum.store(0, std::memory_order_relaxed);
+        shard.max.store(0, std::memory_order_relaxed);
+    }
+}
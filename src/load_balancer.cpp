@@ -1,38 +1,68 @@
 #include "load_balancer.h"
 #include <algorithm>
-#include <numeric>
 #include <sstream>
+#include <random>
 #include "logger.h"
+#include "utils.h"
 #include <stdexcept>
 
 
+namespace {
+
+// splitmix64, one state per thread so selection shares nothing between threads
+uint64_t nextRandom() {
+    static thread_local uint64_t state =
+        (static_cast<uint64_t>(std::random_device{}()) << 32) ^ Utils::currentThreadIndex();
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// map 32 random bits onto [0, n) without a division
+size_t reduce(uint32_t random, size_t n) {
+    return static_cast<size_t>((static_cast<uint64_t>(random) * n) >> 32);
+}
+
+const uint64_t ALIAS_SCALE = 1ULL << 32;
+
+std::string describe(const DBConfig& config) {
+    return config.getConnectionString() + " (weight=" + std::to_string(config.weight) + ", " +
+           roleToString(config.role) + ")";
+}
+
+} // namespace
+
+
 LoadBalancer::LoadBalancer()
     :m_strategy(LoadBalanceStrategy::WEIGHTED)
     ,m_roundRobinIndex(0)
-    ,m_rng(std::random_device{}()) {
-    
+    ,m_nextBackendId(1) {
 }
 
 void LoadBalancer::init(const std::vector<DBConfig>& configs, LoadBalanceStrategy strategy) {
-    std::lock_guard<std::mutex> lock(m_mutex);
     // check if the given configs is empty
     if (configs.empty()) {
         throw std::runtime_error("Cannot initialize load balancer with empty database configs");
     }
     // check if each config is valid
     for (size_t i = 0; i < configs.size(); i++) {
-        DBConfig config = configs[i]; 
-        if (!config.isValid()) {
+        if (!configs[i].isValid()) {
             throw std::runtime_error("config is not valid");
-            LOG_INFO("Database " + std::to_string(i) + ": " + config.user + "@" + 
-            config.host + ":" + std::to_string(config.port) + "/" + config.database + 
-            " (weight=" + std::to_string(config.weight) + ")");
         }
     }
 
-    m_configs = configs;
-    m_strategy = strategy;
-    m_roundRobinIndex = 0;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<BackendPtr> backends;
+    backends.reserve(configs.size());
+    for (size_t i = 0; i < configs.size(); i++) {
+        backends.push_back(std::make_shared<const Backend>(configs[i], m_nextBackendId++,
+                                                          std::make_shared<BackendStats>()));
+        LOG_INFO("Database " + std::to_string(i) + ": " + describe(configs[i]));
+    }
+    m_strategy.store(strategy, std::memory_order_relaxed);
+    m_roundRobinIndex.store(0, std::memory_order_relaxed);
+    publishLocked(std::move(backends));
     LOG_INFO("Load balancer initialized with strategy: " + strategyToString(strategy));
 }
 
@@ -40,7 +70,7 @@ void LoadBalancer::init(const std::vector<DBConfig>& configs, LoadBalanceStrateg
 void LoadBalancer::initSingleDatabase(const std::string& host, const std::string& user,
                                      const std::string& password, const std::string& database,
                                      unsigned int port, unsigned int weight) {
-    LOG_INFO("Initializing load balancer with single database: " + user + "@" + 
+    LOG_INFO("Initializing load balancer with single database: " + user + "@" +
              host + ":" + std::to_string(port) + "/" + database);
 
     DBConfig config(host, user, password, database, port, weight);
@@ -48,157 +78,345 @@ void LoadBalancer::initSingleDatabase(const std::string& host, const std::string
     init(configs, LoadBalanceStrategy::WEIGHTED);
 }
 
-DBConfig LoadBalancer::getNextDatabase() {
-    std::lock_guard<std::mutex> lock(m_mutex);
 
-    if (m_configs.empty()) {
+BackendPtr LoadBalancer::selectBackend() {
+    return selectFrom(m_snapshot.get().all);
+}
+
+
+BackendPtr LoadBalancer::selectBackend(AccessMode mode) {
+    const Snapshot& snapshot = m_snapshot.get();
+    if (mode == AccessMode::READ_ONLY && !snapshot.replicas.backends.empty()) {
+        BackendPtr replica = trySelectFrom(snapshot.replicas);
+        if (replica) {
+            return replica;
+        }
+        // every replica is out, the primaries serve the reads meanwhile
+    }
+    if (snapshot.primaries.backends.empty() && !snapshot.all.backends.empty()) {
+        LOG_ERROR("No primary database available for a read-write connection");
+        throw std::runtime_error("No primary database available for a read-write connection");
+    }
+    return selectFrom(snapshot.primaries);
+}
+
+
+BackendPtr LoadBalancer::selectFrom(const BackendGroup& group) {
+    if (group.backends.empty()) {
         LOG_ERROR("No database configurations available");
         throw std::runtime_error("No database configurations available");
     }
+    BackendPtr backend = trySelectFrom(group);
+    if (!backend) {
+        throw std::runtime_error("No database available: the circuit breaker of every candidate backend is open");
+    }
+    return backend;
+}
+
+
+BackendPtr LoadBalancer::trySelectFrom(const BackendGroup& group) {
+    const BackendPtr& chosen = group.backends.size() == 1 ? group.backends[0] : applyStrategy(group);
+    if (chosen->stats->getBreaker().isClosed()) {
+        return chosen;
+    }
+    return selectPassing(group, chosen);
+}
+
+
+const BackendPtr& LoadBalancer::applyStrategy(const BackendGroup& group) {
+    switch (m_strategy.load(std::memory_order_relaxed)) {
+        case LoadBalanceStrategy::RANDOM:
+            return selectRandom(group);
+        case LoadBalanceStrategy::ROUND_ROBIN:
+            return selectRoundRobin(group);
+        case LoadBalanceStrategy::LEAST_CONNECTIONS:
+            return selectLeastConnections(group);
+        case LoadBalanceStrategy::PEAK_EWMA:
+            return selectPeakEwma(group);
+        case LoadBalanceStrategy::POWER_OF_TWO:
+            return selectPowerOfTwo(group);
+        case LoadBalanceStrategy::WEIGHTED:
+        default:
+            return selectWeighted(group);
+    }
+}
 
-    LOG_INFO("LoadBalancer::getNextDatabase current strategy is " + strategyToString(m_strategy));
-    if (m_strategy == LoadBalanceStrategy::RANDOM) {
-        return selectRandom();
-    } else if (m_strategy == LoadBalanceStrategy::ROUND_ROBIN) {
-        return selectRoundRobin();
-    } else if (m_strategy == LoadBalanceStrategy::WEIGHTED) {
-        return selectWeighted();
-    } else {
-        return selectWeighted();
+
+BackendPtr LoadBalancer::selectPassing(const BackendGroup& group, const BackendPtr& chosen) {
+    // the chosen backend may be due for its probe
+    if (chosen->stats->getBreaker().tryPass()) {
+        return chosen;
+    }
+    // closed backends first, the weights no longer matter while one is out
+    size_t count = group.backends.size();
+    size_t start = static_cast<size_t>(m_roundRobinIndex.fetch_add(1, std::memory_order_relaxed) % count);
+    for (size_t i = 0; i < count; i++) {
+        const BackendPtr& backend = group.backends[(start + i) % count];
+        if (backend->stats->getBreaker().isClosed()) {
+            return backend;
+        }
     }
+    for (size_t i = 0; i < count; i++) {
+        const BackendPtr& backend = group.backends[(start + i) % count];
+        if (backend != chosen && backend->stats->getBreaker().tryPass()) {
+            return backend;
+        }
+    }
+    return nullptr;
+}
+
+
+bool LoadBalancer::hasReplicas() const {
+    return !m_snapshot.get().replicas.backends.empty();
+}
+
+
+DBConfig LoadBalancer::getNextDatabase() {
+    return selectBackend()->config;
 }
 
 
 void LoadBalancer::setStrategy(LoadBalanceStrategy strategy) {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    m_strategy = strategy;
+    m_strategy.store(strategy, std::memory_order_relaxed);
     LOG_INFO("LoadBalancer::setStrategy change strategy with: " + strategyToString(strategy));
-    
+
     if (strategy == LoadBalanceStrategy::ROUND_ROBIN) {
-         LOG_INFO("LoadBalancer::setStrategy rest round robin index to 0");
-        m_roundRobinIndex = 0;
+        LOG_INFO("LoadBalancer::setStrategy rest round robin index to 0");
+        m_roundRobinIndex.store(0, std::memory_order_relaxed);
     }
 }
 
 LoadBalanceStrategy LoadBalancer::getStrategy() const {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    return m_strategy;   
+    return m_strategy.load(std::memory_order_relaxed);
+}
+
+
+void LoadBalancer::publishLocked(std::vector<BackendPtr> backends) {
+    Snapshot snapshot;
+    std::vector<BackendPtr> primaries, replicas;
+    for (const auto& backend : backends) {
+        (backend->config.role == DBRole::REPLICA ? replicas : primaries).push_back(backend);
+    }
+    buildGroup(snapshot.primaries, std::move(primaries));
+    buildGroup(snapshot.replicas, std::move(replicas));
+    buildGroup(snapshot.all, std::move(backends));
+    m_snapshot.store(std::move(snapshot));
+}
+
+
+void LoadBalancer::buildGroup(BackendGroup& group, std::vector<BackendPtr> backends) {
+    const size_t n = backends.size();
+
+    for (const auto& backend : backends) {
+        group.totalWeight += backend->config.weight;
+    }
+
+    // Vose's alias method in integers: every weight is scaled by n so the
+    // average column holds exactly totalWeight
+    const bool uniform = group.totalWeight == 0;
+    const uint64_t columnWeight = uniform ? n : group.totalWeight;
+    std::vector<uint64_t> scaled(n);
+    std::vector<uint32_t> small, large;
+    for (size_t i = 0; i < n; i++) {
+        scaled[i] = (uniform ? 1 : static_cast<uint64_t>(backends[i]->config.weight)) * n;
+        (scaled[i] < columnWeight ? small : large).push_back(static_cast<uint32_t>(i));
+    }
+
+    group.aliasThreshold.assign(n, ALIAS_SCALE);
+    group.alias.resize(n);
+    for (size_t i = 0; i < n; i++) {
+        group.alias[i] = static_cast<uint32_t>(i);
+    }
+    while (!small.empty() && !large.empty()) {
+        uint32_t less = small.back();
+        small.pop_back();
+        uint32_t more = large.back();
+        large.pop_back();
+
+        group.aliasThreshold[less] = static_cast<uint64_t>(
+            static_cast<long double>(scaled[less]) * ALIAS_SCALE / columnWeight);
+        group.alias[less] = more;
+        // the larger weight fills the rest of the smaller one's column
+        scaled[more] = scaled[more] + scaled[less] - columnWeight;
+        (scaled[more] < columnWeight ? small : large).push_back(more);
+    }
+    // whatever is left fills its own column exactly, the threshold stays at ALIAS_SCALE
+
+    group.backends = std::move(backends);
+}
+
+
+const BackendPtr& LoadBalancer::selectRandom(const BackendGroup& group) {
+    uint32_t random = static_cast<uint32_t>(nextRandom() >> 32);
+    return group.backends[reduce(random, group.backends.size())];
+}
+
+
+const BackendPtr& LoadBalancer::selectRoundRobin(const BackendGroup& group) {
+    uint64_t index = m_roundRobinIndex.fetch_add(1, std::memory_order_relaxed);
+    return group.backends[index % group.backends.size()];
 }
 
 
-DBConfig LoadBalancer::selectRandom() {
-    LOG_INFO("LoadBalancer::selectRandom Use Random algorithm to selecte a database");
-    // generate a distribution
-    std::uniform_int_distribution<int> dist(0, m_configs.size() - 1);
-    size_t selectedIndex = dist(m_rng);
-    LOG_INFO("LoadBalancer::selectRandom select database index: " + std::to_string(selectedIndex));
-    return m_configs[selectedIndex];
+size_t LoadBalancer::weightedIndex(const BackendGroup& group) {
+    // high half picks the column, low half decides between the column and its alias
+    uint64_t random = nextRandom();
+    size_t column = reduce(static_cast<uint32_t>(random >> 32), group.backends.size());
+    uint64_t coin = random & (ALIAS_SCALE - 1);
+    if (coin < group.aliasThreshold[column]) {
+        return column;
+    }
+    return group.alias[column];
 }
 
 
-DBConfig LoadBalancer::selectRoundRobin() {
-    LOG_INFO("LoadBalancer::selectRoundRobin Use Round Robin algorithm to select a database");
-    DBConfig config = m_configs[m_roundRobinIndex];
+unsigned int LoadBalancer::effectiveWeight(const BackendGroup& group, size_t index) {
+    // with every weight at 0 the backends are treated as equal
+    return group.totalWeight == 0 ? 1 : group.backends[index]->config.weight;
+}
+
 
-    // update roundRobin index
-    m_roundRobinIndex = (m_roundRobinIndex + 1) % m_configs.size();
-    LOG_DEBUG("Round-robin algorithm selected index: " + std::to_string(m_roundRobinIndex) + 
-              "/" + std::to_string(m_configs.size()));
-    return config;
+const BackendPtr& LoadBalancer::selectWeighted(const BackendGroup& group) {
+    return group.backends[weightedIndex(group)];
 }
 
 
-DBConfig LoadBalancer::selectWeighted() {
-    LOG_INFO("LoadBalancer::selectWeighted Use weight algorithm to select a database");
-    // compute the total weights
-    int totalWeights = 0;
-    for (auto& config : m_configs) {
-        int weight = config.weight;
-        totalWeights += weight;
+const BackendPtr& LoadBalancer::selectLeastConnections(const BackendGroup& group) {
+    // the scan starts at a weighted draw, so ties are split in proportion to the weights
+    const size_t n = group.backends.size();
+    size_t best = weightedIndex(group);
+    uint64_t bestWeight = effectiveWeight(group, best);
+    int64_t bestInFlight = std::max<int64_t>(0, group.backends[best]->stats->getInFlight());
+    int64_t bestOpen = std::max<int64_t>(0, group.backends[best]->stats->getOpenConnections());
+
+    for (size_t step = 1; step < n; step++) {
+        size_t i = (best + step) % n;
+        uint64_t weight = effectiveWeight(group, i);
+        if (weight == 0) {
+            continue;
+        }
+        int64_t inFlight = std::max<int64_t>(0, group.backends[i]->stats->getInFlight());
+        int64_t open = std::max<int64_t>(0, group.backends[i]->stats->getOpenConnections());
+        // compare inFlight / weight without dividing, open connections break ties
+        uint64_t lhs = static_cast<uint64_t>(inFlight) * bestWeight;
+        uint64_t rhs = static_cast<uint64_t>(bestInFlight) * weight;
+        if (lhs < rhs || (lhs == rhs &&
+            static_cast<uint64_t>(open) * bestWeight < static_cast<uint64_t>(bestOpen) * weight)) {
+            best = i;
+            bestWeight = weight;
+            bestInFlight = inFlight;
+            bestOpen = open;
+        }
     }
-    // generate a distribution. range from [0, totalWeigths)
-    std::uniform_int_distribution<int> dist(0, totalWeights - 1);
-    // generate a random weight
-    int randomWeight = dist(m_rng);
+    return group.backends[best];
+}
+
 
-    int currentWeight = 0;
-    size_t index = 0;
-    for (auto& config : m_configs) {
-        ++index;
-        int weight = config.weight;
-        currentWeight += weight;
-        // check if the randomWeight fall in the range
-        if (randomWeight < currentWeight) {
-            LOG_INFO("LoadBalancer::selectWeighted Use weight algorithm to select a database index: " + std::to_string(index));
-            return config;
+const BackendPtr& LoadBalancer::selectPeakEwma(const BackendGroup& group) {
+    const size_t n = group.backends.size();
+    const int64_t now = BackendStats::nowNanos();
+    size_t start = weightedIndex(group);
+    size_t best = start;
+    double bestCost = group.backends[best]->stats->getPeakEwmaCost(now) / effectiveWeight(group, best);
+
+    for (size_t step = 1; step < n; step++) {
+        size_t i = (start + step) % n;
+        unsigned int weight = effectiveWeight(group, i);
+        if (weight == 0) {
+            continue;
+        }
+        double cost = group.backends[i]->stats->getPeakEwmaCost(now) / weight;
+        if (cost < bestCost) {
+            best = i;
+            bestCost = cost;
         }
     }
-    LOG_WARNING("Weighted selection algorithm fallback to first database");
-    return m_configs[0];
+    return group.backends[best];
+}
+
+
+const BackendPtr& LoadBalancer::selectPowerOfTwo(const BackendGroup& group) {
+    // the draws already follow the weights, so the costs are compared as they are
+    size_t first = weightedIndex(group);
+    size_t second = weightedIndex(group);
+    if (second == first) {
+        second = weightedIndex(group);
+    }
+    if (second == first) {
+        return group.backends[first];
+    }
+    const int64_t now = BackendStats::nowNanos();
+    double firstCost = group.backends[first]->stats->getPeakEwmaCost(now);
+    double secondCost = group.backends[second]->stats->getPeakEwmaCost(now);
+    return group.backends[secondCost < firstCost ? second : first];
 }
 
 
 
 void LoadBalancer::addDatabase(const DBConfig& config) {
+    // check if the config is valid
+    if (!config.isValid()) {
+        throw std::runtime_error("invalid config");
+    }
     std::lock_guard<std::mutex> lock(m_mutex);
+    SnapshotPtr current = m_snapshot.load();
     // check if the config is already exist
-    for (auto& existingConfig : m_configs) {
-        if (existingConfig.host == config.host && existingConfig.port == config.port) {
+    for (const auto& backend : current->all.backends) {
+        if (backend->config.host == config.host && backend->config.port == config.port) {
             LOG_WARNING("LoadBalancer::addDatabase already has the database config, host" + config.host + " port is:" + std::to_string(config.port));
             return;
         }
     }
-    // check if the config is valid
-    if (!config.isValid()) {
-        throw std::runtime_error("invalid config");
-    }
-    m_configs.push_back(config);
-    LOG_INFO("Database added: " + config.user + "@" + config.host + ":" + 
-             std::to_string(config.port) + "/" + config.database + 
-             " (weight=" + std::to_string(config.weight) + ")");
-    LOG_INFO("Total databases: " + std::to_string(m_configs.size()));
+    std::vector<BackendPtr> backends = current->all.backends;
+    backends.push_back(std::make_shared<const Backend>(config, m_nextBackendId++, std::make_shared<BackendStats>()));
+    publishLocked(std::move(backends));
+    LOG_INFO("Database added: " + describe(config));
+    LOG_INFO("Total databases: " + std::to_string(current->all.backends.size() + 1));
 }
 
 
 bool LoadBalancer::removeDatabase(const std::string& host, unsigned int port) {
     std::lock_guard<std::mutex> lock(m_mutex);
-    LOG_INFO("LoadBalancer::removeDatabase remove before configs count " + std::to_string(m_configs.size()));
-    auto it = std::remove_if(m_configs.begin(), m_configs.end(), [host, port](DBConfig existingConfig) -> bool {
-        return existingConfig.host  == host && existingConfig.port == port;
-    });
-    if (it != m_configs.end()) {
-        m_configs.erase(it, m_configs.end());
-        LOG_INFO("LoadBalancer::removeDatabase remove after configs count " + std::to_string(m_configs.size()));
-        // update round robin index
-        if (m_configs.empty()) {
-            m_roundRobinIndex = 0;
-        } else {
-            m_roundRobinIndex %= m_configs.size();
+    SnapshotPtr current = m_snapshot.load();
+    LOG_INFO("LoadBalancer::removeDatabase remove before configs count " + std::to_string(current->all.backends.size()));
+
+    std::vector<BackendPtr> backends;
+    backends.reserve(current->all.backends.size());
+    for (const auto& backend : current->all.backends) {
+        if (backend->config.host != host || backend->config.port != port) {
+            backends.push_back(backend);
         }
-        return true;
     }
-    LOG_INFO("LoadBalancer::removeDatabase no target database");
-    return false;
-    
+    if (backends.size() == current->all.backends.size()) {
+        LOG_INFO("LoadBalancer::removeDatabase no target database");
+        return false;
+    }
+    LOG_INFO("LoadBalancer::removeDatabase remove after configs count " + std::to_string(backends.size()));
+    // the round robin index is reduced modulo the new size on the next selection
+    publishLocked(std::move(backends));
+    return true;
 }
 
 
 
 bool LoadBalancer::updateWeight(const std::string& host, unsigned int port, unsigned int weight) {
     std::lock_guard<std::mutex> lock(m_mutex);
-
-    auto it = std::find_if(m_configs.begin(), m_configs.end(), [host, port](DBConfig existingConfig) -> bool {
-        return existingConfig.host  == host && existingConfig.port == port;
-    });
-
-    if (it != m_configs.end()) {
-        auto oldWeight = it->weight;
-        it->weight = weight;
-        LOG_INFO("Database weight updated: " + it->user + "@" + host + ":" + 
-                 std::to_string(port) + "/" + it->database + 
-                 " weight changed from " + std::to_string(oldWeight) + 
-                 " to " + std::to_string(weight));
-        return true;
+    SnapshotPtr current = m_snapshot.load();
+
+    std::vector<BackendPtr> backends = current->all.backends;
+    for (auto& backend : backends) {
+        if (backend->config.host == host && backend->config.port == port) {
+            unsigned int oldWeight = backend->config.weight;
+            DBConfig config = backend->config;
+            config.weight = weight;
+            // backends are immutable, keep the id and the stats so the replacement is the same backend
+            backend = std::make_shared<const Backend>(config, backend->id, backend->stats);
+            publishLocked(std::move(backends));
+            LOG_INFO("Database weight updated: " + config.getConnectionString() +
+                     " weight changed from " + std::to_string(oldWeight) +
+                     " to " + std::to_string(weight));
+            return true;
+        }
     }
     LOG_WARNING("Database not found for weight update: " + host + ":" + std::to_string(port));
     return false;
@@ -206,44 +424,62 @@ bool LoadBalancer::updateWeight(const std::string& host, unsigned int port, unsi
 
 
 size_t LoadBalancer::getDatabaseCount() const {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    return m_configs.size();
+    return m_snapshot.load()->all.backends.size();
 }
 
 
 std::vector<DBConfig> LoadBalancer::getDatabaseConfigs() const {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    return m_configs;
+    SnapshotPtr snapshot = m_snapshot.load();
+    std::vector<DBConfig> configs;
+    configs.reserve(snapshot->all.backends.size());
+    for (const auto& backend : snapshot->all.backends) {
+        configs.push_back(backend->config);
+    }
+    return configs;
+}
+
+
+std::vector<BackendPtr> LoadBalancer::getBackends() const {
+    return m_snapshot.load()->all.backends;
+}
+
+
+uint64_t LoadBalancer::getVersion() const {
+    return m_snapshot.getVersion();
 }
 
 
 std::string LoadBalancer::getStatus() const {
-    std::lock_guard<std::mutex> lock(m_mutex);
+    SnapshotPtr snapshot = m_snapshot.load();
+    LoadBalanceStrategy strategy = m_strategy.load(std::memory_order_relaxed);
+    const int64_t now = BackendStats::nowNanos();
 
     std::stringstream ss;
     ss << "LoadBalancer Status:\n";
-    ss << "  Strategy: " << strategyToString(m_strategy) << "\n";
-    ss << "  Database Count: " << m_configs.size() << "\n";
-    ss << "  Round Robin Index: " << m_roundRobinIndex << "\n";
-    
-    if (!m_configs.empty()) {
+    ss << "  Strategy: " << strategyToString(strategy) << "\n";
+    ss << "  Database Count: " << snapshot->all.backends.size() << " (primaries="
+       << snapshot->primaries.backends.size() << ", replicas=" << snapshot->replicas.backends.size() << ")\n";
+    ss << "  Round Robin Index: " << m_roundRobinIndex.load(std::memory_order_relaxed) << "\n";
+    ss << "  Snapshot Version: " << m_snapshot.getVersion() << "\n";
+
+    if (!snapshot->all.backends.empty()) {
         ss << "  Database Configurations:\n";
-        for (size_t i = 0; i < m_configs.size(); ++i) {
-            const auto& config = m_configs[i];
-            ss << "    [" << i << "] " << config.user << "@" << config.host 
-               << ":" << config.port << "/" << config.database 
-               << " (weight=" << config.weight << ")\n";
+        for (size_t i = 0; i < snapshot->all.backends.size(); ++i) {
+            const auto& config = snapshot->all.backends[i]->config;
+            const auto& stats = *snapshot->all.backends[i]->stats;
+            ss << "    [" << i << "] " << config.user << "@" << config.host
+               << ":" << config.port << "/" << config.database
+               << " (weight=" << config.weight << ", " << roleToString(config.role) << ")"
+               << " inFlight=" << stats.getInFlight()
+               << " connections=" << stats.getOpenConnections()
+               << " ewmaUs=" << static_cast<int64_t>(stats.getEwmaNanos(now) / 1000) << "\n";
         }
-        
+
         // 如果是权重策略，显示总权重
-        if (m_strategy == LoadBalanceStrategy::WEIGHTED) {
-            int totalWeight = std::accumulate(m_configs.begin(), m_configs.end(), 0,
-                [](int sum, const DBConfig& config) {
-                    return sum + config.weight;
-                });
-            ss << "  Total Weight: " << totalWeight << "\n";
+        if (strategy == LoadBalanceStrategy::WEIGHTED) {
+            ss << "  Total Weight: " << snapshot->all.totalWeight << "\n";
         }
     }
 
     return ss.str();
-}
\ No newline at end of file
+}
@@ -1,9 +1,432 @@
 #include "logger.h"
+#include <cstdio>
+#include <cstring>
+#include <vector>
 
-// 由于Logger类是头文件实现的单例模式，
-// 这个源文件为空，所有实现都在logger.h中
+namespace {
 
-// 如果未来需要添加复杂的日志功能，可以在这里实现
-// 比如：日志轮转、异步日志、网络日志发送等
+// records written per batch by the background writer
+const size_t MAX_BATCH = 256;
+// upper bound of an idle writer's sleep, a missed wakeup is never longer than this
+const std::chrono::milliseconds IDLE_WAIT(1000);
 
-// 目前保持空文件，确保编译系统正常工作
\ No newline at end of file
+int64_t currentTimeMillis() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+
+/**
+ * @brief bounded lock-free queue, many producers and the writer thread as the only consumer
+ *
+ * every slot carries a sequence number: a producer claims a position with one CAS on the
+ * enqueue index and publishes the slot by bumping its sequence, the consumer frees the slot
+ * by bumping it again by the capacity.
+ */
+class LogRingBuffer {
+public:
+    explicit LogRingBuffer(size_t capacity)
+        : m_enqueuePos(0)
+        , m_dequeuePos(0) {
+        size_t size = roundCapacity(capacity);
+        m_mask = size - 1;
+        m_slots.reset(new Slot[size]);
+        for (size_t i = 0; i < size; i++) {
+            m_slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    // moves the record in only on success
+    bool tryPush(Logger::Record& record) {
+        size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+        while (true) {
+            Slot& slot = m_slots[pos & m_mask];
+            size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    slot.record = std::move(record);
+                    slot.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                // the consumer has not freed this slot yet: full
+                return false;
+            } else {
+                pos = m_enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // single consumer only
+    bool tryPop(Logger::Record& record) {
+        size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+        Slot& slot = m_slots[pos & m_mask];
+        if (slot.sequence.load(std::memory_order_acquire) != pos + 1) {
+            return false;
+        }
+        record = std::move(slot.record);
+        slot.record.message.clear();
+        slot.sequence.store(pos + m_mask + 1, std::memory_order_release);
+        m_dequeuePos.store(pos + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    size_t capacity() const {
+        return m_mask + 1;
+    }
+
+    // the capacity is a power of two, so a position maps to a slot with a mask
+    static size_t roundCapacity(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        return size;
+    }
+
+    bool empty() const {
+        size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+        return m_slots[pos & m_mask].sequence.load(std::memory_order_acquire) != pos + 1;
+    }
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence;
+        Logger::Record record;
+    };
+
+    std::unique_ptr<Slot[]> m_slots;
+    size_t m_mask;
+    // producers and the consumer write different cache lines
+    char m_padding0[64];
+    std::atomic<size_t> m_enqueuePos;
+    char m_padding1[64];
+    std::atomic<size_t> m_dequeuePos;
+};
+
+
+Logger::Logger()
+    : m_level(static_cast<int>(LogLevel::DEBUG))
+    , m_initialized(false)
+    , m_toConsole(true)
+    , m_buffer(nullptr)
+    , m_running(false)
+    , m_writerIdle(false)
+    , m_dropWhenFull(false)
+    , m_enqueued(0)
+    , m_written(0)
+    , m_dropped(0)
+    , m_cachedSecond(-1) {
+    m_cachedTime[0] = '\0';
+}
+
+
+Logger::~Logger() {
+    std::lock_guard<std::mutex> initLock(m_initMutex);
+    stopWriter();
+}
+
+
+void Logger::init(const std::string& logFile, LogLevel level, bool toConsole, const LoggerOptions& options) {
+    std::lock_guard<std::mutex> initLock(m_initMutex);
+
+    // 之前缓冲的日志先按旧的配置写出
+    stopWriter();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_level.store(static_cast<int>(level), std::memory_order_relaxed);
+        m_toConsole = toConsole;
+        m_options = options;
+        m_dropWhenFull.store(options.dropWhenFull, std::memory_order_relaxed);
+
+        // 如果指定了日志文件，尝试打开
+        if (!logFile.empty()) {
+            if (m_fileStream.is_open()) {
+                m_fileStream.close();
+            }
+            m_fileStream.open(logFile, std::ios::app);  // 追加模式
+            if (!m_fileStream.is_open()) {
+                std::cerr << "Failed to open log file: " << logFile << std::endl;
+            }
+        }
+    }
+
+    if (options.async) {
+        startWriter();
+    }
+    m_initialized.store(true, std::memory_order_release);
+
+    // 记录初始化信息
+    std::cout << "Logger initialized, level=" + std::string(levelToString(level)) +
+             ", file=" + (logFile.empty() ? "none" : logFile) +
+             ", mode=" + (options.async ? "async" : "sync") << std::endl;
+}
+
+
+void Logger::log(LogLevel level, std::string message) {
+    // 如果未初始化，使用默认设置初始化
+    if (!m_initialized.load(std::memory_order_acquire)) {
+        init();
+    }
+
+    // 如果日志级别低于设置的级别，则忽略
+    if (!isEnabled(level)) {
+        return;
+    }
+
+    Record record;
+    record.level = level;
+    record.timestamp = currentTimeMillis();
+    record.message = std::move(message);
+
+    while (m_running.load(std::memory_order_acquire)) {
+        if (m_buffer.load(std::memory_order_acquire)->tryPush(record)) {
+            m_enqueued.fetch_add(1, std::memory_order_relaxed);
+            // pairs with the fence of the writer going idle, so one side always sees the other
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (m_writerIdle.load(std::memory_order_relaxed)) {
+                std::lock_guard<std::mutex> wakeLock(m_wakeMutex);
+                m_wakeCondition.notify_one();
+            }
+            if (level == LogLevel::FATAL) {
+                flush();
+            }
+            return;
+        }
+        // 缓冲区已满
+        if (m_dropWhenFull.load(std::memory_order_relaxed) && level < LogLevel::WARNING) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> wakeLock(m_wakeMutex);
+            m_wakeCondition.notify_one();
+        }
+        std::this_thread::yield();
+    }
+
+    // 同步模式，或者后台线程已经停止
+    std::lock_guard<std::mutex> lock(m_mutex);
+    writeRecordsLocked(&record, 1);
+    if (m_fileStream.is_open()) {
+        m_fileStream.flush();  // 立即刷新到磁盘
+    }
+}
+
+
+void Logger::flush() {
+    if (m_running.load(std::memory_order_acquire)) {
+        uint64_t target = m_enqueued.load(std::memory_order_relaxed);
+        std::unique_lock<std::mutex> wakeLock(m_wakeMutex);
+        m_wakeCondition.notify_one();
+        m_writtenCondition.wait(wakeLock, [this, target]() {
+            return m_written.load(std::memory_order_relaxed) >= target ||
+                   !m_running.load(std::memory_order_acquire);
+        });
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_fileStream.is_open()) {
+        m_fileStream.flush();
+    }
+    std::cout.flush();
+    std::cerr.flush();
+}
+
+
+void Logger::startWriter() {
+    LogRingBuffer* current = m_buffer.load(std::memory_order_relaxed);
+    if (!current || current->capacity() != LogRingBuffer::roundCapacity(m_options.bufferCapacity)) {
+        // 换下的缓冲区不释放：停止后仍可能有调用方在往里入队，它们的日志在下一次停止时写出
+        std::unique_ptr<LogRingBuffer> buffer(new LogRingBuffer(m_options.bufferCapacity));
+        m_buffer.store(buffer.get(), std::memory_order_release);
+        m_buffers.push_back(std::move(buffer));
+    }
+    m_running.store(true, std::memory_order_release);
+    m_writer = std::thread(&Logger::writerLoop, this);
+}
+
+
+void Logger::stopWriter() {
+    if (m_writer.joinable()) {
+        {
+            std::lock_guard<std::mutex> wakeLock(m_wakeMutex);
+            m_running.store(false, std::memory_order_release);
+        }
+        m_wakeCondition.notify_one();
+        m_writer.join();
+    }
+    if (m_buffers.empty()) {
+        return;
+    }
+
+    // 后台线程退出之后这里是唯一的消费者，写出停止前后入队的日志
+    std::vector<Record> rest;
+    Record record;
+    for (auto& buffer : m_buffers) {
+        while (buffer->tryPop(record)) {
+            rest.push_back(std::move(record));
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!rest.empty()) {
+            writeRecordsLocked(rest.data(), rest.size());
+        }
+        if (m_fileStream.is_open()) {
+            m_fileStream.flush();
+        }
+    }
+    m_written.fetch_add(rest.size(), std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> wakeLock(m_wakeMutex);
+    m_writtenCondition.notify_all();
+}
+
+
+void Logger::writerLoop() {
+    const std::chrono::milliseconds flushInterval(m_options.flushInterval);
+    LogRingBuffer* buffer = m_buffer.load(std::memory_order_acquire);
+    std::vector<Record> batch;
+    batch.reserve(MAX_BATCH);
+    auto lastFlush = std::chrono::steady_clock::now();
+    bool dirty = false;
+
+    while (true) {
+        Record record;
+        while (batch.size() < MAX_BATCH && buffer->tryPop(record)) {
+            batch.push_back(std::move(record));
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (!batch.empty()) {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                bool urgent = writeRecordsLocked(batch.data(), batch.size());
+                dirty = true;
+                if (urgent || now - lastFlush >= flushInterval) {
+                    if (m_fileStream.is_open()) {
+                        m_fileStream.flush();
+                    }
+                    dirty = false;
+                    lastFlush = now;
+                }
+            }
+            m_written.fetch_add(batch.size(), std::memory_order_relaxed);
+            batch.clear();
+            {
+                std::lock_guard<std::mutex> wakeLock(m_wakeMutex);
+            }
+            m_writtenCondition.notify_all();
+            continue;
+        }
+
+        if (dirty && now - lastFlush >= flushInterval) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_fileStream.is_open()) {
+                m_fileStream.flush();
+            }
+            dirty = false;
+            lastFlush = now;
+        }
+        // 停止时已经读空了缓冲区，之后入队的日志由stopWriter()写出
+        if (!m_running.load(std::memory_order_acquire)) {
+            break;
+        }
+
+        std::unique_lock<std::mutex> wakeLock(m_wakeMutex);
+        m_writerIdle.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (buffer->empty() && m_running.load(std::memory_order_acquire)) {
+            auto timeout = dirty ?
+                std::chrono::duration_cast<std::chrono::milliseconds>(flushInterval - (now - lastFlush)) :
+                IDLE_WAIT;
+            m_wakeCondition.wait_for(wakeLock, timeout);
+        }
+        m_writerIdle.store(false, std::memory_order_relaxed);
+    }
+}
+
+
+bool Logger::writeRecordsLocked(const Record* records, size_t count) {
+    std::string line;
+    std::string fileText;
+    std::string outText;
+    std::string errText;
+    bool urgent = false;
+
+    for (size_t i = 0; i < count; i++) {
+        const Record& record = records[i];
+        line.clear();
+        formatMessage(line, record);
+        bool isError = record.level == LogLevel::ERROR || record.level == LogLevel::FATAL;
+        urgent = urgent || isError;
+
+        // 输出到文件
+        if (m_fileStream.is_open()) {
+            fileText += line;
+        }
+        // 输出到控制台，错误输出到stderr
+        if (m_toConsole) {
+            (isError ? errText : outText) += line;
+        }
+    }
+
+    // 一批日志只写一次
+    if (!fileText.empty()) {
+        m_fileStream.write(fileText.data(), static_cast<std::streamsize>(fileText.size()));
+    }
+    if (!outText.empty()) {
+        std::cout.write(outText.data(), static_cast<std::streamsize>(outText.size()));
+        std::cout.flush();
+    }
+    if (!errText.empty()) {
+        std::cerr.write(errText.data(), static_cast<std::streamsize>(errText.size()));
+        std::cerr.flush();
+    }
+    return urgent;
+}
+
+
+void Logger::formatMessage(std::string& out, const Record& record) {
+    std::time_t second = static_cast<std::time_t>(record.timestamp / 1000);
+    int millis = static_cast<int>(record.timestamp % 1000);
+
+    // 时间戳
+    if (second != m_cachedSecond) {
+        std::tm localTime;
+        localtime_r(&second, &localTime);
+        std::strftime(m_cachedTime, sizeof(m_cachedTime), "%Y-%m-%d %H:%M:%S", &localTime);
+        m_cachedSecond = second;
+    }
+    char millisText[8];
+    std::snprintf(millisText, sizeof(millisText), ".%03d", millis);
+
+    out += m_cachedTime;
+    out += millisText;
+
+    // 日志级别
+    out += " [";
+    out += levelToString(record.level);
+    out += "] ";
+
+    // 消息
+    out += record.message;
+    out += '\n';
+}
+
+
+const char* Logger::levelToString(LogLevel level) {
+    switch (level) {
+    case LogLevel::DEBUG:   return "DEBUG";
+    case LogLevel::INFO:    return "INFO";
+    case LogLevel::WARNING: return "WARN";
+    case LogLevel::ERROR:   return "ERROR";
+    case LogLevel::FATAL:   return "FATAL";
+    default:                return "UNKNOWN";
+    }
+}
@@ -0,0 +1,342 @@
+#include "metrics_exporter.h"
+#include "connection_pool.h"
+#include "logger.h"
+#include "utils.h"
+#include <chrono>
+
+
+namespace {
+
+const char* const PREFIX = "mysql_pool_";
+
+// label values may hold any text, OpenMetrics escapes backslash, quote and newline
+std::string escapeLabel(const std::string& value) {
+    std::string escaped;
+    escaped.reserve(value.size());
+    for (char c : value) {
+        switch (c) {
+            case '\\': escaped += "\\\\"; break;
+            case '"': escaped += "\\\""; break;
+            case '\n': escaped += "\\n"; break;
+            default: escaped += c;
+        }
+    }
+    return escaped;
+}
+
+// always '.' as decimal point, whatever LC_NUMERIC the application set
+std::string formatDouble(double value) {
+    return Utils::formatDouble(value, "%.9g");
+}
+
+std::string poolLabel(const PoolMetrics& metrics) {
+    return "pool=\"" + escapeLabel(metrics.pool) + "\"";
+}
+
+std::string backendLabels(const PoolMetrics& metrics, const BackendMetrics& backend) {
+    return poolLabel(metrics) + ",backend=\"" + escapeLabel(backend.host + ":" + std::to_string(backend.port)) +
+           "\",role=\"" + (backend.role == DBRole::REPLICA ? "replica" : "primary") + "\"";
+}
+
+class Writer {
+public:
+    explicit Writer(std::string& out) : m_out(out) {}
+
+    // TYPE, UNIT and HELP lines of a metric family
+    void family(const char* name, const char* type, const char* help, const char* unit = nullptr) {
+        m_out += "# TYPE ";
+        m_out += PREFIX;
+        m_out += name;
+        m_out += ' ';
+        m_out += type;
+        m_out += '\n';
+        if (unit) {
+            m_out += "# UNIT ";
+            m_out += PREFIX;
+            m_out += name;
+            m_out += ' ';
+            m_out += unit;
+            m_out += '\n';
+        }
+        m_out += "# HELP ";
+        m_out += PREFIX;
+        m_out += name;
+        m_out += ' ';
+        m_out += help;
+        m_out += '\n';
+    }
+
+    void sample(const char* name, const char* suffix, const std::string& labels, const std::string& value) {
+        m_out += PREFIX;
+        m_out += name;
+        m_out += suffix;
+        m_out += '{';
+        m_out += labels;
+        m_out += "} ";
+        m_out += value;
+        m_out += '\n';
+    }
+
+    void sample(const char* name, const std::string& labels, uint64_t value) {
+        sample(name, "", labels, std::to_string(value));
+    }
+
+    void counter(const char* name, const std::string& labels, uint64_t value) {
+        sample(name, "_total", labels, std::to_string(value));
+    }
+
+    // latency summary in seconds, the histogram holds microseconds
+    void summary(const char* name, const std::string& labels, const HistogramSnapshot& latency) {
+        static const char* const quantiles[] = {"0.5", "0.9", "0.99", "0.999"};
+        static const double percentiles[] = {50.0, 90.0, 99.0, 99.9};
+        for (size_t i = 0; i < 4; i++) {
+            sample(name, "", labels + ",quantile=\"" + quantiles[i] + "\"",
+                   formatDouble(latency.getPercentile(percentiles[i]) / 1e6));
+        }
+        sample(name, "_sum", labels, formatDouble(latency.getSum() / 1e6));
+        sample(name, "_count", labels, std::to_string(latency.getCount()));
+    }
+
+private:
+    std::string& m_out;
+};
+
+} // namespace
+
+
+std::string MetricsExporter::toOpenMetrics(const PoolMetrics& metrics) {
+    return toOpenMetrics(std::vector<PoolMetrics>{metrics});
+}
+
+
+std::string MetricsExporter::toOpenMetrics(const std::vector<PoolMetrics>& pools) {
+    std::string out;
+    out.reserve(4096 * (pools.size() + 1));
+    Writer writer(out);
+
+    std::vector<std::string> labels;
+    labels.reserve(pools.size());
+    for (const auto& pool : pools) {
+        labels.push_back(poolLabel(pool));
+    }
+
+    // pool gauges
+    writer.family("up", "gauge", "1 while the pool is initialized and running.");
+    for (size_t i = 0; i < pools.size(); i++) {
+        writer.sample("up", labels[i], pools[i].running ? 1 : 0);
+    }
+    writer.family("connections", "gauge", "Connections of the pool by state.");
+    for (size_t i = 0; i < pools.size(); i++) {
+        writer.sample("connections", labels[i] + ",state=\"total\"", pools[i].totalConnections);
+        writer.sample("connections", labels[i] + ",state=\"idle\"", pools[i].idleConnections);
+        writer.sample("connections", labels[i] + ",state=\"active\"", pools[i].activeConnections);
+        writer.sample("connections", labels[i] + ",state=\"pending\"", pools[i].pendingConnections);
+    }
+    writer.family("waiters", "gauge", "Threads waiting for a connection.");
+    for (size_t i = 0; i < pools.size(); i++) {
+        writer.sample("waiters", labels[i], pools[i].waiters);
+    }
+    writer.family("target_connections", "gauge", "Connections the autoscaler steers the pool to, 0 when it is off.");
+    for (size_t i = 0; i < pools.size(); i++) {
+        writer.sample("target_connections", labels[i], pools[i].targetConnections);
+    }
+
+    // counters
+    struct CounterFamily {
+        const char* name;
+        const char* help;
+        uint64_t PerformanceStats::*field;
+    };
+    static const CounterFamily counters[] = {
+        {"connections_created", "Connections opened to a database.", &PerformanceStats::totalConnectionsCreated},
+        {"connections_acquired", "Connections handed out by the pool.", &PerformanceStats::totalConnectionsAcquired},
+        {"connections_released", "Connections returned to the pool.", &PerformanceStats::totalConnectionsReleased},
+        {"connection_failures", "Failed connects and checkouts.", &PerformanceStats::failedConnectionAttempts},
+        {"acquires_queued", "Checkouts that waited in the queue.", &PerformanceStats::queuedAcquires},
+        {"acquires_rejected", "Checkouts rejected because the queue was too long.", &PerformanceStats::rejectedAcquires},
+        {"acquire_timeouts", "Checkouts that timed out in the queue.", &PerformanceStats::acquireTimeouts},
+        {"queries", "Queries executed.", &PerformanceStats::totalQueriesExecuted},
+        {"query_failures", "Queries that failed.", &PerformanceStats::failedQueries},
+        {"reconnect_attempts", "Reconnects after a lost connection.", &PerformanceStats::reconnectionAttempts},
+        {"reconnect_successes", "Reconnects that succeeded.", &PerformanceStats::successfulReconnections},
+        {"statement_cache_hits", "Prepared statements reused from the cache.", &PerformanceStats::statementCacheHits},
+        {"statement_cache_misses", "Prepared statements that had to be prepared.", &PerformanceStats::statementCacheMisses},
+        {"query_cache_hits", "Cacheable queries answered from the result cache.", &PerformanceStats::queryCacheHits},
+        {"query_cache_misses", "Cacheable queries that went to the database.", &PerformanceStats::queryCacheMisses}
+    };
+    for (const auto& counter : counters) {
+        writer.family(counter.name, "counter", counter.help);
+        for (size_t i = 0; i < pools.size(); i++) {
+            writer.counter(counter.name, labels[i], pools[i].stats.*counter.field);
+        }
+    }
+
+    // latencies
+    struct SummaryFamily {
+        const char* name;
+        const char* help;
+        HistogramSnapshot PoolMetrics::*field;
+    };
+    static const SummaryFamily summaries[] = {
+        {"acquire_seconds", "Time to get a connection from the pool.", &PoolMetrics::acquireLatency},
+        {"connection_usage_seconds", "Time a connection stayed checked out.", &PoolMetrics::usageLatency},
+        {"query_seconds", "Query execution time.", &PoolMetrics::queryLatency},
+        {"connect_seconds", "Time to open a new connection.", &PoolMetrics::connectLatency},
+        {"queue_wait_seconds", "Time spent in the wait queue by checkouts that queued.", &PoolMetrics::queueWaitLatency}
+    };
+    for (const auto& summary : summaries) {
+        writer.family(summary.name, "summary", summary.help, "seconds");
+        for (size_t i = 0; i < pools.size(); i++) {
+            writer.summary(summary.name, labels[i], pools[i].*summary.field);
+        }
+    }
+
+    // backends
+    std::vector<std::vector<std::string>> backendLabelSets(pools.size());
+    for (size_t i = 0; i < pools.size(); i++) {
+        for (const auto& backend : pools[i].backends) {
+            backendLabelSets[i].push_back(backendLabels(pools[i], backend));
+        }
+    }
+    auto forEachBackend = [&pools, &backendLabelSets](const std::function<void(const BackendMetrics&, const std::string&)>& write) {
+        for (size_t i = 0; i < pools.size(); i++) {
+            for (size_t b = 0; b < pools[i].backends.size(); b++) {
+                write(pools[i].backends[b], backendLabelSets[i][b]);
+            }
+        }
+    };
+
+    writer.family("backend_connections", "gauge", "Connections of a backend sub-pool by state.");
+    forEachBackend([&writer](const BackendMetrics& backend, const std::string& labels) {
+        writer.sample("backend_connections", labels + ",state=\"total\"", backend.totalConnections);
+        writer.sample("backend_connections", labels + ",state=\"idle\"", backend.idleConnections);
+        writer.sample("backend_connections", labels + ",state=\"pending\"", backend.pendingConnections);
+    });
+    writer.family("backend_max_connections", "gauge", "Connection limit of a backend sub-pool.");
+    forEachBackend([&writer](const BackendMetrics& backend, const std::string& labels) {
+        writer.sample("backend_max_connections", labels, backend.maxConnections);
+    });
+    writer.family("backend_waiters", "gauge", "Threads waiting for a connection of a backend.");
+    forEachBackend([&writer](const BackendMetrics& backend, const std::string& labels) {
+        writer.sample("backend_waiters", labels, backend.waiters);
+    });
+    writer.family("backend_weight", "gauge", "Load balancer weight of a backend.");
+    forEachBackend([&writer](const BackendMetrics& backend, const std::string& labels) {
+        writer.sample("backend_weight", labels, backend.weight);
+    });
+    writer.family("backend_draining", "gauge", "1 while a removed backend closes its connections.");
+    forEachBackend([&writer](const BackendMetrics& backend, const std::string& labels) {
+        writer.sample("backend_draining", labels, backend.draining ? 1 : 0);
+    });
+    writer.family("backend_in_flight", "gauge", "Queries sent to a backend and not answered yet.");
+    forEachBackend([&writer](const BackendMetrics& backend, const std::string& labels) {
+        writer.sample("backend_in_flight", "", labels, std::to_string(backend.inFlight));
+    });
+    writer.family("backend_latency_ewma_seconds", "gauge", "Moving average of the backend latency.", "seconds");
+    forEachBackend([&writer](const BackendMetrics& backend, const std::string& labels) {
+        writer.sample("backend_latency_ewma_seconds", "", labels, formatDouble(backend.ewmaLatencyMs / 1e3));
+    });
+    writer.family("backend_circuit_state", "stateset", "Circuit breaker state of a backend.");
+    forEachBackend([&writer](const BackendMetrics& backend, const std::string& labels) {
+        const CircuitBreaker::State states[] = {CircuitBreaker::State::CLOSED, CircuitBreaker::State::OPEN,
+                                                CircuitBreaker::State::HALF_OPEN};
+        for (CircuitBreaker::State state : states) {
+            // a stateset sample carries its state in a label named after the metric family
+            writer.sample("backend_circuit_state", labels + "," + PREFIX + "backend_circuit_state=\"" +
+                          CircuitBreaker::stateName(state) + "\"", backend.circuitState == state ? 1 : 0);
+        }
+    });
+    writer.family("backend_circuit_opens", "counter", "Times the circuit breaker of a backend has opened.");
+    forEachBackend([&writer](const BackendMetrics& backend, const std::string& labels) {
+        writer.counter("backend_circuit_opens", labels, backend.circuitOpenCount);
+    });
+
+    out += "# EOF\n";
+    return out;
+}
+
+
+const char* MetricsExporter::contentType() {
+    return "application/openmetrics-text; version=1.0.0; charset=utf-8";
+}
+
+
+MetricsReporter::MetricsReporter(const ConnectionPool& pool, unsigned int intervalMs, Callback callback)
+    : m_pool(pool)
+    , m_intervalMs(intervalMs > 0 ? intervalMs : 1)
+    , m_callback(std::move(callback))
+    , m_running(false) {
+}
+
+
+MetricsReporter::~MetricsReporter() {
+    stop();
+}
+
+
+void MetricsReporter::start() {
+    std::lock_guard<std::mutex> lock(m_stopMutex);
+    if (m_running) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> reportLock(m_reportMutex);
+        m_previous = m_pool.getMetrics();
+    }
+    m_running = true;
+    m_thread = std::thread([this]() { this->run(); });
+}
+
+
+void MetricsReporter::stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_stopMutex);
+        if (!m_running) {
+            return;
+        }
+        m_running = false;
+    }
+    m_stopCondition.notify_all();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+
+bool MetricsReporter::isRunning() const {
+    return m_running.load();
+}
+
+
+void MetricsReporter::reportNow() {
+    std::lock_guard<std::mutex> lock(m_reportMutex);
+    PoolMetrics current = m_pool.getMetrics();
+    PoolMetrics delta = current.since(m_previous);
+    m_previous = current;
+    try {
+        m_callback(delta, current);
+    } catch (const std::exception& e) {
+        LOG_ERROR("MetricsReporter::reportNow callback has error: " + std::string(e.what()));
+    }
+}
+
+
+void MetricsReporter::run() {
+    auto next = std::chrono::steady_clock::now() + std::chrono::milliseconds(m_intervalMs);
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_stopMutex);
+            if (m_stopCondition.wait_until(lock, next, [this]() { return !m_running.load(); })) {
+                return;
+            }
+        }
+        // fixed rate, a slow callback does not shift the following intervals,
+        // but missed ones are skipped instead of reported in a burst
+        next += std::chrono::milliseconds(m_intervalMs);
+        reportNow();
+        auto now = std::chrono::steady_clock::now();
+        if (next < now) {
+            next = now + std::chrono::milliseconds(m_intervalMs);
+        }
+    }
+}
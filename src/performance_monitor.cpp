@@ -4,33 +4,84 @@
 #include <fstream>
 #include <sstream>
 
+const size_t PerformanceMonitor::COUNTER_SHARDS;
+
+PerformanceMonitor::PerformanceMonitor()
+    : m_enabled(true) {
+    for (auto& shard : m_shards) {
+        for (auto& value : shard.values) {
+            value.store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
 // =========================
 // 获取统计信息实现
 // =========================
 
+uint64_t PerformanceMonitor::sum(Counter counter) const {
+    uint64_t total = 0;
+    for (const auto& shard : m_shards) {
+        total += shard.values[counter].load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
 PerformanceStats PerformanceMonitor::getStats() const {
     PerformanceStats stats;
 
-    // 原子读取所有计数器
-    // 使用 memory_order_acquire 保证读取的一致性
-    stats.totalConnectionsCreated = m_totalConnectionsCreated.load(std::memory_order_acquire);
-    stats.totalConnectionsAcquired = m_totalConnectionsAcquired.load(std::memory_order_acquire);
-    stats.totalConnectionsReleased = m_totalConnectionsReleased.load(std::memory_order_acquire);
-    stats.failedConnectionAttempts = m_failedConnectionAttempts.load(std::memory_order_acquire);
+    // 汇总各分片，期间的记录可能只有一部分计入
+    stats.totalConnectionsCreated = sum(CONNECTIONS_CREATED);
+    stats.totalConnectionsAcquired = sum(CONNECTIONS_ACQUIRED);
+    stats.totalConnectionsReleased = sum(CONNECTIONS_RELEASED);
+    stats.failedConnectionAttempts = sum(FAILED_CONNECTION_ATTEMPTS);
+
+    stats.queuedAcquires = sum(QUEUED_ACQUIRES);
+    stats.rejectedAcquires = sum(REJECTED_ACQUIRES);
+    stats.acquireTimeouts = sum(ACQUIRE_TIMEOUTS);
+
+    stats.totalQueriesExecuted = sum(QUERIES_EXECUTED);
+    stats.failedQueries = sum(FAILED_QUERIES);
 
-    stats.totalQueriesExecuted = m_totalQueriesExecuted.load(std::memory_order_acquire);
-    stats.failedQueries = m_failedQueries.load(std::memory_order_acquire);
+    stats.reconnectionAttempts = sum(RECONNECTION_ATTEMPTS);
+    stats.successfulReconnections = sum(SUCCESSFUL_RECONNECTIONS);
 
-    stats.reconnectionAttempts = m_reconnectionAttempts.load(std::memory_order_acquire);
-    stats.successfulReconnections = m_successfulReconnections.load(std::memory_order_acquire);
+    stats.statementCacheHits = sum(STATEMENT_CACHE_HITS);
+    stats.statementCacheMisses = sum(STATEMENT_CACHE_MISSES);
+    stats.queryCacheHits = sum(QUERY_CACHE_HITS);
+    stats.queryCacheMisses = sum(QUERY_CACHE_MISSES);
 
-    stats.totalConnectionAcquireTime = m_totalConnectionAcquireTime.load(std::memory_order_acquire);
-    stats.totalConnectionUsageTime = m_totalConnectionUsageTime.load(std::memory_order_acquire);
-    stats.totalQueryExecutionTime = m_totalQueryExecutionTime.load(std::memory_order_acquire);
+    stats.totalConnectionAcquireTime = sum(CONNECTION_ACQUIRE_TIME);
+    stats.totalConnectionUsageTime = sum(CONNECTION_USAGE_TIME);
+    stats.totalQueryExecutionTime = sum(QUERY_EXECUTION_TIME);
 
     return stats;
 }
 
+// =========================
+// 延迟分布实现
+// =========================
+
+const LatencyHistogram& PerformanceMonitor::getHistogram(LatencyMetric metric) const {
+    switch (metric) {
+        case LatencyMetric::CONNECTION_ACQUIRE:
+            return m_acquireLatency;
+        case LatencyMetric::CONNECTION_USAGE:
+            return m_usageLatency;
+        case LatencyMetric::QUERY_EXECUTION:
+            return m_queryLatency;
+        case LatencyMetric::QUEUE_WAIT:
+            return m_queueWaitLatency;
+        case LatencyMetric::CONNECT:
+        default:
+            return m_connectLatency;
+    }
+}
+
+HistogramSnapshot PerformanceMonitor::getLatencySnapshot(LatencyMetric metric) const {
+    return getHistogram(metric).snapshot();
+}
+
 // =========================
 // 重置统计信息实现
 // =========================
@@ -38,21 +89,18 @@ PerformanceStats PerformanceMonitor::getStats() const {
 void PerformanceMonitor::resetStats() {
     LOG_INFO("Resetting performance statistics");
 
-    // 使用 memory_order_release 确保重置操作的可见性
-    m_totalConnectionsCreated.store(0, std::memory_order_release);
-    m_totalConnectionsAcquired.store(0, std::memory_order_release);
-    m_totalConnectionsReleased.store(0, std::memory_order_release);
-    m_failedConnectionAttempts.store(0, std::memory_order_release);
-
-    m_totalQueriesExecuted.store(0, std::memory_order_release);
-    m_failedQueries.store(0, std::memory_order_release);
-
-    m_reconnectionAttempts.store(0, std::memory_order_release);
-    m_successfulReconnections.store(0, std::memory_order_release);
+    // 与记录同时进行时，个别记录可能留在重置后的统计里
+    for (auto& shard : m_shards) {
+        for (auto& value : shard.values) {
+            value.store(0, std::memory_order_relaxed);
+        }
+    }
 
-    m_totalConnectionAcquireTime.store(0, std::memory_order_release);
-    m_totalConnectionUsageTime.store(0, std::memory_order_release);
-    m_totalQueryExecutionTime.store(0, std::memory_order_release);
+    m_acquireLatency.reset();
+    m_usageLatency.reset();
+    m_queryLatency.reset();
+    m_connectLatency.reset();
+    m_queueWaitLatency.reset();
 
     LOG_INFO("Performance statistics reset completed");
 }
@@ -79,7 +127,9 @@ std::string PerformanceMonitor::getStatsString() const {
     ss << "  失败次数: " << stats.failedConnectionAttempts << " 次\n";
     ss << "  获取成功率: " << stats.connectionAcquireSuccessRate() << "%\n";
     ss << "  平均获取时间: " << stats.avgConnectionAcquireTime() / 1000.0 << " ms\n";
-    ss << "  平均使用时间: " << stats.avgConnectionUsageTime() << " ms\n\n";
+    ss << "  排队次数: " << stats.queuedAcquires << " 次 (拒绝 " << stats.rejectedAcquires
+       << " 次, 超时 " << stats.acquireTimeouts << " 次)\n";
+    ss << "  平均使用时间: " << stats.avgConnectionUsageTime() / 1000.0 << " ms\n\n";
 
     // === 查询相关统计 ===
     ss << "【查询统计】\n";
@@ -94,6 +144,36 @@ std::string PerformanceMonitor::getStatsString() const {
     ss << "  成功次数: " << stats.successfulReconnections << " 次\n";
     ss << "  成功率: " << stats.reconnectionSuccessRate() << "%\n\n";
 
+    // === 预处理语句缓存统计 ===
+    ss << "【预处理语句缓存】\n";
+    ss << "  命中次数: " << stats.statementCacheHits << " 次\n";
+    ss << "  未命中次数: " << stats.statementCacheMisses << " 次\n";
+    ss << "  命中率: " << stats.statementCacheHitRate() << "%\n\n";
+
+    // === 查询结果缓存统计 ===
+    ss << "【查询结果缓存】\n";
+    ss << "  命中次数: " << stats.queryCacheHits << " 次\n";
+    ss << "  未命中次数: " << stats.queryCacheMisses << " 次\n";
+    ss << "  命中率: " << stats.queryCacheHitRate() << "%\n\n";
+
+    // === 延迟分布 ===
+    ss << "【延迟分布】(ms)\n";
+    const std::pair<const char*, LatencyMetric> metrics[] = {
+        {"连接获取", LatencyMetric::CONNECTION_ACQUIRE},
+        {"连接使用", LatencyMetric::CONNECTION_USAGE},
+        {"查询执行", LatencyMetric::QUERY_EXECUTION},
+        {"建立连接", LatencyMetric::CONNECT},
+        {"排队等待", LatencyMetric::QUEUE_WAIT}
+    };
+    for (const auto& metric : metrics) {
+        HistogramSnapshot snapshot = getLatencySnapshot(metric.second);
+        ss << "  " << metric.first << ": P50 " << snapshot.getPercentile(50) / 1000.0
+           << ", P99 " << snapshot.getPercentile(99) / 1000.0
+           << ", P999 " << snapshot.getPercentile(99.9) / 1000.0
+           << ", 最大 " << snapshot.getMax() / 1000.0 << "\n";
+    }
+    ss << "\n";
+
     // === 性能评估 ===
     ss << "【性能评估】\n";
     ss << "  连接获取性能: " << getPerformanceLevel(stats.avgConnectionAcquireTime()) << "\n";
@@ -179,6 +259,9 @@ bool PerformanceMonitor::exportToCSV(const std::string& filePath) {
         file << "总获取连接数," << stats.totalConnectionsAcquired << ",次,累计获取连接的请求数\n";
         file << "总释放连接数," << stats.totalConnectionsReleased << ",次,累计释放连接的次数\n";
         file << "连接失败次数," << stats.failedConnectionAttempts << ",次,获取连接失败的次数\n";
+        file << "排队获取次数," << stats.queuedAcquires << ",次,需要排队等待连接的获取次数\n";
+        file << "拒绝获取次数," << stats.rejectedAcquires << ",次,队列过长被立即拒绝的获取次数\n";
+        file << "获取超时次数," << stats.acquireTimeouts << ",次,排队等到超时的获取次数\n";
 
         file << "总查询执行数," << stats.totalQueriesExecuted << ",次,累计执行的SQL查询数\n";
         file << "查询失败次数," << stats.failedQueries << ",次,执行失败的查询数\n";
@@ -186,6 +269,11 @@ bool PerformanceMonitor::exportToCSV(const std::string& filePath) {
         file << "重连尝试次数," << stats.reconnectionAttempts << ",次,网络断开后的重连尝试\n";
         file << "重连成功次数," << stats.successfulReconnections << ",次,重连成功的次数\n";
 
+        file << "语句缓存命中次数," << stats.statementCacheHits << ",次,复用已预处理语句的次数\n";
+        file << "语句缓存未命中次数," << stats.statementCacheMisses << ",次,需要重新预处理语句的次数\n";
+        file << "查询缓存命中次数," << stats.queryCacheHits << ",次,直接由缓存返回结果的查询次数\n";
+        file << "查询缓存未命中次数," << stats.queryCacheMisses << ",次,需要到数据库执行的可缓存查询次数\n";
+
         // === 时间统计（转换为毫秒，更容易理解） ===
         file << "总连接获取时间," << stats.totalConnectionAcquireTime / 1000.0 << ",毫秒,获取连接的累计耗时\n";
         file << "总连接使用时间," << stats.totalConnectionUsageTime / 1000.0 << ",毫秒,连接被占用的累计时间\n";
@@ -193,12 +281,24 @@ bool PerformanceMonitor::exportToCSV(const std::string& filePath) {
 
         // === 计算指标（这些是最有价值的数据） ===
         file << "平均连接获取时间," << stats.avgConnectionAcquireTime() / 1000.0 << ",毫秒,平均获取一个连接的时间\n";
-        file << "平均连接使用时间," << stats.avgConnectionUsageTime() << ",毫秒,平均占用连接的时间\n";
+        file << "平均连接使用时间," << stats.avgConnectionUsageTime() / 1000.0 << ",毫秒,平均占用连接的时间\n";
         file << "平均查询执行时间," << stats.avgQueryExecutionTime() / 1000.0 << ",毫秒,平均执行一个查询的时间\n";
 
+        // === 延迟分位数 ===
+        HistogramSnapshot acquire = getLatencySnapshot(LatencyMetric::CONNECTION_ACQUIRE);
+        HistogramSnapshot query = getLatencySnapshot(LatencyMetric::QUERY_EXECUTION);
+        HistogramSnapshot connect = getLatencySnapshot(LatencyMetric::CONNECT);
+        file << "连接获取时间P99," << acquire.getPercentile(99) / 1000.0 << ",毫秒,99%的获取请求不超过该时间\n";
+        file << "连接获取时间P999," << acquire.getPercentile(99.9) / 1000.0 << ",毫秒,99.9%的获取请求不超过该时间\n";
+        file << "查询执行时间P99," << query.getPercentile(99) / 1000.0 << ",毫秒,99%的查询不超过该时间\n";
+        file << "查询执行时间P999," << query.getPercentile(99.9) / 1000.0 << ",毫秒,99.9%的查询不超过该时间\n";
+        file << "建立连接时间P99," << connect.getPercentile(99) / 1000.0 << ",毫秒,99%的新连接握手不超过该时间\n";
+
         file << "连接获取成功率," << stats.connectionAcquireSuccessRate() << ",%,成功获取连接的比例\n";
         file << "查询执行成功率," << stats.querySuccessRate() << ",%,查询执行成功的比例\n";
         file << "重连成功率," << stats.reconnectionSuccessRate() << ",%,重连尝试成功的比例\n";
+        file << "语句缓存命中率," << stats.statementCacheHitRate() << ",%,预处理语句缓存的命中比例\n";
+        file << "查询缓存命中率," << stats.queryCacheHitRate() << ",%,查询结果缓存的命中比例\n";
 
         // === 添加导出时间戳 ===
         file << "导出时间," << getCurrentTimeString() << ",时间戳,统计数据的导出时间\n";
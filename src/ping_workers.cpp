@@ -0,0 +1,104 @@
+#include "ping_workers.h"
+#include <mysql/mysql.h>
+#include <system_error>
+#include "logger.h"
+
+PingWorkers::PingWorkers()
+    : m_task(nullptr)
+    , m_count(0)
+    , m_next(0)
+    , m_done(0)
+    , m_stopping(false) {
+}
+
+
+PingWorkers::~PingWorkers() {
+    stop();
+}
+
+
+void PingWorkers::run(size_t count, size_t concurrency, const Task& task) {
+    std::lock_guard<std::mutex> runLock(m_runMutex);
+    std::unique_lock<std::mutex> lock(m_mutex);
+    // the calling thread is one of them
+    while (m_threads.size() + 1 < concurrency && m_threads.size() + 1 < count) {
+        try {
+            m_threads.emplace_back([this]() {
+                this->worker();
+            });
+        } catch (const std::system_error& e) {
+            LOG_WARNING("PingWorkers::run cannot start another thread: " + std::string(e.what()));
+            break;
+        }
+    }
+    m_task = &task;
+    m_count = count;
+    m_next = 0;
+    m_done = 0;
+    m_condition.notify_all();
+
+    while (runNext(lock)) {
+    }
+    // the task lives on the caller's stack, no thread may still be running it
+    m_doneCondition.wait(lock, [this]() {
+        return m_done == m_count;
+    });
+    m_task = nullptr;
+}
+
+
+void PingWorkers::stop() {
+    std::lock_guard<std::mutex> runLock(m_runMutex);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_condition.notify_all();
+    for (auto& thread : m_threads) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    m_threads.clear();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopping = false;
+}
+
+
+void PingWorkers::worker() {
+    mysql_thread_init();
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_condition.wait(lock, [this]() {
+            return m_stopping || (m_task && m_next < m_count);
+        });
+        if (m_stopping) {
+            break;
+        }
+        runNext(lock);
+    }
+    lock.unlock();
+    mysql_thread_end();
+}
+
+
+bool PingWorkers::runNext(std::unique_lock<std::mutex>& lock) {
+    if (!m_task || m_next >= m_count) {
+        return false;
+    }
+    size_t index = m_next++;
+    const Task& task = *m_task;
+    lock.unlock();
+    try {
+        task(index);
+    } catch (const std::exception& e) {
+        LOG_WARNING("PingWorkers task failed: " + std::string(e.what()));
+    } catch (...) {
+        LOG_WARNING("PingWorkers task failed");
+    }
+    lock.lock();
+    if (++m_done == m_count) {
+        m_doneCondition.notify_all();
+    }
+    return true;
+}
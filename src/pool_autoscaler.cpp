@@ -0,0 +1,128 @@
+#include "pool_autoscaler.h"
+#include <algorithm>
+#include <cmath>
+
+
+const int PoolAutoscaler::LEAD_INTERVALS;
+
+
+namespace {
+
+// smoothing of the level and of the trend of the arrival rate
+const double LEVEL_ALPHA = 0.5;
+const double TREND_BETA = 0.3;
+
+} // namespace
+
+
+AutoscalePolicy AutoscalePolicy::fromConfig(const PoolConfig& config) {
+    AutoscalePolicy policy;
+    policy.minConnections = config.minConnections;
+    policy.maxConnections = config.maxConnections;
+    policy.targetUtilization = config.autoScaleTargetUtilization / 100.0;
+    policy.maxAcquireWaitMicros = static_cast<int64_t>(config.autoScaleMaxAcquireWait) * 1000;
+    policy.scaleDownDelayMicros = static_cast<int64_t>(config.autoScaleDownDelay) * 1000;
+    policy.scaleDownStep = config.autoScaleDownStep;
+    return policy;
+}
+
+
+AutoscaleSample AutoscaleSample::between(const PoolMetrics& earlier, const PoolMetrics& current, int64_t nowMicros) {
+    PoolMetrics interval = current.since(earlier);
+    AutoscaleSample sample;
+    sample.nowMicros = nowMicros;
+    sample.arrivals = interval.stats.totalConnectionsAcquired + interval.stats.rejectedAcquires +
+                      interval.stats.acquireTimeouts;
+    sample.meanUsageMicros = interval.usageLatency.getMean();
+    sample.acquireWaitP99Micros = interval.acquireLatency.getPercentile(99);
+    sample.activeConnections = current.activeConnections;
+    sample.waiters = current.waiters;
+    sample.totalConnections = current.totalConnections;
+    return sample;
+}
+
+
+PoolAutoscaler::PoolAutoscaler() {
+    reset();
+}
+
+
+void PoolAutoscaler::reset() {
+    m_started = false;
+    m_hasRate = false;
+    m_lastMicros = 0;
+    m_level = 0.0;
+    m_trend = 0.0;
+    m_forecastRate = 0.0;
+    m_target = 0;
+    m_belowTarget = false;
+    m_lowSinceMicros = 0;
+}
+
+
+unsigned int PoolAutoscaler::clamp(const AutoscalePolicy& policy, double value) {
+    if (value <= policy.minConnections) {
+        return policy.minConnections;
+    }
+    if (value >= policy.maxConnections) {
+        return policy.maxConnections;
+    }
+    return static_cast<unsigned int>(value);
+}
+
+
+unsigned int PoolAutoscaler::update(const AutoscalePolicy& policy, const AutoscaleSample& sample) {
+    // the pool may have grown on demand between two samples, or been resized
+    unsigned int size = clamp(policy, std::max<double>(m_target, sample.totalConnections));
+    if (!m_started) {
+        m_started = true;
+        m_lastMicros = sample.nowMicros;
+        m_target = clamp(policy, sample.totalConnections);
+        return m_target;
+    }
+    int64_t elapsed = sample.nowMicros - m_lastMicros;
+    if (elapsed <= 0) {
+        return m_target;
+    }
+    m_lastMicros = sample.nowMicros;
+
+    double rate = sample.arrivals * 1e6 / elapsed;
+    if (!m_hasRate) {
+        m_level = rate;
+        m_trend = 0.0;
+        m_hasRate = true;
+    } else {
+        double previous = m_level;
+        m_level = LEVEL_ALPHA * rate + (1 - LEVEL_ALPHA) * (m_level + m_trend);
+        m_trend = TREND_BETA * (m_level - previous) + (1 - TREND_BETA) * m_trend;
+    }
+    // only a rising trend is projected, a falling one is left to the hysteresis
+    m_forecastRate = std::max(rate, m_level + LEAD_INTERVALS * std::max(m_trend, 0.0));
+
+    double busy = m_forecastRate * sample.meanUsageMicros / 1e6;
+    double observed = static_cast<double>(sample.activeConnections + sample.waiters);
+    double wanted = std::max(busy, observed) / policy.targetUtilization;
+    // checkouts waited longer than allowed: the model is behind, even if nobody waits right now.
+    // 0 turns this off, otherwise every checkout that has to wait at all would grow the pool
+    if (policy.maxAcquireWaitMicros > 0 &&
+        static_cast<int64_t>(sample.acquireWaitP99Micros) > policy.maxAcquireWaitMicros) {
+        wanted = std::max(wanted, static_cast<double>(sample.totalConnections + std::max<size_t>(sample.waiters, 1)));
+    }
+    // keep rounding noise from adding a connection
+    unsigned int desired = clamp(policy, std::ceil(wanted - 1e-9));
+
+    if (desired >= size) {
+        m_target = desired;
+        m_belowTarget = false;
+    } else if (!m_belowTarget) {
+        m_belowTarget = true;
+        m_lowSinceMicros = sample.nowMicros - elapsed;
+        m_target = size;
+    } else if (sample.nowMicros - m_lowSinceMicros >= policy.scaleDownDelayMicros) {
+        unsigned int step = std::min(policy.scaleDownStep, size);
+        m_target = std::max(desired, size - step);
+    } else {
+        m_target = size;
+    }
+    return m_target;
+}
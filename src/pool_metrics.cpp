@@ -0,0 +1,42 @@
+#include "pool_metrics.h"
+
+
+namespace {
+
+// counters go back to 0 on resetStats, the interval then starts at the reset
+uint64_t delta(uint64_t current, uint64_t earlier) {
+    return current >= earlier ? current - earlier : current;
+}
+
+} // namespace
+
+
+PoolMetrics PoolMetrics::since(const PoolMetrics& earlier) const {
+    PoolMetrics result = *this;
+    const PerformanceStats& before = earlier.stats;
+    PerformanceStats& stats = result.stats;
+
+    stats.totalConnectionsCreated = delta(stats.totalConnectionsCreated, before.totalConnectionsCreated);
+    stats.totalConnectionsAcquired = delta(stats.totalConnectionsAcquired, before.totalConnectionsAcquired);
+    stats.totalConnectionsReleased = delta(stats.totalConnectionsReleased, before.totalConnectionsReleased);
+    stats.failedConnectionAttempts = delta(stats.failedConnectionAttempts, before.failedConnectionAttempts);
+    stats.queuedAcquires = delta(stats.queuedAcquires, before.queuedAcquires);
+    stats.rejectedAcquires = delta(stats.rejectedAcquires, before.rejectedAcquires);
+    stats.acquireTimeouts = delta(stats.acquireTimeouts, before.acquireTimeouts);
+    stats.totalQueriesExecuted = delta(stats.totalQueriesExecuted, before.totalQueriesExecuted);
+    stats.failedQueries = delta(stats.failedQueries, before.failedQueries);
+    stats.reconnectionAttempts = delta(stats.reconnectionAttempts, before.reconnectionAttempts);
+    stats.successfulReconnections = delta(stats.successfulReconnections, before.successfulReconnections);
+    stats.statementCacheHits = delta(stats.statementCacheHits, before.statementCacheHits);
+    stats.statementCacheMisses = delta(stats.statementCacheMisses, before.statementCacheMisses);
+    stats.totalConnectionAcquireTime = delta(stats.totalConnectionAcquireTime, before.totalConnectionAcquireTime);
+    stats.totalConnectionUsageTime = delta(stats.totalConnectionUsageTime, before.totalConnectionUsageTime);
+    stats.totalQueryExecutionTime = delta(stats.totalQueryExecutionTime, before.totalQueryExecutionTime);
+
+    result.acquireLatency = acquireLatency.since(earlier.acquireLatency);
+    result.usageLatency = usageLatency.since(earlier.usageLatency);
+    result.queryLatency = queryLatency.since(earlier.queryLatency);
+    result.connectLatency = connectLatency.since(earlier.connectLatency);
+    result.queueWaitLatency = queueWaitLatency.since(earlier.queueWaitLatency);
+    return result;
+}
@@ -0,0 +1,331 @@
+#include "prepared_statement.h"
+#include "connection.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include "db_exception.h"
+#include "logger.h"
+#include "performance_monitor.h"
+
+namespace {
+
+// initial buffer of a result column, longer values are fetched again with mysql_stmt_fetch_column
+const unsigned long MIN_COLUMN_BUFFER = 64;
+
+int64_t microsecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+
+PreparedStatement::PreparedStatement(MYSQL_STMT* stmt, const std::string& sql, Connection& connection)
+    : m_stmt(stmt)
+    , m_sql(sql)
+    , m_connection(connection)
+    , m_lastInsertId(0) {
+    unsigned long count = mysql_stmt_param_count(m_stmt);
+    m_parameters.resize(count);
+    m_binds.resize(count);
+    clearParameters();
+}
+
+
+PreparedStatement::~PreparedStatement() {
+    // the owning connection closes its cached statements before the MYSQL handle goes away
+    closeLocked();
+}
+
+
+PreparedStatement::Parameter& PreparedStatement::parameter(unsigned int index) {
+    if (index >= m_parameters.size()) {
+        throw std::out_of_range("Parameter index out of range: " + std::to_string(index) +
+                                ", parameter count: " + std::to_string(m_parameters.size()));
+    }
+    Parameter& param = m_parameters[index];
+    param.isNull = 0;
+    param.isUnsigned = false;
+    return param;
+}
+
+
+void PreparedStatement::setInt(unsigned int index, int value) {
+    setLong(index, value);
+}
+
+
+void PreparedStatement::setLong(unsigned int index, long long value) {
+    Parameter& param = parameter(index);
+    param.type = MYSQL_TYPE_LONGLONG;
+    param.integer = value;
+}
+
+
+void PreparedStatement::setUnsignedLong(unsigned int index, unsigned long long value) {
+    Parameter& param = parameter(index);
+    param.type = MYSQL_TYPE_LONGLONG;
+    param.isUnsigned = true;
+    std::memcpy(&param.integer, &value, sizeof(value));
+}
+
+
+void PreparedStatement::setDouble(unsigned int index, double value) {
+    Parameter& param = parameter(index);
+    param.type = MYSQL_TYPE_DOUBLE;
+    param.real = value;
+}
+
+
+void PreparedStatement::setString(unsigned int index, const std::string& value) {
+    Parameter& param = parameter(index);
+    param.type = MYSQL_TYPE_STRING;
+    param.text = value;
+    param.length = static_cast<unsigned long>(value.size());
+}
+
+
+void PreparedStatement::setNull(unsigned int index) {
+    Parameter& param = parameter(index);
+    param.type = MYSQL_TYPE_NULL;
+    param.isNull = 1;
+}
+
+
+void PreparedStatement::clearParameters() {
+    for (auto& param : m_parameters) {
+        param.type = MYSQL_TYPE_NULL;
+        param.isUnsigned = false;
+        param.integer = 0;
+        param.real = 0.0;
+        param.text.clear();
+        param.length = 0;
+        param.isNull = 1;
+    }
+}
+
+
+QueryResultPtr PreparedStatement::executeQuery() {
+    auto startTime = std::chrono::steady_clock::now();
+    try {
+        std::lock_guard<std::mutex> lock(m_connection.m_mutex);
+        executeLocked();
+
+        MYSQL_RES* metadata = mysql_stmt_result_metadata(m_stmt);
+        if (metadata == nullptr) {
+            if (mysql_stmt_errno(m_stmt) != 0) {
+                throwError("read result metadata");
+            }
+            // the statement returns no rows
+            m_lastInsertId = mysql_stmt_insert_id(m_stmt);
+            m_connection.getPerformanceMonitor().recordQueryExecuted(microsecondsSince(startTime), true);
+            return std::make_shared<QueryResult>(nullptr, mysql_stmt_affected_rows(m_stmt));
+        }
+
+        ResultRowsPtr rows;
+        try {
+            rows = fetchRowsLocked(metadata);
+        } catch (...) {
+            mysql_free_result(metadata);
+            mysql_stmt_free_result(m_stmt);
+            throw;
+        }
+        mysql_free_result(metadata);
+        mysql_stmt_free_result(m_stmt);
+        m_connection.getPerformanceMonitor().recordQueryExecuted(microsecondsSince(startTime), true);
+        return std::make_shared<QueryResult>(rows);
+    } catch (const std::exception&) {
+        m_connection.getPerformanceMonitor().recordQueryExecuted(microsecondsSince(startTime), false);
+        throw;
+    }
+}
+
+
+unsigned long long PreparedStatement::executeUpdate() {
+    auto startTime = std::chrono::steady_clock::now();
+    try {
+        std::lock_guard<std::mutex> lock(m_connection.m_mutex);
+        executeLocked();
+        unsigned long long affectedRows = mysql_stmt_affected_rows(m_stmt);
+        m_lastInsertId = mysql_stmt_insert_id(m_stmt);
+        // discard rows if the statement returned any
+        mysql_stmt_free_result(m_stmt);
+        m_connection.getPerformanceMonitor().recordQueryExecuted(microsecondsSince(startTime), true);
+        return affectedRows;
+    } catch (const std::exception&) {
+        m_connection.getPerformanceMonitor().recordQueryExecuted(microsecondsSince(startTime), false);
+        throw;
+    }
+}
+
+
+void PreparedStatement::executeLocked() {
+    if (!m_stmt) {
+        std::string error = "Prepared statement is closed, SQL: " + m_sql;
+        LOG_ERROR(error);
+        throw db::SQLExecutionError(error, CR_SERVER_GONE_ERROR);
+    }
+    // an unfinished streaming result still owns the session
+    m_connection.finishActiveStreamLocked();
+
+    // parameters live in m_parameters, the binds only point to them
+    for (size_t i = 0; i < m_parameters.size(); i++) {
+        Parameter& param = m_parameters[i];
+        MYSQL_BIND& bind = m_binds[i];
+        std::memset(&bind, 0, sizeof(bind));
+        bind.buffer_type = param.type;
+        bind.is_null = &param.isNull;
+        bind.is_unsigned = param.isUnsigned;
+        switch (param.type) {
+            case MYSQL_TYPE_LONGLONG:
+                bind.buffer = &param.integer;
+                break;
+            case MYSQL_TYPE_DOUBLE:
+                bind.buffer = &param.real;
+                break;
+            case MYSQL_TYPE_STRING:
+                bind.buffer = &param.text[0];
+                bind.buffer_length = param.length;
+                bind.length = &param.length;
+                break;
+            default:
+                break;
+        }
+    }
+
+    if (!m_binds.empty() && mysql_stmt_bind_param(m_stmt, m_binds.data())) {
+        throwError("bind parameters");
+    }
+
+    LOG_DEBUG("Executing prepared statement: " + m_sql);
+    if (mysql_stmt_execute(m_stmt) != 0) {
+        throwError("execute");
+    }
+}
+
+
+ResultRowsPtr PreparedStatement::fetchRowsLocked(MYSQL_RES* metadata) {
+    // buffer the whole result on the client, and let it compute max_length of every column,
+    // so most values fit the first buffer
+    BindFlag updateMaxLength = 1;
+    mysql_stmt_attr_set(m_stmt, STMT_ATTR_UPDATE_MAX_LENGTH, &updateMaxLength);
+    if (mysql_stmt_store_result(m_stmt) != 0) {
+        throwError("store result");
+    }
+
+    unsigned int fieldCount = mysql_num_fields(metadata);
+    MYSQL_FIELD* fields = mysql_fetch_fields(metadata);
+
+    auto rows = std::make_shared<ResultRows>();
+    rows->fieldNames.reserve(fieldCount);
+    rows->fieldTypes.reserve(fieldCount);
+    for (unsigned int i = 0; i < fieldCount; i++) {
+        rows->fieldNames.push_back(fields[i].name);
+        rows->fieldTypes.push_back(fields[i].type);
+    }
+
+    // every column is fetched as text, the same representation as mysql_query results
+    std::vector<MYSQL_BIND> binds(fieldCount);
+    std::vector<std::vector<char>> buffers(fieldCount);
+    std::vector<unsigned long> lengths(fieldCount, 0);
+    // not std::vector, BindFlag is bool in MySQL 8 and vector<bool> has no addressable elements
+    std::unique_ptr<BindFlag[]> nulls(new BindFlag[fieldCount]());
+    std::unique_ptr<BindFlag[]> errors(new BindFlag[fieldCount]());
+    for (unsigned int i = 0; i < fieldCount; i++) {
+        buffers[i].resize(std::max(MIN_COLUMN_BUFFER, fields[i].max_length + 1));
+        std::memset(&binds[i], 0, sizeof(MYSQL_BIND));
+        binds[i].buffer_type = MYSQL_TYPE_STRING;
+        binds[i].buffer = buffers[i].data();
+        binds[i].buffer_length = static_cast<unsigned long>(buffers[i].size());
+        binds[i].length = &lengths[i];
+        binds[i].is_null = &nulls[i];
+        binds[i].error = &errors[i];
+    }
+    if (fieldCount > 0 && mysql_stmt_bind_result(m_stmt, binds.data())) {
+        throwError("bind result");
+    }
+
+    unsigned long long rowCount = mysql_stmt_num_rows(m_stmt);
+    rows->offsets.reserve(static_cast<size_t>(rowCount) * fieldCount);
+    rows->lengths.reserve(static_cast<size_t>(rowCount) * fieldCount);
+
+    std::vector<char> longValue;
+    while (true) {
+        int status = mysql_stmt_fetch(m_stmt);
+        if (status == MYSQL_NO_DATA) {
+            break;
+        }
+        if (status == 1) {
+            throwError("fetch");
+        }
+        for (unsigned int i = 0; i < fieldCount; i++) {
+            if (nulls[i]) {
+                rows->appendNull();
+                continue;
+            }
+            if (lengths[i] <= binds[i].buffer_length) {
+                rows->appendValue(buffers[i].data(), lengths[i]);
+                continue;
+            }
+            // MYSQL_DATA_TRUNCATED: fetch the full value of this column only
+            longValue.resize(lengths[i]);
+            MYSQL_BIND column;
+            std::memset(&column, 0, sizeof(column));
+            unsigned long columnLength = 0;
+            column.buffer_type = MYSQL_TYPE_STRING;
+            column.buffer = longValue.data();
+            column.buffer_length = lengths[i];
+            column.length = &columnLength;
+            if (mysql_stmt_fetch_column(m_stmt, &column, i, 0) != 0) {
+                throwError("fetch column");
+            }
+            rows->appendValue(longValue.data(), columnLength);
+        }
+        rows->rowCount++;
+    }
+    return rows;
+}
+
+
+unsigned long long PreparedStatement::getLastInsertId() const {
+    return m_lastInsertId;
+}
+
+
+unsigned long PreparedStatement::getParamCount() const {
+    return static_cast<unsigned long>(m_parameters.size());
+}
+
+
+const std::string& PreparedStatement::getSql() const {
+    return m_sql;
+}
+
+
+bool PreparedStatement::isOpen() const {
+    std::lock_guard<std::mutex> lock(m_connection.m_mutex);
+    return m_stmt != nullptr;
+}
+
+
+void PreparedStatement::close() {
+    std::lock_guard<std::mutex> lock(m_connection.m_mutex);
+    closeLocked();
+}
+
+
+void PreparedStatement::closeLocked() {
+    if (m_stmt) {
+        mysql_stmt_close(m_stmt);
+        m_stmt = nullptr;
+        LOG_DEBUG("Prepared statement closed: " + m_sql);
+    }
+}
+
+
+void PreparedStatement::throwError(const std::string& action) const {
+    unsigned int errorCode = m_stmt ? mysql_stmt_errno(m_stmt) : CR_SERVER_GONE_ERROR;
+    std::string errorMsg = m_stmt ? mysql_stmt_error(m_stmt) : "statement is closed";
+    LOG_ERROR("Failed to " + action + " prepared statement: " + errorMsg + ", SQL: " + m_sql);
+    throw db::SQLExecutionError(errorMsg + " (Code: " + std::to_string(errorCode) + ")", errorCode);
+}
@@ -0,0 +1,211 @@
+#include "query_cache.h"
+#include <algorithm>
+#include <chrono>
+#include <functional>
+
+const size_t QueryCache::SHARD_COUNT;
+
+
+QueryCache::QueryCache()
+    : m_maxBytes(0)
+    , m_defaultTtlNanos(0)
+    , m_epoch(0) {
+}
+
+
+void QueryCache::configure(size_t maxBytes, int64_t defaultTtlNanos) {
+    m_maxBytes.store(maxBytes, std::memory_order_relaxed);
+    m_defaultTtlNanos.store(std::max<int64_t>(0, defaultTtlNanos), std::memory_order_relaxed);
+    if (maxBytes == 0) {
+        clear();
+    }
+}
+
+
+std::string QueryCache::normalize(const std::string& sql) {
+    std::string normalized;
+    normalized.reserve(sql.size());
+    char quote = 0;
+    bool pendingSpace = false;
+    for (size_t i = 0; i < sql.size(); i++) {
+        char c = sql[i];
+        if (quote) {
+            normalized.push_back(c);
+            if (c == '\\' && quote != '`' && i + 1 < sql.size()) {
+                normalized.push_back(sql[++i]);
+            } else if (c == quote) {
+                quote = 0;
+            }
+            continue;
+        }
+        if (c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v') {
+            pendingSpace = !normalized.empty();
+            continue;
+        }
+        if (pendingSpace) {
+            normalized.push_back(' ');
+            pendingSpace = false;
+        }
+        if (c == '\'' || c == '"' || c == '`') {
+            quote = c;
+        }
+        normalized.push_back(c);
+    }
+    while (!normalized.empty() && (normalized.back() == ';' || normalized.back() == ' ')) {
+        normalized.pop_back();
+    }
+    return normalized;
+}
+
+
+std::string QueryCache::makeKey(const std::string& sql, const std::vector<std::string>& params) {
+    std::string key = normalize(sql);
+    // length prefixes keep ("a,b") and ("a", "b") apart
+    for (const auto& param : params) {
+        key.push_back('\0');
+        key += std::to_string(param.size());
+        key.push_back(':');
+        key += param;
+    }
+    return key;
+}
+
+
+ResultRowsPtr QueryCache::get(const std::string& key) {
+    if (!isEnabled()) {
+        return nullptr;
+    }
+    Shard& shard = shardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto found = shard.index.find(key);
+    if (found == shard.index.end()) {
+        return nullptr;
+    }
+    auto it = found->second;
+    if (it->expiresAt <= nowNanos()) {
+        shard.expirations++;
+        eraseLocked(shard, it);
+        return nullptr;
+    }
+    shard.lru.splice(shard.lru.begin(), shard.lru, it);
+    return it->rows;
+}
+
+
+bool QueryCache::put(const std::string& key, ResultRowsPtr rows, const std::vector<std::string>& tags,
+                     int64_t ttlNanos, uint64_t epoch) {
+    size_t budget = m_maxBytes.load(std::memory_order_relaxed) / SHARD_COUNT;
+    if (budget == 0 || !rows) {
+        return false;
+    }
+    size_t bytes = entryBytes(key, *rows, tags);
+    if (bytes > budget) {
+        return false;
+    }
+    if (ttlNanos <= 0) {
+        ttlNanos = m_defaultTtlNanos.load(std::memory_order_relaxed);
+    }
+    if (ttlNanos <= 0) {
+        return false;
+    }
+    int64_t expiresAt = nowNanos() + ttlNanos;
+
+    Shard& shard = shardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    // checked under the shard lock, invalidate() bumps the epoch before it takes the locks
+    if (m_epoch.load(std::memory_order_acquire) != epoch) {
+        return false;
+    }
+    auto found = shard.index.find(key);
+    if (found != shard.index.end()) {
+        eraseLocked(shard, found->second);
+    }
+    shard.lru.push_front(Entry{key, std::move(rows), tags, expiresAt, bytes});
+    shard.index[key] = shard.lru.begin();
+    shard.bytes += bytes;
+    while (shard.bytes > budget) {
+        shard.evictions++;
+        eraseLocked(shard, std::prev(shard.lru.end()));
+    }
+    return true;
+}
+
+
+size_t QueryCache::invalidate(const std::string& tag) {
+    m_epoch.fetch_add(1, std::memory_order_acq_rel);
+    size_t dropped = 0;
+    for (auto& shard : m_shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        for (auto it = shard.lru.begin(); it != shard.lru.end();) {
+            auto next = std::next(it);
+            if (std::find(it->tags.begin(), it->tags.end(), tag) != it->tags.end()) {
+                shard.invalidations++;
+                eraseLocked(shard, it);
+                dropped++;
+            }
+            it = next;
+        }
+    }
+    return dropped;
+}
+
+
+void QueryCache::clear() {
+    m_epoch.fetch_add(1, std::memory_order_acq_rel);
+    for (auto& shard : m_shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.invalidations += shard.lru.size();
+        shard.index.clear();
+        shard.lru.clear();
+        shard.bytes = 0;
+    }
+}
+
+
+QueryCache::Stats QueryCache::getStats() const {
+    Stats stats;
+    for (const auto& shard : m_shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        stats.entries += shard.lru.size();
+        stats.bytes += shard.bytes;
+        stats.evictions += shard.evictions;
+        stats.expirations += shard.expirations;
+        stats.invalidations += shard.invalidations;
+    }
+    return stats;
+}
+
+
+QueryCache::Shard& QueryCache::shardFor(const std::string& key) {
+    return m_shards[std::hash<std::string>()(key) % SHARD_COUNT];
+}
+
+
+void QueryCache::eraseLocked(Shard& shard, std::list<Entry>::iterator it) {
+    shard.bytes -= it->bytes;
+    shard.index.erase(it->key);
+    shard.lru.erase(it);
+}
+
+
+size_t QueryCache::entryBytes(const std::string& key, const ResultRows& rows, const std::vector<std::string>& tags) {
+    // the key is held twice, by the entry and by the index
+    size_t bytes = sizeof(Entry) + sizeof(ResultRows) + 2 * key.capacity();
+    bytes += rows.data.capacity();
+    bytes += rows.offsets.capacity() * sizeof(size_t);
+    bytes += rows.lengths.capacity() * sizeof(unsigned long);
+    bytes += rows.fieldTypes.capacity() * sizeof(enum_field_types);
+    for (const auto& name : rows.fieldNames) {
+        bytes += sizeof(std::string) + name.capacity();
+    }
+    for (const auto& tag : tags) {
+        bytes += sizeof(std::string) + tag.capacity();
+    }
+    return bytes;
+}
+
+
+int64_t QueryCache::nowNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
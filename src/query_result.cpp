@@ -1,5 +1,9 @@
 #include "query_result.h"
 #include <sstream>
+#include <cstdint>
+#include "db_exception.h"
+
+const size_t ResultRows::NULL_VALUE;
 
 // =========================
 // 构造和析构函数
@@ -12,6 +16,10 @@ QueryResult::QueryResult(MYSQL_RES* result, unsigned long long affectedRows)
     , m_fieldCount(0)
     , m_rowCount(0)
     , m_affectedRows(affectedRows)
+    , m_nextRow(0)
+    , m_mode(ResultMode::BUFFERED)
+    , m_mysql(nullptr)
+    , m_streamState(StreamState::FINISHED)
 {
     // 如果有结果集，初始化元数据
     if (m_result) {
@@ -24,10 +32,61 @@ QueryResult::QueryResult(MYSQL_RES* result, unsigned long long affectedRows)
     }
 }
 
+QueryResult::QueryResult(ResultRowsPtr rows)
+    : m_result(nullptr)
+    , m_currentRow(nullptr)
+    , m_lengths(nullptr)
+    , m_fieldCount(0)
+    , m_rowCount(0)
+    , m_affectedRows(0)
+    , m_rows(std::move(rows))
+    , m_nextRow(0)
+    , m_mode(ResultMode::BUFFERED)
+    , m_mysql(nullptr)
+    , m_streamState(StreamState::FINISHED)
+{
+    if (m_rows) {
+        m_fieldNames = m_rows->fieldNames;
+        m_fieldTypes = m_rows->fieldTypes;
+        m_fieldCount = static_cast<unsigned int>(m_fieldNames.size());
+        buildFieldIndex();
+        m_rowCount = m_rows->rowCount;
+        m_rowPointers.resize(m_fieldCount, nullptr);
+    }
+    LOG_DEBUG("QueryResult created from fetched rows with " + std::to_string(m_rowCount) +
+              " rows and " + std::to_string(m_fieldCount) + " fields");
+}
+
+QueryResult::QueryResult(MYSQL_RES* result, MYSQL* mysql, ResultMode mode)
+    : m_result(result)
+    , m_currentRow(nullptr)
+    , m_lengths(nullptr)
+    , m_fieldCount(0)
+    , m_rowCount(0)
+    , m_affectedRows(0)
+    , m_nextRow(0)
+    , m_mode(mode)
+    , m_mysql(mysql)
+    , m_streamState(StreamState::FINISHED)
+{
+    if (m_result) {
+        // mysql_num_rows() is 0 for a streaming result until the last row is read
+        initializeMetadata();
+    }
+    if (m_mode == ResultMode::STREAMING) {
+        m_streamMutex.reset(new std::mutex());
+        if (m_result) {
+            m_streamState = StreamState::OPEN;
+        }
+        m_rowCount = 0;
+        LOG_DEBUG("QueryResult created in streaming mode with " + std::to_string(m_fieldCount) + " fields");
+    }
+}
+
 QueryResult::~QueryResult() {
     if (m_result) {
-        mysql_free_result(m_result);
-        m_result = nullptr;
+        // a streaming result reads the remaining rows here
+        freeResult();
         LOG_DEBUG("QueryResult destroyed, MySQL result freed");
     }
 }
@@ -41,6 +100,15 @@ QueryResult::QueryResult(QueryResult&& other) noexcept
     , m_rowCount(other.m_rowCount)
     , m_affectedRows(other.m_affectedRows)
     , m_fieldNames(std::move(other.m_fieldNames))
+    , m_fieldTypes(std::move(other.m_fieldTypes))
+    , m_fieldSlots(std::move(other.m_fieldSlots))
+    , m_rows(std::move(other.m_rows))
+    , m_nextRow(other.m_nextRow)
+    , m_rowPointers(std::move(other.m_rowPointers))
+    , m_mode(other.m_mode)
+    , m_mysql(other.m_mysql)
+    , m_streamState(other.m_streamState)
+    , m_streamMutex(std::move(other.m_streamMutex))
 {
     // 清空源对象，避免重复释放
     other.m_result = nullptr;
@@ -49,6 +117,8 @@ QueryResult::QueryResult(QueryResult&& other) noexcept
     other.m_fieldCount = 0;
     other.m_rowCount = 0;
     other.m_affectedRows = 0;
+    other.m_mysql = nullptr;
+    other.m_streamState = StreamState::FINISHED;
 }
 
 // 移动赋值操作符
@@ -67,6 +137,16 @@ QueryResult& QueryResult::operator=(QueryResult&& other) noexcept {
         m_rowCount = other.m_rowCount;
         m_affectedRows = other.m_affectedRows;
         m_fieldNames = std::move(other.m_fieldNames);
+        m_fieldTypes = std::move(other.m_fieldTypes);
+        m_fieldSlots = std::move(other.m_fieldSlots);
+        m_rows = std::move(other.m_rows);
+        m_nextRow = other.m_nextRow;
+        // vector的移动不会搬动元素，m_currentRow仍然指向有效的数组
+        m_rowPointers = std::move(other.m_rowPointers);
+        m_mode = other.m_mode;
+        m_mysql = other.m_mysql;
+        m_streamState = other.m_streamState;
+        m_streamMutex = std::move(other.m_streamMutex);
 
         // 清空源对象
         other.m_result = nullptr;
@@ -75,6 +155,8 @@ QueryResult& QueryResult::operator=(QueryResult&& other) noexcept {
         other.m_fieldCount = 0;
         other.m_rowCount = 0;
         other.m_affectedRows = 0;
+        other.m_mysql = nullptr;
+        other.m_streamState = StreamState::FINISHED;
     }
     return *this;
 }
@@ -96,10 +178,15 @@ void QueryResult::initializeMetadata() {
     MYSQL_FIELD* fields = mysql_fetch_fields(m_result);
     m_fieldNames.clear();
     m_fieldNames.reserve(m_fieldCount);
+    m_fieldTypes.clear();
+    m_fieldTypes.reserve(m_fieldCount);
     
     for (unsigned int i = 0; i < m_fieldCount; ++i) {
         m_fieldNames.push_back(fields[i].name);
+        m_fieldTypes.push_back(fields[i].type);
     }
+    // 字段名哈希表只建一次，之后按名称访问都是O(1)
+    buildFieldIndex();
 
     LOG_DEBUG("QueryResult initialized: " + std::to_string(m_fieldCount) + 
               " fields, " + std::to_string(m_rowCount) + " rows");
@@ -110,6 +197,55 @@ void QueryResult::initializeMetadata() {
 // =========================
 
 bool QueryResult::next() {
+    if (m_mode == ResultMode::STREAMING) {
+        std::lock_guard<std::mutex> lock(*m_streamMutex);
+        if (m_streamState == StreamState::ABORTED) {
+            throw std::runtime_error("Streaming result was aborted by its connection after " +
+                                     std::to_string(m_rowCount) + " rows, the remaining rows are lost");
+        }
+        if (m_streamState == StreamState::FINISHED) {
+            return false;
+        }
+
+        m_currentRow = mysql_fetch_row(m_result);
+        if (m_currentRow) {
+            m_lengths = mysql_fetch_lengths(m_result);
+            m_rowCount++;
+            return true;
+        }
+
+        // NULL means either the end of the result or a read error
+        unsigned int errorCode = m_mysql ? mysql_errno(m_mysql) : 0;
+        std::string errorMsg = m_mysql ? mysql_error(m_mysql) : "";
+        freeResult();
+        m_streamState = StreamState::FINISHED;
+        if (errorCode != 0) {
+            LOG_ERROR("Failed to fetch streaming row after " + std::to_string(m_rowCount) + " rows: " + errorMsg);
+            throw db::SQLExecutionError(errorMsg + " (Code: " + std::to_string(errorCode) + ")", errorCode);
+        }
+        LOG_DEBUG("Streaming result finished, rows: " + std::to_string(m_rowCount));
+        return false;
+    }
+
+    if (m_rows) {
+        if (m_nextRow >= m_rowCount) {
+            m_currentRow = nullptr;
+            m_lengths = nullptr;
+            return false;
+        }
+        size_t base = static_cast<size_t>(m_nextRow) * m_fieldCount;
+        for (unsigned int i = 0; i < m_fieldCount; ++i) {
+            size_t offset = m_rows->offsets[base + i];
+            // getter只读不写，这里去掉const只是为了和MYSQL_ROW共用同一套访问代码
+            m_rowPointers[i] = offset == ResultRows::NULL_VALUE ?
+                nullptr : const_cast<char*>(m_rows->data.data() + offset);
+        }
+        m_currentRow = m_rowPointers.data();
+        m_lengths = const_cast<unsigned long*>(m_rows->lengths.data() + base);
+        m_nextRow++;
+        return true;
+    }
+
     if (!m_result) {
         return false;
     }
@@ -124,6 +260,18 @@ bool QueryResult::next() {
 }
 
 bool QueryResult::reset() {
+    if (m_mode == ResultMode::STREAMING) {
+        LOG_WARNING("QueryResult::reset is not supported for a streaming result, run the query again instead");
+        return false;
+    }
+
+    if (m_rows) {
+        m_nextRow = 0;
+        m_currentRow = nullptr;
+        m_lengths = nullptr;
+        return true;
+    }
+
     if (!m_result) {
         return false;
     }
@@ -135,6 +283,87 @@ bool QueryResult::reset() {
     return true;
 }
 
+ResultRowsPtr QueryResult::toRows() {
+    if (m_mode == ResultMode::STREAMING) {
+        throw std::runtime_error("QueryResult::toRows is not supported for a streaming result");
+    }
+    if (m_rows) {
+        reset();
+        return m_rows;
+    }
+    if (!m_result) {
+        return nullptr;
+    }
+
+    auto rows = std::make_shared<ResultRows>();
+    rows->fieldNames = m_fieldNames;
+    rows->fieldTypes = m_fieldTypes;
+    size_t cells = static_cast<size_t>(m_rowCount) * m_fieldCount;
+    rows->offsets.reserve(cells);
+    rows->lengths.reserve(cells);
+    mysql_data_seek(m_result, 0);
+    while (MYSQL_ROW row = mysql_fetch_row(m_result)) {
+        unsigned long* lengths = mysql_fetch_lengths(m_result);
+        for (unsigned int i = 0; i < m_fieldCount; ++i) {
+            if (row[i] == nullptr) {
+                rows->appendNull();
+            } else {
+                rows->appendValue(row[i], lengths[i]);
+            }
+        }
+        rows->rowCount++;
+    }
+    // 复制过程中移动了游标，回到第一行之前
+    reset();
+    return rows;
+}
+
+void QueryResult::close() {
+    if (m_mode == ResultMode::STREAMING) {
+        std::lock_guard<std::mutex> lock(*m_streamMutex);
+        if (m_streamState == StreamState::OPEN) {
+            freeResult();
+            m_streamState = StreamState::FINISHED;
+        }
+        return;
+    }
+    freeResult();
+    m_rows.reset();
+    m_rowCount = 0;
+}
+
+void QueryResult::abortStream() {
+    if (m_mode != ResultMode::STREAMING) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(*m_streamMutex);
+    if (m_streamState == StreamState::OPEN) {
+        freeResult();
+        m_streamState = StreamState::ABORTED;
+    }
+}
+
+void QueryResult::freeResult() {
+    if (m_result) {
+        mysql_free_result(m_result);
+        m_result = nullptr;
+    }
+    m_currentRow = nullptr;
+    m_lengths = nullptr;
+}
+
+ResultMode QueryResult::getMode() const {
+    return m_mode;
+}
+
+bool QueryResult::isStreamOpen() const {
+    if (m_mode != ResultMode::STREAMING) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(*m_streamMutex);
+    return m_streamState == StreamState::OPEN;
+}
+
 // =========================
 // 元数据获取方法
 // =========================
@@ -155,12 +384,29 @@ std::vector<std::string> QueryResult::getFieldNames() const {
     return m_fieldNames;
 }
 
+const std::vector<enum_field_types>& QueryResult::getFieldTypes() const {
+    return m_fieldTypes;
+}
+
+Column QueryResult::findColumn(ColumnName fieldName) const {
+    return Column(getFieldIndex(fieldName));
+}
+
+bool QueryResult::hasColumn(ColumnName fieldName) const {
+    return lookupField(fieldName.data(), fieldName.size()) >= 0;
+}
+
 bool QueryResult::isEmpty() const {
+    if (m_mode == ResultMode::STREAMING) {
+        // the row count is only known once the stream has ended
+        std::lock_guard<std::mutex> lock(*m_streamMutex);
+        return m_streamState != StreamState::OPEN && m_rowCount == 0;
+    }
     return m_rowCount == 0;
 }
 
 bool QueryResult::hasResultSet() const {
-    return m_result != nullptr;
+    return m_result != nullptr || m_rows != nullptr || m_mode == ResultMode::STREAMING;
 }
 
 // =========================
@@ -185,6 +431,11 @@ int QueryResult::getInt(unsigned int index) const {
     if (m_currentRow[index] == nullptr) {
         return 0;  // NULL值返回0
     }
+    int value = 0;
+    if (FieldView(m_currentRow[index], m_lengths[index]).toInt(value)) {
+        return value;
+    }
+    // 不是完整的整数（例如DECIMAL），保持原来std::stoi的前缀转换语义
     return safeConvert(m_currentRow[index], 0);
 }
 
@@ -195,7 +446,10 @@ long long QueryResult::getLong(unsigned int index) const {
     if (m_currentRow[index] == nullptr) {
         return 0LL;  // NULL值返回0
     }
-
+    long long value = 0;
+    if (FieldView(m_currentRow[index], m_lengths[index]).toLong(value)) {
+        return value;
+    }
     return safeConvert(m_currentRow[index], 0LL);
 }
 
@@ -206,7 +460,10 @@ double QueryResult::getDouble(unsigned int index) const {
     if (m_currentRow[index] == nullptr) {
         return 0.0;  // NULL值返回0.0
     }
-
+    double value = 0.0;
+    if (FieldView(m_currentRow[index], m_lengths[index]).toDouble(value)) {
+        return value;
+    }
     return safeConvert(m_currentRow[index], 0.0);
 }
 
@@ -217,42 +474,144 @@ bool QueryResult::isNull(unsigned int index) const {
     return m_currentRow[index] == nullptr;
 }
 
+FieldView QueryResult::getView(unsigned int index) const {
+    checkIndex(index);
+    checkRow();
+
+    if (m_currentRow[index] == nullptr) {
+        return FieldView();
+    }
+    return FieldView(m_currentRow[index], m_lengths[index]);
+}
+
+bool QueryResult::tryGetInt(unsigned int index, int& value) const {
+    return getView(index).toInt(value);
+}
+
+bool QueryResult::tryGetLong(unsigned int index, long long& value) const {
+    return getView(index).toLong(value);
+}
+
+bool QueryResult::tryGetUnsignedLong(unsigned int index, unsigned long long& value) const {
+    return getView(index).toUnsignedLong(value);
+}
+
+bool QueryResult::tryGetDouble(unsigned int index, double& value) const {
+    return getView(index).toDouble(value);
+}
+
 // =========================
 // 数据访问方法（按字段名）
 // =========================
 
-std::string QueryResult::getString(const std::string& fieldName) const {
+std::string QueryResult::getString(ColumnName fieldName) const {
     return getString(getFieldIndex(fieldName));
 }
 
-int QueryResult::getInt(const std::string& fieldName) const {
+int QueryResult::getInt(ColumnName fieldName) const {
     return getInt(getFieldIndex(fieldName));
 }
 
-long long QueryResult::getLong(const std::string& fieldName) const {
+long long QueryResult::getLong(ColumnName fieldName) const {
     return getLong(getFieldIndex(fieldName));
 }
 
-double QueryResult::getDouble(const std::string& fieldName) const {
+double QueryResult::getDouble(ColumnName fieldName) const {
     return getDouble(getFieldIndex(fieldName));
 }
 
-bool QueryResult::isNull(const std::string& fieldName) const {
+bool QueryResult::isNull(ColumnName fieldName) const {
     return isNull(getFieldIndex(fieldName));
 }
 
+FieldView QueryResult::getView(ColumnName fieldName) const {
+    return getView(getFieldIndex(fieldName));
+}
+
+bool QueryResult::tryGetInt(ColumnName fieldName, int& value) const {
+    return tryGetInt(getFieldIndex(fieldName), value);
+}
+
+bool QueryResult::tryGetLong(ColumnName fieldName, long long& value) const {
+    return tryGetLong(getFieldIndex(fieldName), value);
+}
+
+bool QueryResult::tryGetUnsignedLong(ColumnName fieldName, unsigned long long& value) const {
+    return tryGetUnsignedLong(getFieldIndex(fieldName), value);
+}
+
+bool QueryResult::tryGetDouble(ColumnName fieldName, double& value) const {
+    return tryGetDouble(getFieldIndex(fieldName), value);
+}
+
 // =========================
 // 私有辅助方法
 // =========================
 
-unsigned int QueryResult::getFieldIndex(const std::string& fieldName) const {
-    for (unsigned int i = 0; i < m_fieldNames.size(); ++i) {
-        if (m_fieldNames[i] == fieldName) {
-            return i;
+namespace {
+
+// FNV-1a，字段名很短，足够均匀
+uint32_t hashFieldName(const char* name, size_t size) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<unsigned char>(name[i]);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+} // namespace
+
+void QueryResult::buildFieldIndex() {
+    m_fieldSlots.clear();
+    if (m_fieldNames.empty()) {
+        return;
+    }
+    // 装载因子不超过1/2，容量为2的幂，用位与代替取模
+    size_t capacity = 8;
+    while (capacity < m_fieldNames.size() * 2) {
+        capacity <<= 1;
+    }
+    m_fieldSlots.assign(capacity, -1);
+
+    for (size_t i = 0; i < m_fieldNames.size(); ++i) {
+        const std::string& name = m_fieldNames[i];
+        // 同名字段保留第一个，与原来线性查找的结果一致
+        if (lookupField(name.data(), name.size()) >= 0) {
+            continue;
+        }
+        size_t slot = hashFieldName(name.data(), name.size()) & (capacity - 1);
+        while (m_fieldSlots[slot] >= 0) {
+            slot = (slot + 1) & (capacity - 1);
         }
+        m_fieldSlots[slot] = static_cast<int>(i);
+    }
+}
+
+int QueryResult::lookupField(const char* name, size_t size) const {
+    if (m_fieldSlots.empty() || name == nullptr) {
+        return -1;
+    }
+    size_t mask = m_fieldSlots.size() - 1;
+    size_t slot = hashFieldName(name, size) & mask;
+    // 线性探测，遇到空槽说明不存在
+    while (m_fieldSlots[slot] >= 0) {
+        const std::string& candidate = m_fieldNames[m_fieldSlots[slot]];
+        if (candidate.size() == size && std::memcmp(candidate.data(), name, size) == 0) {
+            return m_fieldSlots[slot];
+        }
+        slot = (slot + 1) & mask;
+    }
+    return -1;
+}
+
+unsigned int QueryResult::getFieldIndex(ColumnName fieldName) const {
+    int index = lookupField(fieldName.data(), fieldName.size());
+    if (index >= 0) {
+        return static_cast<unsigned int>(index);
     }
 
-    throw std::out_of_range("Field name not found: " + fieldName);
+    throw std::out_of_range("Field name not found: " + fieldName.toString());
 }
 
 void QueryResult::checkIndex(unsigned int index) const {
@@ -0,0 +1,214 @@
+#include "query_trace.h"
+#include "logger.h"
+#include <cstdio>
+#include <exception>
+
+
+namespace {
+
+const char* const PHASE_NAMES[TRACE_PHASE_COUNT] = {
+    "pool_wait", "connect", "reconnect", "query", "fetch"
+};
+
+// uniform in [0, 1), one generator per thread so sampling never contends
+double nextSampleValue() {
+    static thread_local uint64_t state =
+        static_cast<uint64_t>(traceClockMicros()) ^ reinterpret_cast<uintptr_t>(&state) ^ 0x9E3779B97F4A7C15ULL;
+    // xorshift64*
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return ((state * 0x2545F4914F6CDD1DULL) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+void appendJsonString(std::string& out, const std::string& value) {
+    out += '"';
+    for (char c : value) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char buffer[8];
+                    std::snprintf(buffer, sizeof(buffer), "\\u%04x", static_cast<unsigned char>(c));
+                    out += buffer;
+                } else {
+                    out += c;
+                }
+        }
+    }
+    out += '"';
+}
+
+} // namespace
+
+
+const char* tracePhaseName(TracePhase phase) {
+    size_t index = static_cast<size_t>(phase);
+    return index < TRACE_PHASE_COUNT ? PHASE_NAMES[index] : "unknown";
+}
+
+
+QuerySpan::QuerySpan()
+    : backendId(0)
+    , isQuery(true)
+    , startMicros(0)
+    , durationMicros(0)
+    , reconnects(0)
+    , success(false)
+    , errorCode(0)
+    , sampled(false)
+    , slow(false) {
+    for (size_t i = 0; i < TRACE_PHASE_COUNT; i++) {
+        phaseMicros[i] = 0;
+    }
+}
+
+
+std::string QuerySpan::toJson() const {
+    std::string json;
+    json.reserve(256 + sql.size());
+    json += "{\"pool\":";
+    appendJsonString(json, pool);
+    json += ",\"backend\":";
+    appendJsonString(json, backend);
+    json += ",\"backend_id\":" + std::to_string(backendId);
+    json += ",\"connection\":";
+    appendJsonString(json, connectionId);
+    json += ",\"kind\":";
+    json += isQuery ? "\"query\"" : "\"update\"";
+    json += ",\"sql\":";
+    appendJsonString(json, sql);
+    json += ",\"start_us\":" + std::to_string(startMicros);
+    json += ",\"duration_us\":" + std::to_string(durationMicros);
+    json += ",\"phases_us\":{";
+    for (size_t i = 0; i < TRACE_PHASE_COUNT; i++) {
+        if (i > 0) {
+            json += ',';
+        }
+        json += '"';
+        json += PHASE_NAMES[i];
+        json += "\":" + std::to_string(phaseMicros[i]);
+    }
+    json += "},\"reconnects\":" + std::to_string(reconnects);
+    json += ",\"success\":";
+    json += success ? "true" : "false";
+    if (!success) {
+        json += ",\"error_code\":" + std::to_string(errorCode);
+        json += ",\"error\":";
+        appendJsonString(json, error);
+    }
+    json += ",\"sampled\":";
+    json += sampled ? "true" : "false";
+    json += ",\"slow\":";
+    json += slow ? "true" : "false";
+    json += '}';
+    return json;
+}
+
+
+QueryTracer::QueryTracer(const std::string& poolName)
+    : m_poolName(poolName)
+    , m_active(false)
+    , m_sampleRate(0)
+    , m_slowThresholdMicros(0)
+    , m_nextSinkId(1)
+    , m_emitted(0)
+    , m_slow(0) {
+}
+
+
+void QueryTracer::configure(double sampleRate, unsigned int slowQueryThreshold) {
+    if (!(sampleRate > 0)) {
+        sampleRate = 0;
+    } else if (sampleRate > 1) {
+        sampleRate = 1;
+    }
+    m_sampleRate.store(sampleRate, std::memory_order_relaxed);
+    m_slowThresholdMicros.store(static_cast<int64_t>(slowQueryThreshold) * 1000, std::memory_order_relaxed);
+    m_active.store(sampleRate > 0 || slowQueryThreshold > 0, std::memory_order_relaxed);
+}
+
+
+double QueryTracer::getSampleRate() const {
+    return m_sampleRate.load(std::memory_order_relaxed);
+}
+
+
+int64_t QueryTracer::getSlowThresholdMicros() const {
+    return m_slowThresholdMicros.load(std::memory_order_relaxed);
+}
+
+
+bool QueryTracer::shouldTrace(bool& sampled) const {
+    double rate = m_sampleRate.load(std::memory_order_relaxed);
+    sampled = rate >= 1 || (rate > 0 && nextSampleValue() < rate);
+    return sampled || m_slowThresholdMicros.load(std::memory_order_relaxed) > 0;
+}
+
+
+bool QueryTracer::shouldEmit(bool sampled, int64_t durationMicros) const {
+    if (sampled) {
+        return true;
+    }
+    int64_t threshold = m_slowThresholdMicros.load(std::memory_order_relaxed);
+    return threshold > 0 && durationMicros >= threshold;
+}
+
+
+void QueryTracer::emit(QuerySpan& span) {
+    int64_t threshold = m_slowThresholdMicros.load(std::memory_order_relaxed);
+    span.pool = m_poolName;
+    span.slow = threshold > 0 && span.durationMicros >= threshold;
+    m_emitted.fetch_add(1, std::memory_order_relaxed);
+    if (span.slow) {
+        m_slow.fetch_add(1, std::memory_order_relaxed);
+        LOG_WARNING("Slow query: " + span.toJson());
+    }
+
+    std::shared_ptr<const SinkList> sinks = m_sinks.load();
+    for (const auto& sink : *sinks) {
+        try {
+            sink.second(span);
+        } catch (const std::exception& e) {
+            LOG_WARNING("QueryTracer::emit trace sink " + std::to_string(sink.first) + " failed: " + e.what());
+        }
+    }
+}
+
+
+size_t QueryTracer::addSink(TraceSink sink) {
+    std::lock_guard<std::mutex> lock(m_sinkMutex);
+    SinkList sinks = *m_sinks.load();
+    size_t id = m_nextSinkId++;
+    sinks.emplace_back(id, std::move(sink));
+    m_sinks.store(std::move(sinks));
+    return id;
+}
+
+
+bool QueryTracer::removeSink(size_t id) {
+    std::lock_guard<std::mutex> lock(m_sinkMutex);
+    SinkList sinks = *m_sinks.load();
+    for (auto it = sinks.begin(); it != sinks.end(); ++it) {
+        if (it->first == id) {
+            sinks.erase(it);
+            m_sinks.store(std::move(sinks));
+            return true;
+        }
+    }
+    return false;
+}
+
+
+uint64_t QueryTracer::getEmittedCount() const {
+    return m_emitted.load(std::memory_order_relaxed);
+}
+
+
+uint64_t QueryTracer::getSlowCount() const {
+    return m_slow.load(std::memory_order_relaxed);
+}
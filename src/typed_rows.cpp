@@ -0,0 +1,126 @@
+#include "typed_rows.h"
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+const size_t StringArena::DEFAULT_CHUNK_SIZE;
+
+
+StringArena::StringArena(size_t chunkSize)
+    : m_chunkSize(std::max<size_t>(chunkSize, 1))
+    , m_next(nullptr)
+    , m_remaining(0)
+    , m_capacity(0) {
+}
+
+
+const char* StringArena::append(const char* data, size_t size) {
+    // never null, an empty value must not read as a NULL FieldView
+    static const char empty = '\0';
+    if (size == 0) {
+        return &empty;
+    }
+    if (size > m_remaining) {
+        // a large value gets a chunk of its own, the free space of the current chunk is kept
+        if (size > m_chunkSize / 2) {
+            std::unique_ptr<char[]> chunk(new char[size]);
+            char* copy = chunk.get();
+            std::memcpy(copy, data, size);
+            m_chunks.insert(m_chunks.empty() ? m_chunks.end() : std::prev(m_chunks.end()), std::move(chunk));
+            m_capacity += size;
+            return copy;
+        }
+        m_chunks.emplace_back(new char[m_chunkSize]);
+        m_next = m_chunks.back().get();
+        m_remaining = m_chunkSize;
+        m_capacity += m_chunkSize;
+    }
+    char* copy = m_next;
+    std::memcpy(copy, data, size);
+    m_next += size;
+    m_remaining -= size;
+    return copy;
+}
+
+
+void StringArena::clear() {
+    if (m_next == nullptr) {
+        m_chunks.clear();
+        m_capacity = 0;
+        return;
+    }
+    // the last chunk is always a regular one once m_next is set
+    std::unique_ptr<char[]> chunk = std::move(m_chunks.back());
+    m_chunks.clear();
+    m_next = chunk.get();
+    m_chunks.push_back(std::move(chunk));
+    m_remaining = m_chunkSize;
+    m_capacity = m_chunkSize;
+}
+
+
+namespace typed_rows_detail {
+
+bool isIntegerType(enum_field_types type) {
+    switch (type) {
+        case MYSQL_TYPE_TINY:
+        case MYSQL_TYPE_SHORT:
+        case MYSQL_TYPE_LONG:
+        case MYSQL_TYPE_INT24:
+        case MYSQL_TYPE_LONGLONG:
+        case MYSQL_TYPE_YEAR:
+            return true;
+        default:
+            return false;
+    }
+}
+
+
+bool isNumericType(enum_field_types type) {
+    switch (type) {
+        case MYSQL_TYPE_FLOAT:
+        case MYSQL_TYPE_DOUBLE:
+        case MYSQL_TYPE_DECIMAL:
+        case MYSQL_TYPE_NEWDECIMAL:
+            return true;
+        default:
+            return isIntegerType(type);
+    }
+}
+
+
+const char* fieldTypeName(enum_field_types type) {
+    switch (type) {
+        case MYSQL_TYPE_TINY: return "TINYINT";
+        case MYSQL_TYPE_SHORT: return "SMALLINT";
+        case MYSQL_TYPE_LONG: return "INT";
+        case MYSQL_TYPE_INT24: return "MEDIUMINT";
+        case MYSQL_TYPE_LONGLONG: return "BIGINT";
+        case MYSQL_TYPE_YEAR: return "YEAR";
+        case MYSQL_TYPE_FLOAT: return "FLOAT";
+        case MYSQL_TYPE_DOUBLE: return "DOUBLE";
+        case MYSQL_TYPE_DECIMAL:
+        case MYSQL_TYPE_NEWDECIMAL: return "DECIMAL";
+        case MYSQL_TYPE_BIT: return "BIT";
+        case MYSQL_TYPE_DATE:
+        case MYSQL_TYPE_NEWDATE: return "DATE";
+        case MYSQL_TYPE_TIME: return "TIME";
+        case MYSQL_TYPE_DATETIME: return "DATETIME";
+        case MYSQL_TYPE_TIMESTAMP: return "TIMESTAMP";
+        case MYSQL_TYPE_JSON: return "JSON";
+        case MYSQL_TYPE_ENUM: return "ENUM";
+        case MYSQL_TYPE_SET: return "SET";
+        case MYSQL_TYPE_GEOMETRY: return "GEOMETRY";
+        case MYSQL_TYPE_TINY_BLOB:
+        case MYSQL_TYPE_MEDIUM_BLOB:
+        case MYSQL_TYPE_LONG_BLOB:
+        case MYSQL_TYPE_BLOB: return "BLOB/TEXT";
+        case MYSQL_TYPE_VARCHAR:
+        case MYSQL_TYPE_VAR_STRING:
+        case MYSQL_TYPE_STRING: return "CHAR/VARCHAR";
+        case MYSQL_TYPE_NULL: return "NULL";
+        default: return "unknown";
+    }
+}
+
+} // namespace typed_rows_detail
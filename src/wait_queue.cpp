@@ -0,0 +1,97 @@
+#include "wait_queue.h"
+#include "utils.h"
+#include <atomic>
+
+
+const uint64_t WaitQueue::MIN_SAMPLES;
+
+
+namespace {
+
+// shared by all queues, a waiter that moves to another backend keeps its arrival order
+std::atomic<uint64_t> nextSequence{1};
+
+} // namespace
+
+
+WaitQueue::WaitQueue()
+    : m_lastHandOffMicros(0)
+    , m_handOffIntervalMicros(0.0)
+    , m_samples(0) {
+}
+
+
+void WaitQueue::push(AcquireWaiter* waiter) {
+    if (waiter->sequence == 0) {
+        waiter->sequence = nextSequence.fetch_add(1, std::memory_order_relaxed);
+        waiter->enqueuedMicros = Utils::currentTimeMicros();
+    }
+    waiter->retry = false;
+    m_waiters.insert(waiter);
+}
+
+
+void WaitQueue::remove(AcquireWaiter* waiter) {
+    m_waiters.erase(waiter);
+    if (m_waiters.empty()) {
+        m_lastHandOffMicros = 0;
+    }
+}
+
+
+size_t WaitQueue::countAhead(AcquirePriority priority) const {
+    size_t ahead = 0;
+    for (const AcquireWaiter* waiter : m_waiters) {
+        if (waiter->priority < priority) {
+            break;
+        }
+        ahead++;
+    }
+    return ahead;
+}
+
+
+bool WaitQueue::handOff(Connection* connection) {
+    if (m_waiters.empty()) {
+        return false;
+    }
+    AcquireWaiter* waiter = *m_waiters.begin();
+    m_waiters.erase(m_waiters.begin());
+    waiter->connection = connection;
+    waiter->condition.notify_one();
+
+    // only intervals with a backlog say how fast the backend frees connections
+    int64_t now = Utils::currentTimeMicros();
+    if (m_lastHandOffMicros > 0) {
+        double interval = static_cast<double>(now - m_lastHandOffMicros);
+        m_handOffIntervalMicros = m_samples == 0 ? interval : 0.8 * m_handOffIntervalMicros + 0.2 * interval;
+        m_samples++;
+    }
+    m_lastHandOffMicros = m_waiters.empty() ? 0 : now;
+    return true;
+}
+
+
+void WaitQueue::wakeFront() {
+    if (!m_waiters.empty()) {
+        AcquireWaiter* waiter = *m_waiters.begin();
+        waiter->retry = true;
+        waiter->condition.notify_one();
+    }
+}
+
+
+void WaitQueue::wakeAll() {
+    for (AcquireWaiter* waiter : m_waiters) {
+        waiter->retry = true;
+        waiter->condition.notify_one();
+    }
+}
+
+
+int64_t WaitQueue::estimateWaitMicros(size_t ahead) const {
+    if (m_samples < MIN_SAMPLES) {
+        return -1;
+    }
+    return static_cast<int64_t>(m_handOffIntervalMicros * (ahead + 1));
+}
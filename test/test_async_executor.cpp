@@ -0,0 +1,275 @@
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <atomic>
+#include <future>
+#include <stdexcept>
+#include "async_executor.h"
+#include "connection_pool.h"
+#include "pool_config.h"
+#include "logger.h"
+
+/**
+ * @brief 非阻塞执行测试
+ *
+ * 重点验证：
+ * 1. 一个事件循环线程同时驱动多个连接上的查询，结果通过future返回
+ * 2. 更新操作通过回调返回受影响的行数，连接在回调前归还连接池
+ * 3. 超过超时时间的语句失败，连接被关闭，不影响后续语句
+ * 4. 停止后提交语句抛出异常
+ * 5. 回调中（事件循环线程上）提交语句抛出异常，不会阻塞事件循环
+ * 6. 开启线程本地缓存时，事件循环线程归还的连接回到连接池，不留在事件循环线程中
+ */
+
+// 测试数据库连接参数
+const std::string TEST_HOST = "127.0.0.1";
+const std::string TEST_USER = "mxk";
+const std::string TEST_PASSWORD = "d2v8s2q3";
+const std::string TEST_DATABASE = "testdb";
+const unsigned int TEST_PORT = 3306;
+
+void printTestHeader(const std::string& title) {
+    std::cout << "\n" << std::string(60, '=') << std::endl;
+    std::cout << "  " << title << std::endl;
+    std::cout << std::string(60, '=') << std::endl;
+}
+
+bool testConcurrentFutures(ConnectionPool& pool) {
+    printTestHeader("测试单个事件循环并发执行查询");
+
+    try {
+        AsyncExecutor executor(pool, 1);
+        // 8条各睡眠200ms的查询，串行需要1.6秒
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::future<QueryResultPtr>> results;
+        for (int i = 0; i < 8; i++) {
+            results.push_back(executor.executeQuery("SELECT SLEEP(0.2), " + std::to_string(i) + " AS id",
+                                                    AccessMode::READ_ONLY));
+        }
+        bool ok = true;
+        for (int i = 0; i < 8; i++) {
+            QueryResultPtr result = results[i].get();
+            ok = ok && result->next() && result->getInt("id") == i;
+        }
+        int64_t elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        std::cout << "非阻塞API: " << (AsyncExecutor::isNonBlocking() ? "是" : "否")
+                  << ", 8条查询耗时: " << elapsedMs << "ms" << std::endl;
+        if (AsyncExecutor::isNonBlocking()) {
+            ok = ok && elapsedMs < 1200;
+        }
+        return ok && executor.getInFlight() == 0;
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool testUpdateCallback(ConnectionPool& pool) {
+    printTestHeader("测试更新回调");
+
+    try {
+        {
+            PooledConnection conn = pool.acquire();
+            conn->executeUpdate("CREATE TABLE IF NOT EXISTS async_test (id INT PRIMARY KEY, value INT)");
+            conn->executeUpdate("DELETE FROM async_test");
+        }
+
+        AsyncExecutor executor(pool, 2);
+        std::atomic<unsigned long long> affected(0);
+        std::atomic<int> failures(0);
+        std::atomic<size_t> activeInCallback(0);
+        std::promise<void> allDone;
+        std::atomic<int> remaining(10);
+        for (int i = 0; i < 10; i++) {
+            executor.executeUpdate("INSERT INTO async_test VALUES (" + std::to_string(i) + ", " + std::to_string(i * 10) + ")",
+                [&](unsigned long long rows, std::exception_ptr error) {
+                    if (error) {
+                        failures++;
+                    }
+                    affected += rows;
+                    activeInCallback = std::max<size_t>(activeInCallback, pool.getActiveCount());
+                    if (--remaining == 0) {
+                        allDone.set_value();
+                    }
+                });
+        }
+        allDone.get_future().wait();
+
+        // 语法错误通过future中的异常返回
+        bool syntaxError = false;
+        try {
+            executor.executeUpdate("INSERT INTO async_test VALUES (").get();
+        } catch (const std::exception&) {
+            syntaxError = true;
+        }
+
+        unsigned long long deleted = executor.executeUpdate("DELETE FROM async_test").get();
+        std::cout << "插入: " << affected << ", 失败: " << failures << ", 删除: " << deleted
+                  << ", 语法错误: " << (syntaxError ? "已抛出" : "未抛出") << std::endl;
+        return affected == 10 && failures == 0 && deleted == 10 && syntaxError &&
+               activeInCallback < 10 && pool.getActiveCount() == 0;
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool testQueryTimeout(ConnectionPool& pool) {
+    printTestHeader("测试语句超时");
+
+    try {
+        AsyncExecutor executor(pool, 1, 200);
+        auto start = std::chrono::steady_clock::now();
+        std::future<QueryResultPtr> slow = executor.executeQuery("SELECT SLEEP(3)");
+        bool timedOut = false;
+        try {
+            slow.get();
+        } catch (const std::exception& e) {
+            timedOut = true;
+            std::cout << "超时错误: " << e.what() << std::endl;
+        }
+        int64_t elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start).count();
+
+        // 超时关闭的连接被连接池替换，后续查询正常
+        QueryResultPtr result = executor.executeQuery("SELECT 1 AS one").get();
+        bool next = result->next() && result->getInt("one") == 1;
+        std::cout << "超时耗时: " << elapsedMs << "ms" << std::endl;
+        return timedOut && elapsedMs < 1500 && next;
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool testSubmitFromCallback(ConnectionPool& pool) {
+    printTestHeader("测试回调中提交语句");
+
+    try {
+        AsyncExecutor executor(pool, 1);
+        std::promise<bool> rejected;
+        executor.executeQuery("SELECT 1", [&](QueryResultPtr, std::exception_ptr) {
+            try {
+                executor.executeQuery("SELECT 1", [](QueryResultPtr, std::exception_ptr) {});
+                rejected.set_value(false);
+            } catch (const std::runtime_error&) {
+                rejected.set_value(true);
+            }
+        });
+        bool ok = rejected.get_future().get();
+        // 事件循环仍然可用
+        QueryResultPtr result = executor.executeQuery("SELECT 1 AS one").get();
+        ok = ok && result->next() && result->getInt("one") == 1;
+        std::cout << "回调中提交被拒绝: " << (ok ? "是" : "否") << std::endl;
+        return ok && executor.getInFlight() == 0;
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool testStop(ConnectionPool& pool) {
+    printTestHeader("测试停止");
+
+    try {
+        AsyncExecutor executor(pool, 1);
+        std::future<QueryResultPtr> pending = executor.executeQuery("SELECT SLEEP(3)");
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        auto start = std::chrono::steady_clock::now();
+        executor.stop();
+        int64_t stopMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start).count();
+
+        bool pendingFailed = false;
+        try {
+            pending.get();
+        } catch (const std::exception&) {
+            pendingFailed = true;
+        }
+        bool rejected = false;
+        try {
+            executor.executeQuery("SELECT 1");
+        } catch (const std::runtime_error&) {
+            rejected = true;
+        }
+        std::cout << "停止耗时: " << stopMs << "ms, 未完成的语句失败: " << (pendingFailed ? "是" : "否")
+                  << ", 停止后提交被拒绝: " << (rejected ? "是" : "否") << std::endl;
+        bool ok = rejected && executor.getInFlight() == 0;
+        if (AsyncExecutor::isNonBlocking()) {
+            ok = ok && pendingFailed && stopMs < 1000;
+        }
+        return ok;
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool testThreadLocalCache() {
+    printTestHeader("测试开启线程本地缓存时的归还");
+
+    ConnectionPool pool("async_cached");
+    try {
+        PoolConfig config;
+        config.setConnectionLimits(1, 4, 1);
+        config.threadLocalCache = true;
+        config.threadCacheIdleTimeout = 60000;
+        config.readAfterWriteWindow = 1000;
+        pool.initWithSingleDatabase(config, TEST_HOST, TEST_USER, TEST_PASSWORD, TEST_DATABASE, TEST_PORT);
+    } catch (const std::exception& e) {
+        std::cout << "连接池初始化失败: " << e.what() << std::endl;
+        return false;
+    }
+
+    bool ok = false;
+    try {
+        AsyncExecutor executor(pool, 1);
+        for (int i = 0; i < 4; i++) {
+            executor.executeUpdate("DO " + std::to_string(i)).get();
+            executor.executeQuery("SELECT 1", AccessMode::READ_ONLY).get();
+        }
+        // 留在事件循环线程里的连接一直算作借出，这个线程以后也不会再借出它
+        std::cout << "借出中的连接: " << pool.getActiveCount() << ", 空闲连接: " << pool.getIdleCount() << std::endl;
+        ok = pool.getActiveCount() == 0 && executor.getInFlight() == 0;
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+    }
+    pool.shutdown();
+    return ok;
+}
+
+int main() {
+    Logger::getInstance().init("", LogLevel::WARNING, true);
+
+    ConnectionPool pool("async");
+    try {
+        PoolConfig config;
+        config.setConnectionLimits(2, 12, 2);
+        pool.initWithSingleDatabase(config, TEST_HOST, TEST_USER, TEST_PASSWORD, TEST_DATABASE, TEST_PORT);
+    } catch (const std::exception& e) {
+        std::cout << "连接池初始化失败: " << e.what() << std::endl;
+        return 1;
+    }
+
+    std::vector<std::pair<std::string, bool>> results;
+    results.emplace_back("单个事件循环并发执行查询", testConcurrentFutures(pool));
+    results.emplace_back("更新回调", testUpdateCallback(pool));
+    results.emplace_back("语句超时", testQueryTimeout(pool));
+    results.emplace_back("回调中提交语句", testSubmitFromCallback(pool));
+    results.emplace_back("停止", testStop(pool));
+    results.emplace_back("线程本地缓存", testThreadLocalCache());
+
+    pool.shutdown();
+
+    size_t passed = 0;
+    std::cout << "\n" << std::string(60, '*') << std::endl;
+    for (const auto& result : results) {
+        std::cout << (result.second ? "成功" : "失败") << " " << result.first << std::endl;
+        if (result.second) passed++;
+    }
+    std::cout << "\n通过: " << passed << "/" << results.size() << " 项测试" << std::endl;
+
+    return (passed == results.size()) ? 0 : 1;
+}
@@ -0,0 +1,202 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <cstdio>
+#include "logger.h"
+
+/**
+ * @brief 异步日志测试
+ *
+ * 重点验证：
+ * 1. 缓冲区满且允许丢弃时，DEBUG/INFO被丢弃并计数，写出条数+丢弃条数等于总条数
+ * 2. 级别未开启时LOG_*宏不计算消息参数
+ * 3. 多线程写日志，flush()之后条数完整，每个线程内的顺序不变
+ * 4. FATAL日志返回时已经写入文件，同步模式下每条日志立即写入
+ * 5. 同步与异步模式的调用方耗时对比
+ */
+
+const std::string LOG_FILE = "test_async_logger.log";
+
+void printTestHeader(const std::string& title) {
+    std::cout << "\n" << std::string(60, '=') << std::endl;
+    std::cout << "  " << title << std::endl;
+    std::cout << std::string(60, '=') << std::endl;
+}
+
+std::vector<std::string> readLines() {
+    std::vector<std::string> lines;
+    std::ifstream in(LOG_FILE);
+    std::string line;
+    while (std::getline(in, line)) {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+size_t countContaining(const std::vector<std::string>& lines, const std::string& text) {
+    size_t count = 0;
+    for (const auto& line : lines) {
+        if (line.find(text) != std::string::npos) {
+            count++;
+        }
+    }
+    return count;
+}
+
+bool testDropWhenFull() {
+    printTestHeader("测试缓冲区满时丢弃低级别日志");
+
+    std::remove(LOG_FILE.c_str());
+    LoggerOptions options;
+    options.bufferCapacity = 16;
+    options.dropWhenFull = true;
+    Logger::getInstance().init(LOG_FILE, LogLevel::INFO, false, options);
+
+    const int threads = 4;
+    const int perThread = 20000;
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([t]() {
+            for (int i = 0; i < perThread; i++) {
+                LOG_INFO("drop " + std::to_string(t) + " " + std::to_string(i));
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    Logger::getInstance().flush();
+
+    size_t written = countContaining(readLines(), "] drop ");
+    uint64_t dropped = Logger::getInstance().getDroppedCount();
+    std::cout << "写出: " << written << ", 丢弃: " << dropped << std::endl;
+    return written + dropped == static_cast<size_t>(threads * perThread);
+}
+
+bool testLazyEvaluation() {
+    printTestHeader("测试级别未开启时不计算消息");
+
+    LoggerOptions options;
+    Logger::getInstance().init(LOG_FILE, LogLevel::WARNING, false, options);
+
+    int evaluated = 0;
+    auto expensive = [&evaluated]() {
+        evaluated++;
+        return std::string("expensive message");
+    };
+    for (int i = 0; i < 1000; i++) {
+        LOG_DEBUG(expensive());
+        LOG_INFO(expensive());
+    }
+    LOG_WARNING(expensive());
+    std::cout << "消息被计算的次数: " << evaluated << std::endl;
+    return evaluated == 1;
+}
+
+bool testMultiThreadOrder() {
+    printTestHeader("测试多线程写日志的完整性与顺序");
+
+    std::remove(LOG_FILE.c_str());
+    Logger::getInstance().init(LOG_FILE, LogLevel::INFO, false);
+
+    const int threads = 8;
+    const int perThread = 5000;
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([t]() {
+            for (int i = 0; i < perThread; i++) {
+                LOG_INFO("order " + std::to_string(t) + " " + std::to_string(i));
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    Logger::getInstance().flush();
+
+    std::vector<int> next(threads, 0);
+    size_t count = 0;
+    for (const auto& line : readLines()) {
+        int t = 0, i = 0;
+        size_t pos = line.find("] order ");
+        if (pos == std::string::npos || std::sscanf(line.c_str() + pos, "] order %d %d", &t, &i) != 2) {
+            continue;
+        }
+        if (t < 0 || t >= threads || next[t] != i) {
+            std::cout << "线程" << t << "的日志顺序不正确: " << line << std::endl;
+            return false;
+        }
+        next[t]++;
+        count++;
+    }
+    std::cout << "写出 " << count << " 条日志" << std::endl;
+    return count == static_cast<size_t>(threads * perThread);
+}
+
+bool testFatalAndSync() {
+    printTestHeader("测试FATAL和同步模式立即写出");
+
+    std::remove(LOG_FILE.c_str());
+    Logger::getInstance().init(LOG_FILE, LogLevel::INFO, false);
+    // flushInterval很长，只有FATAL会等待写出
+    LOG_INFO("before fatal");
+    LOG_FATAL("fatal message");
+    std::vector<std::string> lines = readLines();
+    bool ok = countContaining(lines, "before fatal") == 1 && countContaining(lines, "[FATAL] fatal message") == 1;
+
+    LoggerOptions options;
+    options.async = false;
+    Logger::getInstance().init(LOG_FILE, LogLevel::INFO, false, options);
+    LOG_INFO("sync message");
+    ok = ok && countContaining(readLines(), "sync message") == 1;
+    return ok;
+}
+
+bool testCallerLatency() {
+    printTestHeader("测试同步与异步模式的调用方耗时");
+
+    const int count = 50000;
+    int64_t elapsed[2] = {0, 0};
+    for (int mode = 0; mode < 2; mode++) {
+        std::remove(LOG_FILE.c_str());
+        LoggerOptions options;
+        options.async = mode == 1;
+        Logger::getInstance().init(LOG_FILE, LogLevel::INFO, false, options);
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < count; i++) {
+            LOG_INFO("latency message " + std::to_string(i));
+        }
+        elapsed[mode] = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        Logger::getInstance().flush();
+    }
+    std::cout << "同步模式 " << count << " 条: " << elapsed[0] << "us" << std::endl;
+    std::cout << "异步模式 " << count << " 条: " << elapsed[1] << "us" << std::endl;
+    return countContaining(readLines(), "latency message") == static_cast<size_t>(count);
+}
+
+int main() {
+    std::vector<std::pair<std::string, bool>> results;
+    results.emplace_back("缓冲区满时丢弃低级别日志", testDropWhenFull());
+    results.emplace_back("级别未开启时不计算消息", testLazyEvaluation());
+    results.emplace_back("多线程写日志的完整性与顺序", testMultiThreadOrder());
+    results.emplace_back("FATAL和同步模式立即写出", testFatalAndSync());
+    results.emplace_back("调用方耗时对比", testCallerLatency());
+
+    std::remove(LOG_FILE.c_str());
+
+    size_t passed = 0;
+    std::cout << "\n" << std::string(60, '*') << std::endl;
+    for (const auto& result : results) {
+        std::cout << (result.second ? "成功" : "失败") << " " << result.first << std::endl;
+        if (result.second) passed++;
+    }
+    std::cout << "\n通过: " << passed << "/" << results.size() << " 项测试" << std::endl;
+
+    return (passed == results.size()) ? 0 : 1;
+}
@@ -0,0 +1,246 @@
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <atomic>
+#include <stdexcept>
+#include "connection_pool.h"
+#include "pool_autoscaler.h"
+#include "pool_config.h"
+#include "logger.h"
+
+/**
+ * @brief 自动伸缩测试
+ *
+ * 重点验证：
+ * 1. 需求上升时按趋势提前扩容，需求回落后等待一段时间才逐步收缩
+ * 2. 排队超过阈值时按排队数量立即扩容，目标始终在最小和最大连接数之间
+ * 3. 连接池在突发流量下扩容，流量结束后收缩回最小连接数
+ * 4. 健康检查周期按毫秒计算，关闭连接池不用等满一个周期
+ */
+
+// 测试数据库连接参数
+const std::string TEST_HOST = "127.0.0.1";
+const std::string TEST_USER = "mxk";
+const std::string TEST_PASSWORD = "d2v8s2q3";
+const std::string TEST_DATABASE = "testdb";
+const unsigned int TEST_PORT = 3306;
+
+void printTestHeader(const std::string& title) {
+    std::cout << "\n" << std::string(60, '=') << std::endl;
+    std::cout << "  " << title << std::endl;
+    std::cout << std::string(60, '=') << std::endl;
+}
+
+AutoscalePolicy testPolicy() {
+    AutoscalePolicy policy;
+    policy.minConnections = 2;
+    policy.maxConnections = 40;
+    policy.targetUtilization = 0.5;
+    policy.maxAcquireWaitMicros = 10000;
+    policy.scaleDownDelayMicros = 3000000;
+    policy.scaleDownStep = 1;
+    return policy;
+}
+
+// 每秒一个采样，每个借出持有20ms
+AutoscaleSample sampleAt(int second, uint64_t arrivals, size_t total) {
+    AutoscaleSample sample;
+    sample.nowMicros = second * 1000000LL;
+    sample.arrivals = arrivals;
+    sample.meanUsageMicros = 20000;
+    sample.totalConnections = total;
+    return sample;
+}
+
+bool testTrendAndHysteresis() {
+    printTestHeader("测试按趋势扩容和延迟收缩");
+
+    AutoscalePolicy policy = testPolicy();
+    PoolAutoscaler scaler;
+    bool ok = scaler.update(policy, sampleAt(0, 0, 2)) == 2;
+
+    // 100次/秒 * 20ms = 2 个忙碌连接，使用率50% 需要4个
+    ok = ok && scaler.update(policy, sampleAt(1, 100, 2)) == 4;
+
+    // 需求持续上升，目标要超过按当前速率算出的连接数
+    unsigned int target = 0;
+    int second = 2;
+    for (uint64_t rate = 200; rate <= 400; rate += 100, second++) {
+        target = scaler.update(policy, sampleAt(second, rate, target));
+    }
+    std::cout << "400次/秒时的目标: " << target << ", 预测: " << scaler.getForecastRate() << "次/秒" << std::endl;
+    ok = ok && target > 16;
+
+    // 需求从第4秒开始消失，延迟3秒内保持不变，之后每秒减1
+    unsigned int peak = target;
+    std::vector<unsigned int> targets;
+    for (int i = 0; i < 6; i++, second++) {
+        target = scaler.update(policy, sampleAt(second, 0, target));
+        targets.push_back(target);
+    }
+    std::cout << "回落后的目标:";
+    for (unsigned int t : targets) {
+        std::cout << " " << t;
+    }
+    std::cout << std::endl;
+    return ok && targets[0] == peak && targets[1] == peak && targets[2] == peak - 1 &&
+           targets[3] == peak - 2 && targets[5] == peak - 4;
+}
+
+bool testQueueAndBounds() {
+    printTestHeader("测试排队扩容和上下限");
+
+    AutoscalePolicy policy = testPolicy();
+    policy.targetUtilization = 1.0;
+    PoolAutoscaler scaler;
+    scaler.update(policy, sampleAt(0, 0, 4));
+
+    // 4个连接都在用，采样时没有线程排队，但区间内的借出等待超过了10ms
+    AutoscaleSample waited = sampleAt(1, 10, 4);
+    waited.activeConnections = 4;
+    waited.acquireWaitP99Micros = 50000;
+    unsigned int grown = scaler.update(policy, waited);
+
+    // 等待没有超过阈值时，只按忙碌的连接数计算
+    PoolAutoscaler calm;
+    calm.update(policy, sampleAt(0, 0, 4));
+    AutoscaleSample shortWait = waited;
+    shortWait.acquireWaitP99Micros = 5000;
+    unsigned int calmTarget = calm.update(policy, shortWait);
+
+    // 阈值为0时不按借出耗时扩容
+    PoolAutoscaler unlimited;
+    AutoscalePolicy noWaitLimit = policy;
+    noWaitLimit.maxAcquireWaitMicros = 0;
+    unlimited.update(noWaitLimit, sampleAt(0, 0, 4));
+    unsigned int unlimitedTarget = unlimited.update(noWaitLimit, waited);
+
+    // 有8个线程排队时按排队数量扩容
+    AutoscaleSample queued = waited;
+    queued.nowMicros = 2000000;
+    queued.waiters = 8;
+    queued.totalConnections = grown;
+    unsigned int queuedTarget = scaler.update(policy, queued);
+
+    // 超过最大连接数的需求被截断
+    AutoscaleSample flood = sampleAt(3, 100000, queuedTarget);
+    unsigned int capped = scaler.update(policy, flood);
+
+    // 没有需求时不低于最小连接数
+    PoolAutoscaler idle;
+    AutoscalePolicy eager = policy;
+    eager.scaleDownDelayMicros = 0;
+    idle.update(eager, sampleAt(0, 0, 1));
+    unsigned int floor = 0;
+    for (int second = 1; second < 5; second++) {
+        floor = idle.update(eager, sampleAt(second, 0, 1));
+    }
+
+    std::cout << "等待扩容: " << grown << ", 等待未超阈值: " << calmTarget << ", 阈值为0: " << unlimitedTarget
+              << ", 排队扩容: " << queuedTarget
+              << ", 截断: " << capped << ", 下限: " << floor << std::endl;
+    return grown == 5 && calmTarget == 4 && unlimitedTarget == 4 && queuedTarget == 13 && capped == 40 && floor == 2;
+}
+
+bool testPoolBurst() {
+    printTestHeader("测试连接池在突发流量下伸缩");
+
+    ConnectionPool pool("autoscaling");
+    try {
+        PoolConfig config;
+        config.setConnectionLimits(1, 10, 1);
+        config.autoScaling = true;
+        config.autoScaleInterval = 50;
+        config.autoScaleDownDelay = 300;
+        config.autoScaleDownStep = 2;
+        pool.initWithSingleDatabase(config, TEST_HOST, TEST_USER, TEST_PASSWORD, TEST_DATABASE, TEST_PORT);
+
+        std::atomic<bool> stop(false);
+        std::vector<std::thread> workers;
+        for (int i = 0; i < 6; i++) {
+            workers.emplace_back([&pool, &stop]() {
+                while (!stop) {
+                    PooledConnection conn = pool.acquire(AccessMode::READ_WRITE, 5000);
+                    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                }
+            });
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        size_t busyTarget = pool.getAutoscaleTarget();
+        size_t busyTotal = pool.getTotalCount();
+        stop = true;
+        for (auto& worker : workers) {
+            worker.join();
+        }
+
+        // 流量刚结束时还在延迟期内
+        std::this_thread::sleep_for(std::chrono::milliseconds(150));
+        size_t afterBurst = pool.getTotalCount();
+
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (pool.getTotalCount() > 1 && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+        size_t settled = pool.getTotalCount();
+        std::cout << "突发时目标: " << busyTarget << ", 连接数: " << busyTotal << ", 结束后150ms: " << afterBurst
+                  << ", 最终: " << settled << ", 目标: " << pool.getAutoscaleTarget() << std::endl;
+        return busyTarget >= 6 && busyTotal >= 6 && afterBurst >= 6 && settled == 1 &&
+               pool.getAutoscaleTarget() == 1 && pool.getMetrics().targetConnections == 1;
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool testHealthCheckPeriod() {
+    printTestHeader("测试健康检查周期");
+
+    try {
+        // 空闲超过100ms的连接在下一次健康检查时关闭
+        ConnectionPool pool("health-period");
+        PoolConfig config;
+        config.setConnectionLimits(1, 5, 4);
+        config.setTimeouts(3000, 100, 200);
+        pool.initWithSingleDatabase(config, TEST_HOST, TEST_USER, TEST_PASSWORD, TEST_DATABASE, TEST_PORT);
+        size_t before = pool.getTotalCount();
+        std::this_thread::sleep_for(std::chrono::milliseconds(600));
+        size_t trimmed = pool.getTotalCount();
+
+        // 30秒的健康检查周期不会拖慢关闭
+        ConnectionPool slow("health-shutdown");
+        PoolConfig slowConfig;
+        slowConfig.setConnectionLimits(1, 2, 1);
+        slow.initWithSingleDatabase(slowConfig, TEST_HOST, TEST_USER, TEST_PASSWORD, TEST_DATABASE, TEST_PORT);
+        auto start = std::chrono::steady_clock::now();
+        slow.shutdown();
+        int64_t shutdownMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start).count();
+
+        std::cout << "清理前: " << before << ", 清理后: " << trimmed << ", 关闭耗时: " << shutdownMs << "ms" << std::endl;
+        return before == 4 && trimmed == 1 && shutdownMs < 1000;
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+int main() {
+    Logger::getInstance().init("", LogLevel::WARNING, true);
+
+    std::vector<std::pair<std::string, bool>> results;
+    results.emplace_back("按趋势扩容和延迟收缩", testTrendAndHysteresis());
+    results.emplace_back("排队扩容和上下限", testQueueAndBounds());
+    results.emplace_back("突发流量下伸缩", testPoolBurst());
+    results.emplace_back("健康检查周期", testHealthCheckPeriod());
+
+    size_t passed = 0;
+    std::cout << "\n" << std::string(60, '*') << std::endl;
+    for (const auto& result : results) {
+        std::cout << (result.second ? "成功" : "失败") << " " << result.first << std::endl;
+        if (result.second) passed++;
+    }
+    std::cout << "\n通过: " << passed << "/" << results.size() << " 项测试" << std::endl;
+
+    return (passed == results.size()) ? 0 : 1;
+}
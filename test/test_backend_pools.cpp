@@ -0,0 +1,265 @@
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <map>
+#include <stdexcept>
+#include "connection_pool.h"
+#include "load_balancer.h"
+#include "pool_config.h"
+#include "logger.h"
+
+/**
+ * @brief 按实例划分的子连接池测试
+ *
+ * 两个实例都指向同一个 MySQL（127.0.0.1 与 localhost），重点验证：
+ * 1. 每个实例的 maxConnections 单独生效，满了以后借用其他实例的空闲连接
+ * 2. 修改权重后，新的借出按新权重分布
+ * 3. 移除实例后不再借出它的连接，借出的连接归还时被关闭
+ * 4. 读写借出只用主库，只读借出只用从库；写入后的短时间内只读借出仍走主库
+ */
+
+// 测试数据库连接参数
+const std::string TEST_HOST = "127.0.0.1";
+const std::string OTHER_HOST = "localhost";
+const std::string TEST_USER = "mxk";
+const std::string TEST_PASSWORD = "d2v8s2q3";
+const std::string TEST_DATABASE = "testdb";
+const unsigned int TEST_PORT = 3306;
+
+void printTestHeader(const std::string& title) {
+    std::cout << "\n" << std::string(60, '=') << std::endl;
+    std::cout << "  " << title << std::endl;
+    std::cout << std::string(60, '=') << std::endl;
+}
+
+// 连接所属实例的主机名
+std::string backendHost(const PooledConnection& conn) {
+    for (const auto& backend : LoadBalancer::getInstance().getBackends()) {
+        if (backend->id == conn->getBackendId()) {
+            return backend->config.host;
+        }
+    }
+    return "";
+}
+
+StartupReport initTwoBackends(const PoolConfig& config, unsigned int firstWeight, unsigned int secondWeight,
+                              unsigned int firstMax = 0) {
+    DBConfig first(TEST_HOST, TEST_USER, TEST_PASSWORD, TEST_DATABASE, TEST_PORT, firstWeight);
+    first.maxConnections = firstMax;
+    DBConfig second(OTHER_HOST, TEST_USER, TEST_PASSWORD, TEST_DATABASE, TEST_PORT, secondWeight);
+    return ConnectionPool::getInstance().initWithMultipleDatabases(config, {first, second});
+}
+
+bool testBackendMaxConnections() {
+    printTestHeader("测试实例的最大连接数");
+
+    auto& pool = ConnectionPool::getInstance();
+    try {
+        PoolConfig config;
+        config.setConnectionLimits(1, 8, 6);
+        // 权重几乎全部给第一个实例，但它最多只有2个连接，预热时其余连接分给第二个实例
+        StartupReport report = initTwoBackends(config, 100, 1, 2);
+        std::cout << report.toString() << std::endl;
+        if (report.backends.size() != 2 || report.backends[0].requested != 2 || report.backends[1].requested != 4) {
+            pool.shutdown();
+            return false;
+        }
+
+        std::vector<PooledConnection> borrowed;
+        std::map<std::string, int> perHost;
+        for (int i = 0; i < 6; i++) {
+            borrowed.push_back(pool.acquire());
+            perHost[backendHost(borrowed.back())]++;
+        }
+        std::cout << TEST_HOST << ": " << perHost[TEST_HOST] << ", "
+                  << OTHER_HOST << ": " << perHost[OTHER_HOST] << std::endl;
+        bool ok = perHost[TEST_HOST] <= 2 && perHost[TEST_HOST] + perHost[OTHER_HOST] == 6 &&
+                  pool.getTotalCount() == 6;
+
+        // 第一个实例满了，归还到第二个实例的连接被直接借出而不是等待
+        borrowed.pop_back();
+        PooledConnection again = pool.acquire();
+        std::cout << pool.getStatus();
+        ok = ok && again && pool.getTotalCount() == 6;
+
+        borrowed.clear();
+        again.reset();
+        pool.shutdown();
+        return ok;
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        pool.shutdown();
+        return false;
+    }
+}
+
+bool testWeightShift() {
+    printTestHeader("测试修改权重后借出比例变化");
+
+    auto& pool = ConnectionPool::getInstance();
+    try {
+        PoolConfig config;
+        config.setConnectionLimits(1, 10, 4);
+        initTwoBackends(config, 1, 1);
+        LoadBalancer::getInstance().setStrategy(LoadBalanceStrategy::WEIGHTED);
+
+        auto countOther = [&pool](int rounds) {
+            int other = 0;
+            for (int i = 0; i < rounds; i++) {
+                PooledConnection conn = pool.acquire();
+                if (backendHost(conn) == OTHER_HOST) {
+                    other++;
+                }
+            }
+            return other;
+        };
+
+        int before = countOther(200);
+        LoadBalancer::getInstance().updateWeight(OTHER_HOST, TEST_PORT, 9);
+        int after = countOther(200);
+        std::cout << "修改前 " << OTHER_HOST << ": " << before << "/200, 修改后: " << after << "/200" << std::endl;
+
+        // 1:1 时约一半，1:9 时约九成
+        bool ok = before > 60 && before < 140 && after > 160;
+        pool.shutdown();
+        return ok;
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        pool.shutdown();
+        return false;
+    }
+}
+
+bool testRemoveBackend() {
+    printTestHeader("测试移除实例后排空子连接池");
+
+    auto& pool = ConnectionPool::getInstance();
+    try {
+        PoolConfig config;
+        config.setConnectionLimits(1, 10, 6);
+        initTwoBackends(config, 1, 1);
+        LoadBalancer::getInstance().setStrategy(LoadBalanceStrategy::ROUND_ROBIN);
+
+        // 借出一个第一个实例的连接，移除实例时它仍在使用
+        PooledConnection held;
+        std::vector<PooledConnection> others;
+        while (!held) {
+            PooledConnection conn = pool.acquire();
+            if (backendHost(conn) == TEST_HOST) {
+                held = std::move(conn);
+            } else {
+                others.push_back(std::move(conn));
+            }
+        }
+        others.clear();
+
+        LoadBalancer::getInstance().removeDatabase(TEST_HOST, TEST_PORT);
+
+        bool ok = true;
+        for (int i = 0; i < 20; i++) {
+            PooledConnection conn = pool.acquire();
+            if (backendHost(conn) != OTHER_HOST) {
+                ok = false;
+            }
+        }
+        // 仍在使用的连接不受影响
+        ok = ok && held->executeQuery("SELECT 1") != nullptr;
+
+        size_t totalBefore = pool.getTotalCount();
+        held.reset();
+        size_t totalAfter = pool.getTotalCount();
+        std::cout << "归还前总连接数: " << totalBefore << ", 归还后: " << totalAfter << std::endl;
+        std::cout << pool.getStatus();
+
+        ok = ok && totalAfter == totalBefore - 1;
+        pool.shutdown();
+        return ok;
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        pool.shutdown();
+        return false;
+    }
+}
+
+bool testReadWriteSplit() {
+    printTestHeader("测试读写分离");
+
+    auto& pool = ConnectionPool::getInstance();
+    try {
+        PoolConfig config;
+        config.setConnectionLimits(1, 10, 4);
+        config.readAfterWriteWindow = 300;
+        DBConfig primary(TEST_HOST, TEST_USER, TEST_PASSWORD, TEST_DATABASE, TEST_PORT);
+        primary.maxConnections = 2;
+        DBConfig replica(OTHER_HOST, TEST_USER, TEST_PASSWORD, TEST_DATABASE, TEST_PORT, 1, DBRole::REPLICA);
+        pool.initWithMultipleDatabases(config, {primary, replica});
+
+        bool ok = true;
+        for (int i = 0; i < 20; i++) {
+            PooledConnection reader = pool.acquire(AccessMode::READ_ONLY);
+            if (backendHost(reader) != OTHER_HOST) {
+                ok = false;
+            }
+        }
+        std::vector<PooledConnection> writers;
+        for (int i = 0; i < 2; i++) {
+            writers.push_back(pool.acquire(AccessMode::READ_WRITE));
+            if (backendHost(writers.back()) != TEST_HOST) {
+                ok = false;
+            }
+        }
+        // 主库已满时，读写借出也不会借用从库的空闲连接
+        try {
+            pool.acquire(AccessMode::READ_WRITE, 200);
+            ok = false;
+        } catch (const std::exception& e) {
+            std::cout << "主库已满: " << e.what() << std::endl;
+        }
+        writers.clear();
+
+        // 刚写入过，只读借出仍走主库
+        std::string afterWrite = backendHost(pool.acquire(AccessMode::READ_ONLY));
+        std::this_thread::sleep_for(std::chrono::milliseconds(400));
+        std::string afterWindow = backendHost(pool.acquire(AccessMode::READ_ONLY));
+        std::cout << "写入后只读借出: " << afterWrite << ", 窗口过后: " << afterWindow << std::endl;
+
+        // 窗口从归还时算起，归还的连接交给后台线程回滚事务时也一样
+        {
+            PooledConnection writer = pool.acquire(AccessMode::READ_WRITE);
+            writer->beginTransaction();
+            std::this_thread::sleep_for(std::chrono::milliseconds(400));
+        }
+        std::string afterLongWrite = backendHost(pool.acquire(AccessMode::READ_ONLY));
+        std::cout << "长事务归还后只读借出: " << afterLongWrite << std::endl;
+        std::cout << pool.getStatus();
+
+        ok = ok && afterWrite == TEST_HOST && afterWindow == OTHER_HOST && afterLongWrite == TEST_HOST;
+        pool.shutdown();
+        return ok;
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        pool.shutdown();
+        return false;
+    }
+}
+
+int main() {
+    Logger::getInstance().init("", LogLevel::WARNING, true);
+
+    std::vector<std::pair<std::string, bool>> results;
+    results.emplace_back("实例的最大连接数", testBackendMaxConnections());
+    results.emplace_back("修改权重后借出比例变化", testWeightShift());
+    results.emplace_back("移除实例后排空子连接池", testRemoveBackend());
+    results.emplace_back("读写分离", testReadWriteSplit());
+
+    size_t passed = 0;
+    std::cout << "\n" << std::string(60, '*') << std::endl;
+    for (const auto& result : results) {
+        std::cout << (result.second ? "成功" : "失败") << " " << result.first << std::endl;
+        if (result.second) passed++;
+    }
+    std::cout << "\n通过: " << passed << "/" << results.size() << " 项测试" << std::endl;
+
+    return (passed == results.size()) ? 0 : 1;
+}
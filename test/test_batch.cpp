@@ -0,0 +1,297 @@
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <stdexcept>
+#include <clocale>
+#include "connection_pool.h"
+#include "pool_config.h"
+#include "batch.h"
+#include "logger.h"
+
+/**
+ * @brief 批量插入与多语句流水线测试
+ *
+ * 重点验证：
+ * 1. BatchInsert 按大小拆分成多条多行INSERT，特殊字符、NULL、浮点数原样写入
+ * 2. executeBatch 返回每条语句的影响行数，按包大小拆成多次往返
+ * 3. 某条语句失败时 stopOnError 的两种行为，之后普通查询不允许多语句
+ * 4. 与逐行 executeUpdate 的吞吐对比
+ * 5. 小数点为','的locale下浮点数仍按'.'写入
+ */
+
+// 测试数据库连接参数
+const std::string TEST_HOST = "127.0.0.1";
+const std::string TEST_USER = "mxk";
+const std::string TEST_PASSWORD = "d2v8s2q3";
+const std::string TEST_DATABASE = "testdb";
+const unsigned int TEST_PORT = 3306;
+
+void printTestHeader(const std::string& title) {
+    std::cout << "\n" << std::string(60, '=') << std::endl;
+    std::cout << "  " << title << std::endl;
+    std::cout << std::string(60, '=') << std::endl;
+}
+
+bool prepareTable() {
+    try {
+        PooledConnection conn = ConnectionPool::getInstance().acquire(3000);
+        conn->executeUpdate("DROP TABLE IF EXISTS test_batch");
+        conn->executeUpdate(
+            "CREATE TABLE test_batch ("
+            "  id INT PRIMARY KEY,"
+            "  name VARCHAR(64),"
+            "  score DOUBLE"
+            ")");
+        return true;
+    } catch (const std::exception& e) {
+        std::cout << "建表失败: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+long long countRows(PooledConnection& conn) {
+    auto result = conn->executeQuery("SELECT COUNT(*) AS total FROM test_batch");
+    return result->next() ? result->getLong("total") : -1;
+}
+
+bool testBatchInsert() {
+    printTestHeader("测试多行INSERT批量插入");
+
+    try {
+        PooledConnection conn = ConnectionPool::getInstance().acquire(3000);
+        conn->executeUpdate("DELETE FROM test_batch");
+
+        // 限制每条语句4KB，5000行会被拆成多条语句
+        BatchInsert insert(*conn, "test_batch", {"id", "name", "score"}, 4096);
+        for (int i = 1; i <= 5000; i++) {
+            if (i == 1) {
+                insert.addRow({i, "O'Brien \\ \"x\"", 0.1});
+            } else if (i == 2) {
+                insert.addRow({i, nullptr, nullptr});
+            } else {
+                insert.addRow({i, "user_" + std::to_string(i), i * 1.5});
+            }
+        }
+        insert.flush();
+        std::cout << "语句数: " << insert.getStatementCount() << ", 写入行数: " << insert.getAffectedRows() << std::endl;
+        if (insert.getStatementCount() < 2 || insert.getAffectedRows() != 5000 ||
+            insert.getPendingRows() != 0 || countRows(conn) != 5000) {
+            return false;
+        }
+
+        auto result = conn->executeQuery("SELECT id, name, score FROM test_batch WHERE id IN (1, 2) ORDER BY id");
+        if (!result->next() || result->getString("name") != "O'Brien \\ \"x\"" || result->getDouble("score") != 0.1) {
+            std::cout << "特殊字符或浮点数写入不正确" << std::endl;
+            return false;
+        }
+        if (!result->next() || !result->isNull("name") || !result->isNull("score")) {
+            std::cout << "NULL写入不正确" << std::endl;
+            return false;
+        }
+
+        // 列数不对的行被拒绝
+        try {
+            insert.addRow({1, "x"});
+            return false;
+        } catch (const std::invalid_argument& e) {
+            std::cout << "捕获到预期异常: " << e.what() << std::endl;
+        }
+        return insert.getPendingRows() == 0;
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool testExecuteBatch() {
+    printTestHeader("测试多语句批量执行");
+
+    try {
+        PooledConnection conn = ConnectionPool::getInstance().acquire(3000);
+        conn->executeUpdate("DELETE FROM test_batch");
+
+        std::vector<std::string> statements;
+        for (int i = 1; i <= 100; i++) {
+            statements.push_back("INSERT INTO test_batch (id, name) VALUES (" + std::to_string(i) + ", 'b');");
+        }
+        statements.push_back("UPDATE test_batch SET score = 1 WHERE id <= 10");
+        statements.push_back("SELECT id FROM test_batch WHERE id <= 3");
+
+        // 每个包最多1KB，需要多次往返
+        BatchResult result = conn->executeBatch(statements, true, 1024);
+        std::cout << "执行: " << result.executedCount << ", 往返次数: " << result.roundTrips
+                  << ", 总影响行数: " << result.totalAffectedRows << std::endl;
+        return result.succeeded() &&
+               result.roundTrips > 1 &&
+               result.statements[0].affectedRows == 1 &&
+               result.statements[100].affectedRows == 10 &&
+               result.statements[101].affectedRows == 3 &&
+               countRows(conn) == 100;
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool testBatchErrors() {
+    printTestHeader("测试批量执行中的错误");
+
+    try {
+        PooledConnection conn = ConnectionPool::getInstance().acquire(3000);
+        conn->executeUpdate("DELETE FROM test_batch");
+
+        std::vector<std::string> statements = {
+            "INSERT INTO test_batch (id) VALUES (1)",
+            "INSERT INTO test_batch (id) VALUES (1)",   // 主键冲突
+            "INSERT INTO test_batch (id) VALUES (2)"
+        };
+
+        BatchResult stopped = conn->executeBatch(statements);
+        std::cout << "stopOnError=true: 执行 " << stopped.executedCount << ", 失败 " << stopped.failedCount
+                  << ", 错误: " << stopped.statements[1].error << std::endl;
+        if (stopped.succeeded() || !stopped.statements[0].succeeded() ||
+            stopped.statements[1].errorCode == 0 || stopped.statements[2].executed) {
+            return false;
+        }
+
+        conn->executeUpdate("DELETE FROM test_batch");
+        BatchResult continued = conn->executeBatch(statements, false);
+        std::cout << "stopOnError=false: 执行 " << continued.executedCount << ", 失败 " << continued.failedCount << std::endl;
+        if (continued.failedCount != 1 || !continued.statements[2].succeeded() || countRows(conn) != 2) {
+            return false;
+        }
+
+        // 批量执行结束后，普通查询不能再执行多条语句
+        try {
+            conn->executeQuery("SELECT 1; SELECT 2");
+            std::cout << "普通查询不应该允许多语句" << std::endl;
+            return false;
+        } catch (const std::exception& e) {
+            std::cout << "捕获到预期异常: " << e.what() << std::endl;
+        }
+        return true;
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool testCommaLocale() {
+    printTestHeader("测试小数点为逗号的locale");
+
+    const char* locales[] = {"de_DE.UTF-8", "de_DE.utf8", "fr_FR.UTF-8", "fr_FR.utf8", "ru_RU.UTF-8", "ru_RU.utf8"};
+    const char* selected = nullptr;
+    for (const char* name : locales) {
+        if (std::setlocale(LC_NUMERIC, name)) {
+            selected = name;
+            break;
+        }
+    }
+    if (!selected) {
+        std::cout << "系统没有小数点为','的locale，跳过" << std::endl;
+        return true;
+    }
+    std::cout << "LC_NUMERIC=" << selected << std::endl;
+
+    bool passed = false;
+    try {
+        PooledConnection conn = ConnectionPool::getInstance().acquire(3000);
+        conn->executeUpdate("DELETE FROM test_batch");
+
+        // 按locale格式化会写出 (1, 'a', 1,5)，列数不对
+        BatchInsert insert(*conn, "test_batch", {"id", "name", "score"});
+        insert.addRow({1, "a", 1.5});
+        insert.addRow({2, "b", -0.25});
+        insert.flush();
+
+        auto result = conn->executeQuery("SELECT score FROM test_batch ORDER BY id");
+        passed = result->next() && result->getDouble("score") == 1.5 &&
+                 result->next() && result->getDouble("score") == -0.25;
+        if (!passed) {
+            std::cout << "浮点数写入不正确" << std::endl;
+        }
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+    }
+    std::setlocale(LC_NUMERIC, "C");
+    return passed;
+}
+
+bool testThroughput() {
+    printTestHeader("测试批量插入与逐行插入的吞吐对比");
+
+    const int rows = 2000;
+    try {
+        PooledConnection conn = ConnectionPool::getInstance().acquire(3000);
+        conn->executeUpdate("DELETE FROM test_batch");
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 1; i <= rows; i++) {
+            conn->executeUpdate("INSERT INTO test_batch (id, name) VALUES (" + std::to_string(i) + ", 'single')");
+        }
+        auto singleMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start).count();
+
+        conn->executeUpdate("DELETE FROM test_batch");
+        start = std::chrono::steady_clock::now();
+        BatchInsert insert(*conn, "test_batch", {"id", "name"});
+        for (int i = 1; i <= rows; i++) {
+            insert.addRow({i, "batch"});
+        }
+        insert.flush();
+        auto batchMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start).count();
+
+        std::cout << "逐行插入 " << rows << " 行: " << singleMs << "ms" << std::endl;
+        std::cout << "批量插入 " << rows << " 行: " << batchMs << "ms" << std::endl;
+        return countRows(conn) == rows && batchMs <= singleMs;
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+int main() {
+    Logger::getInstance().init("", LogLevel::WARNING, true);
+
+    try {
+        PoolConfig config;
+        config.setConnectionLimits(1, 4, 1);
+        ConnectionPool::getInstance().initWithSingleDatabase(config, TEST_HOST, TEST_USER, TEST_PASSWORD, TEST_DATABASE, TEST_PORT);
+    } catch (const std::exception& e) {
+        std::cerr << "无法初始化连接池: " << e.what() << std::endl;
+        return 1;
+    }
+
+    if (!prepareTable()) {
+        ConnectionPool::getInstance().shutdown();
+        return 1;
+    }
+
+    std::vector<std::pair<std::string, bool>> results;
+    results.emplace_back("多行INSERT批量插入", testBatchInsert());
+    results.emplace_back("多语句批量执行", testExecuteBatch());
+    results.emplace_back("批量执行中的错误", testBatchErrors());
+    results.emplace_back("逗号小数点locale", testCommaLocale());
+    results.emplace_back("吞吐对比", testThroughput());
+
+    try {
+        PooledConnection conn = ConnectionPool::getInstance().acquire(3000);
+        conn->executeUpdate("DROP TABLE IF EXISTS test_batch");
+    } catch (const std::exception& e) {
+        std::cout << "清理测试表失败: " << e.what() << std::endl;
+    }
+
+    size_t passed = 0;
+    std::cout << "\n" << std::string(60, '*') << std::endl;
+    for (const auto& result : results) {
+        std::cout << (result.second ? "成功" : "失败") << " " << result.first << std::endl;
+        if (result.second) passed++;
+    }
+    std::cout << "\n通过: " << passed << "/" << results.size() << " 项测试" << std::endl;
+
+    ConnectionPool::getInstance().shutdown();
+    return (passed == results.size()) ? 0 : 1;
+}
@@ -0,0 +1,269 @@
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <atomic>
+#include <stdexcept>
+#include "circuit_breaker.h"
+#include "connection_pool.h"
+#include "load_balancer.h"
+#include "pool_config.h"
+#include "logger.h"
+
+/**
+ * @brief 熔断器测试
+ *
+ * 重点验证：
+ * 1. 连续失败达到阈值后熔断，熔断期结束后只放行一个探测请求
+ * 2. 探测失败重新熔断，探测成功恢复
+ * 3. 退避时间在 [0, min(上限, 基数 * 2^(n-1))] 内随机分布
+ * 4. 负载均衡跳过熔断的实例，全部熔断时立即失败
+ * 5. 连接池不再向不可达的实例建连，借出全部落在可用的实例上
+ */
+
+// 测试数据库连接参数
+const std::string TEST_HOST = "127.0.0.1";
+const std::string OTHER_HOST = "localhost";
+const std::string TEST_USER = "mxk";
+const std::string TEST_PASSWORD = "d2v8s2q3";
+const std::string TEST_DATABASE = "testdb";
+const unsigned int TEST_PORT = 3306;
+const unsigned int UNREACHABLE_PORT = 1;
+
+void printTestHeader(const std::string& title) {
+    std::cout << "\n" << std::string(60, '=') << std::endl;
+    std::cout << "  " << title << std::endl;
+    std::cout << std::string(60, '=') << std::endl;
+}
+
+CircuitBreaker::Policy shortPolicy(uint32_t threshold) {
+    CircuitBreaker::Policy policy;
+    policy.failureThreshold = threshold;
+    policy.openNanos = 50LL * 1000 * 1000;
+    policy.maxOpenNanos = 200LL * 1000 * 1000;
+    policy.probeTimeoutNanos = 100LL * 1000 * 1000;
+    return policy;
+}
+
+// 熔断时长有随机，等到最长的熔断期结束
+void waitOpenPeriod() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(220));
+}
+
+bool testStateMachine() {
+    printTestHeader("测试熔断与恢复");
+
+    CircuitBreaker breaker;
+    breaker.configure(shortPolicy(3));
+
+    breaker.recordFailure();
+    breaker.recordFailure();
+    bool closedBelowThreshold = breaker.isClosed();
+    // 成功清零连续失败次数
+    breaker.recordSuccess();
+    breaker.recordFailure();
+    breaker.recordFailure();
+    bool stillClosed = breaker.isClosed();
+    breaker.recordFailure();
+    bool opened = breaker.getState() == CircuitBreaker::State::OPEN && !breaker.tryPass();
+
+    waitOpenPeriod();
+    bool probe = breaker.tryPass() && breaker.getState() == CircuitBreaker::State::HALF_OPEN;
+    // 探测失败重新熔断
+    breaker.recordFailure();
+    bool reopened = breaker.getState() == CircuitBreaker::State::OPEN && breaker.getOpenCount() == 2;
+
+    waitOpenPeriod();
+    bool secondProbe = breaker.tryPass();
+    breaker.recordSuccess();
+    bool recovered = breaker.isClosed() && breaker.getConsecutiveFailures() == 0 && breaker.tryPass();
+
+    std::cout << "未达阈值: " << (closedBelowThreshold && stillClosed ? "关闭" : "熔断")
+              << ", 达到阈值: " << CircuitBreaker::stateName(opened ? CircuitBreaker::State::OPEN : breaker.getState())
+              << ", 熔断次数: " << breaker.getOpenCount()
+              << ", 恢复: " << (recovered ? "是" : "否") << std::endl;
+    return closedBelowThreshold && stillClosed && opened && probe && reopened && secondProbe && recovered;
+}
+
+bool testSingleProbe() {
+    printTestHeader("测试半开状态只放行一个探测请求");
+
+    CircuitBreaker breaker;
+    breaker.configure(shortPolicy(1));
+    breaker.recordFailure();
+    waitOpenPeriod();
+
+    std::atomic<int> passed(0);
+    std::atomic<bool> go(false);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 8; i++) {
+        threads.emplace_back([&]() {
+            while (!go) {
+                std::this_thread::yield();
+            }
+            for (int j = 0; j < 100; j++) {
+                if (breaker.tryPass()) {
+                    passed++;
+                }
+            }
+        });
+    }
+    go = true;
+    for (auto& t : threads) {
+        t.join();
+    }
+    // 已经借出的连接在半开状态下可以重连，熔断状态下不行
+    bool reconnectHalfOpen = breaker.allowConnect();
+
+    // 探测超时未返回，由下一个请求重新探测
+    std::this_thread::sleep_for(std::chrono::milliseconds(120));
+    bool replaced = breaker.tryPass();
+    breaker.recordFailure();
+    bool reconnectOpen = breaker.allowConnect();
+
+    std::cout << "800次请求中放行: " << passed << ", 探测超时后重新放行: " << (replaced ? "是" : "否") << std::endl;
+    return passed == 1 && reconnectHalfOpen && replaced && !reconnectOpen;
+}
+
+bool testBackoffBounds() {
+    printTestHeader("测试全抖动退避");
+
+    bool ok = true;
+    for (unsigned int attempt = 1; attempt <= 12; attempt++) {
+        int64_t ceiling = std::min<int64_t>(1000, 100LL << (attempt - 1));
+        int64_t lowest = ceiling;
+        int64_t highest = 0;
+        for (int i = 0; i < 2000; i++) {
+            int64_t delay = CircuitBreaker::backoffDelay(100, attempt, 1000);
+            ok = ok && delay >= 0 && delay <= ceiling;
+            lowest = std::min(lowest, delay);
+            highest = std::max(highest, delay);
+        }
+        // 均匀分布在整个区间内，而不是集中在上限附近
+        ok = ok && lowest < ceiling / 10 && highest > ceiling * 9 / 10;
+        std::cout << "第" << attempt << "次: [" << lowest << ", " << highest << "] 上限 " << ceiling << std::endl;
+    }
+    ok = ok && CircuitBreaker::backoffDelay(0, 3, 1000) == 0 && CircuitBreaker::backoffDelay(100, 1000, 1000) <= 1000;
+    return ok;
+}
+
+bool testBalancerSkipsOpenBackend() {
+    printTestHeader("测试负载均衡跳过熔断的实例");
+
+    auto& balancer = LoadBalancer::getInstance();
+    try {
+        balancer.init({DBConfig(TEST_HOST, TEST_USER, TEST_PASSWORD, TEST_DATABASE, TEST_PORT, 1),
+                       DBConfig(OTHER_HOST, TEST_USER, TEST_PASSWORD, TEST_DATABASE, TEST_PORT, 1)},
+                      LoadBalanceStrategy::ROUND_ROBIN);
+        std::vector<BackendPtr> backends = balancer.getBackends();
+        if (backends.size() != 2) {
+            return false;
+        }
+        CircuitBreaker::Policy policy = shortPolicy(1);
+        policy.openNanos = policy.maxOpenNanos = 10LL * 1000 * 1000 * 1000;
+        for (const auto& backend : backends) {
+            backend->stats->getBreaker().configure(policy);
+        }
+
+        backends[0]->stats->getBreaker().recordFailure();
+        int skipped = 0;
+        for (int i = 0; i < 20; i++) {
+            if (balancer.selectBackend()->id == backends[1]->id) {
+                skipped++;
+            }
+        }
+
+        backends[1]->stats->getBreaker().recordFailure();
+        bool allOpenThrows = false;
+        auto start = std::chrono::steady_clock::now();
+        try {
+            balancer.selectBackend();
+        } catch (const std::runtime_error& e) {
+            allOpenThrows = true;
+            std::cout << "全部熔断: " << e.what() << std::endl;
+        }
+        int64_t elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start).count();
+
+        backends[0]->stats->getBreaker().recordSuccess();
+        bool recovered = balancer.selectBackend()->id == backends[0]->id;
+        backends[1]->stats->getBreaker().recordSuccess();
+
+        std::cout << "20次选择中落在可用实例: " << skipped << ", 恢复后重新选中: " << (recovered ? "是" : "否") << std::endl;
+        return skipped == 20 && allOpenThrows && elapsedMs < 100 && recovered;
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool testPoolAvoidsUnreachableBackend() {
+    printTestHeader("测试连接池避开不可达的实例");
+
+    ConnectionPool pool("breaker");
+    try {
+        PoolConfig config;
+        config.setConnectionLimits(2, 10, 6);
+        config.circuitBreakerThreshold = 2;
+        config.circuitBreakerOpenTime = 10000;
+        config.circuitBreakerMaxOpenTime = 10000;
+        std::vector<DBConfig> databases = {
+            DBConfig(TEST_HOST, TEST_USER, TEST_PASSWORD, TEST_DATABASE, TEST_PORT, 1),
+            DBConfig(TEST_HOST, TEST_USER, TEST_PASSWORD, TEST_DATABASE, UNREACHABLE_PORT, 1)
+        };
+        StartupReport report = pool.initWithMultipleDatabases(config, databases, LoadBalanceStrategy::ROUND_ROBIN);
+        std::cout << report.toString() << std::endl;
+
+        uint64_t reachableId = 0;
+        for (const auto& backend : pool.getMetrics().backends) {
+            if (backend.port == TEST_PORT) {
+                reachableId = backend.id;
+            }
+        }
+        // 轮询策略下一半的选择本应落在不可达的实例上
+        size_t onReachable = 0;
+        for (int i = 0; i < 20; i++) {
+            PooledConnection conn = pool.acquire(AccessMode::READ_WRITE, 1000);
+            if (conn->getBackendId() == reachableId) {
+                onReachable++;
+            }
+        }
+
+        PoolMetrics metrics = pool.getMetrics();
+        bool open = false;
+        for (const auto& backend : metrics.backends) {
+            if (backend.port == UNREACHABLE_PORT) {
+                open = backend.circuitState == CircuitBreaker::State::OPEN && backend.circuitOpenCount == 1 &&
+                       backend.totalConnections == 0;
+            }
+        }
+        std::cout << "借出到可用实例: " << onReachable << "/20, 不可达实例已熔断: " << (open ? "是" : "否") << std::endl;
+        pool.shutdown();
+        return onReachable == 20 && open;
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        pool.shutdown();
+        return false;
+    }
+}
+
+int main() {
+    Logger::getInstance().init("", LogLevel::ERROR, true);
+
+    std::vector<std::pair<std::string, bool>> results;
+    results.emplace_back("熔断与恢复", testStateMachine());
+    results.emplace_back("半开状态只放行一个探测请求", testSingleProbe());
+    results.emplace_back("全抖动退避", testBackoffBounds());
+    results.emplace_back("负载均衡跳过熔断的实例", testBalancerSkipsOpenBackend());
+    results.emplace_back("连接池避开不可达的实例", testPoolAvoidsUnreachableBackend());
+
+    size_t passed = 0;
+    std::cout << "\n" << std::string(60, '*') << std::endl;
+    for (const auto& result : results) {
+        std::cout << (result.second ? "成功" : "失败") << " " << result.first << std::endl;
+        if (result.second) passed++;
+    }
+    std::cout << "\n通过: " << passed << "/" << results.size() << " 项测试" << std::endl;
+
+    return (passed == results.size()) ? 0 : 1;
+}
@@ -0,0 +1,159 @@
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include <stdexcept>
+#include "query_result.h"
+#include "logger.h"
+
+/**
+ * @brief 按字段名访问的哈希索引测试
+ *
+ * 重点验证：
+ * 1. 宽结果集（80列）按名称访问每一列都能得到正确的值
+ * 2. 同名字段返回第一个，字段名区分大小写，不存在的字段抛出异常
+ * 3. Column句柄可以跨行复用，用const char*字段名访问不产生堆内存分配
+ */
+
+// 统计堆内存分配次数
+std::atomic<size_t> g_allocations(0);
+
+void* operator new(size_t size) {
+    g_allocations++;
+    void* p = std::malloc(size ? size : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+const unsigned int COLUMNS = 80;
+const int ROWS = 1000;
+
+void printTestHeader(const std::string& title) {
+    std::cout << "\n" << std::string(60, '=') << std::endl;
+    std::cout << "  " << title << std::endl;
+    std::cout << std::string(60, '=') << std::endl;
+}
+
+// 第row行第col列的值为 row * 1000 + col
+ResultRowsPtr buildWideRows() {
+    auto rows = std::make_shared<ResultRows>();
+    for (unsigned int col = 0; col < COLUMNS; col++) {
+        rows->fieldNames.push_back("column_" + std::to_string(col));
+    }
+    for (int row = 0; row < ROWS; row++) {
+        for (unsigned int col = 0; col < COLUMNS; col++) {
+            std::string value = std::to_string(row * 1000 + static_cast<int>(col));
+            rows->appendValue(value.data(), static_cast<unsigned long>(value.size()));
+        }
+        rows->rowCount++;
+    }
+    return rows;
+}
+
+bool testWideResult() {
+    printTestHeader("测试宽结果集按名称访问");
+
+    QueryResult result(buildWideRows());
+    std::vector<std::string> names = result.getFieldNames();
+    auto start = std::chrono::steady_clock::now();
+    int row = 0;
+    while (result.next()) {
+        for (unsigned int col = 0; col < COLUMNS; col++) {
+            if (result.getLong(names[col]) != row * 1000 + static_cast<int>(col)) {
+                std::cout << "第" << row << "行第" << col << "列的值不正确" << std::endl;
+                return false;
+            }
+        }
+        row++;
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    std::cout << "读取 " << ROWS * COLUMNS << " 个字段耗时: " << elapsed << "us" << std::endl;
+    return row == ROWS;
+}
+
+bool testNameRules() {
+    printTestHeader("测试同名字段、大小写与不存在的字段");
+
+    auto rows = std::make_shared<ResultRows>();
+    rows->fieldNames = {"id", "name", "id", "Name"};
+    rows->appendValue("1", 1);
+    rows->appendValue("first", 5);
+    rows->appendValue("2", 1);
+    rows->appendValue("second", 6);
+    rows->rowCount = 1;
+
+    QueryResult result(rows);
+    result.next();
+    bool ok = result.getInt("id") == 1 &&
+              result.getString("name") == "first" &&
+              result.getString(std::string("Name")) == "second" &&
+              result.hasColumn("id") && !result.hasColumn("ID") && !result.hasColumn("");
+    try {
+        result.getString("missing");
+        ok = false;
+    } catch (const std::out_of_range& e) {
+        std::cout << "捕获到预期异常: " << e.what() << std::endl;
+    }
+    // 按索引访问的重载不受影响
+    ok = ok && result.getString(0) == "1" && result.getView(3) == "second";
+    return ok;
+}
+
+bool testColumnHandle() {
+    printTestHeader("测试字段句柄复用与零分配");
+
+    QueryResult result(buildWideRows());
+    Column first = result.findColumn("column_0");
+    Column last = result.findColumn("column_79");
+
+    long long sum = 0;
+    size_t before = g_allocations.load();
+    while (result.next()) {
+        long long value = 0;
+        if (result.tryGetLong(first, value)) {
+            sum += value;
+        }
+        if (result.tryGetLong("column_79", value) && value == result.getLong(last)) {
+            sum += 1;
+        }
+    }
+    size_t allocations = g_allocations.load() - before;
+
+    long long expected = 1000LL * ROWS * (ROWS - 1) / 2 + ROWS;
+    std::cout << "求和: " << sum << " (期望 " << expected << "), 堆分配次数: " << allocations << std::endl;
+    return first.index() == 0 && last.index() == 79 && sum == expected && allocations == 0;
+}
+
+int main() {
+    Logger::getInstance().init("", LogLevel::WARNING, true);
+
+    std::vector<std::pair<std::string, bool>> results;
+    results.emplace_back("宽结果集按名称访问", testWideResult());
+    results.emplace_back("同名字段、大小写与不存在的字段", testNameRules());
+    results.emplace_back("字段句柄复用与零分配", testColumnHandle());
+
+    size_t passed = 0;
+    std::cout << "\n" << std::string(60, '*') << std::endl;
+    for (const auto& result : results) {
+        std::cout << (result.second ? "成功" : "失败") << " " << result.first << std::endl;
+        if (result.second) passed++;
+    }
+    std::cout << "\n通过: " << passed << "/" << results.size() << " 项测试" << std::endl;
+
+    return (passed == results.size()) ? 0 : 1;
+}
@@ -0,0 +1,230 @@
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include "connection_pool.h"
+#include "pool_config.h"
+#include "query_result.h"
+#include "field_view.h"
+#include "logger.h"
+
+/**
+ * @brief 零拷贝字段访问与不抛异常的数值解析测试
+ *
+ * 重点验证：
+ * 1. FieldView 的整数/浮点解析：边界值、溢出、非法输入都返回false而不抛异常
+ * 2. getView/tryGet* 在内存结果集上正确处理NULL，getInt等对DECIMAL保持原来的语义
+ * 3. 遍历结果集时使用 getView/tryGet* 不产生任何堆内存分配
+ * 4. 真实查询结果上的读取
+ */
+
+// 测试数据库连接参数
+const std::string TEST_HOST = "127.0.0.1";
+const std::string TEST_USER = "mxk";
+const std::string TEST_PASSWORD = "d2v8s2q3";
+const std::string TEST_DATABASE = "testdb";
+const unsigned int TEST_PORT = 3306;
+
+// 统计堆内存分配次数
+std::atomic<size_t> g_allocations(0);
+
+void* operator new(size_t size) {
+    g_allocations++;
+    void* p = std::malloc(size ? size : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+void printTestHeader(const std::string& title) {
+    std::cout << "\n" << std::string(60, '=') << std::endl;
+    std::cout << "  " << title << std::endl;
+    std::cout << std::string(60, '=') << std::endl;
+}
+
+FieldView view(const char* text) {
+    return FieldView(text, std::strlen(text));
+}
+
+bool testParsers() {
+    printTestHeader("测试整数与浮点数解析");
+
+    bool ok = true;
+    long long l = 0;
+    int i = 0;
+    unsigned long long u = 0;
+    double d = 0.0;
+
+    ok = ok && view("9223372036854775807").toLong(l) && l == 9223372036854775807LL;
+    ok = ok && view("-9223372036854775808").toLong(l) && l == (-9223372036854775807LL - 1);
+    ok = ok && !view("9223372036854775808").toLong(l);
+    ok = ok && view("18446744073709551615").toUnsignedLong(u) && u == 18446744073709551615ULL;
+    ok = ok && !view("18446744073709551616").toUnsignedLong(u);
+    ok = ok && !view("-1").toUnsignedLong(u);
+    ok = ok && view("-2147483648").toInt(i) && i == -2147483647 - 1;
+    ok = ok && !view("2147483648").toInt(i);
+    ok = ok && !view("12abc").toLong(l) && !view("").toLong(l) && !view("-").toLong(l);
+    ok = ok && !FieldView().toLong(l);
+    std::cout << "整数解析: " << (ok ? "通过" : "失败") << std::endl;
+
+    // 与strtod的结果逐位一致（快速路径和回退路径都覆盖到）
+    const char* doubles[] = {
+        "0", "-0", "0.1", "95.5", "-12.50", "3.14159265358979323846", "1e23",
+        "2.2250738585072014e-308", "1.7976931348623157e308", "9007199254740993", "1e-320"
+    };
+    for (const char* text : doubles) {
+        double expected = std::strtod(text, nullptr);
+        if (!view(text).toDouble(d) || std::memcmp(&d, &expected, sizeof(d)) != 0) {
+            std::cout << "浮点数解析不正确: " << text << std::endl;
+            ok = false;
+        }
+    }
+    ok = ok && !view("1e309").toDouble(d) && !view("1e").toDouble(d) &&
+         !view(".").toDouble(d) && !view("1.5x").toDouble(d) && !view("nan").toDouble(d);
+    return ok;
+}
+
+ResultRowsPtr buildRows(int rowCount) {
+    auto rows = std::make_shared<ResultRows>();
+    rows->fieldNames = {"id", "amount", "name"};
+    for (int r = 0; r < rowCount; r++) {
+        std::string id = std::to_string(r);
+        std::string amount = std::to_string(r) + ".25";
+        rows->appendValue(id.data(), static_cast<unsigned long>(id.size()));
+        if (r % 10 == 0) {
+            rows->appendNull();
+        } else {
+            rows->appendValue(amount.data(), static_cast<unsigned long>(amount.size()));
+        }
+        rows->appendValue("row", 3);
+        rows->rowCount++;
+    }
+    return rows;
+}
+
+bool testViews() {
+    printTestHeader("测试视图与NULL处理");
+
+    try {
+        QueryResult result(buildRows(20));
+        if (!result.next()) {
+            return false;
+        }
+        long long id = -1;
+        double amount = -1.0;
+        // NULL返回false，value保持不变
+        bool ok = result.tryGetLong(0, id) && id == 0 &&
+                  !result.tryGetDouble(1, amount) && amount == -1.0 &&
+                  result.getView(1).isNull() && result.getView("name") == "row";
+
+        result.next();
+        ok = ok && result.tryGetDouble("amount", amount) && amount == 1.25;
+        // 不是完整整数时tryGet返回false，getInt保持std::stoi的前缀语义
+        int truncated = 0;
+        ok = ok && !result.tryGetInt(1, truncated) && result.getInt(1) == 1;
+        // 字符串字段解析失败不抛异常
+        ok = ok && !result.tryGetLong("name", id);
+        return ok;
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool testNoAllocation() {
+    printTestHeader("测试遍历结果集不分配内存");
+
+    QueryResult result(buildRows(10000));
+    long long idSum = 0;
+    double amountSum = 0.0;
+    size_t nameBytes = 0;
+
+    size_t before = g_allocations.load();
+    while (result.next()) {
+        long long id = 0;
+        double amount = 0.0;
+        if (result.tryGetLong(0, id)) {
+            idSum += id;
+        }
+        if (result.tryGetDouble(1, amount)) {
+            amountSum += amount;
+        }
+        nameBytes += result.getView(2).size();
+    }
+    size_t allocations = g_allocations.load() - before;
+
+    std::cout << "id之和: " << idSum << ", amount之和: " << amountSum
+              << ", 堆分配次数: " << allocations << std::endl;
+    return allocations == 0 && idSum == 49995000LL && nameBytes == 30000;
+}
+
+bool testLiveQuery() {
+    printTestHeader("测试真实查询结果");
+
+    try {
+        PooledConnection conn = ConnectionPool::getInstance().acquire(3000);
+        auto result = conn->executeQuery(
+            "SELECT CAST(-42 AS SIGNED) AS i, CAST(18446744073709551615 AS UNSIGNED) AS u, "
+            "CAST(12.75 AS DECIMAL(10,2)) AS d, 0.1e0 AS f, NULL AS n, 'abc' AS s");
+        if (!result->next()) {
+            return false;
+        }
+        long long i = 0;
+        unsigned long long u = 0;
+        double d = 0.0, f = 0.0;
+        std::cout << "d=" << result->getView("d").toString() << " s=" << result->getView("s").toString() << std::endl;
+        return result->tryGetLong("i", i) && i == -42 &&
+               result->tryGetUnsignedLong("u", u) && u == 18446744073709551615ULL &&
+               result->tryGetDouble("d", d) && d == 12.75 &&
+               result->tryGetDouble("f", f) && f == 0.1 &&
+               result->getView("n").isNull() &&
+               result->getView("s") == "abc";
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+int main() {
+    Logger::getInstance().init("", LogLevel::WARNING, true);
+
+    std::vector<std::pair<std::string, bool>> results;
+    results.emplace_back("整数与浮点数解析", testParsers());
+    results.emplace_back("视图与NULL处理", testViews());
+    results.emplace_back("遍历不分配内存", testNoAllocation());
+
+    try {
+        PoolConfig config;
+        config.setConnectionLimits(1, 2, 1);
+        ConnectionPool::getInstance().initWithSingleDatabase(config, TEST_HOST, TEST_USER, TEST_PASSWORD, TEST_DATABASE, TEST_PORT);
+        results.emplace_back("真实查询结果", testLiveQuery());
+    } catch (const std::exception& e) {
+        std::cerr << "无法初始化连接池: " << e.what() << std::endl;
+        results.emplace_back("真实查询结果", false);
+    }
+
+    size_t passed = 0;
+    std::cout << "\n" << std::string(60, '*') << std::endl;
+    for (const auto& result : results) {
+        std::cout << (result.second ? "成功" : "失败") << " " << result.first << std::endl;
+        if (result.second) passed++;
+    }
+    std::cout << "\n通过: " << passed << "/" << results.size() << " 项测试" << std::endl;
+
+    ConnectionPool::getInstance().shutdown();
+    return (passed == results.size()) ? 0 : 1;
+}
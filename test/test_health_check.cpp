@@ -0,0 +1,128 @@
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include "connection_pool.h"
+#include "pool_config.h"
+#include "logger.h"
+
+/**
+ * @brief 后台健康检查测试
+ *
+ * 重点验证：
+ * 1. 空闲连接分批检查，检查期间其余空闲连接仍然可以借出
+ * 2. 每个空闲连接在一个健康检查周期内都被检查到
+ * 3. 被服务器断开的空闲连接在检查时被关闭并补足最小连接数
+ */
+
+// 测试数据库连接参数
+const std::string TEST_HOST = "127.0.0.1";
+const std::string TEST_USER = "mxk";
+const std::string TEST_PASSWORD = "d2v8s2q3";
+const std::string TEST_DATABASE = "testdb";
+const unsigned int TEST_PORT = 3306;
+
+void printTestHeader(const std::string& title) {
+    std::cout << "\n" << std::string(60, '=') << std::endl;
+    std::cout << "  " << title << std::endl;
+    std::cout << std::string(60, '=') << std::endl;
+}
+
+bool testIncrementalCheck() {
+    printTestHeader("测试分批检查空闲连接");
+
+    ConnectionPool pool("health-incremental");
+    try {
+        PoolConfig config;
+        config.setConnectionLimits(20, 20, 20);
+        config.setTimeouts(3000, 600000, 1000);
+        config.healthCheckBatchSize = 4;
+        config.validationPolicy = ValidationPolicy::BACKGROUND;
+        pool.initWithSingleDatabase(config, TEST_HOST, TEST_USER, TEST_PASSWORD, TEST_DATABASE, TEST_PORT);
+
+        // 两个周期内不断观察空闲连接数，同时只有一批被取出检查
+        size_t lowest = pool.getIdleCount();
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(2200);
+        while (std::chrono::steady_clock::now() < deadline) {
+            lowest = std::min(lowest, pool.getIdleCount());
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        std::vector<PooledConnection> borrowed;
+        size_t checked = 0;
+        for (int i = 0; i < 20; i++) {
+            borrowed.push_back(pool.acquire());
+            if (borrowed.back()->getLastCheckedTime() > 0) {
+                checked++;
+            }
+        }
+        std::cout << "最少空闲连接: " << lowest << ", 被检查过的连接: " << checked << "/20" << std::endl;
+        return lowest >= 16 && checked == 20;
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool testDeadConnectionReplaced() {
+    printTestHeader("测试关闭被服务器断开的空闲连接");
+
+    ConnectionPool pool("health-dead");
+    try {
+        PoolConfig config;
+        config.setConnectionLimits(3, 3, 3);
+        config.validationPolicy = ValidationPolicy::BACKGROUND;
+        pool.initWithSingleDatabase(config, TEST_HOST, TEST_USER, TEST_PASSWORD, TEST_DATABASE, TEST_PORT);
+
+        long long killed = 0;
+        {
+            PooledConnection victim = pool.acquire();
+            PooledConnection killer = pool.acquire();
+            QueryResultPtr id = victim->executeQuery("SELECT CONNECTION_ID() AS id");
+            killed = id->next() ? id->getLong("id") : 0;
+            victim.reset();
+            killer->executeUpdate("KILL " + std::to_string(killed));
+        }
+        pool.performHealthCheck();
+
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (pool.getIdleCount() < 3 && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        std::vector<PooledConnection> borrowed;
+        bool found = false;
+        for (int i = 0; i < 3; i++) {
+            borrowed.push_back(pool.acquire(AccessMode::READ_WRITE, 1000));
+            QueryResultPtr id = borrowed.back()->executeQuery("SELECT CONNECTION_ID() AS id");
+            if (id->next() && id->getLong("id") == killed) {
+                found = true;
+            }
+        }
+        std::cout << "被断开的会话: " << killed << ", 仍在连接池中: " << (found ? "是" : "否")
+                  << ", 连接数: " << pool.getTotalCount() << std::endl;
+        return killed > 0 && !found && pool.getTotalCount() == 3;
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+int main() {
+    Logger::getInstance().init("", LogLevel::WARNING, true);
+
+    std::vector<std::pair<std::string, bool>> results;
+    results.emplace_back("分批检查空闲连接", testIncrementalCheck());
+    results.emplace_back("关闭被服务器断开的空闲连接", testDeadConnectionReplaced());
+
+    size_t passed = 0;
+    std::cout << "\n" << std::string(60, '*') << std::endl;
+    for (const auto& result : results) {
+        std::cout << (result.second ? "成功" : "失败") << " " << result.first << std::endl;
+        if (result.second) passed++;
+    }
+    std::cout << "\n通过: " << passed << "/" << results.size() << " 项测试" << std::endl;
+
+    return (passed == results.size()) ? 0 : 1;
+}
@@ -0,0 +1,162 @@
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <stdexcept>
+#include "connection_pool.h"
+#include "latency_histogram.h"
+#include "performance_monitor.h"
+#include "pool_config.h"
+#include "logger.h"
+
+/**
+ * @brief 延迟分布（直方图）测试
+ *
+ * 重点验证：
+ * 1. 分位数的误差不超过 6.25%，最大值精确
+ * 2. 多线程同时记录不丢数据，快照可以合并、相减得到区间分布
+ * 3. 连接池把获取、使用、查询和建立连接的时间以微秒记录到性能监控
+ */
+
+// 测试数据库连接参数
+const std::string TEST_HOST = "127.0.0.1";
+const std::string TEST_USER = "mxk";
+const std::string TEST_PASSWORD = "d2v8s2q3";
+const std::string TEST_DATABASE = "testdb";
+const unsigned int TEST_PORT = 3306;
+
+void printTestHeader(const std::string& title) {
+    std::cout << "\n" << std::string(60, '=') << std::endl;
+    std::cout << "  " << title << std::endl;
+    std::cout << std::string(60, '=') << std::endl;
+}
+
+// 估计值不小于真实值，且误差不超过 1/16
+bool withinError(uint64_t estimate, uint64_t expected) {
+    return estimate >= expected && estimate - expected <= expected / 16;
+}
+
+bool testPercentiles() {
+    printTestHeader("测试分位数精度");
+
+    LatencyHistogram histogram;
+    // 1..100000 微秒各一次
+    for (uint64_t v = 1; v <= 100000; v++) {
+        histogram.record(v);
+    }
+    HistogramSnapshot snapshot = histogram.snapshot();
+    std::cout << "P50: " << snapshot.getPercentile(50) << ", P99: " << snapshot.getPercentile(99)
+              << ", P999: " << snapshot.getPercentile(99.9) << ", 最大: " << snapshot.getMax() << std::endl;
+
+    bool ok = snapshot.getCount() == 100000 && snapshot.getMax() == 100000 &&
+              snapshot.getSum() == 100000ULL * 100001 / 2 &&
+              withinError(snapshot.getPercentile(50), 50000) &&
+              withinError(snapshot.getPercentile(99), 99000) &&
+              withinError(snapshot.getPercentile(99.9), 99900) &&
+              snapshot.getPercentile(100) == 100000;
+
+    // 小值精确，超大值落在最后一个桶
+    LatencyHistogram small;
+    small.record(0);
+    small.record(7);
+    small.record(1ULL << 50);
+    HistogramSnapshot smallSnapshot = small.snapshot();
+    ok = ok && smallSnapshot.getPercentile(1) == 0 && smallSnapshot.getPercentile(50) == 7 &&
+         smallSnapshot.getMax() == (1ULL << 50) && HistogramSnapshot().getPercentile(99) == 0;
+    return ok;
+}
+
+bool testConcurrentRecord() {
+    printTestHeader("测试多线程记录与区间快照");
+
+    LatencyHistogram histogram;
+    const int threads = 16;
+    const int perThread = 20000;
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&histogram, t]() {
+            for (int i = 0; i < perThread; i++) {
+                histogram.record(100 + t);
+            }
+        });
+    }
+    // 记录期间取快照，不会阻塞记录线程
+    HistogramSnapshot during = histogram.snapshot();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    HistogramSnapshot first = histogram.snapshot();
+    std::cout << "记录期间: " << during.getCount() << ", 结束后: " << first.getCount() << std::endl;
+    bool ok = first.getCount() == static_cast<uint64_t>(threads) * perThread &&
+              during.getCount() <= first.getCount() && first.getMax() == 100 + threads - 1;
+
+    // 区间内只记录了慢请求
+    for (int i = 0; i < 100; i++) {
+        histogram.record(50000);
+    }
+    HistogramSnapshot interval = histogram.snapshot().since(first);
+    std::cout << "区间内: " << interval.getCount() << " 次, P50: " << interval.getPercentile(50) << std::endl;
+    ok = ok && interval.getCount() == 100 && withinError(interval.getPercentile(50), 50000) &&
+         interval.getSum() == 100 * 50000ULL;
+
+    // 合并两个快照
+    HistogramSnapshot merged = first;
+    merged.merge(interval);
+    ok = ok && merged.getCount() == first.getCount() + 100 && merged.getMax() >= interval.getMax();
+
+    histogram.reset();
+    ok = ok && histogram.snapshot().getCount() == 0;
+    return ok;
+}
+
+bool testPoolLatencies() {
+    printTestHeader("测试连接池记录的延迟分布");
+
+    ConnectionPool pool("latency");
+    try {
+        PoolConfig config;
+        config.setConnectionLimits(1, 4, 2);
+        pool.initWithSingleDatabase(config, TEST_HOST, TEST_USER, TEST_PASSWORD, TEST_DATABASE, TEST_PORT);
+        PerformanceMonitor& monitor = pool.getPerformanceMonitor();
+
+        for (int i = 0; i < 20; i++) {
+            PooledConnection conn = pool.acquire();
+            conn->executeQuery("SELECT 1");
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+
+        HistogramSnapshot usage = monitor.getLatencySnapshot(LatencyMetric::CONNECTION_USAGE);
+        HistogramSnapshot acquire = monitor.getLatencySnapshot(LatencyMetric::CONNECTION_ACQUIRE);
+        HistogramSnapshot query = monitor.getLatencySnapshot(LatencyMetric::QUERY_EXECUTION);
+        HistogramSnapshot connect = monitor.getLatencySnapshot(LatencyMetric::CONNECT);
+        std::cout << monitor.getStatsString();
+
+        // 每次借出至少持有2ms，以微秒记录
+        return usage.getCount() == 20 && usage.getPercentile(50) >= 2000 &&
+               acquire.getCount() == 20 && query.getCount() >= 20 &&
+               connect.getCount() >= 1 && connect.getMax() > 0 &&
+               monitor.getLatencyPercentile(LatencyMetric::CONNECTION_USAGE, 99) >= usage.getPercentile(50);
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+int main() {
+    Logger::getInstance().init("", LogLevel::WARNING, true);
+
+    std::vector<std::pair<std::string, bool>> results;
+    results.emplace_back("分位数精度", testPercentiles());
+    results.emplace_back("多线程记录与区间快照", testConcurrentRecord());
+    results.emplace_back("连接池记录的延迟分布", testPoolLatencies());
+
+    size_t passed = 0;
+    std::cout << "\n" << std::string(60, '*') << std::endl;
+    for (const auto& result : results) {
+        std::cout << (result.second ? "成功" : "失败") << " " << result.first << std::endl;
+        if (result.second) passed++;
+    }
+    std::cout << "\n通过: " << passed << "/" << results.size() << " 项测试" << std::endl;
+
+    return (passed == results.size()) ? 0 : 1;
+}
@@ -0,0 +1,377 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <cstdlib>
+#include <cmath>
+#include <new>
+#include "load_balancer.h"
+#include "connection_pool.h"
+#include "pool_config.h"
+#include "logger.h"
+
+/**
+ * @brief 负载均衡器快照选择与自适应策略测试（除第8项外不需要数据库）
+ *
+ * 重点验证：
+ * 1. 权重策略的选择比例与权重一致，权重为0的实例不会被选中
+ * 2. 轮询策略依次选择每个实例
+ * 3. 选择过程不产生堆内存分配
+ * 4. 多线程选择的同时增删实例、修改权重，选择结果始终有效
+ * 5. 选择吞吐量
+ * 6. LEAST_CONNECTIONS/PEAK_EWMA/POWER_OF_TWO 根据执行中的查询数和延迟避开慢的实例
+ * 7. 读写借出只选主库，只读借出只选从库，没有从库时回退到主库
+ * 8. 连接执行查询时更新所属实例的统计（需要数据库）
+ */
+
+// 测试数据库连接参数
+const std::string TEST_HOST = "127.0.0.1";
+const std::string TEST_USER = "mxk";
+const std::string TEST_PASSWORD = "d2v8s2q3";
+const std::string TEST_DATABASE = "testdb";
+const unsigned int TEST_PORT = 3306;
+
+// 统计堆内存分配次数
+std::atomic<size_t> g_allocations(0);
+
+void* operator new(size_t size) {
+    g_allocations++;
+    void* p = std::malloc(size ? size : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+void printTestHeader(const std::string& title) {
+    std::cout << "\n" << std::string(60, '=') << std::endl;
+    std::cout << "  " << title << std::endl;
+    std::cout << std::string(60, '=') << std::endl;
+}
+
+DBConfig makeConfig(unsigned int port, unsigned int weight) {
+    return DBConfig("127.0.0.1", "mxk", "d2v8s2q3", "testdb", port, weight);
+}
+
+bool testWeightedDistribution() {
+    printTestHeader("测试权重策略的选择比例");
+
+    auto& balancer = LoadBalancer::getInstance();
+    balancer.init({makeConfig(3001, 1), makeConfig(3002, 2), makeConfig(3003, 7), makeConfig(3004, 0)},
+                  LoadBalanceStrategy::WEIGHTED);
+
+    const int picks = 1000000;
+    std::vector<int> counts(4, 0);
+    for (int i = 0; i < picks; i++) {
+        counts[balancer.selectBackend()->config.port - 3001]++;
+    }
+
+    bool ok = counts[3] == 0;
+    const double expected[] = {0.1, 0.2, 0.7};
+    for (int i = 0; i < 3; i++) {
+        double ratio = static_cast<double>(counts[i]) / picks;
+        std::cout << "端口 " << 3001 + i << ": " << ratio << " (期望 " << expected[i] << ")" << std::endl;
+        ok = ok && std::fabs(ratio - expected[i]) < 0.005;
+    }
+
+    // 修改权重后立即生效
+    balancer.updateWeight("127.0.0.1", 3003, 0);
+    balancer.updateWeight("127.0.0.1", 3004, 1);
+    counts.assign(4, 0);
+    for (int i = 0; i < picks; i++) {
+        counts[balancer.selectBackend()->config.port - 3001]++;
+    }
+    std::cout << "修改权重后端口3003被选中 " << counts[2] << " 次" << std::endl;
+    return ok && counts[2] == 0 && std::fabs(counts[3] / static_cast<double>(picks) - 0.25) < 0.005;
+}
+
+bool testRoundRobin() {
+    printTestHeader("测试轮询策略");
+
+    auto& balancer = LoadBalancer::getInstance();
+    balancer.init({makeConfig(3001, 1), makeConfig(3002, 1), makeConfig(3003, 1)},
+                  LoadBalanceStrategy::ROUND_ROBIN);
+    for (int i = 0; i < 30; i++) {
+        if (balancer.selectBackend()->config.port != static_cast<unsigned int>(3001 + i % 3)) {
+            std::cout << "第" << i << "次选择的顺序不正确" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool testNoAllocation() {
+    printTestHeader("测试选择过程不分配内存");
+
+    auto& balancer = LoadBalancer::getInstance();
+    balancer.init({makeConfig(3001, 3), makeConfig(3002, 5)}, LoadBalanceStrategy::WEIGHTED);
+    balancer.selectBackend();
+
+    const LoadBalanceStrategy strategies[] = {
+        LoadBalanceStrategy::WEIGHTED, LoadBalanceStrategy::RANDOM, LoadBalanceStrategy::ROUND_ROBIN,
+        LoadBalanceStrategy::LEAST_CONNECTIONS, LoadBalanceStrategy::PEAK_EWMA, LoadBalanceStrategy::POWER_OF_TWO
+    };
+    size_t allocations = 0;
+    unsigned long long portSum = 0;
+    for (LoadBalanceStrategy strategy : strategies) {
+        balancer.setStrategy(strategy);
+        size_t before = g_allocations.load();
+        for (int i = 0; i < 100000; i++) {
+            portSum += balancer.selectBackend()->config.port;
+        }
+        allocations += g_allocations.load() - before;
+    }
+    std::cout << "堆分配次数: " << allocations << " (端口和 " << portSum << ")" << std::endl;
+    return allocations == 0;
+}
+
+bool testConcurrentUpdates() {
+    printTestHeader("测试选择与配置修改并发进行");
+
+    auto& balancer = LoadBalancer::getInstance();
+    balancer.init({makeConfig(3001, 1), makeConfig(3002, 1)}, LoadBalanceStrategy::WEIGHTED);
+
+    std::atomic<bool> stop(false);
+    std::atomic<bool> invalid(false);
+    std::atomic<unsigned long long> selections(0);
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; t++) {
+        readers.emplace_back([&]() {
+            unsigned long long local = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                BackendPtr backend = balancer.selectBackend();
+                if (!backend || backend->config.port < 3001 || backend->config.port > 3010) {
+                    invalid = true;
+                }
+                local++;
+            }
+            selections += local;
+        });
+    }
+
+    int updates = 0;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(500);
+    while (std::chrono::steady_clock::now() < deadline) {
+        unsigned int port = 3003 + updates % 8;
+        balancer.addDatabase(makeConfig(port, 1 + updates % 5));
+        balancer.updateWeight("127.0.0.1", 3001, updates % 4);
+        LoadBalanceStrategy strategy = static_cast<LoadBalanceStrategy>(updates % 6);
+        balancer.setStrategy(strategy);
+        balancer.removeDatabase("127.0.0.1", port);
+        updates++;
+    }
+    stop = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+
+    std::cout << "配置修改 " << updates << " 轮, 选择 " << selections.load() << " 次" << std::endl;
+    return !invalid && balancer.getDatabaseCount() == 2;
+}
+
+bool testThroughput() {
+    printTestHeader("测试选择吞吐量");
+
+    auto& balancer = LoadBalancer::getInstance();
+    balancer.init({makeConfig(3001, 1), makeConfig(3002, 2), makeConfig(3003, 3), makeConfig(3004, 4)},
+                  LoadBalanceStrategy::WEIGHTED);
+
+    const int threadCount = 4;
+    const int perThread = 2000000;
+    std::atomic<unsigned long long> checksum(0);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threadCount; t++) {
+        workers.emplace_back([&]() {
+            unsigned long long local = 0;
+            for (int i = 0; i < perThread; i++) {
+                local += balancer.selectBackend()->config.port;
+            }
+            checksum += local;
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double perSecond = threadCount * static_cast<double>(perThread) / seconds;
+    std::cout << threadCount << " 个线程共选择 " << threadCount * perThread << " 次, 每秒 "
+              << static_cast<long long>(perSecond) << " 次" << std::endl;
+    return checksum.load() > 0;
+}
+
+// 在指定策略下选择picks次，返回端口3001被选中的比例
+double shareOfFirst(LoadBalanceStrategy strategy, int picks) {
+    auto& balancer = LoadBalancer::getInstance();
+    balancer.setStrategy(strategy);
+    int first = 0;
+    for (int i = 0; i < picks; i++) {
+        if (balancer.selectBackend()->config.port == 3001) {
+            first++;
+        }
+    }
+    return static_cast<double>(first) / picks;
+}
+
+bool testAdaptiveStrategies() {
+    printTestHeader("测试根据负载和延迟选择实例");
+
+    auto& balancer = LoadBalancer::getInstance();
+    balancer.init({makeConfig(3001, 1), makeConfig(3002, 1)}, LoadBalanceStrategy::WEIGHTED);
+    std::vector<BackendPtr> backends = balancer.getBackends();
+    BackendStats& fast = *backends[0]->stats;
+    BackendStats& slow = *backends[1]->stats;
+
+    // 没有任何统计时按权重平分
+    double idleShare = shareOfFirst(LoadBalanceStrategy::PEAK_EWMA, 100000);
+    std::cout << "无统计时PEAK_EWMA选择3001的比例: " << idleShare << std::endl;
+    bool ok = idleShare > 0.45 && idleShare < 0.55;
+
+    // 3002延迟50ms，3001延迟1ms
+    for (int i = 0; i < 20; i++) {
+        fast.requestStarted();
+        fast.requestFinished(1000000);
+        slow.requestStarted();
+        slow.requestFinished(50000000);
+    }
+    double ewmaShare = shareOfFirst(LoadBalanceStrategy::PEAK_EWMA, 10000);
+    double p2cShare = shareOfFirst(LoadBalanceStrategy::POWER_OF_TWO, 100000);
+    std::cout << "PEAK_EWMA选择快实例的比例: " << ewmaShare << std::endl;
+    std::cout << "POWER_OF_TWO选择快实例的比例: " << p2cShare << std::endl;
+    ok = ok && ewmaShare == 1.0 && p2cShare > 0.7;
+
+    // 一次慢查询立即抬高平均延迟
+    fast.requestStarted();
+    fast.requestFinished(200000000);
+    ok = ok && shareOfFirst(LoadBalanceStrategy::PEAK_EWMA, 1000) == 0.0;
+
+    // 3001上有3个执行中的查询，LEAST_CONNECTIONS选择3002
+    for (int i = 0; i < 3; i++) {
+        fast.requestStarted();
+    }
+    double lcShare = shareOfFirst(LoadBalanceStrategy::LEAST_CONNECTIONS, 1000);
+    std::cout << "LEAST_CONNECTIONS选择忙实例的比例: " << lcShare << std::endl;
+    ok = ok && lcShare == 0.0;
+
+    // 按权重比较：3002权重为4时，4个执行中的查询仍比3001的3个更空闲
+    balancer.updateWeight("127.0.0.1", 3002, 4);
+    for (int i = 0; i < 4; i++) {
+        slow.requestStarted();
+    }
+    ok = ok && shareOfFirst(LoadBalanceStrategy::LEAST_CONNECTIONS, 1000) == 0.0;
+    // 修改权重不会丢掉统计
+    ok = ok && balancer.getBackends()[1]->stats->getInFlight() == 4;
+    return ok;
+}
+
+bool testRoleRouting() {
+    printTestHeader("测试按主从角色选择实例");
+
+    auto& balancer = LoadBalancer::getInstance();
+    DBConfig primary = makeConfig(3001, 1);
+    DBConfig replicaA = makeConfig(3002, 1);
+    replicaA.role = DBRole::REPLICA;
+    DBConfig replicaB = makeConfig(3003, 3);
+    replicaB.role = DBRole::REPLICA;
+    balancer.init({primary, replicaA, replicaB}, LoadBalanceStrategy::WEIGHTED);
+
+    bool ok = balancer.hasReplicas();
+    int counts[3] = {0, 0, 0};
+    for (int i = 0; i < 40000; i++) {
+        if (balancer.selectBackend(AccessMode::READ_WRITE)->config.port != 3001) {
+            ok = false;
+        }
+        counts[balancer.selectBackend(AccessMode::READ_ONLY)->config.port - 3001]++;
+    }
+    // 从库之间仍按权重分配
+    double share = counts[2] / 40000.0;
+    std::cout << "只读借出分布: " << counts[0] << " / " << counts[1] << " / " << counts[2] << std::endl;
+    ok = ok && counts[0] == 0 && share > 0.72 && share < 0.78;
+
+    // 移除所有从库后，只读借出回退到主库
+    balancer.removeDatabase("127.0.0.1", 3002);
+    balancer.removeDatabase("127.0.0.1", 3003);
+    ok = ok && !balancer.hasReplicas() && balancer.selectBackend(AccessMode::READ_ONLY)->config.port == 3001;
+
+    // 只有从库时，读写借出失败
+    balancer.init({replicaA}, LoadBalanceStrategy::WEIGHTED);
+    try {
+        balancer.selectBackend(AccessMode::READ_WRITE);
+        ok = false;
+    } catch (const std::exception& e) {
+        std::cout << "捕获到预期异常: " << e.what() << std::endl;
+    }
+    return ok && balancer.selectBackend(AccessMode::READ_ONLY)->config.port == 3002;
+}
+
+bool testLiveStats() {
+    printTestHeader("测试查询更新实例统计");
+
+    try {
+        auto& pool = ConnectionPool::getInstance();
+        pool.setLoadBalanceStrategy(LoadBalanceStrategy::PEAK_EWMA);
+        BackendPtr backend = LoadBalancer::getInstance().getBackends().at(0);
+        uint64_t before = backend->stats->getSampleCount();
+        {
+            PooledConnection conn = pool.acquire(3000);
+            for (int i = 0; i < 10; i++) {
+                conn->executeQuery("SELECT 1");
+            }
+        }
+        int64_t now = BackendStats::nowNanos();
+        std::cout << "样本数: " << backend->stats->getSampleCount() - before
+                  << ", 平均延迟: " << backend->stats->getEwmaNanos(now) / 1000 << "us"
+                  << ", 打开的连接: " << backend->stats->getOpenConnections() << std::endl;
+        return backend->stats->getSampleCount() - before == 10 &&
+               backend->stats->getInFlight() == 0 &&
+               backend->stats->getOpenConnections() > 0 &&
+               backend->stats->getEwmaNanos(now) > 0;
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+int main() {
+    Logger::getInstance().init("", LogLevel::WARNING, true);
+
+    std::vector<std::pair<std::string, bool>> results;
+    results.emplace_back("权重策略的选择比例", testWeightedDistribution());
+    results.emplace_back("轮询策略", testRoundRobin());
+    results.emplace_back("选择过程不分配内存", testNoAllocation());
+    results.emplace_back("选择与配置修改并发进行", testConcurrentUpdates());
+    results.emplace_back("选择吞吐量", testThroughput());
+    results.emplace_back("根据负载和延迟选择实例", testAdaptiveStrategies());
+    results.emplace_back("按主从角色选择实例", testRoleRouting());
+
+    try {
+        PoolConfig config;
+        config.setConnectionLimits(1, 2, 1);
+        ConnectionPool::getInstance().initWithSingleDatabase(config, TEST_HOST, TEST_USER, TEST_PASSWORD, TEST_DATABASE, TEST_PORT);
+        results.emplace_back("查询更新实例统计", testLiveStats());
+    } catch (const std::exception& e) {
+        std::cerr << "无法初始化连接池: " << e.what() << std::endl;
+        results.emplace_back("查询更新实例统计", false);
+    }
+
+    size_t passed = 0;
+    std::cout << "\n" << std::string(60, '*') << std::endl;
+    for (const auto& result : results) {
+        std::cout << (result.second ? "成功" : "失败") << " " << result.first << std::endl;
+        if (result.second) passed++;
+    }
+    std::cout << "\n通过: " << passed << "/" << results.size() << " 项测试" << std::endl;
+
+    ConnectionPool::getInstance().shutdown();
+    return (passed == results.size()) ? 0 : 1;
+}
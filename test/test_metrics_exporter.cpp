@@ -0,0 +1,177 @@
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <mutex>
+#include <stdexcept>
+#include "connection_pool.h"
+#include "metrics_exporter.h"
+#include "pool_config.h"
+#include "logger.h"
+
+/**
+ * @brief 指标导出测试
+ *
+ * 重点验证：
+ * 1. OpenMetrics 文本格式正确：每个指标族只出现一次，标签值被转义，以 # EOF 结尾
+ * 2. 连接池的指标快照包含计数、连接数和每个实例的负载
+ * 3. 定时回调收到的区间增量加起来等于实际的借出次数
+ */
+
+// 测试数据库连接参数
+const std::string TEST_HOST = "127.0.0.1";
+const std::string TEST_USER = "mxk";
+const std::string TEST_PASSWORD = "d2v8s2q3";
+const std::string TEST_DATABASE = "testdb";
+const unsigned int TEST_PORT = 3306;
+
+void printTestHeader(const std::string& title) {
+    std::cout << "\n" << std::string(60, '=') << std::endl;
+    std::cout << "  " << title << std::endl;
+    std::cout << std::string(60, '=') << std::endl;
+}
+
+bool contains(const std::string& text, const std::string& part) {
+    if (text.find(part) == std::string::npos) {
+        std::cout << "缺少: " << part << std::endl;
+        return false;
+    }
+    return true;
+}
+
+size_t countOf(const std::string& text, const std::string& part) {
+    size_t count = 0;
+    for (size_t pos = text.find(part); pos != std::string::npos; pos = text.find(part, pos + 1)) {
+        count++;
+    }
+    return count;
+}
+
+bool testFormat() {
+    printTestHeader("测试 OpenMetrics 格式");
+
+    PoolMetrics first;
+    first.pool = "order\"s";
+    first.running = true;
+    first.totalConnections = 5;
+    first.idleConnections = 3;
+    first.stats.totalConnectionsAcquired = 42;
+    BackendMetrics backend;
+    backend.host = "db1";
+    backend.port = 3306;
+    backend.role = DBRole::REPLICA;
+    backend.totalConnections = 5;
+    backend.maxConnections = 10;
+    first.backends.push_back(backend);
+
+    PoolMetrics second;
+    second.pool = "report";
+
+    std::string text = MetricsExporter::toOpenMetrics(std::vector<PoolMetrics>{first, second});
+    std::cout << text.substr(0, 600) << "..." << std::endl;
+
+    size_t eof = text.rfind("# EOF\n");
+    return contains(text, "mysql_pool_up{pool=\"order\\\"s\"} 1\n") &&
+           contains(text, "mysql_pool_up{pool=\"report\"} 0\n") &&
+           contains(text, "mysql_pool_connections{pool=\"order\\\"s\",state=\"idle\"} 3\n") &&
+           contains(text, "mysql_pool_connections_acquired_total{pool=\"order\\\"s\"} 42\n") &&
+           contains(text, "mysql_pool_acquire_seconds{pool=\"report\",quantile=\"0.99\"} 0\n") &&
+           contains(text, "mysql_pool_backend_connections{pool=\"order\\\"s\",backend=\"db1:3306\",role=\"replica\",state=\"total\"} 5\n") &&
+           contains(text, "mysql_pool_backend_circuit_state{pool=\"order\\\"s\",backend=\"db1:3306\",role=\"replica\","
+                          "mysql_pool_backend_circuit_state=\"closed\"} 1\n") &&
+           countOf(text, "# TYPE mysql_pool_connections_acquired counter\n") == 1 &&
+           countOf(text, "# UNIT mysql_pool_query_seconds seconds\n") == 1 &&
+           eof != std::string::npos && eof + 6 == text.size();
+}
+
+bool testPoolMetrics() {
+    printTestHeader("测试连接池的指标快照");
+
+    ConnectionPool pool("metrics");
+    try {
+        PoolConfig config;
+        config.setConnectionLimits(1, 4, 2);
+        pool.initWithSingleDatabase(config, TEST_HOST, TEST_USER, TEST_PASSWORD, TEST_DATABASE, TEST_PORT);
+
+        PooledConnection held = pool.acquire();
+        for (int i = 0; i < 10; i++) {
+            pool.acquire()->executeQuery("SELECT 1");
+        }
+        PoolMetrics metrics = pool.getMetrics();
+        std::string text = MetricsExporter::toOpenMetrics(metrics);
+        std::cout << "总连接: " << metrics.totalConnections << ", 借出中: " << metrics.activeConnections
+                  << ", 借出次数: " << metrics.stats.totalConnectionsAcquired << std::endl;
+
+        return metrics.pool == "metrics" && metrics.running && metrics.activeConnections == 1 &&
+               metrics.stats.totalConnectionsAcquired == 11 && metrics.queryLatency.getCount() == 10 &&
+               metrics.backends.size() == 1 && metrics.backends[0].host == TEST_HOST &&
+               metrics.backends[0].maxConnections == 4 &&
+               metrics.idleConnections + metrics.activeConnections == metrics.totalConnections &&
+               contains(text, "mysql_pool_queries_total{pool=\"metrics\"} 10\n") &&
+               contains(text, "backend=\"" + TEST_HOST + ":3306\",role=\"primary\"");
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool testReporter() {
+    printTestHeader("测试定时增量回调");
+
+    ConnectionPool pool("reporter");
+    try {
+        PoolConfig config;
+        config.setConnectionLimits(1, 4, 2);
+        pool.initWithSingleDatabase(config, TEST_HOST, TEST_USER, TEST_PASSWORD, TEST_DATABASE, TEST_PORT);
+        pool.acquire();
+
+        std::mutex mutex;
+        std::vector<uint64_t> deltas;
+        uint64_t lastTotal = 0;
+        MetricsReporter reporter(pool, 30, [&](const PoolMetrics& delta, const PoolMetrics& current) {
+            std::lock_guard<std::mutex> lock(mutex);
+            deltas.push_back(delta.stats.totalConnectionsAcquired);
+            lastTotal = current.stats.totalConnectionsAcquired;
+        });
+        reporter.start();
+        for (int i = 0; i < 50; i++) {
+            pool.acquire();
+            std::this_thread::sleep_for(std::chrono::milliseconds(3));
+        }
+        reporter.stop();
+        // 停止后补上最后一个区间
+        reporter.reportNow();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        uint64_t sum = 0;
+        for (uint64_t delta : deltas) {
+            sum += delta;
+        }
+        std::cout << "回调 " << deltas.size() << " 次, 增量合计: " << sum << ", 累计: " << lastTotal << std::endl;
+
+        // 启动前的一次借出不计入增量
+        return !reporter.isRunning() && deltas.size() >= 3 && sum == 50 && lastTotal == 51;
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+int main() {
+    Logger::getInstance().init("", LogLevel::WARNING, true);
+
+    std::vector<std::pair<std::string, bool>> results;
+    results.emplace_back("OpenMetrics 格式", testFormat());
+    results.emplace_back("连接池的指标快照", testPoolMetrics());
+    results.emplace_back("定时增量回调", testReporter());
+
+    size_t passed = 0;
+    std::cout << "\n" << std::string(60, '*') << std::endl;
+    for (const auto& result : results) {
+        std::cout << (result.second ? "成功" : "失败") << " " << result.first << std::endl;
+        if (result.second) passed++;
+    }
+    std::cout << "\n通过: " << passed << "/" << results.size() << " 项测试" << std::endl;
+
+    return (passed == results.size()) ? 0 : 1;
+}
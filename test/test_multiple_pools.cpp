@@ -0,0 +1,156 @@
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include "connection_pool.h"
+#include "load_balancer.h"
+#include "performance_monitor.h"
+#include "pool_config.h"
+#include "logger.h"
+
+/**
+ * @brief 多个独立连接池测试
+ *
+ * 重点验证：
+ * 1. 命名连接池各自拥有配置、负载均衡器和性能统计，默认连接池仍是 getInstance()
+ * 2. 修改一个连接池的实例不影响另一个连接池
+ * 3. 关闭一个连接池不影响另一个连接池，直接构造的连接池由调用者管理生命周期
+ */
+
+// 测试数据库连接参数
+const std::string TEST_HOST = "127.0.0.1";
+const std::string OTHER_HOST = "localhost";
+const std::string TEST_USER = "mxk";
+const std::string TEST_PASSWORD = "d2v8s2q3";
+const std::string TEST_DATABASE = "testdb";
+const unsigned int TEST_PORT = 3306;
+
+void printTestHeader(const std::string& title) {
+    std::cout << "\n" << std::string(60, '=') << std::endl;
+    std::cout << "  " << title << std::endl;
+    std::cout << std::string(60, '=') << std::endl;
+}
+
+// 连接所属实例的主机名
+std::string backendHost(ConnectionPool& pool, const PooledConnection& conn) {
+    for (const auto& backend : pool.getLoadBalancer().getBackends()) {
+        if (backend->id == conn->getBackendId()) {
+            return backend->config.host;
+        }
+    }
+    return "";
+}
+
+bool testNamedInstances() {
+    printTestHeader("测试命名连接池");
+
+    auto& oltp = ConnectionPool::getInstance("oltp");
+    auto& analytics = ConnectionPool::getInstance("analytics");
+    std::vector<std::string> names = ConnectionPool::getInstanceNames();
+
+    bool ok = &ConnectionPool::getInstance("oltp") == &oltp &&
+              &ConnectionPool::getInstance("default") == &ConnectionPool::getInstance() &&
+              &oltp != &analytics && &oltp != &ConnectionPool::getInstance() &&
+              &oltp.getLoadBalancer() != &analytics.getLoadBalancer() &&
+              &oltp.getLoadBalancer() != &LoadBalancer::getInstance() &&
+              &ConnectionPool::getInstance().getLoadBalancer() == &LoadBalancer::getInstance() &&
+              &oltp.getPerformanceMonitor() != &PerformanceMonitor::getInstance() &&
+              oltp.getName() == "oltp" &&
+              std::count(names.begin(), names.end(), "analytics") == 1 &&
+              std::count(names.begin(), names.end(), "default") == 1;
+    return ok;
+}
+
+bool testIsolation() {
+    printTestHeader("测试连接池之间相互隔离");
+
+    auto& oltp = ConnectionPool::getInstance("oltp");
+    auto& analytics = ConnectionPool::getInstance("analytics");
+    try {
+        PoolConfig oltpConfig;
+        oltpConfig.setConnectionLimits(2, 10, 4);
+        PoolConfig analyticsConfig;
+        analyticsConfig.setConnectionLimits(1, 3, 2);
+        oltp.initWithSingleDatabase(oltpConfig, TEST_HOST, TEST_USER, TEST_PASSWORD, TEST_DATABASE, TEST_PORT);
+        analytics.initWithSingleDatabase(analyticsConfig, OTHER_HOST, TEST_USER, TEST_PASSWORD, TEST_DATABASE, TEST_PORT);
+
+        uint64_t oltpBefore = oltp.getPerformanceMonitor().getStats().totalConnectionsAcquired;
+        uint64_t analyticsBefore = analytics.getPerformanceMonitor().getStats().totalConnectionsAcquired;
+        for (int i = 0; i < 10; i++) {
+            PooledConnection conn = oltp.acquire();
+            if (backendHost(oltp, conn) != TEST_HOST) {
+                std::cout << "连接来自错误的实例: " << backendHost(oltp, conn) << std::endl;
+                oltp.shutdown();
+                analytics.shutdown();
+                return false;
+            }
+        }
+        PooledConnection report = analytics.acquire();
+
+        // 统计分别记录
+        uint64_t oltpAcquired = oltp.getPerformanceMonitor().getStats().totalConnectionsAcquired - oltpBefore;
+        uint64_t analyticsAcquired = analytics.getPerformanceMonitor().getStats().totalConnectionsAcquired - analyticsBefore;
+        std::cout << "oltp 借出: " << oltpAcquired << ", analytics 借出: " << analyticsAcquired << std::endl;
+        bool ok = oltpAcquired == 10 && analyticsAcquired == 1 &&
+                  backendHost(analytics, report) == OTHER_HOST &&
+                  oltp.getConfig().maxConnections == 10 && analytics.getConfig().maxConnections == 3;
+
+        // 给 oltp 增加实例不影响 analytics
+        oltp.getLoadBalancer().addDatabase(DBConfig(OTHER_HOST, TEST_USER, TEST_PASSWORD, TEST_DATABASE, TEST_PORT));
+        ok = ok && oltp.getLoadBalancer().getDatabaseCount() == 2 &&
+                   analytics.getLoadBalancer().getDatabaseCount() == 1;
+
+        // 关闭 oltp 后 analytics 照常工作
+        oltp.shutdown();
+        report.reset();
+        PooledConnection again = analytics.acquire();
+        ok = ok && !oltp.isInitialized() && analytics.isInitialized() && again->executeQuery("SELECT 1") != nullptr;
+        again.reset();
+        analytics.shutdown();
+        return ok;
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        oltp.shutdown();
+        analytics.shutdown();
+        return false;
+    }
+}
+
+bool testOwnedInstance() {
+    printTestHeader("测试直接构造的连接池");
+
+    try {
+        ConnectionPool tenant("tenant-42");
+        PoolConfig config;
+        config.setConnectionLimits(1, 2, 1);
+        tenant.initWithSingleDatabase(config, TEST_HOST, TEST_USER, TEST_PASSWORD, TEST_DATABASE, TEST_PORT);
+        bool ok = tenant.acquire()->executeQuery("SELECT 1") != nullptr && tenant.getTotalCount() >= 1;
+        std::vector<std::string> names = ConnectionPool::getInstanceNames();
+        // 直接构造的连接池不进入全局列表，析构时自动关闭
+        return ok && std::count(names.begin(), names.end(), "tenant-42") == 0;
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+int main() {
+    Logger::getInstance().init("", LogLevel::WARNING, true);
+
+    std::vector<std::pair<std::string, bool>> results;
+    results.emplace_back("命名连接池", testNamedInstances());
+    results.emplace_back("连接池之间相互隔离", testIsolation());
+    results.emplace_back("直接构造的连接池", testOwnedInstance());
+
+    size_t passed = 0;
+    std::cout << "\n" << std::string(60, '*') << std::endl;
+    for (const auto& result : results) {
+        std::cout << (result.second ? "成功" : "失败") << " " << result.first << std::endl;
+        if (result.second) passed++;
+    }
+    std::cout << "\n通过: " << passed << "/" << results.size() << " 项测试" << std::endl;
+
+    return (passed == results.size()) ? 0 : 1;
+}
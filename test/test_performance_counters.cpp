@@ -0,0 +1,142 @@
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <stdexcept>
+#include "connection_pool.h"
+#include "performance_monitor.h"
+#include "pool_config.h"
+#include "logger.h"
+
+/**
+ * @brief 分片计数器测试
+ *
+ * 重点验证：
+ * 1. 线程数多于分片数时，多线程同时记录的计数仍然准确
+ * 2. 关闭统计后不再记录，重新开启后继续累加
+ * 3. 连接池按 PoolConfig::enablePerformanceStats 开关自己的统计
+ */
+
+// 测试数据库连接参数
+const std::string TEST_HOST = "127.0.0.1";
+const std::string TEST_USER = "mxk";
+const std::string TEST_PASSWORD = "d2v8s2q3";
+const std::string TEST_DATABASE = "testdb";
+const unsigned int TEST_PORT = 3306;
+
+void printTestHeader(const std::string& title) {
+    std::cout << "\n" << std::string(60, '=') << std::endl;
+    std::cout << "  " << title << std::endl;
+    std::cout << std::string(60, '=') << std::endl;
+}
+
+bool testConcurrentCounters() {
+    printTestHeader("测试多线程计数");
+
+    PerformanceMonitor monitor;
+    const int threads = 64;
+    const int perThread = 10000;
+    std::vector<std::thread> workers;
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&monitor, t]() {
+            for (int i = 0; i < perThread; i++) {
+                monitor.recordQueryExecuted(10, i % 100 != 0);
+                monitor.recordConnectionAcquired(5);
+                monitor.recordConnectionReleased(t);
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+
+    PerformanceStats stats = monitor.getStats();
+    const uint64_t total = static_cast<uint64_t>(threads) * perThread;
+    std::cout << "记录 " << total * 3 << " 次, 耗时 " << elapsed << " ms" << std::endl;
+    std::cout << "查询: " << stats.totalQueriesExecuted << ", 失败: " << stats.failedQueries
+              << ", 获取: " << stats.totalConnectionsAcquired << std::endl;
+
+    bool ok = stats.totalQueriesExecuted == total && stats.failedQueries == total / 100 &&
+              stats.totalQueryExecutionTime == total * 10 &&
+              stats.totalConnectionsAcquired == total && stats.totalConnectionAcquireTime == total * 5 &&
+              stats.totalConnectionsReleased == total &&
+              stats.totalConnectionUsageTime == static_cast<uint64_t>(perThread) * threads * (threads - 1) / 2;
+
+    monitor.resetStats();
+    ok = ok && monitor.getStats().totalQueriesExecuted == 0 && monitor.getStats().totalConnectionUsageTime == 0;
+    return ok;
+}
+
+bool testDisabled() {
+    printTestHeader("测试关闭统计");
+
+    PerformanceMonitor monitor;
+    monitor.recordQueryExecuted(100, true);
+    monitor.setEnabled(false);
+    monitor.recordQueryExecuted(100, true);
+    monitor.recordConnectionCreated(1000);
+    monitor.recordStatementCacheLookup(true);
+    bool ok = !monitor.isEnabled() && monitor.getStats().totalQueriesExecuted == 1 &&
+              monitor.getStats().totalConnectionsCreated == 0 && monitor.getStats().statementCacheHits == 0 &&
+              monitor.getLatencySnapshot(LatencyMetric::QUERY_EXECUTION).getCount() == 1;
+
+    monitor.setEnabled(true);
+    monitor.recordQueryExecuted(100, true);
+    return ok && monitor.getStats().totalQueriesExecuted == 2;
+}
+
+bool testPoolConfigSwitch() {
+    printTestHeader("测试连接池的统计开关");
+
+    ConnectionPool pool("no-stats");
+    try {
+        PoolConfig config;
+        config.setConnectionLimits(1, 2, 1);
+        config.enablePerformanceStats = false;
+        pool.initWithSingleDatabase(config, TEST_HOST, TEST_USER, TEST_PASSWORD, TEST_DATABASE, TEST_PORT);
+        for (int i = 0; i < 5; i++) {
+            pool.acquire()->executeQuery("SELECT 1");
+        }
+        PerformanceStats disabled = pool.getPerformanceMonitor().getStats();
+
+        // 运行时重新开启
+        config.enablePerformanceStats = true;
+        pool.adjustConfiguration(config);
+        for (int i = 0; i < 5; i++) {
+            pool.acquire()->executeQuery("SELECT 1");
+        }
+        PerformanceStats enabled = pool.getPerformanceMonitor().getStats();
+        std::cout << "关闭时获取: " << disabled.totalConnectionsAcquired
+                  << ", 开启后获取: " << enabled.totalConnectionsAcquired
+                  << ", 查询: " << enabled.totalQueriesExecuted << std::endl;
+
+        return disabled.totalConnectionsAcquired == 0 && disabled.totalQueriesExecuted == 0 &&
+               disabled.totalConnectionsCreated == 0 &&
+               enabled.totalConnectionsAcquired == 5 && enabled.totalQueriesExecuted == 5;
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+int main() {
+    Logger::getInstance().init("", LogLevel::WARNING, true);
+
+    std::vector<std::pair<std::string, bool>> results;
+    results.emplace_back("多线程计数", testConcurrentCounters());
+    results.emplace_back("关闭统计", testDisabled());
+    results.emplace_back("连接池的统计开关", testPoolConfigSwitch());
+
+    size_t passed = 0;
+    std::cout << "\n" << std::string(60, '*') << std::endl;
+    for (const auto& result : results) {
+        std::cout << (result.second ? "成功" : "失败") << " " << result.first << std::endl;
+        if (result.second) passed++;
+    }
+    std::cout << "\n通过: " << passed << "/" << results.size() << " 项测试" << std::endl;
+
+    return (passed == results.size()) ? 0 : 1;
+}
@@ -0,0 +1,168 @@
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <stdexcept>
+#include "connection_pool.h"
+#include "pool_config.h"
+#include "logger.h"
+
+/**
+ * @brief 连接池并行预热测试
+ *
+ * 重点验证：
+ * 1. 初始连接全部建好，启动报告与实际连接数一致
+ * 2. 初始连接按权重分布到各个数据库实例，不可达的实例不影响启动
+ * 3. 每个实例达到 minReadyPerBackend 后立即返回，其余连接在后台继续创建
+ * 4. 预热超时且没有任何连接时，init 抛出异常
+ */
+
+// 测试数据库连接参数
+const std::string TEST_HOST = "127.0.0.1";
+const std::string TEST_USER = "mxk";
+const std::string TEST_PASSWORD = "d2v8s2q3";
+const std::string TEST_DATABASE = "testdb";
+const unsigned int TEST_PORT = 3306;
+// 没有 MySQL 监听的端口，连接会立即被拒绝
+const unsigned int UNREACHABLE_PORT = 1;
+
+void printTestHeader(const std::string& title) {
+    std::cout << "\n" << std::string(60, '=') << std::endl;
+    std::cout << "  " << title << std::endl;
+    std::cout << std::string(60, '=') << std::endl;
+}
+
+bool testFullWarmup() {
+    printTestHeader("测试全部初始连接预热");
+
+    auto& pool = ConnectionPool::getInstance();
+    try {
+        PoolConfig config;
+        config.setConnectionLimits(2, 10, 6);
+        config.warmupConcurrency = 3;
+        StartupReport report = pool.initWithSingleDatabase(config, TEST_HOST, TEST_USER, TEST_PASSWORD, TEST_DATABASE, TEST_PORT);
+        std::cout << report.toString() << std::endl;
+
+        bool ok = report.ready && !report.timedOut &&
+                  report.created == 6 && report.backgroundConnections == 0 &&
+                  report.backends.size() == 1 && report.backends[0].requested == 6 &&
+                  pool.getTotalCount() == 6 && pool.getIdleCount() == 6;
+        pool.shutdown();
+        return ok;
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        pool.shutdown();
+        return false;
+    }
+}
+
+bool testSpreadOverBackends() {
+    printTestHeader("测试按权重分布到多个实例");
+
+    auto& pool = ConnectionPool::getInstance();
+    try {
+        PoolConfig config;
+        config.setConnectionLimits(2, 20, 10);
+        config.warmupConcurrency = 4;
+        std::vector<DBConfig> databases = {
+            DBConfig(TEST_HOST, TEST_USER, TEST_PASSWORD, TEST_DATABASE, TEST_PORT, 3),
+            DBConfig("localhost", TEST_USER, TEST_PASSWORD, TEST_DATABASE, TEST_PORT, 1),
+            DBConfig(TEST_HOST, TEST_USER, TEST_PASSWORD, TEST_DATABASE, UNREACHABLE_PORT, 1)
+        };
+        StartupReport report = pool.initWithMultipleDatabases(config, databases);
+        std::cout << report.toString() << std::endl;
+
+        if (report.backends.size() != 3) {
+            return false;
+        }
+        unsigned int planned = 0;
+        for (const auto& backend : report.backends) {
+            planned += backend.requested;
+        }
+        // 权重3的实例分到最多的连接，不可达的实例全部失败，但启动依然成功
+        bool ok = planned == 10 &&
+                  report.backends[0].requested > report.backends[1].requested &&
+                  report.backends[2].created == 0 && report.backends[2].failed > 0 &&
+                  !report.ready &&
+                  report.created == report.backends[0].requested + report.backends[1].requested &&
+                  pool.getTotalCount() == report.created;
+        pool.shutdown();
+        return ok;
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        pool.shutdown();
+        return false;
+    }
+}
+
+bool testReadyPerBackend() {
+    printTestHeader("测试达到就绪数量后提前返回");
+
+    auto& pool = ConnectionPool::getInstance();
+    try {
+        PoolConfig config;
+        config.setConnectionLimits(2, 20, 12);
+        config.warmupConcurrency = 1;
+        config.minReadyPerBackend = 2;
+        StartupReport report = pool.initWithSingleDatabase(config, TEST_HOST, TEST_USER, TEST_PASSWORD, TEST_DATABASE, TEST_PORT);
+        std::cout << report.toString() << std::endl;
+
+        if (!report.ready || report.created < 2 || report.created + report.backgroundConnections != 12) {
+            pool.shutdown();
+            return false;
+        }
+
+        // 剩余的连接在后台继续创建
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (pool.getIdleCount() < 12 && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+        std::cout << "后台预热完成后空闲连接数: " << pool.getIdleCount() << std::endl;
+        bool ok = pool.getIdleCount() == 12 && pool.getTotalCount() == 12;
+        pool.shutdown();
+        return ok;
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        pool.shutdown();
+        return false;
+    }
+}
+
+bool testNoBackendReachable() {
+    printTestHeader("测试没有可用实例时启动失败");
+
+    auto& pool = ConnectionPool::getInstance();
+    try {
+        PoolConfig config;
+        config.setConnectionLimits(2, 10, 4);
+        config.warmupTimeout = 500;
+        pool.initWithSingleDatabase(config, TEST_HOST, TEST_USER, TEST_PASSWORD, TEST_DATABASE, UNREACHABLE_PORT);
+        std::cout << "应该抛出异常" << std::endl;
+        pool.shutdown();
+        return false;
+    } catch (const std::exception& e) {
+        std::cout << "捕获到预期异常: " << e.what() << std::endl;
+    }
+    std::cout << "失败后总连接数: " << pool.getTotalCount() << std::endl;
+    return !pool.isInitialized() && pool.getTotalCount() == 0;
+}
+
+int main() {
+    Logger::getInstance().init("", LogLevel::WARNING, true);
+
+    std::vector<std::pair<std::string, bool>> results;
+    results.emplace_back("全部初始连接预热", testFullWarmup());
+    results.emplace_back("按权重分布到多个实例", testSpreadOverBackends());
+    results.emplace_back("达到就绪数量后提前返回", testReadyPerBackend());
+    results.emplace_back("没有可用实例时启动失败", testNoBackendReachable());
+
+    size_t passed = 0;
+    std::cout << "\n" << std::string(60, '*') << std::endl;
+    for (const auto& result : results) {
+        std::cout << (result.second ? "成功" : "失败") << " " << result.first << std::endl;
+        if (result.second) passed++;
+    }
+    std::cout << "\n通过: " << passed << "/" << results.size() << " 项测试" << std::endl;
+
+    return (passed == results.size()) ? 0 : 1;
+}
@@ -0,0 +1,175 @@
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <atomic>
+#include <stdexcept>
+#include "connection_pool.h"
+#include "pool_config.h"
+#include "logger.h"
+
+/**
+ * @brief PooledConnection RAII句柄测试
+ * 
+ * 重点验证：
+ * 1. 句柄析构时自动归还连接
+ * 2. 句柄只能移动，移动后由新句柄负责归还
+ * 3. 异常路径上也不会泄漏连接
+ * 4. 多线程下活跃连接数不会超过上限，且最终全部归还
+ */
+
+// 测试数据库连接参数
+const std::string TEST_HOST = "127.0.0.1";
+const std::string TEST_USER = "mxk";
+const std::string TEST_PASSWORD = "d2v8s2q3";
+const std::string TEST_DATABASE = "testdb";
+const unsigned int TEST_PORT = 3306;
+
+void printTestHeader(const std::string& title) {
+    std::cout << "\n" << std::string(60, '=') << std::endl;
+    std::cout << "  " << title << std::endl;
+    std::cout << std::string(60, '=') << std::endl;
+}
+
+bool testScopeRelease() {
+    printTestHeader("测试作用域结束自动归还");
+
+    try {
+        auto& pool = ConnectionPool::getInstance();
+        size_t activeBefore = pool.getActiveCount();
+        {
+            PooledConnection conn = pool.acquire(3000);
+            auto result = conn->executeQuery("SELECT 1 AS value");
+            if (!result->next() || result->getInt("value") != 1) {
+                std::cout << "查询结果不正确" << std::endl;
+                return false;
+            }
+            std::cout << "借出后活跃连接数: " << pool.getActiveCount() << std::endl;
+            if (pool.getActiveCount() != activeBefore + 1) {
+                return false;
+            }
+        }
+        std::cout << "作用域结束后活跃连接数: " << pool.getActiveCount() << std::endl;
+        return pool.getActiveCount() == activeBefore;
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool testMoveSemantics() {
+    printTestHeader("测试句柄移动语义");
+
+    try {
+        auto& pool = ConnectionPool::getInstance();
+        size_t activeBefore = pool.getActiveCount();
+
+        PooledConnection first = pool.acquire(3000);
+        Connection* raw = first.get();
+        PooledConnection second = std::move(first);
+        if (first || second.get() != raw) {
+            std::cout << "移动后句柄状态不正确" << std::endl;
+            return false;
+        }
+        if (pool.getActiveCount() != activeBefore + 1) {
+            std::cout << "移动不应该归还连接" << std::endl;
+            return false;
+        }
+
+        // reset() 立即归还
+        second.reset();
+        std::cout << "reset后活跃连接数: " << pool.getActiveCount() << std::endl;
+        return pool.getActiveCount() == activeBefore;
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool testExceptionSafety() {
+    printTestHeader("测试异常路径不泄漏连接");
+
+    auto& pool = ConnectionPool::getInstance();
+    size_t activeBefore = pool.getActiveCount();
+    try {
+        PooledConnection conn = pool.acquire(3000);
+        conn->executeQuery("SELECT * FROM table_that_does_not_exist");
+        std::cout << "应该抛出异常" << std::endl;
+        return false;
+    } catch (const std::exception& e) {
+        std::cout << "捕获到预期异常: " << e.what() << std::endl;
+    }
+    std::cout << "异常后活跃连接数: " << pool.getActiveCount() << std::endl;
+    return pool.getActiveCount() == activeBefore;
+}
+
+bool testConcurrentHandles() {
+    printTestHeader("测试多线程并发借还");
+
+    auto& pool = ConnectionPool::getInstance();
+    const int threadCount = 16;
+    const int iterations = 50;
+    std::atomic<int> success{0};
+    std::atomic<size_t> maxActive{0};
+    size_t maxConnections = pool.getConfig().maxConnections;
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; t++) {
+        threads.emplace_back([&]() {
+            for (int i = 0; i < iterations; i++) {
+                try {
+                    PooledConnection conn = pool.acquire(5000);
+                    size_t active = pool.getActiveCount();
+                    size_t seen = maxActive.load();
+                    while (active > seen && !maxActive.compare_exchange_weak(seen, active)) {
+                    }
+                    conn->executeQuery("SELECT 1");
+                    success++;
+                } catch (const std::exception& e) {
+                    std::cout << "线程内异常: " << e.what() << std::endl;
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    std::cout << "成功次数: " << success.load() << "/" << threadCount * iterations << std::endl;
+    std::cout << "最大活跃连接数: " << maxActive.load() << " (上限 " << maxConnections << ")" << std::endl;
+    std::cout << "结束后活跃连接数: " << pool.getActiveCount() << std::endl;
+    return success.load() == threadCount * iterations &&
+           maxActive.load() <= maxConnections &&
+           pool.getActiveCount() == 0;
+}
+
+int main() {
+    Logger::getInstance().init("", LogLevel::WARNING, true);
+
+    try {
+        PoolConfig config;
+        config.setConnectionLimits(2, 8, 4);
+        ConnectionPool::getInstance().initWithSingleDatabase(config, TEST_HOST, TEST_USER, TEST_PASSWORD, TEST_DATABASE, TEST_PORT);
+    } catch (const std::exception& e) {
+        std::cerr << "无法初始化连接池: " << e.what() << std::endl;
+        return 1;
+    }
+
+    std::vector<std::pair<std::string, bool>> results;
+    results.emplace_back("作用域自动归还", testScopeRelease());
+    results.emplace_back("句柄移动语义", testMoveSemantics());
+    results.emplace_back("异常安全", testExceptionSafety());
+    results.emplace_back("多线程并发借还", testConcurrentHandles());
+
+    size_t passed = 0;
+    std::cout << "\n" << std::string(60, '*') << std::endl;
+    for (const auto& result : results) {
+        std::cout << (result.second ? "成功" : "失败") << " " << result.first << std::endl;
+        if (result.second) passed++;
+    }
+    std::cout << "\n通过: " << passed << "/" << results.size() << " 项测试" << std::endl;
+
+    ConnectionPool::getInstance().shutdown();
+    return (passed == results.size()) ? 0 : 1;
+}
@@ -0,0 +1,246 @@
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include "connection_pool.h"
+#include "pool_config.h"
+#include "performance_monitor.h"
+#include "logger.h"
+
+/**
+ * @brief 预处理语句与语句缓存测试
+ *
+ * 重点验证：
+ * 1. 参数绑定（整数、浮点、字符串、NULL）与结果读取
+ * 2. 同一条SQL在同一个连接上只预处理一次，命中次数计入PerformanceMonitor
+ * 3. 超过缓存容量时淘汰最久未使用的语句
+ * 4. 超过初始缓冲区的长字符串能完整读取
+ * 5. 重连后缓存的语句被关闭，重新获取后可以继续使用
+ */
+
+// 测试数据库连接参数
+const std::string TEST_HOST = "127.0.0.1";
+const std::string TEST_USER = "mxk";
+const std::string TEST_PASSWORD = "d2v8s2q3";
+const std::string TEST_DATABASE = "testdb";
+const unsigned int TEST_PORT = 3306;
+
+void printTestHeader(const std::string& title) {
+    std::cout << "\n" << std::string(60, '=') << std::endl;
+    std::cout << "  " << title << std::endl;
+    std::cout << std::string(60, '=') << std::endl;
+}
+
+bool prepareTable() {
+    try {
+        PooledConnection conn = ConnectionPool::getInstance().acquire(3000);
+        conn->executeUpdate("DROP TABLE IF EXISTS test_prepared");
+        conn->executeUpdate(
+            "CREATE TABLE test_prepared ("
+            "  id INT AUTO_INCREMENT PRIMARY KEY,"
+            "  name VARCHAR(64),"
+            "  score DOUBLE,"
+            "  note TEXT"
+            ")");
+        return true;
+    } catch (const std::exception& e) {
+        std::cout << "建表失败: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool testBindAndFetch() {
+    printTestHeader("测试参数绑定与结果读取");
+
+    try {
+        PooledConnection conn = ConnectionPool::getInstance().acquire(3000);
+        auto insert = conn->prepareStatement("INSERT INTO test_prepared (name, score, note) VALUES (?, ?, ?)");
+        if (insert->getParamCount() != 3) {
+            std::cout << "参数数量不正确: " << insert->getParamCount() << std::endl;
+            return false;
+        }
+        // 含有引号的输入不需要转义
+        insert->setString(0, "O'Brien");
+        insert->setDouble(1, 95.5);
+        insert->setNull(2);
+        if (insert->executeUpdate() != 1 || insert->getLastInsertId() == 0) {
+            return false;
+        }
+        unsigned long long id = insert->getLastInsertId();
+
+        auto select = conn->prepareStatement("SELECT id, name, score, note FROM test_prepared WHERE id = ?");
+        select->setLong(0, static_cast<long long>(id));
+        auto result = select->executeQuery();
+        if (!result->next()) {
+            std::cout << "没有读取到刚插入的行" << std::endl;
+            return false;
+        }
+        std::cout << "id=" << result->getLong("id") << " name=" << result->getString("name")
+                  << " score=" << result->getDouble("score") << std::endl;
+        return result->getLong("id") == static_cast<long long>(id) &&
+               result->getString("name") == "O'Brien" &&
+               result->getDouble("score") == 95.5 &&
+               result->isNull("note") &&
+               !result->next();
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool testCacheHit() {
+    printTestHeader("测试语句缓存命中");
+
+    try {
+        PooledConnection conn = ConnectionPool::getInstance().acquire(3000);
+        const std::string sql = "SELECT COUNT(*) AS total FROM test_prepared WHERE score > ?";
+
+        auto first = conn->prepareStatement(sql);
+        PerformanceStats before = PerformanceMonitor::getInstance().getStats();
+        for (int i = 0; i < 10; i++) {
+            auto stmt = conn->prepareStatement(sql);
+            if (stmt != first) {
+                std::cout << "同一连接上的同一条SQL应该复用同一个语句" << std::endl;
+                return false;
+            }
+            stmt->setDouble(0, 0.0);
+            auto result = stmt->executeQuery();
+            if (!result->next() || result->getLong("total") < 1) {
+                return false;
+            }
+        }
+        PerformanceStats after = PerformanceMonitor::getInstance().getStats();
+        std::cout << "缓存命中增加: " << after.statementCacheHits - before.statementCacheHits << std::endl;
+        std::cout << "缓存未命中增加: " << after.statementCacheMisses - before.statementCacheMisses << std::endl;
+        return after.statementCacheHits - before.statementCacheHits == 10 &&
+               after.statementCacheMisses == before.statementCacheMisses;
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool testEviction() {
+    printTestHeader("测试超出容量时淘汰最久未使用的语句");
+
+    try {
+        PooledConnection conn = ConnectionPool::getInstance().acquire(3000);
+        conn->setStatementCacheSize(2);
+        auto a = conn->prepareStatement("SELECT 1");
+        auto b = conn->prepareStatement("SELECT 2");
+        // 访问a，使b成为最久未使用的语句
+        conn->prepareStatement("SELECT 1");
+        auto c = conn->prepareStatement("SELECT 3");
+
+        std::cout << "缓存语句数量: " << conn->getCachedStatementCount() << std::endl;
+        bool ok = conn->getCachedStatementCount() == 2 && a->isOpen() && !b->isOpen() && c->isOpen();
+
+        // 被淘汰的语句不能再执行
+        try {
+            b->executeQuery();
+            ok = false;
+        } catch (const std::exception& e) {
+            std::cout << "捕获到预期异常: " << e.what() << std::endl;
+        }
+        conn->setStatementCacheSize(ConnectionPool::getInstance().getConfig().statementCacheSize);
+        return ok;
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool testLongValue() {
+    printTestHeader("测试读取长字符串");
+
+    try {
+        PooledConnection conn = ConnectionPool::getInstance().acquire(3000);
+        std::string note(100000, 'x');
+        note += "end";
+        auto insert = conn->prepareStatement("INSERT INTO test_prepared (name, score, note) VALUES (?, ?, ?)");
+        insert->setString(0, "long");
+        insert->setInt(1, 1);
+        insert->setString(2, note);
+        insert->executeUpdate();
+
+        auto select = conn->prepareStatement("SELECT note FROM test_prepared WHERE name = ?");
+        select->setString(0, "long");
+        auto result = select->executeQuery();
+        if (!result->next()) {
+            return false;
+        }
+        std::string value = result->getString(0);
+        std::cout << "读取长度: " << value.size() << " (期望 " << note.size() << ")" << std::endl;
+        return value == note;
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool testReconnectInvalidates() {
+    printTestHeader("测试重连后缓存失效");
+
+    try {
+        PooledConnection conn = ConnectionPool::getInstance().acquire(3000);
+        auto stmt = conn->prepareStatement("SELECT 1 AS value");
+        if (!conn->reconnect()) {
+            std::cout << "重连失败" << std::endl;
+            return false;
+        }
+        if (stmt->isOpen() || conn->getCachedStatementCount() != 0) {
+            std::cout << "重连后旧语句应该被关闭" << std::endl;
+            return false;
+        }
+        auto again = conn->prepareStatement("SELECT 1 AS value");
+        auto result = again->executeQuery();
+        return result->next() && result->getInt("value") == 1;
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+int main() {
+    Logger::getInstance().init("", LogLevel::WARNING, true);
+
+    try {
+        PoolConfig config;
+        config.setConnectionLimits(2, 4, 2);
+        ConnectionPool::getInstance().initWithSingleDatabase(config, TEST_HOST, TEST_USER, TEST_PASSWORD, TEST_DATABASE, TEST_PORT);
+    } catch (const std::exception& e) {
+        std::cerr << "无法初始化连接池: " << e.what() << std::endl;
+        return 1;
+    }
+
+    if (!prepareTable()) {
+        ConnectionPool::getInstance().shutdown();
+        return 1;
+    }
+
+    std::vector<std::pair<std::string, bool>> results;
+    results.emplace_back("参数绑定与结果读取", testBindAndFetch());
+    results.emplace_back("语句缓存命中", testCacheHit());
+    results.emplace_back("LRU淘汰", testEviction());
+    results.emplace_back("读取长字符串", testLongValue());
+    results.emplace_back("重连后缓存失效", testReconnectInvalidates());
+
+    try {
+        PooledConnection conn = ConnectionPool::getInstance().acquire(3000);
+        conn->executeUpdate("DROP TABLE IF EXISTS test_prepared");
+    } catch (const std::exception& e) {
+        std::cout << "清理测试表失败: " << e.what() << std::endl;
+    }
+
+    size_t passed = 0;
+    std::cout << "\n" << std::string(60, '*') << std::endl;
+    for (const auto& result : results) {
+        std::cout << (result.second ? "成功" : "失败") << " " << result.first << std::endl;
+        if (result.second) passed++;
+    }
+    std::cout << "\n通过: " << passed << "/" << results.size() << " 项测试" << std::endl;
+
+    ConnectionPool::getInstance().shutdown();
+    return (passed == results.size()) ? 0 : 1;
+}
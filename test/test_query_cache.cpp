@@ -0,0 +1,243 @@
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <stdexcept>
+#include "connection_pool.h"
+#include "query_cache.h"
+#include "pool_config.h"
+#include "logger.h"
+
+/**
+ * @brief 查询结果缓存测试
+ *
+ * 重点验证：
+ * 1. 空白不同的同一条SQL命中同一个缓存项，引号内的空白和参数区分缓存项
+ * 2. 命中时不借出连接，每个调用者有自己的游标
+ * 3. 超过有效期后重新查询
+ * 4. 按表名失效后读到新数据，失效期间执行的查询结果不进入缓存
+ * 5. 超过内存上限时淘汰最久未使用的结果
+ * 6. 未开启缓存时直接执行，不计入未命中次数
+ */
+
+// 测试数据库连接参数
+const std::string TEST_HOST = "127.0.0.1";
+const std::string TEST_USER = "mxk";
+const std::string TEST_PASSWORD = "d2v8s2q3";
+const std::string TEST_DATABASE = "testdb";
+const unsigned int TEST_PORT = 3306;
+
+void printTestHeader(const std::string& title) {
+    std::cout << "\n" << std::string(60, '=') << std::endl;
+    std::cout << "  " << title << std::endl;
+    std::cout << std::string(60, '=') << std::endl;
+}
+
+// 一列一行的内存结果集
+ResultRowsPtr makeRows(const std::string& value) {
+    auto rows = std::make_shared<ResultRows>();
+    rows->fieldNames.push_back("value");
+    rows->appendValue(value.data(), static_cast<unsigned long>(value.size()));
+    rows->rowCount = 1;
+    return rows;
+}
+
+bool testKeys() {
+    printTestHeader("测试缓存键");
+
+    std::string a = QueryCache::makeKey("SELECT  *\n FROM config WHERE name = 'a  b';", {});
+    std::string b = QueryCache::makeKey(" SELECT * FROM config\tWHERE name = 'a  b'", {});
+    std::string c = QueryCache::makeKey("SELECT * FROM config WHERE name = 'a b'", {});
+    std::string p1 = QueryCache::makeKey("SELECT * FROM config WHERE id = ?", {"1"});
+    std::string p2 = QueryCache::makeKey("SELECT * FROM config WHERE id = ?", {"2"});
+    std::string split = QueryCache::makeKey("SELECT ?, ?", {"a", "b"});
+    std::string joined = QueryCache::makeKey("SELECT ?, ?", {std::string("a\0" "1:b", 5)});
+
+    std::cout << "规范化结果: " << QueryCache::normalize(" SELECT  1 ;\n") << std::endl;
+    return a == b && a != c && p1 != p2 && split != joined && QueryCache::normalize(" SELECT  1 ;\n") == "SELECT 1";
+}
+
+bool testHitWithoutAcquire(ConnectionPool& pool) {
+    printTestHeader("测试命中时不借出连接");
+
+    try {
+        pool.clearQueryCache();
+        const std::string sql = "SELECT 1 AS id, 'feature' AS name UNION ALL SELECT 2, 'config'";
+        QueryResultPtr first = pool.executeCachedQuery(sql, {"features"});
+        uint64_t acquiredBefore = pool.getPerformanceMonitor().getStats().totalConnectionsAcquired;
+        uint64_t hitsBefore = pool.getPerformanceMonitor().getStats().queryCacheHits;
+
+        auto start = std::chrono::steady_clock::now();
+        const int rounds = 10000;
+        bool ok = true;
+        for (int i = 0; i < rounds; i++) {
+            QueryResultPtr result = pool.executeCachedQuery("SELECT 1 AS id, 'feature' AS name UNION ALL  SELECT 2, 'config'",
+                                                            {"features"});
+            ok = ok && result->getRowCount() == 2;
+        }
+        int64_t avgNanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count() / rounds;
+
+        // 两个结果共享同一份数据，但游标互不影响
+        QueryResultPtr second = pool.executeCachedQuery(sql, {"features"});
+        int firstRows = 0;
+        while (first->next()) {
+            firstRows++;
+            ok = ok && second->next() && second->getString("name") == first->getString("name");
+        }
+        PerformanceStats stats = pool.getPerformanceMonitor().getStats();
+        std::cout << "平均命中耗时: " << avgNanos << "ns, 期间借出连接: " << stats.totalConnectionsAcquired - acquiredBefore
+                  << ", 命中: " << stats.queryCacheHits - hitsBefore << ", 命中率: " << stats.queryCacheHitRate() << "%" << std::endl;
+        return ok && firstRows == 2 && stats.totalConnectionsAcquired == acquiredBefore &&
+               stats.queryCacheHits - hitsBefore == rounds + 1;
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool testTtl(ConnectionPool& pool) {
+    printTestHeader("测试有效期");
+
+    try {
+        pool.clearQueryCache();
+        const std::string sql = "SELECT CONNECTION_ID() AS id, RAND() AS value";
+        QueryResultPtr first = pool.executeCachedQuery(sql, {}, 100);
+        QueryResultPtr cached = pool.executeCachedQuery(sql, {}, 100);
+        std::this_thread::sleep_for(std::chrono::milliseconds(150));
+        QueryResultPtr expired = pool.executeCachedQuery(sql, {}, 100);
+
+        bool same = first->next() && cached->next() && first->getString("value") == cached->getString("value");
+        bool refreshed = expired->next() && expired->getString("value") != first->getString("value");
+        QueryCache::Stats stats = pool.getQueryCacheStats();
+        std::cout << "有效期内相同: " << (same ? "是" : "否") << ", 过期后重新查询: " << (refreshed ? "是" : "否")
+                  << ", 过期次数: " << stats.expirations << std::endl;
+        return same && refreshed && stats.expirations == 1;
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool testTagInvalidation(ConnectionPool& pool) {
+    printTestHeader("测试按表名失效");
+
+    try {
+        {
+            PooledConnection conn = pool.acquire();
+            conn->executeUpdate("CREATE TABLE IF NOT EXISTS query_cache_test (id INT PRIMARY KEY, value INT)");
+            conn->executeUpdate("DELETE FROM query_cache_test");
+            conn->executeUpdate("INSERT INTO query_cache_test VALUES (1, 10)");
+        }
+        const std::string sql = "SELECT value FROM query_cache_test WHERE id = ?";
+        QueryResultPtr before = pool.executeCachedStatement(sql, {"1"}, {"query_cache_test"}, 60000);
+        {
+            PooledConnection conn = pool.acquire();
+            conn->executeUpdate("UPDATE query_cache_test SET value = 20 WHERE id = 1");
+        }
+        QueryResultPtr stale = pool.executeCachedStatement(sql, {"1"}, {"query_cache_test"}, 60000);
+        size_t dropped = pool.invalidateQueryCache("query_cache_test");
+        QueryResultPtr after = pool.executeCachedStatement(sql, {"1"}, {"query_cache_test"}, 60000);
+
+        int beforeValue = before->next() ? before->getInt("value") : -1;
+        int staleValue = stale->next() ? stale->getInt("value") : -1;
+        int afterValue = after->next() ? after->getInt("value") : -1;
+
+        // 查询开始后发生失效，结果不进入缓存
+        QueryCache cache;
+        cache.configure(1 << 20, 60LL * 1000 * 1000 * 1000);
+        uint64_t epoch = cache.getEpoch();
+        cache.invalidate("query_cache_test");
+        bool raceDropped = !cache.put("key", makeRows("old"), {"query_cache_test"}, 0, epoch) && !cache.get("key");
+
+        std::cout << "失效前: " << beforeValue << ", 失效前（缓存）: " << staleValue << ", 失效后: " << afterValue
+                  << ", 丢弃: " << dropped << ", 失效期间的结果被丢弃: " << (raceDropped ? "是" : "否") << std::endl;
+        return beforeValue == 10 && staleValue == 10 && afterValue == 20 && dropped == 1 && raceDropped;
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool testLruEviction() {
+    printTestHeader("测试超过内存上限时淘汰");
+
+    QueryCache cache;
+    cache.configure(QueryCache::SHARD_COUNT * 4096, 60LL * 1000 * 1000 * 1000);
+    const std::string hot = "SELECT hot";
+    cache.put(hot, makeRows(std::string(256, 'h')), {}, 0, cache.getEpoch());
+    for (int i = 0; i < 2000; i++) {
+        cache.put("SELECT " + std::to_string(i), makeRows(std::string(256, 'x')), {}, 0, cache.getEpoch());
+        cache.get(hot);
+    }
+    // 超过一个分片上限的结果不缓存
+    bool tooLarge = !cache.put("SELECT large", makeRows(std::string(8192, 'l')), {}, 0, cache.getEpoch());
+
+    QueryCache::Stats stats = cache.getStats();
+    bool hotKept = cache.get(hot) != nullptr;
+    bool coldEvicted = cache.get("SELECT 0") == nullptr;
+    std::cout << "缓存项: " << stats.entries << ", 占用: " << stats.bytes << " 字节, 淘汰: " << stats.evictions
+              << ", 常用项保留: " << (hotKept ? "是" : "否") << std::endl;
+    return stats.bytes <= QueryCache::SHARD_COUNT * 4096 && stats.evictions > 0 && hotKept && coldEvicted && tooLarge;
+}
+
+bool testDisabled() {
+    printTestHeader("测试未开启缓存");
+
+    ConnectionPool pool("query-cache-off");
+    bool ok = false;
+    try {
+        PoolConfig config;
+        config.setConnectionLimits(1, 2, 1);
+        pool.initWithSingleDatabase(config, TEST_HOST, TEST_USER, TEST_PASSWORD, TEST_DATABASE, TEST_PORT);
+        PerformanceStats before = pool.getPerformanceMonitor().getStats();
+        for (int i = 0; i < 3; i++) {
+            ok = pool.executeCachedQuery("SELECT 1 AS id")->getRowCount() == 1;
+        }
+        PerformanceStats after = pool.getPerformanceMonitor().getStats();
+        std::cout << "借出连接: " << after.totalConnectionsAcquired - before.totalConnectionsAcquired
+                  << ", 未命中: " << after.queryCacheMisses - before.queryCacheMisses << std::endl;
+        // 每次都到数据库执行，命中率里不出现这些查询
+        ok = ok && after.totalConnectionsAcquired - before.totalConnectionsAcquired == 3 &&
+             after.queryCacheMisses == before.queryCacheMisses && after.queryCacheHits == before.queryCacheHits;
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        ok = false;
+    }
+    pool.shutdown();
+    return ok;
+}
+
+int main() {
+    Logger::getInstance().init("", LogLevel::WARNING, true);
+
+    std::vector<std::pair<std::string, bool>> results;
+    results.emplace_back("缓存键", testKeys());
+    results.emplace_back("超过内存上限时淘汰", testLruEviction());
+
+    ConnectionPool pool("query-cache");
+    try {
+        PoolConfig config;
+        config.setConnectionLimits(2, 4, 2);
+        config.queryCacheMaxBytes = 1 << 20;
+        pool.initWithSingleDatabase(config, TEST_HOST, TEST_USER, TEST_PASSWORD, TEST_DATABASE, TEST_PORT);
+        results.emplace_back("命中时不借出连接", testHitWithoutAcquire(pool));
+        results.emplace_back("有效期", testTtl(pool));
+        results.emplace_back("按表名失效", testTagInvalidation(pool));
+    } catch (const std::exception& e) {
+        std::cout << "连接池初始化失败: " << e.what() << std::endl;
+        results.emplace_back("连接池初始化", false);
+    }
+    pool.shutdown();
+    results.emplace_back("未开启缓存", testDisabled());
+
+    size_t passed = 0;
+    std::cout << "\n" << std::string(60, '*') << std::endl;
+    for (const auto& result : results) {
+        std::cout << (result.second ? "成功" : "失败") << " " << result.first << std::endl;
+        if (result.second) passed++;
+    }
+    std::cout << "\n通过: " << passed << "/" << results.size() << " 项测试" << std::endl;
+
+    return (passed == results.size()) ? 0 : 1;
+}
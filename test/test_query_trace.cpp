@@ -0,0 +1,283 @@
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <mutex>
+#include <stdexcept>
+#include "connection_pool.h"
+#include "query_trace.h"
+#include "pool_config.h"
+#include "logger.h"
+
+/**
+ * @brief 查询追踪与慢查询日志测试
+ *
+ * 重点验证：
+ * 1. 采样比例生效，关闭时不计时
+ * 2. span的JSON转义，sink的注册、移除和异常隔离
+ * 3. 查询、读取结果各阶段的耗时，以及实例和连接标识
+ * 4. 借出等待计入借出后的第一次查询
+ * 5. 只开慢查询日志时，只有超过阈值的查询生成span
+ * 6. 失败的查询带上错误码
+ */
+
+// 测试数据库连接参数
+const std::string TEST_HOST = "127.0.0.1";
+const std::string TEST_USER = "mxk";
+const std::string TEST_PASSWORD = "d2v8s2q3";
+const std::string TEST_DATABASE = "testdb";
+const unsigned int TEST_PORT = 3306;
+
+void printTestHeader(const std::string& title) {
+    std::cout << "\n" << std::string(60, '=') << std::endl;
+    std::cout << "  " << title << std::endl;
+    std::cout << std::string(60, '=') << std::endl;
+}
+
+// 收集span的sink
+class SpanCollector {
+public:
+    explicit SpanCollector(QueryTracer& tracer) : m_tracer(tracer) {
+        m_id = tracer.addSink([this](const QuerySpan& span) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_spans.push_back(span);
+        });
+    }
+
+    ~SpanCollector() {
+        m_tracer.removeSink(m_id);
+    }
+
+    std::vector<QuerySpan> take() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::vector<QuerySpan> spans;
+        spans.swap(m_spans);
+        return spans;
+    }
+
+private:
+    QueryTracer& m_tracer;
+    size_t m_id;
+    std::mutex m_mutex;
+    std::vector<QuerySpan> m_spans;
+};
+
+void printSpan(const QuerySpan& span) {
+    std::cout << span.toJson() << std::endl;
+}
+
+bool testSampling() {
+    printTestHeader("测试采样比例");
+
+    QueryTracer tracer("sampling");
+    bool sampled = true;
+    bool ok = !tracer.isActive() && !tracer.shouldTrace(sampled) && !sampled;
+
+    tracer.configure(0.25, 0);
+    const int draws = 100000;
+    int picked = 0;
+    for (int i = 0; i < draws; i++) {
+        if (tracer.shouldTrace(sampled)) {
+            picked++;
+        }
+    }
+    double rate = static_cast<double>(picked) / draws;
+    std::cout << "采样比例0.25，实际: " << rate << std::endl;
+    ok = ok && tracer.isActive() && rate > 0.23 && rate < 0.27;
+
+    tracer.configure(5, 0);
+    ok = ok && tracer.getSampleRate() == 1 && tracer.shouldTrace(sampled) && sampled;
+
+    // 只开慢查询日志时每个查询都计时，但不算采样
+    tracer.configure(0, 100);
+    ok = ok && tracer.isActive() && tracer.shouldTrace(sampled) && !sampled;
+    ok = ok && !tracer.shouldEmit(false, 99999) && tracer.shouldEmit(false, 100000) && tracer.shouldEmit(true, 1);
+
+    tracer.configure(0, 0);
+    return ok && !tracer.isActive();
+}
+
+bool testSinks() {
+    printTestHeader("测试sink与JSON");
+
+    QueryTracer tracer("sinks");
+    tracer.configure(1, 10);
+    size_t failing = tracer.addSink([](const QuerySpan&) {
+        throw std::runtime_error("sink failed");
+    });
+    SpanCollector collector(tracer);
+
+    QuerySpan span;
+    span.backend = "127.0.0.1:3306";
+    span.connectionId = "abc";
+    span.sql = "SELECT \"a\"\n FROM t WHERE x = '\\'";
+    span.durationMicros = 20000;
+    span.phaseMicros[static_cast<size_t>(TracePhase::QUERY)] = 15000;
+    span.success = true;
+    span.sampled = true;
+    tracer.emit(span);
+
+    std::vector<QuerySpan> spans = collector.take();
+    if (spans.size() != 1) {
+        return false;
+    }
+    std::string json = spans[0].toJson();
+    std::cout << json << std::endl;
+    bool ok = spans[0].pool == "sinks" && spans[0].slow && tracer.getSlowCount() == 1;
+    ok = ok && json.find("\"sql\":\"SELECT \\\"a\\\"\\n FROM t WHERE x = '\\\\'\"") != std::string::npos;
+    ok = ok && json.find("\"query\":15000") != std::string::npos && json.find("\"error\"") == std::string::npos;
+
+    ok = ok && tracer.removeSink(failing) && !tracer.removeSink(failing);
+    span.durationMicros = 5000;
+    tracer.emit(span);
+    spans = collector.take();
+    return ok && spans.size() == 1 && !spans[0].slow && tracer.getEmittedCount() == 2;
+}
+
+bool testPhases(ConnectionPool& pool) {
+    printTestHeader("测试查询各阶段耗时");
+
+    try {
+        pool.getQueryTracer().configure(1, 0);
+        SpanCollector collector(pool.getQueryTracer());
+        PooledConnection conn = pool.acquire();
+        conn->executeQuery("SELECT SLEEP(0.05), REPEAT('x', 1000)");
+        conn->executeUpdate("DO 1");
+
+        std::vector<QuerySpan> spans = collector.take();
+        if (spans.size() != 2) {
+            std::cout << "span数量: " << spans.size() << std::endl;
+            return false;
+        }
+        printSpan(spans[0]);
+        printSpan(spans[1]);
+        const QuerySpan& query = spans[0];
+        bool ok = query.success && query.sampled && query.isQuery && !spans[1].isQuery;
+        ok = ok && query.backend == TEST_HOST + ":" + std::to_string(TEST_PORT);
+        ok = ok && query.connectionId == conn->getConnectionId() && query.backendId == conn->getBackendId();
+        ok = ok && query.getPhase(TracePhase::QUERY) >= 40000 && query.durationMicros >= query.getPhase(TracePhase::QUERY);
+        // 借出等待只计入借出后的第一次查询
+        ok = ok && spans[1].getPhase(TracePhase::POOL_WAIT) == 0 && spans[1].getPhase(TracePhase::FETCH) == 0;
+        return ok;
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool testPoolWait(ConnectionPool& pool) {
+    printTestHeader("测试借出等待");
+
+    try {
+        pool.getQueryTracer().configure(1, 0);
+        SpanCollector collector(pool.getQueryTracer());
+        // 占住所有连接100毫秒
+        std::vector<PooledConnection> held;
+        for (unsigned int i = 0; i < pool.getConfig().maxConnections; i++) {
+            held.push_back(pool.acquire());
+        }
+        std::thread releaser([&held]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            held.clear();
+        });
+
+        {
+            PooledConnection conn = pool.acquire();
+            conn->executeQuery("SELECT 1");
+        }
+        releaser.join();
+
+        std::vector<QuerySpan> spans = collector.take();
+        if (spans.size() != 1) {
+            return false;
+        }
+        printSpan(spans[0]);
+        int64_t wait = spans[0].getPhase(TracePhase::POOL_WAIT);
+        std::cout << "借出等待: " << wait << " us" << std::endl;
+        return wait >= 50000 && spans[0].durationMicros >= wait;
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool testSlowQueryLog(ConnectionPool& pool) {
+    printTestHeader("测试慢查询日志");
+
+    try {
+        pool.getQueryTracer().configure(0, 30);
+        SpanCollector collector(pool.getQueryTracer());
+        PooledConnection conn = pool.acquire();
+        for (int i = 0; i < 10; i++) {
+            conn->executeQuery("SELECT 1");
+        }
+        conn->executeQuery("SELECT SLEEP(0.05)");
+
+        std::vector<QuerySpan> spans = collector.take();
+        if (spans.size() != 1) {
+            std::cout << "span数量: " << spans.size() << std::endl;
+            return false;
+        }
+        printSpan(spans[0]);
+        return spans[0].slow && !spans[0].sampled && spans[0].sql == "SELECT SLEEP(0.05)";
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool testFailedQuery(ConnectionPool& pool) {
+    printTestHeader("测试失败的查询");
+
+    pool.getQueryTracer().configure(1, 0);
+    SpanCollector collector(pool.getQueryTracer());
+    try {
+        PooledConnection conn = pool.acquire();
+        conn->executeQuery("SELECT * FROM table_that_does_not_exist");
+        return false;
+    } catch (const std::exception& e) {
+        std::cout << "预期的错误: " << e.what() << std::endl;
+    }
+
+    std::vector<QuerySpan> spans = collector.take();
+    if (spans.size() != 1) {
+        return false;
+    }
+    printSpan(spans[0]);
+    // ER_NO_SUCH_TABLE
+    return !spans[0].success && spans[0].errorCode == 1146 && !spans[0].error.empty();
+}
+
+int main() {
+    Logger::getInstance().init("", LogLevel::WARNING, true);
+
+    std::vector<std::pair<std::string, bool>> results;
+    results.emplace_back("采样比例", testSampling());
+    results.emplace_back("sink与JSON", testSinks());
+
+    ConnectionPool pool("query-trace");
+    try {
+        PoolConfig config;
+        config.setConnectionLimits(2, 2, 2);
+        config.traceSampleRate = 1;
+        pool.initWithSingleDatabase(config, TEST_HOST, TEST_USER, TEST_PASSWORD, TEST_DATABASE, TEST_PORT);
+        results.emplace_back("查询各阶段耗时", testPhases(pool));
+        results.emplace_back("借出等待", testPoolWait(pool));
+        results.emplace_back("慢查询日志", testSlowQueryLog(pool));
+        results.emplace_back("失败的查询", testFailedQuery(pool));
+    } catch (const std::exception& e) {
+        std::cout << "连接池初始化失败: " << e.what() << std::endl;
+        results.emplace_back("连接池初始化", false);
+    }
+    pool.shutdown();
+
+    size_t passed = 0;
+    std::cout << "\n" << std::string(60, '*') << std::endl;
+    for (const auto& result : results) {
+        std::cout << (result.second ? "成功" : "失败") << " " << result.first << std::endl;
+        if (result.second) passed++;
+    }
+    std::cout << "\n通过: " << passed << "/" << results.size() << " 项测试" << std::endl;
+
+    return (passed == results.size()) ? 0 : 1;
+}
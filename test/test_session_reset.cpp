@@ -0,0 +1,192 @@
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <stdexcept>
+#include "connection_pool.h"
+#include "pool_config.h"
+#include "logger.h"
+
+/**
+ * @brief 归还时会话清理测试
+ *
+ * 重点验证：
+ * 1. 未提交的事务在归还时回滚，下一个借用者看不到
+ * 2. RESET策略清除用户变量和临时表，连接不重新握手
+ * 3. 只执行预处理语句的连接不重置，语句缓存保留
+ * 4. 后台清理时，关闭连接池不会泄漏等待清理的连接
+ */
+
+// 测试数据库连接参数
+const std::string TEST_HOST = "127.0.0.1";
+const std::string TEST_USER = "mxk";
+const std::string TEST_PASSWORD = "d2v8s2q3";
+const std::string TEST_DATABASE = "testdb";
+const unsigned int TEST_PORT = 3306;
+
+void printTestHeader(const std::string& title) {
+    std::cout << "\n" << std::string(60, '=') << std::endl;
+    std::cout << "  " << title << std::endl;
+    std::cout << std::string(60, '=') << std::endl;
+}
+
+// 只有一个连接，两次借出拿到的是同一个会话
+PoolConfig singleConnectionConfig(SessionResetPolicy policy, bool async) {
+    PoolConfig config;
+    config.setConnectionLimits(1, 1, 1);
+    config.sessionResetPolicy = policy;
+    config.asyncSessionReset = async;
+    return config;
+}
+
+long long countRows(PooledConnection& conn) {
+    QueryResultPtr result = conn->executeQuery("SELECT COUNT(*) AS n FROM session_reset_test");
+    return result->next() ? result->getLong("n") : -1;
+}
+
+bool testRollbackOnRelease() {
+    printTestHeader("测试归还时回滚未提交的事务");
+
+    ConnectionPool pool("session-rollback");
+    try {
+        pool.initWithSingleDatabase(singleConnectionConfig(SessionResetPolicy::ROLLBACK, true),
+                                    TEST_HOST, TEST_USER, TEST_PASSWORD, TEST_DATABASE, TEST_PORT);
+        {
+            PooledConnection conn = pool.acquire();
+            conn->executeUpdate("CREATE TABLE IF NOT EXISTS session_reset_test (id INT PRIMARY KEY) ENGINE=InnoDB");
+            conn->executeUpdate("DELETE FROM session_reset_test");
+        }
+        bool leftOpen = false;
+        {
+            PooledConnection conn = pool.acquire();
+            conn->beginTransaction();
+            conn->executeUpdate("INSERT INTO session_reset_test VALUES (1)");
+            leftOpen = conn->isInTransaction();
+            // 忘记提交或回滚
+        }
+        PooledConnection conn = pool.acquire();
+        bool clean = !conn->isInTransaction();
+        long long rows = countRows(conn);
+        std::cout << "归还前在事务中: " << (leftOpen ? "是" : "否") << ", 再次借出在事务中: " << (clean ? "否" : "是")
+                  << ", 行数: " << rows << std::endl;
+        return leftOpen && clean && rows == 0;
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool testFullReset() {
+    printTestHeader("测试重置会话");
+
+    ConnectionPool pool("session-reset");
+    try {
+        pool.initWithSingleDatabase(singleConnectionConfig(SessionResetPolicy::RESET, false),
+                                    TEST_HOST, TEST_USER, TEST_PASSWORD, TEST_DATABASE, TEST_PORT);
+        long long before = 0;
+        {
+            PooledConnection conn = pool.acquire();
+            QueryResultPtr id = conn->executeQuery("SELECT CONNECTION_ID() AS id");
+            before = id->next() ? id->getLong("id") : -1;
+            conn->executeUpdate("SET @pool_test = 42");
+            conn->executeUpdate("CREATE TEMPORARY TABLE session_reset_tmp (id INT)");
+        }
+        PooledConnection conn = pool.acquire();
+        QueryResultPtr result = conn->executeQuery("SELECT CONNECTION_ID() AS id, @pool_test AS value");
+        bool next = result->next();
+        long long after = next ? result->getLong("id") : -2;
+        bool variableCleared = next && result->isNull("value");
+
+        bool tableDropped = false;
+        try {
+            conn->executeQuery("SELECT * FROM session_reset_tmp");
+        } catch (const std::exception&) {
+            tableDropped = true;
+        }
+        std::cout << "会话ID: " << before << " -> " << after << ", 变量已清除: " << (variableCleared ? "是" : "否")
+                  << ", 临时表已删除: " << (tableDropped ? "是" : "否") << std::endl;
+        return before == after && variableCleared && tableDropped;
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool testPreparedOnlyKeepsCache() {
+    printTestHeader("测试只用预处理语句时保留语句缓存");
+
+    ConnectionPool pool("session-prepared");
+    try {
+        pool.initWithSingleDatabase(singleConnectionConfig(SessionResetPolicy::RESET, false),
+                                    TEST_HOST, TEST_USER, TEST_PASSWORD, TEST_DATABASE, TEST_PORT);
+        {
+            // 建连后第一次借出执行过文本语句，归还时重置
+            PooledConnection conn = pool.acquire();
+            conn->executeQuery("SELECT 1");
+        }
+        {
+            PooledConnection conn = pool.acquire();
+            auto stmt = conn->prepareStatement("SELECT ? AS value");
+            stmt->setInt(0, 7);
+            stmt->executeQuery();
+        }
+        size_t kept = 0;
+        {
+            PooledConnection conn = pool.acquire();
+            kept = conn->getCachedStatementCount();
+            conn->executeQuery("SELECT 1");
+        }
+        PooledConnection conn = pool.acquire();
+        size_t afterReset = conn->getCachedStatementCount();
+        std::cout << "只用预处理语句后缓存: " << kept << ", 执行文本语句后缓存: " << afterReset << std::endl;
+        return kept == 1 && afterReset == 0;
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool testShutdownWithPendingResets() {
+    printTestHeader("测试关闭时有等待清理的连接");
+
+    try {
+        ConnectionPool pool("session-shutdown");
+        PoolConfig config;
+        config.setConnectionLimits(4, 4, 4);
+        config.sessionResetPolicy = SessionResetPolicy::RESET;
+        pool.initWithSingleDatabase(config, TEST_HOST, TEST_USER, TEST_PASSWORD, TEST_DATABASE, TEST_PORT);
+        {
+            std::vector<PooledConnection> borrowed;
+            for (int i = 0; i < 4; i++) {
+                borrowed.push_back(pool.acquire());
+                borrowed.back()->executeUpdate("SET @pool_test = " + std::to_string(i));
+            }
+        }
+        pool.shutdown();
+        std::cout << "关闭后连接数: " << pool.getTotalCount() << ", 借出数: " << pool.getActiveCount() << std::endl;
+        return pool.getTotalCount() == 0 && pool.getActiveCount() == 0;
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+int main() {
+    Logger::getInstance().init("", LogLevel::WARNING, true);
+
+    std::vector<std::pair<std::string, bool>> results;
+    results.emplace_back("归还时回滚未提交的事务", testRollbackOnRelease());
+    results.emplace_back("重置会话", testFullReset());
+    results.emplace_back("只用预处理语句时保留语句缓存", testPreparedOnlyKeepsCache());
+    results.emplace_back("关闭时有等待清理的连接", testShutdownWithPendingResets());
+
+    size_t passed = 0;
+    std::cout << "\n" << std::string(60, '*') << std::endl;
+    for (const auto& result : results) {
+        std::cout << (result.second ? "成功" : "失败") << " " << result.first << std::endl;
+        if (result.second) passed++;
+    }
+    std::cout << "\n通过: " << passed << "/" << results.size() << " 项测试" << std::endl;
+
+    return (passed == results.size()) ? 0 : 1;
+}
@@ -0,0 +1,203 @@
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include "connection_pool.h"
+#include "pool_config.h"
+#include "logger.h"
+
+/**
+ * @brief 流式（非缓冲）查询测试
+ *
+ * 重点验证：
+ * 1. 逐行读取百万行结果，getRowCount() 返回已读取行数，reset() 不支持
+ * 2. 流未读完时执行其他命令，剩余行被读掉，原结果集随后抛出异常，连接仍然可用
+ * 3. close() 提前结束后连接可以继续使用
+ * 4. 流未读完就归还连接，连接被关闭而不会回到空闲队列，连接池依然可用
+ */
+
+// 测试数据库连接参数
+const std::string TEST_HOST = "127.0.0.1";
+const std::string TEST_USER = "mxk";
+const std::string TEST_PASSWORD = "d2v8s2q3";
+const std::string TEST_DATABASE = "testdb";
+const unsigned int TEST_PORT = 3306;
+
+// 1000 x 1000 的笛卡尔积，一共一百万行
+const int TABLE_ROWS = 1000;
+const std::string BIG_QUERY = "SELECT a.id AS a_id, b.id AS b_id FROM test_stream a CROSS JOIN test_stream b";
+
+void printTestHeader(const std::string& title) {
+    std::cout << "\n" << std::string(60, '=') << std::endl;
+    std::cout << "  " << title << std::endl;
+    std::cout << std::string(60, '=') << std::endl;
+}
+
+bool prepareTable() {
+    try {
+        PooledConnection conn = ConnectionPool::getInstance().acquire(3000);
+        conn->executeUpdate("DROP TABLE IF EXISTS test_stream");
+        conn->executeUpdate("CREATE TABLE test_stream (id INT PRIMARY KEY)");
+        std::string sql = "INSERT INTO test_stream (id) VALUES ";
+        for (int i = 1; i <= TABLE_ROWS; i++) {
+            sql += (i == 1 ? "(" : ",(") + std::to_string(i) + ")";
+        }
+        conn->executeUpdate(sql);
+        return true;
+    } catch (const std::exception& e) {
+        std::cout << "建表失败: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool testReadAllRows() {
+    printTestHeader("测试逐行读取一百万行");
+
+    try {
+        PooledConnection conn = ConnectionPool::getInstance().acquire(3000);
+        auto result = conn->executeStreamingQuery(BIG_QUERY);
+        if (result->getMode() != ResultMode::STREAMING || result->getRowCount() != 0) {
+            return false;
+        }
+
+        long long sum = 0;
+        while (result->next()) {
+            sum += result->getLong("a_id");
+            if (result->getRowCount() == 10 && result->reset()) {
+                std::cout << "流式结果集不应该支持reset()" << std::endl;
+                return false;
+            }
+        }
+        long long expected = 1LL * TABLE_ROWS * TABLE_ROWS * (TABLE_ROWS + 1) / 2;
+        std::cout << "读取行数: " << result->getRowCount() << ", 求和: " << sum << std::endl;
+        return result->getRowCount() == 1000000ULL && sum == expected &&
+               !result->isStreamOpen() && !conn->hasActiveStream();
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool testCommandDuringStream() {
+    printTestHeader("测试流未读完时执行其他命令");
+
+    try {
+        PooledConnection conn = ConnectionPool::getInstance().acquire(3000);
+        auto result = conn->executeStreamingQuery(BIG_QUERY);
+        for (int i = 0; i < 100 && result->next(); i++) {
+        }
+
+        // 剩余的行先被读掉，然后执行新的查询
+        auto other = conn->executeQuery("SELECT 1 AS value");
+        if (!other->next() || other->getInt("value") != 1) {
+            return false;
+        }
+
+        try {
+            result->next();
+            std::cout << "被中断的结果集应该抛出异常" << std::endl;
+            return false;
+        } catch (const std::exception& e) {
+            std::cout << "捕获到预期异常: " << e.what() << std::endl;
+        }
+        return !conn->hasActiveStream();
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool testCloseEarly() {
+    printTestHeader("测试close()提前结束");
+
+    try {
+        PooledConnection conn = ConnectionPool::getInstance().acquire(3000);
+        auto result = conn->executeStreamingQuery(BIG_QUERY);
+        result->next();
+        result->close();
+        if (result->next() || conn->hasActiveStream()) {
+            return false;
+        }
+        auto other = conn->executeQuery("SELECT 2 AS value");
+        return other->next() && other->getInt("value") == 2;
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool testReleaseDuringStream() {
+    printTestHeader("测试流未读完就归还连接");
+
+    auto& pool = ConnectionPool::getInstance();
+    try {
+        QueryResultPtr result;
+        {
+            PooledConnection conn = pool.acquire(3000);
+            result = conn->executeStreamingQuery(BIG_QUERY);
+            result->next();
+        }
+        // 归还时流被取消，连接被关闭
+        std::cout << "归还后结果集是否仍然打开: " << result->isStreamOpen() << std::endl;
+        if (result->isStreamOpen()) {
+            return false;
+        }
+        try {
+            result->next();
+            return false;
+        } catch (const std::exception& e) {
+            std::cout << "捕获到预期异常: " << e.what() << std::endl;
+        }
+
+        // 被关闭的连接不会再被借出，连接池依然可用
+        PooledConnection next = pool.acquire(3000);
+        auto value = next->executeQuery("SELECT 3 AS value");
+        return value->next() && value->getInt("value") == 3;
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+int main() {
+    Logger::getInstance().init("", LogLevel::WARNING, true);
+
+    try {
+        PoolConfig config;
+        config.setConnectionLimits(1, 4, 1);
+        ConnectionPool::getInstance().initWithSingleDatabase(config, TEST_HOST, TEST_USER, TEST_PASSWORD, TEST_DATABASE, TEST_PORT);
+    } catch (const std::exception& e) {
+        std::cerr << "无法初始化连接池: " << e.what() << std::endl;
+        return 1;
+    }
+
+    if (!prepareTable()) {
+        ConnectionPool::getInstance().shutdown();
+        return 1;
+    }
+
+    std::vector<std::pair<std::string, bool>> results;
+    results.emplace_back("逐行读取一百万行", testReadAllRows());
+    results.emplace_back("流未读完时执行其他命令", testCommandDuringStream());
+    results.emplace_back("close()提前结束", testCloseEarly());
+    results.emplace_back("流未读完就归还连接", testReleaseDuringStream());
+
+    try {
+        PooledConnection conn = ConnectionPool::getInstance().acquire(3000);
+        conn->executeUpdate("DROP TABLE IF EXISTS test_stream");
+    } catch (const std::exception& e) {
+        std::cout << "清理测试表失败: " << e.what() << std::endl;
+    }
+
+    size_t passed = 0;
+    std::cout << "\n" << std::string(60, '*') << std::endl;
+    for (const auto& result : results) {
+        std::cout << (result.second ? "成功" : "失败") << " " << result.first << std::endl;
+        if (result.second) passed++;
+    }
+    std::cout << "\n通过: " << passed << "/" << results.size() << " 项测试" << std::endl;
+
+    ConnectionPool::getInstance().shutdown();
+    return (passed == results.size()) ? 0 : 1;
+}
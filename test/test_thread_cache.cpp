@@ -0,0 +1,258 @@
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <atomic>
+#include <stdexcept>
+#include "connection_pool.h"
+#include "pool_config.h"
+#include "logger.h"
+
+/**
+ * @brief 线程本地连接缓存测试
+ *
+ * 重点验证：
+ * 1. 同一线程归还后再借出拿到同一个连接，不经过共享的空闲连接
+ * 2. 连接池用完时，等待的线程收回其他线程留下的连接
+ * 3. 线程超过时限不再借出、线程退出后，留下的连接回到连接池
+ * 4. 多线程反复借出归还时连接总数不超过 maxConnections
+ * 5. 需要清理会话的连接不留在线程中，关闭连接池时线程留下的连接被关闭
+ */
+
+// 测试数据库连接参数
+const std::string TEST_HOST = "127.0.0.1";
+const std::string TEST_USER = "mxk";
+const std::string TEST_PASSWORD = "d2v8s2q3";
+const std::string TEST_DATABASE = "testdb";
+const unsigned int TEST_PORT = 3306;
+
+void printTestHeader(const std::string& title) {
+    std::cout << "\n" << std::string(60, '=') << std::endl;
+    std::cout << "  " << title << std::endl;
+    std::cout << std::string(60, '=') << std::endl;
+}
+
+PoolConfig makeConfig(unsigned int maxConnections) {
+    PoolConfig config;
+    config.setConnectionLimits(1, maxConnections, maxConnections);
+    config.threadLocalCache = true;
+    config.threadCacheIdleTimeout = 200;
+    config.connectionTimeout = 3000;
+    return config;
+}
+
+bool initPool(ConnectionPool& pool, const PoolConfig& config) {
+    try {
+        pool.initWithSingleDatabase(config, TEST_HOST, TEST_USER, TEST_PASSWORD, TEST_DATABASE, TEST_PORT);
+        return true;
+    } catch (const std::exception& e) {
+        std::cout << "连接池初始化失败: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+// 等待条件成立，超时返回false
+template <typename Condition>
+bool waitFor(Condition condition, int timeoutMillis) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMillis);
+    while (!condition()) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return true;
+}
+
+bool testReuseOnSameThread() {
+    printTestHeader("测试同一线程复用连接");
+
+    ConnectionPool pool("thread-cache-reuse");
+    if (!initPool(pool, makeConfig(2))) {
+        return false;
+    }
+    bool ok = true;
+    try {
+        ConnectionPtr first = pool.getConnection();
+        std::string id = first->getConnectionId();
+        pool.releaseConnection(first);
+        first.reset();
+        size_t idle = pool.getIdleCount();
+
+        const int rounds = 10000;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < rounds && ok; i++) {
+            PooledConnection conn = pool.acquire();
+            ok = conn->getConnectionId() == id;
+        }
+        int64_t avgNanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count() / rounds;
+        std::cout << "平均每次借出归还: " << avgNanos << " ns" << std::endl;
+
+        // 留在线程中的连接不在空闲连接里，算作活跃连接
+        std::cout << "空闲连接: " << pool.getIdleCount() << ", 活跃连接: " << pool.getActiveCount() << std::endl;
+        ok = ok && pool.getIdleCount() == idle && pool.getActiveCount() == 1;
+        ConnectionPtr conn = pool.getConnection();
+        ok = ok && conn->executeQuery("SELECT 1")->getRowCount() == 1;
+        pool.releaseConnection(conn);
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        ok = false;
+    }
+    pool.shutdown();
+    return ok;
+}
+
+bool testReclaimWhenDry() {
+    printTestHeader("测试连接池用完时收回");
+
+    ConnectionPool pool("thread-cache-dry");
+    if (!initPool(pool, makeConfig(1))) {
+        return false;
+    }
+    std::atomic<bool> parked{false};
+    std::atomic<bool> done{false};
+    std::string parkedId;
+    // 这个线程留下唯一的连接后一直不再借出
+    std::thread owner([&]() {
+        ConnectionPtr conn = pool.getConnection();
+        parkedId = conn->getConnectionId();
+        pool.releaseConnection(conn);
+        parked = true;
+        while (!done) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    });
+    bool ok = waitFor([&]() { return parked.load(); }, 3000);
+    try {
+        auto start = std::chrono::steady_clock::now();
+        PooledConnection conn = pool.acquire(1000);
+        int64_t waited = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        std::cout << "等待: " << waited << " ms, 连接总数: " << pool.getTotalCount() << std::endl;
+        ok = ok && conn->getConnectionId() == parkedId && waited < 100 && pool.getTotalCount() == 1;
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        ok = false;
+    }
+    done = true;
+    owner.join();
+    pool.shutdown();
+    return ok;
+}
+
+bool testIdleDeadline() {
+    printTestHeader("测试超过时限和线程退出后收回");
+
+    ConnectionPool pool("thread-cache-deadline");
+    if (!initPool(pool, makeConfig(2))) {
+        return false;
+    }
+    bool ok = true;
+    {
+        ConnectionPtr conn = pool.getConnection();
+        pool.releaseConnection(conn);
+    }
+    ok = pool.getActiveCount() == 1;
+    // 健康检查线程在 threadCacheIdleTimeout 的1.5倍内收回
+    ok = ok && waitFor([&]() { return pool.getActiveCount() == 0; }, 1000);
+    std::cout << "超时后活跃连接: " << pool.getActiveCount() << ", 空闲连接: " << pool.getIdleCount() << std::endl;
+
+    std::thread worker([&pool]() {
+        ConnectionPtr conn = pool.getConnection();
+        pool.releaseConnection(conn);
+    });
+    worker.join();
+    ok = ok && waitFor([&]() { return pool.getActiveCount() == 0; }, 1000);
+    std::cout << "线程退出后活跃连接: " << pool.getActiveCount() << std::endl;
+    pool.shutdown();
+    return ok;
+}
+
+bool testLimitUnderLoad() {
+    printTestHeader("测试多线程下的连接数上限");
+
+    const unsigned int maxConnections = 4;
+    ConnectionPool pool("thread-cache-load");
+    if (!initPool(pool, makeConfig(maxConnections))) {
+        return false;
+    }
+    std::atomic<size_t> failures{0};
+    std::atomic<size_t> maxSeen{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; t++) {
+        threads.emplace_back([&]() {
+            for (int i = 0; i < 200; i++) {
+                try {
+                    PooledConnection conn = pool.acquire();
+                    conn->executeQuery("SELECT 1");
+                    size_t total = pool.getTotalCount();
+                    size_t seen = maxSeen.load();
+                    while (total > seen && !maxSeen.compare_exchange_weak(seen, total)) {
+                    }
+                } catch (const std::exception& e) {
+                    failures++;
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    std::cout << "失败: " << failures.load() << ", 最多连接数: " << maxSeen.load() << std::endl;
+    bool ok = failures.load() == 0 && maxSeen.load() <= maxConnections;
+    pool.shutdown();
+    return ok && pool.getTotalCount() == 0;
+}
+
+bool testDirtySessionNotKept() {
+    printTestHeader("测试需要清理的会话不留在线程中");
+
+    ConnectionPool pool("thread-cache-dirty");
+    PoolConfig config = makeConfig(2);
+    config.asyncSessionReset = false;
+    if (!initPool(pool, config)) {
+        return false;
+    }
+    bool ok = true;
+    try {
+        ConnectionPtr conn = pool.getConnection();
+        conn->beginTransaction();
+        pool.releaseConnection(conn);
+        // 回滚后回到共享的空闲连接
+        ok = pool.getActiveCount() == 0 && !conn->isInTransaction();
+        conn.reset();
+
+        conn = pool.getConnection();
+        pool.releaseConnection(conn);
+        ok = ok && pool.getActiveCount() == 1;
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        ok = false;
+    }
+    // 线程留下的连接随连接池关闭
+    pool.shutdown();
+    std::cout << "关闭后连接总数: " << pool.getTotalCount() << std::endl;
+    return ok && pool.getTotalCount() == 0;
+}
+
+int main() {
+    Logger::getInstance().init("", LogLevel::WARNING, true);
+
+    std::vector<std::pair<std::string, bool>> results;
+    results.emplace_back("同一线程复用连接", testReuseOnSameThread());
+    results.emplace_back("连接池用完时收回", testReclaimWhenDry());
+    results.emplace_back("超过时限和线程退出后收回", testIdleDeadline());
+    results.emplace_back("多线程下的连接数上限", testLimitUnderLoad());
+    results.emplace_back("需要清理的会话不留在线程中", testDirtySessionNotKept());
+
+    size_t passed = 0;
+    std::cout << "\n" << std::string(60, '*') << std::endl;
+    for (const auto& result : results) {
+        std::cout << (result.second ? "成功" : "失败") << " " << result.first << std::endl;
+        if (result.second) passed++;
+    }
+    std::cout << "\n通过: " << passed << "/" << results.size() << " 项测试" << std::endl;
+
+    return (passed == results.size()) ? 0 : 1;
+}
@@ -0,0 +1,274 @@
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <tuple>
+#include <stdexcept>
+#include "connection_pool.h"
+#include "typed_rows.h"
+#include "pool_config.h"
+#include "logger.h"
+
+/**
+ * @brief 类型化行映射测试
+ *
+ * 重点验证：
+ * 1. 解码到std::tuple和映射过的结构体，NULL按getter的规则解码
+ * 2. 列数和列类型不匹配时一次性报错，超出范围的值报错
+ * 3. FieldView字段指向结果自带的字符串区，移动后仍然有效
+ * 4. 流式结果可以分批解码
+ * 5. 与逐个字段调用getter的耗时对比
+ * 6. 空字符串和NULL可以区分，解码失败的行不留在结果中
+ */
+
+// 测试数据库连接参数
+const std::string TEST_HOST = "127.0.0.1";
+const std::string TEST_USER = "mxk";
+const std::string TEST_PASSWORD = "d2v8s2q3";
+const std::string TEST_DATABASE = "testdb";
+const unsigned int TEST_PORT = 3306;
+
+struct Order {
+    long long id;
+    FieldView name;
+    double price;
+};
+
+template <>
+struct RowMapping<Order> {
+    static std::tuple<long long Order::*, FieldView Order::*, double Order::*> fields() {
+        return std::make_tuple(&Order::id, &Order::name, &Order::price);
+    }
+};
+
+void printTestHeader(const std::string& title) {
+    std::cout << "\n" << std::string(60, '=') << std::endl;
+    std::cout << "  " << title << std::endl;
+    std::cout << std::string(60, '=') << std::endl;
+}
+
+// id, name, price三列的内存结果集，name为空字符串时存NULL
+ResultRowsPtr makeOrders(size_t count) {
+    auto rows = std::make_shared<ResultRows>();
+    rows->fieldNames = {"id", "name", "price"};
+    rows->fieldTypes = {MYSQL_TYPE_LONGLONG, MYSQL_TYPE_VAR_STRING, MYSQL_TYPE_NEWDECIMAL};
+    for (size_t i = 0; i < count; i++) {
+        std::string id = std::to_string(i + 1);
+        std::string name = i % 10 == 9 ? "" : "order-" + std::to_string(i + 1);
+        std::string price = std::to_string(i + 1) + ".50";
+        rows->appendValue(id.data(), static_cast<unsigned long>(id.size()));
+        if (name.empty()) {
+            rows->appendNull();
+        } else {
+            rows->appendValue(name.data(), static_cast<unsigned long>(name.size()));
+        }
+        rows->appendValue(price.data(), static_cast<unsigned long>(price.size()));
+        rows->rowCount++;
+    }
+    return rows;
+}
+
+bool testDecode() {
+    printTestHeader("测试解码到tuple和结构体");
+
+    QueryResult tupleResult(makeOrders(10));
+    auto tuples = fetchRows<std::tuple<int, std::string, double>>(tupleResult);
+
+    TypedRows<Order> orders;
+    {
+        // 结果集释放之后，FieldView仍然指向orders自己的字符串区
+        QueryResult structResult(makeOrders(10));
+        TypedRows<Order> fetched = fetchRows<Order>(structResult);
+        orders = std::move(fetched);
+    }
+
+    bool ok = tuples.size() == 10 && orders.size() == 10;
+    ok = ok && std::get<0>(tuples[0]) == 1 && std::get<1>(tuples[0]) == "order-1" && std::get<2>(tuples[0]) == 1.5;
+    ok = ok && orders[4].id == 5 && orders[4].name == "order-5" && orders[4].price == 5.5;
+    // NULL：std::string为空，FieldView为null视图
+    ok = ok && std::get<1>(tuples[9]).empty() && orders[9].name.isNull();
+    std::cout << "第5行: " << orders[4].id << ", " << orders[4].name.toString() << ", " << orders[4].price
+              << ", 字符串区: " << orders.arenaBytes() << " 字节" << std::endl;
+    return ok;
+}
+
+bool testMismatch() {
+    printTestHeader("测试列数和类型不匹配");
+
+    int rejected = 0;
+    QueryResult result(makeOrders(1));
+    try {
+        // 列数不同
+        fetchRows<std::tuple<long long, std::string>>(result);
+    } catch (const std::invalid_argument& e) {
+        std::cout << "列数: " << e.what() << std::endl;
+        rejected++;
+    }
+    try {
+        // VARCHAR不能解码成整数，在读取任何一行之前报错
+        fetchRows<std::tuple<long long, long long, double>>(result);
+    } catch (const std::invalid_argument& e) {
+        std::cout << "类型: " << e.what() << std::endl;
+        rejected++;
+    }
+    try {
+        // DECIMAL不能解码成整数
+        fetchRows<std::tuple<long long, std::string, int>>(result);
+    } catch (const std::invalid_argument& e) {
+        std::cout << "类型: " << e.what() << std::endl;
+        rejected++;
+    }
+    bool untouched = result.getRowCount() == 1 && result.next();
+
+    auto big = std::make_shared<ResultRows>();
+    big->fieldNames = {"value"};
+    big->fieldTypes = {MYSQL_TYPE_LONGLONG};
+    big->appendValue("5000000000", 10);
+    big->rowCount = 1;
+    QueryResult bigResult(big);
+    try {
+        fetchRows<std::tuple<int>>(bigResult);
+    } catch (const std::out_of_range& e) {
+        std::cout << "范围: " << e.what() << std::endl;
+        rejected++;
+    }
+    return rejected == 4 && untouched;
+}
+
+bool testEmptyAndFailedRows() {
+    printTestHeader("测试空字符串与解码失败的行");
+
+    // 第一个字符串就是空字符串，此时字符串区还没有分配任何内存
+    auto rows = std::make_shared<ResultRows>();
+    rows->fieldNames = {"id", "name"};
+    rows->fieldTypes = {MYSQL_TYPE_LONGLONG, MYSQL_TYPE_VAR_STRING};
+    rows->appendValue("1", 1);
+    rows->appendValue("", 0);
+    rows->appendValue("2", 1);
+    rows->appendNull();
+    rows->appendValue("5000000000", 10);
+    rows->appendValue("x", 1);
+    rows->rowCount = 3;
+
+    QueryResult result(rows);
+    RowDecoder<std::tuple<int, FieldView>> decoder(result);
+    TypedRows<std::tuple<int, FieldView>> batch;
+    bool overflow = false;
+    try {
+        decoder.fetch(result, batch);
+    } catch (const std::out_of_range& e) {
+        std::cout << "范围: " << e.what() << std::endl;
+        overflow = true;
+    }
+    std::cout << "解码的行: " << batch.size() << std::endl;
+    return overflow && batch.size() == 2 && !std::get<1>(batch[0]).isNull() && std::get<1>(batch[0]).empty() &&
+           std::get<1>(batch[1]).isNull();
+}
+
+bool testBatches() {
+    printTestHeader("测试分批解码");
+
+    QueryResult result(makeOrders(25));
+    RowDecoder<Order> decoder(result);
+    TypedRows<Order> batch;
+    std::vector<size_t> sizes;
+    size_t count = 0;
+    while ((count = decoder.fetch(result, batch, 10)) > 0) {
+        sizes.push_back(count);
+    }
+    std::cout << "批次: " << sizes.size() << ", 总行数: " << batch.size() << std::endl;
+    return sizes == std::vector<size_t>({10, 10, 5}) && batch.size() == 25 && batch[24].id == 25;
+}
+
+bool testThroughput() {
+    printTestHeader("测试解码耗时");
+
+    const size_t rowCount = 200000;
+    ResultRowsPtr rows = makeOrders(rowCount);
+
+    auto start = std::chrono::steady_clock::now();
+    QueryResult getterResult(rows);
+    double getterTotal = 0;
+    while (getterResult.next()) {
+        getterTotal += getterResult.getLong(0) + getterResult.getDouble(2) + getterResult.getString(1).size();
+    }
+    auto getterMicros = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+
+    // 分批解码并复用同一块内存，和getter一样不需要保存所有行
+    start = std::chrono::steady_clock::now();
+    QueryResult typedResult(rows);
+    RowDecoder<Order> decoder(typedResult);
+    TypedRows<Order> batch;
+    double typedTotal = 0;
+    while (decoder.fetch(typedResult, batch, 1024) > 0) {
+        for (const auto& order : batch) {
+            typedTotal += order.id + order.price + order.name.size();
+        }
+        batch.clear();
+    }
+    auto typedMicros = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+
+    std::cout << rowCount << " 行, getter: " << getterMicros << "us, 类型化解码: " << typedMicros << "us" << std::endl;
+    return getterTotal == typedTotal;
+}
+
+bool testQuery(ConnectionPool& pool) {
+    printTestHeader("测试Connection::query");
+
+    try {
+        PooledConnection conn = pool.acquire();
+        auto rows = conn->query<std::tuple<long long, FieldView, double>>(
+            "SELECT 1, 'first', 1.25 UNION ALL SELECT 2, NULL, 2.5");
+
+        auto stream = conn->executeStreamingQuery("SELECT 1 AS id, 'first' AS name, 1.25 AS price");
+        TypedRows<Order> orders = fetchRows<Order>(*stream);
+
+        bool mismatch = false;
+        try {
+            conn->query<std::tuple<int, int, double>>("SELECT 1, 'text', 2.5");
+        } catch (const std::invalid_argument& e) {
+            std::cout << "类型检查: " << e.what() << std::endl;
+            mismatch = true;
+        }
+        std::cout << "行数: " << rows.size() << ", 流式行数: " << orders.size() << std::endl;
+        return rows.size() == 2 && std::get<1>(rows[0]) == "first" && std::get<1>(rows[1]).isNull() &&
+               std::get<2>(rows[1]) == 2.5 && orders.size() == 1 && orders[0].name == "first" && mismatch;
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+int main() {
+    Logger::getInstance().init("", LogLevel::WARNING, true);
+
+    std::vector<std::pair<std::string, bool>> results;
+    results.emplace_back("解码到tuple和结构体", testDecode());
+    results.emplace_back("列数和类型不匹配", testMismatch());
+    results.emplace_back("空字符串与解码失败的行", testEmptyAndFailedRows());
+    results.emplace_back("分批解码", testBatches());
+    results.emplace_back("解码耗时", testThroughput());
+
+    ConnectionPool pool("typed-rows");
+    try {
+        PoolConfig config;
+        config.setConnectionLimits(1, 2, 1);
+        pool.initWithSingleDatabase(config, TEST_HOST, TEST_USER, TEST_PASSWORD, TEST_DATABASE, TEST_PORT);
+        results.emplace_back("Connection::query", testQuery(pool));
+    } catch (const std::exception& e) {
+        std::cout << "连接池初始化失败: " << e.what() << std::endl;
+        results.emplace_back("连接池初始化", false);
+    }
+    pool.shutdown();
+
+    size_t passed = 0;
+    std::cout << "\n" << std::string(60, '*') << std::endl;
+    for (const auto& result : results) {
+        std::cout << (result.second ? "成功" : "失败") << " " << result.first << std::endl;
+        if (result.second) passed++;
+    }
+    std::cout << "\n通过: " << passed << "/" << results.size() << " 项测试" << std::endl;
+
+    return (passed == results.size()) ? 0 : 1;
+}
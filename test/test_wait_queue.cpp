@@ -0,0 +1,238 @@
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <stdexcept>
+#include "connection_pool.h"
+#include "pool_config.h"
+#include "logger.h"
+
+/**
+ * @brief 等待队列测试
+ *
+ * 连接池只有一个连接，重点验证：
+ * 1. 排队的线程按到达顺序拿到连接
+ * 2. 高优先级的线程排在低优先级之前
+ * 3. 超时按毫秒计算，超时次数被统计
+ * 4. 队列达到 maxWaitQueueLength 或预计等待超过超时时间时立即失败
+ */
+
+// 测试数据库连接参数
+const std::string TEST_HOST = "127.0.0.1";
+const std::string TEST_USER = "mxk";
+const std::string TEST_PASSWORD = "d2v8s2q3";
+const std::string TEST_DATABASE = "testdb";
+const unsigned int TEST_PORT = 3306;
+
+void printTestHeader(const std::string& title) {
+    std::cout << "\n" << std::string(60, '=') << std::endl;
+    std::cout << "  " << title << std::endl;
+    std::cout << std::string(60, '=') << std::endl;
+}
+
+int64_t elapsedMs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+// 只有一个连接的连接池
+void initSingleConnection(ConnectionPool& pool, PoolConfig config = PoolConfig()) {
+    config.setConnectionLimits(1, 1, 1);
+    pool.initWithSingleDatabase(config, TEST_HOST, TEST_USER, TEST_PASSWORD, TEST_DATABASE, TEST_PORT);
+}
+
+// 在连接被占用时依次启动线程排队，归还后记录它们拿到连接的顺序
+std::vector<int> servedOrder(ConnectionPool& pool, const std::vector<AcquirePriority>& priorities) {
+    std::mutex mutex;
+    std::vector<int> order;
+    std::vector<std::thread> threads;
+    PooledConnection holder = pool.acquire();
+    for (size_t i = 0; i < priorities.size(); i++) {
+        AcquirePriority priority = priorities[i];
+        threads.emplace_back([&pool, &mutex, &order, i, priority]() {
+            PooledConnection conn = pool.acquire(AccessMode::READ_WRITE, 5000, priority);
+            std::lock_guard<std::mutex> lock(mutex);
+            order.push_back(static_cast<int>(i));
+        });
+        // 保证到达顺序
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    holder.reset();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    return order;
+}
+
+bool testFifo() {
+    printTestHeader("测试按到达顺序分配连接");
+
+    ConnectionPool pool("fifo");
+    try {
+        initSingleConnection(pool);
+        std::vector<int> order = servedOrder(pool, std::vector<AcquirePriority>(6, AcquirePriority::NORMAL));
+        std::cout << "顺序:";
+        for (int i : order) {
+            std::cout << " " << i;
+        }
+        std::cout << std::endl;
+        return order == std::vector<int>{0, 1, 2, 3, 4, 5} &&
+               pool.getPerformanceMonitor().getStats().queuedAcquires == 6;
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool testPriority() {
+    printTestHeader("测试优先级");
+
+    ConnectionPool pool("priority");
+    try {
+        initSingleConnection(pool);
+        std::vector<int> order = servedOrder(pool, {AcquirePriority::LOW, AcquirePriority::NORMAL,
+                                                    AcquirePriority::LOW, AcquirePriority::HIGH});
+        std::cout << "顺序:";
+        for (int i : order) {
+            std::cout << " " << i;
+        }
+        std::cout << std::endl;
+        return order == std::vector<int>{3, 1, 0, 2};
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool testTimeout() {
+    printTestHeader("测试超时（毫秒）");
+
+    ConnectionPool pool("timeout");
+    try {
+        initSingleConnection(pool);
+        PooledConnection holder = pool.acquire();
+        auto start = std::chrono::steady_clock::now();
+        try {
+            pool.acquire(AccessMode::READ_WRITE, 150);
+            return false;
+        } catch (const std::exception& e) {
+            std::cout << "等待 " << elapsedMs(start) << "ms 后: " << e.what() << std::endl;
+        }
+        int64_t waited = elapsedMs(start);
+        PerformanceStats stats = pool.getPerformanceMonitor().getStats();
+        return waited >= 140 && waited < 1000 && stats.acquireTimeouts == 1 && stats.queuedAcquires == 1 &&
+               pool.getPerformanceMonitor().getLatencyPercentile(LatencyMetric::QUEUE_WAIT, 50) >= 140000;
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool testQueueLimit() {
+    printTestHeader("测试队列长度上限");
+
+    ConnectionPool pool("limit");
+    try {
+        PoolConfig config;
+        config.maxWaitQueueLength = 2;
+        initSingleConnection(pool, config);
+        PooledConnection holder = pool.acquire();
+
+        std::vector<std::thread> waiters;
+        for (int i = 0; i < 2; i++) {
+            waiters.emplace_back([&pool]() {
+                pool.acquire(AccessMode::READ_WRITE, 5000);
+            });
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+        bool rejected = false;
+        auto start = std::chrono::steady_clock::now();
+        try {
+            pool.acquire(AccessMode::READ_WRITE, 5000);
+        } catch (const std::exception& e) {
+            rejected = true;
+            std::cout << "立即失败: " << e.what() << std::endl;
+        }
+        int64_t waited = elapsedMs(start);
+
+        holder.reset();
+        for (auto& waiter : waiters) {
+            waiter.join();
+        }
+        return rejected && waited < 100 && pool.getPerformanceMonitor().getStats().rejectedAcquires == 1 &&
+               pool.getMetrics().backends[0].waiters == 0;
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool testFailFast() {
+    printTestHeader("测试按预计等待时间立即失败");
+
+    ConnectionPool pool("fail-fast");
+    try {
+        PoolConfig config;
+        config.failFastOnEstimatedWait = true;
+        initSingleConnection(pool, config);
+
+        // 三个线程轮流持有唯一的连接 30ms，队列一直不空
+        std::atomic<bool> stop(false);
+        std::vector<std::thread> workers;
+        for (int i = 0; i < 3; i++) {
+            workers.emplace_back([&pool, &stop]() {
+                while (!stop) {
+                    PooledConnection conn = pool.acquire(AccessMode::READ_WRITE, 5000);
+                    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+                }
+            });
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(400));
+
+        // 前面至少有一个线程在排队，预计要等 60ms 以上
+        bool rejected = false;
+        auto start = std::chrono::steady_clock::now();
+        try {
+            pool.acquire(AccessMode::READ_WRITE, 20);
+        } catch (const std::exception& e) {
+            rejected = true;
+            std::cout << "立即失败: " << e.what() << std::endl;
+        }
+        int64_t waited = elapsedMs(start);
+
+        stop = true;
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        PerformanceStats stats = pool.getPerformanceMonitor().getStats();
+        std::cout << "等待 " << waited << "ms, 拒绝 " << stats.rejectedAcquires << " 次, 超时 "
+                  << stats.acquireTimeouts << " 次" << std::endl;
+        return rejected && waited < 20 && stats.rejectedAcquires == 1 && stats.acquireTimeouts == 0;
+    } catch (const std::exception& e) {
+        std::cout << "测试失败: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+int main() {
+    Logger::getInstance().init("", LogLevel::WARNING, true);
+
+    std::vector<std::pair<std::string, bool>> results;
+    results.emplace_back("按到达顺序分配连接", testFifo());
+    results.emplace_back("优先级", testPriority());
+    results.emplace_back("超时（毫秒）", testTimeout());
+    results.emplace_back("队列长度上限", testQueueLimit());
+    results.emplace_back("按预计等待时间立即失败", testFailFast());
+
+    size_t passed = 0;
+    std::cout << "\n" << std::string(60, '*') << std::endl;
+    for (const auto& result : results) {
+        std::cout << (result.second ? "成功" : "失败") << " " << result.first << std::endl;
+        if (result.second) passed++;
+    }
+    std::cout << "\n通过: " << passed << "/" << results.size() << " 项测试" << std::endl;
+
+    return (passed == results.size()) ? 0 : 1;
+}